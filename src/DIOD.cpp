@@ -21,6 +21,8 @@
 
 #include "plugin.hpp"
 #include "diode.h"
+#include "paramcache.h"
+#include "controlrate.h"
 
 struct DIOD : Module {
   enum ParamIds {
@@ -48,11 +50,28 @@ struct DIOD : Module {
 
   int _oversampling = 4;
   int _decimatorOrder = 16;
+  DSPPrecision _precision = DSP_PRECISION_FLOAT;
+  int _controlRate = 16;
+  bool _controlRateNoise = false;
   
   DiodeIntegrationMethod _integrationMethod = DIODE_PREDICTOR_CORRECTOR_FULL_TANH;
   
-  // create ladder class instances
-  Diode diode[16];
+  // create diode class instances, four voices each
+  DiodeX4 diode[4];
+
+  // double precision voices, one per channel
+  Diode diodeDouble[16];
+
+  // gain normalization follows the resonance knob
+  ParamCache gainNormalizationParam;
+
+  // cutoff and resonance knobs are sampled at control rate
+  // and ramped linearly in between, cv stays at audio rate
+  ControlRateDivider controlDivider;
+  ControlRamp cutoffRamp;
+  ControlRamp resoRamp;
+  float cutoffTarget = 0.f;
+  float resoTarget = 0.f;
   
   DIOD() {
     config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -79,18 +98,12 @@ struct DIOD : Module {
     }    
     
     // parameters
-    float cutoff = params[FREQ_PARAM].getValue();
-    float reso = params[RESO_PARAM].getValue();
     float gain = params[GAIN_PARAM].getValue();
     float lincv_atten = params[LINCV_ATTEN_PARAM].getValue();
     float expcv_atten = params[EXPCV_ATTEN_PARAM].getValue();
     DiodeFilterMode filterMode;
 
-    // gain normalization
-    float gainNormalization = 1.f + 6.f * std::log(1.f + 0.75f * reso);
-
     // shape panel input for a pseudoexponential response
-    cutoff = 0.001+2.25*(cutoff * cutoff * cutoff * cutoff);
     gain = 32.f*(gain * gain * gain * gain)/10.f;    
     lincv_atten *= lincv_atten*lincv_atten;
     expcv_atten *= expcv_atten*expcv_atten;
@@ -98,39 +111,123 @@ struct DIOD : Module {
     // filter mode
     filterMode = (DiodeFilterMode)(params[MODE_PARAM].getValue());
     
-    for(int ii = 0; ii < channels; ii++){    
-      float channelCutoff = cutoff;
+    // sample and shape cutoff and resonance knobs at control rate
+    bool controlTick = controlDivider.Tick(_controlRate);
+    if(controlTick){
+      float cutoffKnob = params[FREQ_PARAM].getValue();
+      cutoffTarget = 0.001+2.25*(cutoffKnob * cutoffKnob * cutoffKnob * cutoffKnob);
+      resoTarget = params[RESO_PARAM].getValue();
+      cutoffRamp.SetTarget(cutoffTarget, _controlRate);
+      resoRamp.SetTarget(resoTarget, _controlRate);
+    }
+    float cutoff = cutoffRamp.Next();
+    float reso = resoRamp.Next();
+    
+    // gain normalization follows the ramped resonance
+    float gainNormalization = gainNormalizationParam.Get(reso, [](float x){
+	return 1.f + 6.f * std::log(1.f + 0.75f * x);
+      });
+
+    // without cutoff cv the voices compute their integration rate on
+    // control ticks and ramp it themselves, patched cv stays at audio rate
+    bool cvPatched = inputs[LINCV_INPUT].isConnected() || inputs[EXPCV_INPUT].isConnected();
+    
+    // with mono cv inputs all voices share
+    // the same cutoff, compute it once per sample
+    bool monoCV = inputs[LINCV_INPUT].getChannels() <= 1 && inputs[EXPCV_INPUT].getChannels() <= 1;
+    if(cvPatched && monoCV){
+      cutoff += 2.0f*lincv_atten*inputs[LINCV_INPUT].getVoltage()/10.f;
+      cutoff *= FloatExp2(expcv_atten*inputs[EXPCV_INPUT].getVoltage());
+    }
+    
+    // process four channels per filter instance
+    for(int ii = 0; ii < channels; ii += 4){
+      float channelCutoff[4];
+      float channelExpCV[4];
+      float channelInput[4];
+      float channelOutput[4];
       
-      // sum in linear cv
-      if(inputs[LINCV_INPUT].getChannels() == 1){
-	channelCutoff += 2.0f*lincv_atten*inputs[LINCV_INPUT].getVoltage()/10.f;
+      for(int jj = 0; jj < 4; jj++){
+	int ch = ii + jj;
+	
+	channelCutoff[jj] = cutoff;
+
+	if(!monoCV){
+	  // sum in linear cv
+	  if(inputs[LINCV_INPUT].getChannels() == 1){
+	    channelCutoff[jj] += 2.0f*lincv_atten*inputs[LINCV_INPUT].getVoltage()/10.f;
+	  }
+	  else{
+	    channelCutoff[jj] += 2.0f*lincv_atten*inputs[LINCV_INPUT].getVoltage(ch)/10.f;
+	  }
+	
+	  // exponential cv
+	  if(inputs[EXPCV_INPUT].getChannels() == 1){
+	    channelExpCV[jj] = expcv_atten*inputs[EXPCV_INPUT].getVoltage();
+	  }
+	  else{
+	    channelExpCV[jj] = expcv_atten*inputs[EXPCV_INPUT].getVoltage(ch);
+	  }
+	}
+
+	// unused lanes run silent
+	channelInput[jj] = ch < channels ? inputs[INPUT_INPUT].getVoltage(ch) * gain : 0.f;
       }
-      else{
-	channelCutoff += 2.0f*lincv_atten*inputs[LINCV_INPUT].getVoltage(ii)/10.f;
+
+      // apply exponential cv to all four lanes at once
+      if(!monoCV){
+	Float4Store(channelCutoff, Float4Load(channelCutoff) * Float4Exp2(Float4Load(channelExpCV)));
       }
       
-      // apply exponential cv
-      if(inputs[EXPCV_INPUT].getChannels() == 1){
-	channelCutoff = channelCutoff * std::pow(2.f, expcv_atten*inputs[EXPCV_INPUT].getVoltage());
+      if(_precision == DSP_PRECISION_DOUBLE){
+	// double precision voices tick one channel at a time
+	for(int jj = 0; jj < 4 && ii + jj < channels; jj++){
+	  if(cvPatched){
+	    diodeDouble[ii + jj].SetFilterCutoff((double)(channelCutoff[jj]));
+	    diodeDouble[ii + jj].SetFilterResonance((double)(reso));
+	  }
+	  else if(controlTick){
+	    diodeDouble[ii + jj].SetFilterControlRamp((double)(cutoffTarget), (double)(resoTarget), _controlRate);
+	  }
+	  diodeDouble[ii + jj].SetFilterMode(filterMode);
+	  diodeDouble[ii + jj].DiodeFilter(channelInput[jj]);
+	  channelOutput[jj] = (float)(diodeDouble[ii + jj].GetFilterOutput() * 6.f * gainNormalization);
+	}
       }
       else{
-	channelCutoff = channelCutoff * std::pow(2.f, expcv_atten*inputs[EXPCV_INPUT].getVoltage(ii));
+	// set filter parameters
+	if(cvPatched){
+	  diode[ii/4].SetFilterCutoff(Float4Load(channelCutoff));
+	  diode[ii/4].SetFilterResonance(Float4(reso));
+	}
+	else if(controlTick){
+	  diode[ii/4].SetFilterControlRamp(Float4(cutoffTarget), Float4(resoTarget), _controlRate);
+	}
+	diode[ii/4].SetFilterMode(filterMode);
+    
+	// tick filter state
+	diode[ii/4].DiodeFilter(Float4Load(channelInput));
+      
+	// set output
+	Float4Store(channelOutput, diode[ii/4].GetFilterOutput() * (6.f * gainNormalization));
       }
       
-      // set filter parameters
-      diode[ii].SetFilterCutoff((double)(channelCutoff));
-      diode[ii].SetFilterResonance((double)(reso));
-      diode[ii].SetFilterMode(filterMode);
+      for(int jj = 0; jj < 4 && ii + jj < channels; jj++){
+	outputs[OUTPUT_OUTPUT].setVoltage(channelOutput[jj], ii + jj);
+      }
+    }
     
-      // tick filter state
-#ifdef FLOATDSP
-      diode[ii].DiodeFilter((float)(inputs[INPUT_INPUT].getVoltage(ii) * gain));
-#else
-      diode[ii].DiodeFilter((double)(inputs[INPUT_INPUT].getVoltage(ii) * gain));
-#endif
-
-      // set output
-      outputs[OUTPUT_OUTPUT].setVoltage((float)(diode[ii].GetFilterOutput() * 6.f * gainNormalization), ii);
+    // idle voices jump to the control targets so that they
+    // start from the current knob settings once they run
+    if(controlTick && !cvPatched){
+      int activeX4 = _precision == DSP_PRECISION_DOUBLE ? 0 : (channels + 3) / 4;
+      int activeDouble = _precision == DSP_PRECISION_DOUBLE ? channels : 0;
+      for(int ii = activeX4; ii < 4; ii++){
+	diode[ii].SetFilterControlRamp(Float4(cutoffTarget), Float4(resoTarget), 1);
+      }
+      for(int ii = activeDouble; ii < 16; ii++){
+	diodeDouble[ii].SetFilterControlRamp((double)(cutoffTarget), (double)(resoTarget), 1);
+      }
     }
     
     // set output to be polyphonic
@@ -140,38 +237,65 @@ struct DIOD : Module {
   void onSampleRateChange() override {
     float sr = APP->engine->getSampleRate();
     
-    for(int ii = 0; ii < 16; ii++){    
+    for(int ii = 0; ii < 4; ii++){    
       diode[ii].SetFilterSampleRate(sr);
     }
+    for(int ii = 0; ii < 16; ii++){    
+      diodeDouble[ii].SetFilterSampleRate(sr);
+    }
   }
 
   void onReset() override {
     float sr = APP->engine->getSampleRate();
     
-    for(int ii = 0; ii < 16; ii++){    
+    for(int ii = 0; ii < 4; ii++){    
       diode[ii].ResetFilterState();
-      diode[ii].SetFilterCutoff((double)(0.25));
-      diode[ii].SetFilterResonance((double)(0.0));
+      diode[ii].SetFilterCutoff(Float4(0.25f));
+      diode[ii].SetFilterResonance(Float4(0.0f));
       diode[ii].SetFilterMode(DIODE_LOWPASS4_MODE);
       diode[ii].SetFilterSampleRate(sr);
       diode[ii].SetFilterIntegrationMethod(_integrationMethod);
       diode[ii].SetFilterOversamplingFactor(_oversampling);
       diode[ii].SetFilterDecimatorOrder(_decimatorOrder);
+      diode[ii].SetFilterControlRateNoise(_controlRateNoise);
+    }
+    for(int ii = 0; ii < 16; ii++){    
+      diodeDouble[ii].ResetFilterState();
+      diodeDouble[ii].SetFilterCutoff(0.25f);
+      diodeDouble[ii].SetFilterResonance(0.0f);
+      diodeDouble[ii].SetFilterMode(DIODE_LOWPASS4_MODE);
+      diodeDouble[ii].SetFilterSampleRate(sr);
+      diodeDouble[ii].SetFilterIntegrationMethod(_integrationMethod);
+      diodeDouble[ii].SetFilterOversamplingFactor(_oversampling);
+      diodeDouble[ii].SetFilterDecimatorOrder(_decimatorOrder);
+      diodeDouble[ii].SetFilterControlRateNoise(_controlRateNoise);
     }
   }
 
   void onAdd() override {
     float sr = APP->engine->getSampleRate();
     
-    for(int ii = 0; ii < 16; ii++){
+    for(int ii = 0; ii < 4; ii++){
       diode[ii].ResetFilterState();
-      diode[ii].SetFilterCutoff((double)(0.25));
-      diode[ii].SetFilterResonance((double)(0.0));
+      diode[ii].SetFilterCutoff(Float4(0.25f));
+      diode[ii].SetFilterResonance(Float4(0.0f));
       diode[ii].SetFilterMode(DIODE_LOWPASS4_MODE);
       diode[ii].SetFilterSampleRate(sr);
       diode[ii].SetFilterIntegrationMethod(_integrationMethod);
       diode[ii].SetFilterOversamplingFactor(_oversampling);
       diode[ii].SetFilterDecimatorOrder(_decimatorOrder);
+      diode[ii].SetFilterControlRateNoise(_controlRateNoise);
+    }
+    for(int ii = 0; ii < 16; ii++){
+      diodeDouble[ii].ResetFilterState();
+      diodeDouble[ii].SetFilterCutoff(0.25f);
+      diodeDouble[ii].SetFilterResonance(0.0f);
+      diodeDouble[ii].SetFilterMode(DIODE_LOWPASS4_MODE);
+      diodeDouble[ii].SetFilterSampleRate(sr);
+      diodeDouble[ii].SetFilterIntegrationMethod(_integrationMethod);
+      diodeDouble[ii].SetFilterOversamplingFactor(_oversampling);
+      diodeDouble[ii].SetFilterDecimatorOrder(_decimatorOrder);
+      diodeDouble[ii].SetFilterControlRateNoise(_controlRateNoise);
     }
   }
 
@@ -181,18 +305,34 @@ struct DIOD : Module {
     json_object_set_new(rootJ, "oversampling", json_integer(_oversampling));
     json_object_set_new(rootJ, "decimatorOrder", json_integer(_decimatorOrder));
     json_object_set_new(rootJ, "integrationMethod", json_integer((int)(_integrationMethod)));
+    json_object_set_new(rootJ, "precision", json_integer((int)(_precision)));
+    json_object_set_new(rootJ, "controlRate", json_integer(_controlRate));
+    json_object_set_new(rootJ, "controlRateNoise", json_boolean(_controlRateNoise));
     
     return rootJ;
   }
 
   void dataFromJson(json_t* rootJ) override {
+    // patches saved before the precision option ran in double
+    json_t* precisionJ = json_object_get(rootJ, "precision");
+    _precision = precisionJ ? (DSPPrecision)(json_integer_value(precisionJ)) : DSP_PRECISION_DOUBLE;
+
+    // patches saved before the control rate option ran at audio rate
+    json_t* controlRateJ = json_object_get(rootJ, "controlRate");
+    _controlRate = controlRateJ ? json_integer_value(controlRateJ) : 1;
+
+    // clamp to the rates offered in the menu
+    _controlRate = (_controlRate <= 1 ? 1 : _controlRate <= 8 ? 8 : _controlRate <= 16 ? 16 : 32);
+
     json_t* integrationMethodJ = json_object_get(rootJ, "integrationMethod");
     if (integrationMethodJ && (_integrationMethod != (DiodeIntegrationMethod)(json_integer_value(integrationMethodJ)))) {
       _integrationMethod = (DiodeIntegrationMethod)(json_integer_value(integrationMethodJ));
       
       // set new integration method
-      for(int ii = 0; ii < 16; ii++)
+      for(int ii = 0; ii < 4; ii++)
 	diode[ii].SetFilterIntegrationMethod(_integrationMethod);
+      for(int ii = 0; ii < 16; ii++)
+	diodeDouble[ii].SetFilterIntegrationMethod(_integrationMethod);
     }
     
     json_t* oversamplingJ = json_object_get(rootJ, "oversampling");
@@ -200,8 +340,10 @@ struct DIOD : Module {
       _oversampling = json_integer_value(oversamplingJ);
 
       // set new oversampling factor
-      for(int ii = 0; ii < 16; ii++)
+      for(int ii = 0; ii < 4; ii++)
 	diode[ii].SetFilterOversamplingFactor(_oversampling);
+      for(int ii = 0; ii < 16; ii++)
+	diodeDouble[ii].SetFilterOversamplingFactor(_oversampling);
     }
     
     json_t* decimatorOrderJ = json_object_get(rootJ, "decimatorOrder");
@@ -209,8 +351,21 @@ struct DIOD : Module {
       _decimatorOrder = json_integer_value(decimatorOrderJ);
 
       // set new decimator order
-      for(int ii = 0; ii < 16; ii++)
+      for(int ii = 0; ii < 4; ii++)
 	diode[ii].SetFilterDecimatorOrder(_decimatorOrder);
+      for(int ii = 0; ii < 16; ii++)
+	diodeDouble[ii].SetFilterDecimatorOrder(_decimatorOrder);
+    }
+
+    json_t* controlRateNoiseJ = json_object_get(rootJ, "controlRateNoise");
+    if (controlRateNoiseJ) {
+      _controlRateNoise = json_is_true(controlRateNoiseJ);
+
+      // set thermal noise rate
+      for(int ii = 0; ii < 4; ii++)
+	diode[ii].SetFilterControlRateNoise(_controlRateNoise);
+      for(int ii = 0; ii < 16; ii++)
+	diodeDouble[ii].SetFilterControlRateNoise(_controlRateNoise);
     }
   }
 };
@@ -254,9 +409,12 @@ struct DIODWidget : ModuleWidget {
 
     void onAction(const event::Action& e) override {
       _module->_oversampling = _oversampling;
-      for(int ii = 0; ii < 16; ii++){    
+      for(int ii = 0; ii < 4; ii++){    
 	_module->diode[ii].SetFilterOversamplingFactor(_module->_oversampling);
       }
+      for(int ii = 0; ii < 16; ii++){    
+	_module->diodeDouble[ii].SetFilterOversamplingFactor(_module->_oversampling);
+      }
     }
 
     void step() override {
@@ -278,9 +436,12 @@ struct DIODWidget : ModuleWidget {
 
     void onAction(const event::Action& e) override {
       _module->_decimatorOrder = _decimatorOrder;
-      for(int ii = 0; ii < 16; ii++){    
+      for(int ii = 0; ii < 4; ii++){    
 	_module->diode[ii].SetFilterDecimatorOrder(_module->_decimatorOrder);
       }
+      for(int ii = 0; ii < 16; ii++){    
+	_module->diodeDouble[ii].SetFilterDecimatorOrder(_module->_decimatorOrder);
+      }
     }
 
     void step() override {
@@ -302,9 +463,12 @@ struct DIODWidget : ModuleWidget {
 
     void onAction(const event::Action& e) override {
       _module->_integrationMethod = (DiodeIntegrationMethod)(_integrationMethod);
-      for(int ii = 0; ii < 16; ii++){    
+      for(int ii = 0; ii < 4; ii++){    
 	_module->diode[ii].SetFilterIntegrationMethod(_module->_integrationMethod);
       }
+      for(int ii = 0; ii < 16; ii++){    
+	_module->diodeDouble[ii].SetFilterIntegrationMethod(_module->_integrationMethod);
+      }
     }
 
     void step() override {
@@ -313,16 +477,93 @@ struct DIODWidget : ModuleWidget {
     }
   };
   
+  struct ControlRateNoiseMenuItem : MenuItem {
+    DIOD* _module;
+
+    ControlRateNoiseMenuItem(DIOD* module, const char* label)
+      : _module(module)
+    {
+      this->text = label;
+    }
+
+    void onAction(const event::Action& e) override {
+      _module->_controlRateNoise = !_module->_controlRateNoise;
+      for(int ii = 0; ii < 4; ii++){    
+	_module->diode[ii].SetFilterControlRateNoise(_module->_controlRateNoise);
+      }
+      for(int ii = 0; ii < 16; ii++){    
+	_module->diodeDouble[ii].SetFilterControlRateNoise(_module->_controlRateNoise);
+      }
+    }
+
+    void step() override {
+      MenuItem::step();
+      rightText = _module->_controlRateNoise ? "✔" : "";
+    }
+  };
+  
+  struct PrecisionMenuItem : MenuItem {
+    DIOD* _module;
+    const int _precision;
+
+    PrecisionMenuItem(DIOD* module, const char* label, DSPPrecision precision)
+      : _module(module)
+      , _precision(precision)
+    {
+      this->text = label;
+    }
+
+    void onAction(const event::Action& e) override {
+      // voices of the new precision start from rest
+      for(int ii = 0; ii < 4; ii++){    
+	_module->diode[ii].ResetFilterState();
+      }
+      for(int ii = 0; ii < 16; ii++){    
+	_module->diodeDouble[ii].ResetFilterState();
+      }
+      _module->_precision = (DSPPrecision)(_precision);
+    }
+
+    void step() override {
+      MenuItem::step();
+      rightText = _module->_precision == _precision ? "✔" : "";
+    }
+  };
+  
+  struct ControlRateMenuItem : MenuItem {
+    DIOD* _module;
+    const int _controlRate;
+
+    ControlRateMenuItem(DIOD* module, const char* label, int controlRate)
+      : _module(module)
+      , _controlRate(controlRate)
+    {
+      this->text = label;
+    }
+
+    void onAction(const event::Action& e) override {
+      _module->_controlRate = _controlRate;
+    }
+
+    void step() override {
+      MenuItem::step();
+      rightText = _module->_controlRate == _controlRate ? "✔" : "";
+    }
+  };
+  
   void appendContextMenu(Menu* menu) override {
     DIOD* a = dynamic_cast<DIOD*>(module);
     assert(a);
     
     menu->addChild(new MenuSeparator());
     menu->addChild(createMenuLabel("Oversampling"));
+    menu->addChild(new OversamplingMenuItem(a, "Oversampling: auto", OVERSAMPLER_AUTO));
     menu->addChild(new OversamplingMenuItem(a, "Oversampling: off", 1));
     menu->addChild(new OversamplingMenuItem(a, "Oversampling: x2", 2));
     menu->addChild(new OversamplingMenuItem(a, "Oversampling: x4", 4));
     menu->addChild(new OversamplingMenuItem(a, "Oversampling: x8", 8));
+    menu->addChild(new OversamplingMenuItem(a, "Oversampling: x16", 16));
+    menu->addChild(new OversamplingMenuItem(a, "Oversampling: x32", 32));
 
     menu->addChild(new MenuSeparator());
     menu->addChild(createMenuLabel("Decimator order"));
@@ -334,6 +575,23 @@ struct DIODWidget : ModuleWidget {
     menu->addChild(createMenuLabel("Integration Method"));
     menu->addChild(new IntegrationMenuItem(a, "Semi-implicit Euler w/ Full Tanh", DIODE_EULER_FULL_TANH));
     menu->addChild(new IntegrationMenuItem(a, "Predictor-Corrector w/ Full Tanh", DIODE_PREDICTOR_CORRECTOR_FULL_TANH));
+    menu->addChild(new IntegrationMenuItem(a, "Semi-implicit Euler w/ ADAA Tanh", DIODE_EULER_ADAA_TANH));
+    menu->addChild(new IntegrationMenuItem(a, "Trapezoidal w/ Full Tanh", DIODE_TRAPEZOIDAL_FULL_TANH));
+
+    menu->addChild(new MenuSeparator());
+    menu->addChild(new ControlRateNoiseMenuItem(a, "Control-rate thermal noise"));
+
+    menu->addChild(new MenuSeparator());
+    menu->addChild(createMenuLabel("DSP precision"));
+    menu->addChild(new PrecisionMenuItem(a, "Float (SIMD)", DSP_PRECISION_FLOAT));
+    menu->addChild(new PrecisionMenuItem(a, "Double", DSP_PRECISION_DOUBLE));
+
+    menu->addChild(new MenuSeparator());
+    menu->addChild(createMenuLabel("Knob rate"));
+    menu->addChild(new ControlRateMenuItem(a, "Audio rate", 1));
+    menu->addChild(new ControlRateMenuItem(a, "Every 8 samples", 8));
+    menu->addChild(new ControlRateMenuItem(a, "Every 16 samples", 16));
+    menu->addChild(new ControlRateMenuItem(a, "Every 32 samples", 32));
   }
 };
 
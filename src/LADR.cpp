@@ -21,6 +21,23 @@
 
 #include "plugin.hpp"
 #include "ladder.h"
+#include "paramcache.h"
+#include "controlrate.h"
+
+// pole mixing response names
+static const char* poleMixNames[LADDER_NUM_POLE_MIX_RESPONSES] = {
+  "1-pole lowpass",
+  "2-pole lowpass",
+  "3-pole lowpass",
+  "4-pole lowpass",
+  "1-pole highpass",
+  "2-pole highpass",
+  "3-pole highpass",
+  "4-pole highpass",
+  "2-pole bandpass",
+  "4-pole bandpass",
+  "Notch"
+};
 
 struct LADR : Module {
   enum ParamIds {
@@ -40,7 +57,8 @@ struct LADR : Module {
   };
   enum OutputIds {
      OUTPUT_OUTPUT,
-     NUM_OUTPUTS
+     POLE_MIX_OUTPUT,
+     NUM_OUTPUTS = POLE_MIX_OUTPUT + LADDER_POLE_MIX_OUTPUTS
   };
   enum LightIds {
      NUM_LIGHTS
@@ -48,11 +66,30 @@ struct LADR : Module {
 
   int _oversampling = 4;
   int _decimatorOrder = 16;
+  DSPPrecision _precision = DSP_PRECISION_FLOAT;
+  int _controlRate = 16;
+  bool _controlRateNoise = false;
+  LadderPoleMixResponse _poleMix[LADDER_POLE_MIX_OUTPUTS] = {LADDER_POLE_MIX_LP2, LADDER_POLE_MIX_BP2,
+							    LADDER_POLE_MIX_HP2, LADDER_POLE_MIX_NOTCH};
   
   LadderIntegrationMethod _integrationMethod = LADDER_PREDICTOR_CORRECTOR_FULL_TANH;
   
-  // create ladder class instances
-  Ladder ladder[16];
+  // create ladder class instances, four voices each
+  LadderX4 ladder[4];
+
+  // double precision voices, one per channel
+  Ladder ladderDouble[16];
+
+  // gain normalization follows the resonance knob
+  ParamCache gainNormalizationParam;
+
+  // cutoff and resonance knobs are sampled at control rate
+  // and ramped linearly in between, cv stays at audio rate
+  ControlRateDivider controlDivider;
+  ControlRamp cutoffRamp;
+  ControlRamp resoRamp;
+  float cutoffTarget = 0.f;
+  float resoTarget = 0.f;
   
   LADR() {
     config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -66,9 +103,24 @@ struct LADR : Module {
     configInput(EXPCV_INPUT, "Exponential CV");
     configInput(INPUT_INPUT, "Audio");
     configOutput(OUTPUT_OUTPUT, "Filter");
+    for(int rr = 0; rr < LADDER_POLE_MIX_OUTPUTS; rr++){
+      configOutput(POLE_MIX_OUTPUT + rr, poleMixNames[_poleMix[rr]]);
+    }
     configBypass(INPUT_INPUT, OUTPUT_OUTPUT);
   }
 
+  void SetPoleMixResponse(int output, LadderPoleMixResponse response){
+    _poleMix[output] = response;
+    outputInfos[POLE_MIX_OUTPUT + output]->name = poleMixNames[response];
+    
+    for(int ii = 0; ii < 4; ii++){
+      ladder[ii].SetFilterPoleMixResponse(output, response);
+    }
+    for(int ii = 0; ii < 16; ii++){
+      ladderDouble[ii].SetFilterPoleMixResponse(output, response);
+    }
+  }
+
   void process(const ProcessArgs& args) override {
     // get channels from primary input 
     int channels = inputs[INPUT_INPUT].getChannels();
@@ -79,18 +131,12 @@ struct LADR : Module {
     }    
     
     // parameters
-    float cutoff = params[FREQ_PARAM].getValue();
-    float reso = params[RESO_PARAM].getValue();
     float gain = params[GAIN_PARAM].getValue();
     float lincv_atten = params[LINCV_ATTEN_PARAM].getValue();
     float expcv_atten = params[EXPCV_ATTEN_PARAM].getValue();
     LadderFilterMode filterMode;
     
-    // gain normalization
-    float gainNormalization = 1.f + 2.f * std::log(1.f + 0.45f * reso);
-
     // shape panel input for a pseudoexponential response
-    cutoff = 0.001+2.25*(cutoff * cutoff * cutoff * cutoff);
     gain = 32.f*(gain * gain * gain * gain)/10.f;    
     lincv_atten *= lincv_atten*lincv_atten;
     expcv_atten *= expcv_atten*expcv_atten;
@@ -98,80 +144,226 @@ struct LADR : Module {
     // filter mode
     filterMode = (LadderFilterMode)(params[MODE_PARAM].getValue());
     
-    for(int ii = 0; ii < channels; ii++){    
-      float channelCutoff = cutoff;
+    // mix only the pole mixing outputs that are connected
+    int poleMixMask = 0;
+    for(int rr = 0; rr < LADDER_POLE_MIX_OUTPUTS; rr++){
+      if(outputs[POLE_MIX_OUTPUT + rr].isConnected()){
+	poleMixMask |= 1 << rr;
+      }
+    }
+    
+    // sample and shape cutoff and resonance knobs at control rate
+    bool controlTick = controlDivider.Tick(_controlRate);
+    if(controlTick){
+      float cutoffKnob = params[FREQ_PARAM].getValue();
+      cutoffTarget = 0.001+2.25*(cutoffKnob * cutoffKnob * cutoffKnob * cutoffKnob);
+      resoTarget = params[RESO_PARAM].getValue();
+      cutoffRamp.SetTarget(cutoffTarget, _controlRate);
+      resoRamp.SetTarget(resoTarget, _controlRate);
+    }
+    float cutoff = cutoffRamp.Next();
+    float reso = resoRamp.Next();
+    
+    // gain normalization follows the ramped resonance
+    float gainNormalization = gainNormalizationParam.Get(reso, [](float x){
+	return 1.f + 2.f * std::log(1.f + 0.45f * x);
+      });
+
+    // without cutoff cv the voices compute their integration rate on
+    // control ticks and ramp it themselves, patched cv stays at audio rate
+    bool cvPatched = inputs[LINCV_INPUT].isConnected() || inputs[EXPCV_INPUT].isConnected();
+    
+    // with mono cv inputs all voices share
+    // the same cutoff, compute it once per sample
+    bool monoCV = inputs[LINCV_INPUT].getChannels() <= 1 && inputs[EXPCV_INPUT].getChannels() <= 1;
+    if(cvPatched && monoCV){
+      cutoff += lincv_atten*inputs[LINCV_INPUT].getVoltage()/10.f;
+      cutoff *= FloatExp2(expcv_atten*inputs[EXPCV_INPUT].getVoltage());
+    }
+    
+    // process four channels per filter instance
+    for(int ii = 0; ii < channels; ii += 4){
+      float channelCutoff[4];
+      float channelExpCV[4];
+      float channelInput[4];
+      float channelOutput[4];
+      float channelPoleMix[LADDER_POLE_MIX_OUTPUTS][4];
       
-      // sum in linear cv
-      if(inputs[LINCV_INPUT].getChannels() == 1){
-	channelCutoff += lincv_atten*inputs[LINCV_INPUT].getVoltage()/10.f;
+      for(int jj = 0; jj < 4; jj++){
+	int ch = ii + jj;
+	
+	channelCutoff[jj] = cutoff;
+
+	if(!monoCV){
+	  // sum in linear cv
+	  if(inputs[LINCV_INPUT].getChannels() == 1){
+	    channelCutoff[jj] += lincv_atten*inputs[LINCV_INPUT].getVoltage()/10.f;
+	  }
+	  else{
+	    channelCutoff[jj] += lincv_atten*inputs[LINCV_INPUT].getVoltage(ch)/10.f;
+	  }
+	
+	  // exponential cv
+	  if(inputs[EXPCV_INPUT].getChannels() == 1){
+	    channelExpCV[jj] = expcv_atten*inputs[EXPCV_INPUT].getVoltage();
+	  }
+	  else{
+	    channelExpCV[jj] = expcv_atten*inputs[EXPCV_INPUT].getVoltage(ch);
+	  }
+	}
+
+	// unused lanes run silent
+	channelInput[jj] = ch < channels ? inputs[INPUT_INPUT].getVoltage(ch) * gain : 0.f;
       }
-      else{
-	channelCutoff += lincv_atten*inputs[LINCV_INPUT].getVoltage(ii)/10.f;
+
+      // apply exponential cv to all four lanes at once
+      if(!monoCV){
+	Float4Store(channelCutoff, Float4Load(channelCutoff) * Float4Exp2(Float4Load(channelExpCV)));
       }
       
-      // apply exponential cv
-      if(inputs[EXPCV_INPUT].getChannels() == 1){
-	channelCutoff = channelCutoff * std::pow(2.f, expcv_atten*inputs[EXPCV_INPUT].getVoltage());
+      if(_precision == DSP_PRECISION_DOUBLE){
+	// double precision voices tick one channel at a time
+	for(int jj = 0; jj < 4 && ii + jj < channels; jj++){
+	  if(cvPatched){
+	    ladderDouble[ii + jj].SetFilterCutoff((double)(channelCutoff[jj]));
+	    ladderDouble[ii + jj].SetFilterResonance((double)(reso));
+	  }
+	  else if(controlTick){
+	    ladderDouble[ii + jj].SetFilterControlRamp((double)(cutoffTarget), (double)(resoTarget), _controlRate);
+	  }
+	  ladderDouble[ii + jj].SetFilterMode(filterMode);
+	  ladderDouble[ii + jj].SetFilterPoleMixMask(poleMixMask);
+	  ladderDouble[ii + jj].LadderFilter(channelInput[jj]);
+	  channelOutput[jj] = (float)(ladderDouble[ii + jj].GetFilterOutput() * 3.f * gainNormalization);
+	  for(int rr = 0; rr < LADDER_POLE_MIX_OUTPUTS; rr++){
+	    channelPoleMix[rr][jj] = (float)(ladderDouble[ii + jj].GetFilterPoleMix(rr) * 3.f * gainNormalization);
+	  }
+	}
       }
       else{
-	channelCutoff = channelCutoff * std::pow(2.f, expcv_atten*inputs[EXPCV_INPUT].getVoltage(ii));
+	// set filter parameters
+	if(cvPatched){
+	  ladder[ii/4].SetFilterCutoff(Float4Load(channelCutoff));
+	  ladder[ii/4].SetFilterResonance(Float4(reso));
+	}
+	else if(controlTick){
+	  ladder[ii/4].SetFilterControlRamp(Float4(cutoffTarget), Float4(resoTarget), _controlRate);
+	}
+	ladder[ii/4].SetFilterMode(filterMode);
+	ladder[ii/4].SetFilterPoleMixMask(poleMixMask);
+    
+	// tick filter state
+	ladder[ii/4].LadderFilter(Float4Load(channelInput));
+      
+	// set output
+	Float4Store(channelOutput, ladder[ii/4].GetFilterOutput() * (3.f * gainNormalization));
+	for(int rr = 0; rr < LADDER_POLE_MIX_OUTPUTS; rr++){
+	  Float4Store(channelPoleMix[rr], ladder[ii/4].GetFilterPoleMix(rr) * (3.f * gainNormalization));
+	}
       }
       
-      // set filter parameters
-      ladder[ii].SetFilterCutoff((double)(channelCutoff));
-      ladder[ii].SetFilterResonance((double)(reso));
-      ladder[ii].SetFilterMode(filterMode);
+      for(int jj = 0; jj < 4 && ii + jj < channels; jj++){
+	outputs[OUTPUT_OUTPUT].setVoltage(channelOutput[jj], ii + jj);
+	for(int rr = 0; rr < LADDER_POLE_MIX_OUTPUTS; rr++){
+	  outputs[POLE_MIX_OUTPUT + rr].setVoltage(channelPoleMix[rr][jj], ii + jj);
+	}
+      }
+    }
     
-      // tick filter state
-#ifdef FLOATDSP
-      ladder[ii].LadderFilter((float)(inputs[INPUT_INPUT].getVoltage(ii) * gain));
-#else
-      ladder[ii].LadderFilter((double)(inputs[INPUT_INPUT].getVoltage(ii) * gain));
-#endif
-      
-      // set output
-      outputs[OUTPUT_OUTPUT].setVoltage((float)(ladder[ii].GetFilterOutput() * 3.f * gainNormalization), ii);
+    // idle voices jump to the control targets so that they
+    // start from the current knob settings once they run
+    if(controlTick && !cvPatched){
+      int activeX4 = _precision == DSP_PRECISION_DOUBLE ? 0 : (channels + 3) / 4;
+      int activeDouble = _precision == DSP_PRECISION_DOUBLE ? channels : 0;
+      for(int ii = activeX4; ii < 4; ii++){
+	ladder[ii].SetFilterControlRamp(Float4(cutoffTarget), Float4(resoTarget), 1);
+      }
+      for(int ii = activeDouble; ii < 16; ii++){
+	ladderDouble[ii].SetFilterControlRamp((double)(cutoffTarget), (double)(resoTarget), 1);
+      }
     }
     
-    // set output to be polyphonic
+    // set outputs to be polyphonic
     outputs[OUTPUT_OUTPUT].setChannels(channels);    
+    for(int rr = 0; rr < LADDER_POLE_MIX_OUTPUTS; rr++){
+      outputs[POLE_MIX_OUTPUT + rr].setChannels(channels);
+    }
   }
   
   void onSampleRateChange() override {
     float sr = APP->engine->getSampleRate();
     
-    for(int ii = 0; ii < 16; ii++){    
+    for(int ii = 0; ii < 4; ii++){    
       ladder[ii].SetFilterSampleRate(sr);
     }
+    for(int ii = 0; ii < 16; ii++){    
+      ladderDouble[ii].SetFilterSampleRate(sr);
+    }
   }
 
   void onReset() override {
     float sr = APP->engine->getSampleRate();
     
-    for(int ii = 0; ii < 16; ii++){    
+    for(int ii = 0; ii < 4; ii++){    
       ladder[ii].ResetFilterState();
-      ladder[ii].SetFilterCutoff((double)(0.25));
-      ladder[ii].SetFilterResonance((double)(0.0));
+      ladder[ii].SetFilterCutoff(Float4(0.25f));
+      ladder[ii].SetFilterResonance(Float4(0.0f));
       ladder[ii].SetFilterMode(LADDER_LOWPASS_MODE);
       ladder[ii].SetFilterSampleRate(sr);
       ladder[ii].SetFilterIntegrationMethod(_integrationMethod);
       ladder[ii].SetFilterOversamplingFactor(_oversampling);
       ladder[ii].SetFilterDecimatorOrder(_decimatorOrder);
+      ladder[ii].SetFilterControlRateNoise(_controlRateNoise);
+      for(int rr = 0; rr < LADDER_POLE_MIX_OUTPUTS; rr++){
+	ladder[ii].SetFilterPoleMixResponse(rr, _poleMix[rr]);
+      }
+    }
+    for(int ii = 0; ii < 16; ii++){    
+      ladderDouble[ii].ResetFilterState();
+      ladderDouble[ii].SetFilterCutoff(0.25f);
+      ladderDouble[ii].SetFilterResonance(0.0f);
+      ladderDouble[ii].SetFilterMode(LADDER_LOWPASS_MODE);
+      ladderDouble[ii].SetFilterSampleRate(sr);
+      ladderDouble[ii].SetFilterIntegrationMethod(_integrationMethod);
+      ladderDouble[ii].SetFilterOversamplingFactor(_oversampling);
+      ladderDouble[ii].SetFilterDecimatorOrder(_decimatorOrder);
+      ladderDouble[ii].SetFilterControlRateNoise(_controlRateNoise);
+      for(int rr = 0; rr < LADDER_POLE_MIX_OUTPUTS; rr++){
+	ladderDouble[ii].SetFilterPoleMixResponse(rr, _poleMix[rr]);
+      }
     }
   }
 
   void onAdd() override {
     float sr = APP->engine->getSampleRate();
     
-    for(int ii = 0; ii < 16; ii++){
+    for(int ii = 0; ii < 4; ii++){
       ladder[ii].ResetFilterState();
-      ladder[ii].SetFilterCutoff((double)(0.25));
-      ladder[ii].SetFilterResonance((double)(0.0));
+      ladder[ii].SetFilterCutoff(Float4(0.25f));
+      ladder[ii].SetFilterResonance(Float4(0.0f));
       ladder[ii].SetFilterMode(LADDER_LOWPASS_MODE);
       ladder[ii].SetFilterSampleRate(sr);
       ladder[ii].SetFilterIntegrationMethod(_integrationMethod);
       ladder[ii].SetFilterOversamplingFactor(_oversampling);
       ladder[ii].SetFilterDecimatorOrder(_decimatorOrder);
+      ladder[ii].SetFilterControlRateNoise(_controlRateNoise);
+      for(int rr = 0; rr < LADDER_POLE_MIX_OUTPUTS; rr++){
+	ladder[ii].SetFilterPoleMixResponse(rr, _poleMix[rr]);
+      }
+    }
+    for(int ii = 0; ii < 16; ii++){
+      ladderDouble[ii].ResetFilterState();
+      ladderDouble[ii].SetFilterCutoff(0.25f);
+      ladderDouble[ii].SetFilterResonance(0.0f);
+      ladderDouble[ii].SetFilterMode(LADDER_LOWPASS_MODE);
+      ladderDouble[ii].SetFilterSampleRate(sr);
+      ladderDouble[ii].SetFilterIntegrationMethod(_integrationMethod);
+      ladderDouble[ii].SetFilterOversamplingFactor(_oversampling);
+      ladderDouble[ii].SetFilterDecimatorOrder(_decimatorOrder);
+      ladderDouble[ii].SetFilterControlRateNoise(_controlRateNoise);
+      for(int rr = 0; rr < LADDER_POLE_MIX_OUTPUTS; rr++){
+	ladderDouble[ii].SetFilterPoleMixResponse(rr, _poleMix[rr]);
+      }
     }
   }
 
@@ -181,18 +373,40 @@ struct LADR : Module {
     json_object_set_new(rootJ, "oversampling", json_integer(_oversampling));
     json_object_set_new(rootJ, "decimatorOrder", json_integer(_decimatorOrder));
     json_object_set_new(rootJ, "integrationMethod", json_integer((int)(_integrationMethod)));
+    json_object_set_new(rootJ, "precision", json_integer((int)(_precision)));
+    json_object_set_new(rootJ, "controlRate", json_integer(_controlRate));
+    json_object_set_new(rootJ, "controlRateNoise", json_boolean(_controlRateNoise));
+
+    json_t* poleMixJ = json_array();
+    for(int rr = 0; rr < LADDER_POLE_MIX_OUTPUTS; rr++){
+      json_array_append_new(poleMixJ, json_integer((int)(_poleMix[rr])));
+    }
+    json_object_set_new(rootJ, "poleMix", poleMixJ);
     
     return rootJ;
   }
 
   void dataFromJson(json_t* rootJ) override {
+    // patches saved before the precision option ran in double
+    json_t* precisionJ = json_object_get(rootJ, "precision");
+    _precision = precisionJ ? (DSPPrecision)(json_integer_value(precisionJ)) : DSP_PRECISION_DOUBLE;
+
+    // patches saved before the control rate option ran at audio rate
+    json_t* controlRateJ = json_object_get(rootJ, "controlRate");
+    _controlRate = controlRateJ ? json_integer_value(controlRateJ) : 1;
+
+    // clamp to the rates offered in the menu
+    _controlRate = (_controlRate <= 1 ? 1 : _controlRate <= 8 ? 8 : _controlRate <= 16 ? 16 : 32);
+
     json_t* integrationMethodJ = json_object_get(rootJ, "integrationMethod");
     if (integrationMethodJ && (_integrationMethod != (LadderIntegrationMethod)(json_integer_value(integrationMethodJ)))) {
       _integrationMethod = (LadderIntegrationMethod)(json_integer_value(integrationMethodJ));
       
       // set new integration method
-      for(int ii = 0; ii < 16; ii++)
+      for(int ii = 0; ii < 4; ii++)
 	ladder[ii].SetFilterIntegrationMethod(_integrationMethod);
+      for(int ii = 0; ii < 16; ii++)
+	ladderDouble[ii].SetFilterIntegrationMethod(_integrationMethod);
     }
     
     json_t* oversamplingJ = json_object_get(rootJ, "oversampling");
@@ -200,8 +414,10 @@ struct LADR : Module {
       _oversampling = json_integer_value(oversamplingJ);
 
       // set new oversampling factor
-      for(int ii = 0; ii < 16; ii++)
+      for(int ii = 0; ii < 4; ii++)
 	ladder[ii].SetFilterOversamplingFactor(_oversampling);
+      for(int ii = 0; ii < 16; ii++)
+	ladderDouble[ii].SetFilterOversamplingFactor(_oversampling);
     }
     
     json_t* decimatorOrderJ = json_object_get(rootJ, "decimatorOrder");
@@ -209,8 +425,35 @@ struct LADR : Module {
       _decimatorOrder = json_integer_value(decimatorOrderJ);
 
       // set new decimator order
-      for(int ii = 0; ii < 16; ii++)
+      for(int ii = 0; ii < 4; ii++)
 	ladder[ii].SetFilterDecimatorOrder(_decimatorOrder);
+      for(int ii = 0; ii < 16; ii++)
+	ladderDouble[ii].SetFilterDecimatorOrder(_decimatorOrder);
+    }
+
+    json_t* controlRateNoiseJ = json_object_get(rootJ, "controlRateNoise");
+    if (controlRateNoiseJ) {
+      _controlRateNoise = json_is_true(controlRateNoiseJ);
+
+      // set thermal noise rate
+      for(int ii = 0; ii < 4; ii++)
+	ladder[ii].SetFilterControlRateNoise(_controlRateNoise);
+      for(int ii = 0; ii < 16; ii++)
+	ladderDouble[ii].SetFilterControlRateNoise(_controlRateNoise);
+    }
+
+    json_t* poleMixJ = json_object_get(rootJ, "poleMix");
+    if (poleMixJ) {
+      // set pole mixing responses
+      for(int rr = 0; rr < LADDER_POLE_MIX_OUTPUTS; rr++){
+	json_t* responseJ = json_array_get(poleMixJ, rr);
+	if (responseJ) {
+	  // skip responses this version does not know
+	  json_int_t response = json_integer_value(responseJ);
+	  if (response >= 0 && response < LADDER_NUM_POLE_MIX_RESPONSES)
+	    SetPoleMixResponse(rr, (LadderPoleMixResponse)(response));
+	}
+      }
     }
   }
 };
@@ -239,6 +482,11 @@ struct LADRWidget : ModuleWidget {
     addInput(createInputCentered<PJ301MPort>(mm2px(Vec(8.96, 104.7)), module, LADR::INPUT_INPUT));
     
     addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(21.681, 104.7)), module, LADR::OUTPUT_OUTPUT));
+    
+    addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(35.56, 52.44)), module, LADR::POLE_MIX_OUTPUT + 0));
+    addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(35.56, 69.86)), module, LADR::POLE_MIX_OUTPUT + 1));
+    addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(35.56, 87.28)), module, LADR::POLE_MIX_OUTPUT + 2));
+    addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(35.56, 104.7)), module, LADR::POLE_MIX_OUTPUT + 3));
   }
 
   struct OversamplingMenuItem : MenuItem {
@@ -254,9 +502,12 @@ struct LADRWidget : ModuleWidget {
 
     void onAction(const event::Action& e) override {
       _module->_oversampling = _oversampling;
-      for(int ii = 0; ii < 16; ii++){    
+      for(int ii = 0; ii < 4; ii++){    
 	_module->ladder[ii].SetFilterOversamplingFactor(_module->_oversampling);
       }
+      for(int ii = 0; ii < 16; ii++){    
+	_module->ladderDouble[ii].SetFilterOversamplingFactor(_module->_oversampling);
+      }
     }
 
     void step() override {
@@ -278,9 +529,12 @@ struct LADRWidget : ModuleWidget {
 
     void onAction(const event::Action& e) override {
       _module->_decimatorOrder = _decimatorOrder;
-      for(int ii = 0; ii < 16; ii++){    
+      for(int ii = 0; ii < 4; ii++){    
 	_module->ladder[ii].SetFilterDecimatorOrder(_module->_decimatorOrder);
       }
+      for(int ii = 0; ii < 16; ii++){    
+	_module->ladderDouble[ii].SetFilterDecimatorOrder(_module->_decimatorOrder);
+      }
     }
 
     void step() override {
@@ -302,9 +556,12 @@ struct LADRWidget : ModuleWidget {
 
     void onAction(const event::Action& e) override {
       _module->_integrationMethod = (LadderIntegrationMethod)(_integrationMethod);
-      for(int ii = 0; ii < 16; ii++){    
+      for(int ii = 0; ii < 4; ii++){    
 	_module->ladder[ii].SetFilterIntegrationMethod(_module->_integrationMethod);
       }
+      for(int ii = 0; ii < 16; ii++){    
+	_module->ladderDouble[ii].SetFilterIntegrationMethod(_module->_integrationMethod);
+      }
     }
 
     void step() override {
@@ -313,16 +570,137 @@ struct LADRWidget : ModuleWidget {
     }
   };
   
+  struct ControlRateNoiseMenuItem : MenuItem {
+    LADR* _module;
+
+    ControlRateNoiseMenuItem(LADR* module, const char* label)
+      : _module(module)
+    {
+      this->text = label;
+    }
+
+    void onAction(const event::Action& e) override {
+      _module->_controlRateNoise = !_module->_controlRateNoise;
+      for(int ii = 0; ii < 4; ii++){    
+	_module->ladder[ii].SetFilterControlRateNoise(_module->_controlRateNoise);
+      }
+      for(int ii = 0; ii < 16; ii++){    
+	_module->ladderDouble[ii].SetFilterControlRateNoise(_module->_controlRateNoise);
+      }
+    }
+
+    void step() override {
+      MenuItem::step();
+      rightText = _module->_controlRateNoise ? "✔" : "";
+    }
+  };
+  
+  struct PrecisionMenuItem : MenuItem {
+    LADR* _module;
+    const int _precision;
+
+    PrecisionMenuItem(LADR* module, const char* label, DSPPrecision precision)
+      : _module(module)
+      , _precision(precision)
+    {
+      this->text = label;
+    }
+
+    void onAction(const event::Action& e) override {
+      // voices of the new precision start from rest
+      for(int ii = 0; ii < 4; ii++){    
+	_module->ladder[ii].ResetFilterState();
+      }
+      for(int ii = 0; ii < 16; ii++){    
+	_module->ladderDouble[ii].ResetFilterState();
+      }
+      _module->_precision = (DSPPrecision)(_precision);
+    }
+
+    void step() override {
+      MenuItem::step();
+      rightText = _module->_precision == _precision ? "✔" : "";
+    }
+  };
+  
+  struct ControlRateMenuItem : MenuItem {
+    LADR* _module;
+    const int _controlRate;
+
+    ControlRateMenuItem(LADR* module, const char* label, int controlRate)
+      : _module(module)
+      , _controlRate(controlRate)
+    {
+      this->text = label;
+    }
+
+    void onAction(const event::Action& e) override {
+      _module->_controlRate = _controlRate;
+    }
+
+    void step() override {
+      MenuItem::step();
+      rightText = _module->_controlRate == _controlRate ? "✔" : "";
+    }
+  };
+  
+  struct PoleMixMenuItem : MenuItem {
+    LADR* _module;
+    const int _output;
+    const int _response;
+
+    PoleMixMenuItem(LADR* module, const char* label, int output, LadderPoleMixResponse response)
+      : _module(module)
+      , _output(output)
+      , _response(response)
+    {
+      this->text = label;
+    }
+
+    void onAction(const event::Action& e) override {
+      _module->SetPoleMixResponse(_output, (LadderPoleMixResponse)(_response));
+    }
+
+    void step() override {
+      MenuItem::step();
+      rightText = _module->_poleMix[_output] == _response ? "✔" : "";
+    }
+  };
+  
+  struct PoleMixOutputMenuItem : MenuItem {
+    LADR* _module;
+    const int _output;
+
+    PoleMixOutputMenuItem(LADR* module, const char* label, int output)
+      : _module(module)
+      , _output(output)
+    {
+      this->text = label;
+      this->rightText = RIGHT_ARROW;
+    }
+
+    Menu* createChildMenu() override {
+      Menu* menu = new Menu;
+      for(int rr = 0; rr < LADDER_NUM_POLE_MIX_RESPONSES; rr++){
+	menu->addChild(new PoleMixMenuItem(_module, poleMixNames[rr], _output, (LadderPoleMixResponse)(rr)));
+      }
+      return menu;
+    }
+  };
+  
   void appendContextMenu(Menu* menu) override {
     LADR* a = dynamic_cast<LADR*>(module);
     assert(a);
     
     menu->addChild(new MenuSeparator());
     menu->addChild(createMenuLabel("Oversampling"));
+    menu->addChild(new OversamplingMenuItem(a, "Oversampling: auto", OVERSAMPLER_AUTO));
     menu->addChild(new OversamplingMenuItem(a, "Oversampling: off", 1));
     menu->addChild(new OversamplingMenuItem(a, "Oversampling: x2", 2));
     menu->addChild(new OversamplingMenuItem(a, "Oversampling: x4", 4));
     menu->addChild(new OversamplingMenuItem(a, "Oversampling: x8", 8));
+    menu->addChild(new OversamplingMenuItem(a, "Oversampling: x16", 16));
+    menu->addChild(new OversamplingMenuItem(a, "Oversampling: x32", 32));
 
     menu->addChild(new MenuSeparator());
     menu->addChild(createMenuLabel("Decimator order"));
@@ -336,6 +714,29 @@ struct LADRWidget : ModuleWidget {
     menu->addChild(new IntegrationMenuItem(a, "Predictor-Corrector w/ Full Tanh", LADDER_PREDICTOR_CORRECTOR_FULL_TANH));
     menu->addChild(new IntegrationMenuItem(a, "Predictor-Corrector w/ Tanh Feedback", LADDER_PREDICTOR_CORRECTOR_FEEDBACK_TANH));
     menu->addChild(new IntegrationMenuItem(a, "Trapezoidal w/ Tanh Feedback", LADDER_TRAPEZOIDAL_FEEDBACK_TANH));
+    menu->addChild(new IntegrationMenuItem(a, "Semi-implicit Euler w/ ADAA Tanh", LADDER_EULER_ADAA_TANH));
+
+    menu->addChild(new MenuSeparator());
+    menu->addChild(new ControlRateNoiseMenuItem(a, "Control-rate thermal noise"));
+
+    menu->addChild(new MenuSeparator());
+    menu->addChild(createMenuLabel("DSP precision"));
+    menu->addChild(new PrecisionMenuItem(a, "Float (SIMD)", DSP_PRECISION_FLOAT));
+    menu->addChild(new PrecisionMenuItem(a, "Double", DSP_PRECISION_DOUBLE));
+
+    menu->addChild(new MenuSeparator());
+    menu->addChild(createMenuLabel("Knob rate"));
+    menu->addChild(new ControlRateMenuItem(a, "Audio rate", 1));
+    menu->addChild(new ControlRateMenuItem(a, "Every 8 samples", 8));
+    menu->addChild(new ControlRateMenuItem(a, "Every 16 samples", 16));
+    menu->addChild(new ControlRateMenuItem(a, "Every 32 samples", 32));
+
+    menu->addChild(new MenuSeparator());
+    menu->addChild(createMenuLabel("Pole mixing outputs"));
+    menu->addChild(new PoleMixOutputMenuItem(a, "Output 1", 0));
+    menu->addChild(new PoleMixOutputMenuItem(a, "Output 2", 1));
+    menu->addChild(new PoleMixOutputMenuItem(a, "Output 3", 2));
+    menu->addChild(new PoleMixOutputMenuItem(a, "Output 4", 3));
   }
 };
 
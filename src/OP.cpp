@@ -22,6 +22,7 @@
 #include <cmath>
 #include "plugin.hpp"
 #include "phasor.h"
+#include "fastsimd.h"
 
 struct OP : Module {
   enum ParamIds {
@@ -81,19 +82,30 @@ struct OP : Module {
     // shape index parameter
     index *= index*index*index;
     
+    // pitch cv of all channels, unused lanes stay at zero
+    float cv[16] = {};
     for(int ii = 0; ii < channels; ii++){
-      float cv = inputs[CV_INPUT].getVoltage(ii) + (float)(offset)/12.f;
-      float phase_mod = inputs[PHASE_MOD_INPUT].getVoltage(ii);
-      float reset = inputs[RESET_INPUT].getVoltage(ii);
+      cv[ii] = inputs[CV_INPUT].getVoltage(ii) + (float)(offset)/12.f;
       
       // apply scale to cv
-      cv *= (float)(scale)/12.f;
+      cv[ii] *= (float)(scale)/12.f;
 
       // clip negative cv
-      if(cv < 0.0) {
-	cv = 0.0;
+      if(cv[ii] < 0.0) {
+	cv[ii] = 0.0;
       }
+    }
 
+    // convert pitch cv to frequency four channels at a time
+    float frequency[16];
+    for(int ii = 0; ii < channels; ii += 4){
+      Float4Store(frequency + ii, (float)(440.0/128.0) * Float4Exp2(Float4Load(cv + ii)));
+    }
+    
+    for(int ii = 0; ii < channels; ii++){
+      float phase_mod = inputs[PHASE_MOD_INPUT].getVoltage(ii);
+      float reset = inputs[RESET_INPUT].getVoltage(ii);
+      
       // detect rising zero crossing as a reset state
       if(last_reset[ii] <= 0.0f && reset > 0.0f){
 	phasor[ii].SetPhase((double)(0.0f));
@@ -103,7 +115,7 @@ struct OP : Module {
       last_reset[ii] = reset;
       
       // set operator frequency
-      phasor[ii].SetFrequency((double)((440.0/128.0) * std::pow(2.f, cv)));
+      phasor[ii].SetFrequency((double)(frequency[ii]));
       
       // set operator phase modulation
       phasor[ii].SetPhaseModulation((double)(32.0*index*phase_mod + phase_offset));
@@ -21,6 +21,8 @@
 
 #include "plugin.hpp"
 #include "phasor.h"
+#include "fastsimd.h"
+#include "paramcache.h"
 
 struct PHASR : Module {
   enum ParamIds {
@@ -54,6 +56,9 @@ struct PHASR : Module {
 
   // create phasor instances
   Phasor phasor[16];
+
+  // base frequency follows the tuning knobs
+  ParamCache freqParam;
   
   void process(const ProcessArgs& args) override {
     // get channels from primary input 
@@ -70,22 +75,35 @@ struct PHASR : Module {
     float index = params[INDEX_PARAM].getValue();
 
     // compute base frequency
-    freq = std::pow(2.f, 12.0*freq + 0.1*fine);
+    freq = freqParam.Get(12.0*freq + 0.1*fine, [](float x){
+	return FloatExp2(x);
+      });
 
     // shape index parameter
     index *= index*index*index;
     
+    // pitch cv of all channels, unused lanes stay at zero
+    float cv[16] = {};
     for(int ii = 0; ii < channels; ii++){
-      float cv = inputs[CV_INPUT].getVoltage(ii);
-      float phase_mod = inputs[PHASE_MOD_INPUT].getVoltage(ii);
+      cv[ii] = inputs[CV_INPUT].getVoltage(ii);
       
       // clip negative cv
-      if(cv < 0.0) {
-	cv = 0.0;
+      if(cv[ii] < 0.0) {
+	cv[ii] = 0.0;
       }
+    }
 
+    // convert pitch cv to frequency four channels at a time
+    float frequency[16];
+    for(int ii = 0; ii < channels; ii += 4){
+      Float4Store(frequency + ii, freq * Float4Exp2(Float4Load(cv + ii)));
+    }
+    
+    for(int ii = 0; ii < channels; ii++){
+      float phase_mod = inputs[PHASE_MOD_INPUT].getVoltage(ii);
+      
       // set frequency
-      phasor[ii].SetFrequency((double)(freq * std::pow(2.f, cv)));
+      phasor[ii].SetFrequency((double)(frequency[ii]));
 
       // set phase modulation
       phasor[ii].SetPhaseModulation((double)(32.0*index*phase_mod));
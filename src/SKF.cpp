@@ -21,6 +21,8 @@
 
 #include "plugin.hpp"
 #include "sallenkey.h"
+#include "paramcache.h"
+#include "controlrate.h"
 
 struct SKF : Module {
   enum ParamIds {
@@ -48,11 +50,27 @@ struct SKF : Module {
 
   int _oversampling = 2;
   int _decimatorOrder = 16;
+  DSPPrecision _precision = DSP_PRECISION_FLOAT;
+  int _controlRate = 16;
   
   SKIntegrationMethod _integrationMethod = SK_TRAPEZOIDAL;
   
-  // create sallen-key filter class instances
-  SKFilter skf[16];
+  // create sallen-key filter class instances, four voices each
+  SKFilterX4 skf[4];
+
+  // double precision voices, one per channel
+  SKFilter skfDouble[16];
+
+  // gain compensation follows the gain knob
+  ParamCache gainCompParam;
+
+  // cutoff and resonance knobs are sampled at control rate
+  // and ramped linearly in between, cv stays at audio rate
+  ControlRateDivider controlDivider;
+  ControlRamp cutoffRamp;
+  ControlRamp resoRamp;
+  float cutoffTarget = 0.f;
+  float resoTarget = 0.f;
   
   SKF() {
     config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -79,59 +97,136 @@ struct SKF : Module {
     }    
     
     // parameters
-    float cutoff = params[FREQ_PARAM].getValue();
-    float reso = params[RESO_PARAM].getValue();
     float gain = params[GAIN_PARAM].getValue();
     float lincv_atten = params[LINCV_ATTEN_PARAM].getValue();
     float expcv_atten = params[EXPCV_ATTEN_PARAM].getValue();
     float gainComp = params[GAIN_PARAM].getValue() - 0.5;
     
     // shape panel input for a pseudoexponential response
-    cutoff = 0.001+2.25*(cutoff * cutoff * cutoff * cutoff);
     gain = (gain * gain * gain * gain)/10.f;
     lincv_atten *= lincv_atten*lincv_atten;
     expcv_atten *= expcv_atten*expcv_atten;
       
     // compute gain compensation to normalize output on high drive levels
-    if(gainComp < 0.0) {
-      gainComp = 0.0;
+    gainComp = gainCompParam.Get(gainComp, [](float x){
+	if(x < 0.0) {
+	  x = 0.0;
+	}
+	return 9.0 * (1.0 - 1.9 * std::log(1.0 + x));
+      });
+    
+    // sample and shape cutoff and resonance knobs at control rate
+    bool controlTick = controlDivider.Tick(_controlRate);
+    if(controlTick){
+      float cutoffKnob = params[FREQ_PARAM].getValue();
+      cutoffTarget = 0.001+2.25*(cutoffKnob * cutoffKnob * cutoffKnob * cutoffKnob);
+      resoTarget = params[RESO_PARAM].getValue();
+      cutoffRamp.SetTarget(cutoffTarget, _controlRate);
+      resoRamp.SetTarget(resoTarget, _controlRate);
     }
+    float cutoff = cutoffRamp.Next();
+    float reso = resoRamp.Next();
+    
+    // without cutoff cv the voices compute their integration rate on
+    // control ticks and ramp it themselves, patched cv stays at audio rate
+    bool cvPatched = inputs[LINCV_INPUT].isConnected() || inputs[EXPCV_INPUT].isConnected();
     
-    gainComp = 9.0 * (1.0 - 1.9 * std::log(1.0 + gainComp));
+    // with mono cv inputs all voices share
+    // the same cutoff, compute it once per sample
+    bool monoCV = inputs[LINCV_INPUT].getChannels() <= 1 && inputs[EXPCV_INPUT].getChannels() <= 1;
+    if(cvPatched && monoCV){
+      cutoff += lincv_atten*inputs[LINCV_INPUT].getVoltage()/10.f;
+      cutoff *= FloatExp2(expcv_atten*inputs[EXPCV_INPUT].getVoltage());
+    }
     
-    for(int ii = 0; ii < channels; ii++){
-      float channelCutoff = cutoff;
+    // process four channels per filter instance
+    for(int ii = 0; ii < channels; ii += 4){
+      float channelCutoff[4];
+      float channelExpCV[4];
+      float channelInput[4];
+      float channelOutput[4];
       
-      // sum in linear cv
-      if(inputs[LINCV_INPUT].getChannels() == 1){
-	channelCutoff += lincv_atten*inputs[LINCV_INPUT].getVoltage()/10.f;
+      for(int jj = 0; jj < 4; jj++){
+	int ch = ii + jj;
+	
+	channelCutoff[jj] = cutoff;
+
+	if(!monoCV){
+	  // sum in linear cv
+	  if(inputs[LINCV_INPUT].getChannels() == 1){
+	    channelCutoff[jj] += lincv_atten*inputs[LINCV_INPUT].getVoltage()/10.f;
+	  }
+	  else{
+	    channelCutoff[jj] += lincv_atten*inputs[LINCV_INPUT].getVoltage(ch)/10.f;
+	  }
+	
+	  // exponential cv
+	  if(inputs[EXPCV_INPUT].getChannels() == 1){
+	    channelExpCV[jj] = expcv_atten*inputs[EXPCV_INPUT].getVoltage();
+	  }
+	  else{
+	    channelExpCV[jj] = expcv_atten*inputs[EXPCV_INPUT].getVoltage(ch);
+	  }
+	}
+
+	// unused lanes run silent
+	channelInput[jj] = ch < channels ? inputs[INPUT_INPUT].getVoltage(ch) * gain * 2.f : 0.f;
       }
-      else{
-	channelCutoff += lincv_atten*inputs[LINCV_INPUT].getVoltage(ii)/10.f;
+
+      // apply exponential cv to all four lanes at once
+      if(!monoCV){
+	Float4Store(channelCutoff, Float4Load(channelCutoff) * Float4Exp2(Float4Load(channelExpCV)));
       }
       
-      // apply exponential cv
-      if(inputs[EXPCV_INPUT].getChannels() == 1){
-	channelCutoff = channelCutoff * std::pow(2.f, expcv_atten*inputs[EXPCV_INPUT].getVoltage());
+      if(_precision == DSP_PRECISION_DOUBLE){
+	// double precision voices tick one channel at a time
+	for(int jj = 0; jj < 4 && ii + jj < channels; jj++){
+	  if(cvPatched){
+	    skfDouble[ii + jj].SetFilterCutoff((double)(channelCutoff[jj]));
+	    skfDouble[ii + jj].SetFilterResonance((double)(reso));
+	  }
+	  else if(controlTick){
+	    skfDouble[ii + jj].SetFilterControlRamp((double)(cutoffTarget), (double)(resoTarget), _controlRate);
+	  }
+	  skfDouble[ii + jj].SetFilterMode((SKFilterMode)(params[MODE_PARAM].getValue()));
+	  skfDouble[ii + jj].filter(channelInput[jj]);
+	  channelOutput[jj] = (float)(skfDouble[ii + jj].GetFilterOutput() * 5.f * gainComp);
+	}
       }
       else{
-	channelCutoff = channelCutoff * std::pow(2.f, expcv_atten*inputs[EXPCV_INPUT].getVoltage(ii));
-      }
+	// set filter parameters
+	if(cvPatched){
+	  skf[ii/4].SetFilterCutoff(Float4Load(channelCutoff));
+	  skf[ii/4].SetFilterResonance(Float4(reso));
+	}
+	else if(controlTick){
+	  skf[ii/4].SetFilterControlRamp(Float4(cutoffTarget), Float4(resoTarget), _controlRate);
+	}
+	skf[ii/4].SetFilterMode((SKFilterMode)(params[MODE_PARAM].getValue()));
     
-      // set filter parameters
-      skf[ii].SetFilterCutoff((double)(channelCutoff));
-      skf[ii].SetFilterResonance((double)(reso));
-      skf[ii].SetFilterMode((SKFilterMode)(params[MODE_PARAM].getValue()));
-    
-      // tick filter state
-#ifdef FLOATDSP
-      skf[ii].filter((float)(inputs[INPUT_INPUT].getVoltage(ii) * gain * 2.0));
-#else
-      skf[ii].filter((double)(inputs[INPUT_INPUT].getVoltage(ii) * gain * 2.0));
-#endif
+	// tick filter state
+	skf[ii/4].filter(Float4Load(channelInput));
+      
+	// set output
+	Float4Store(channelOutput, skf[ii/4].GetFilterOutput() * (5.f * gainComp));
+      }
       
-      // set output
-      outputs[OUTPUT_OUTPUT].setVoltage((float)(skf[ii].GetFilterOutput() * 5.0 * gainComp), ii);
+      for(int jj = 0; jj < 4 && ii + jj < channels; jj++){
+	outputs[OUTPUT_OUTPUT].setVoltage(channelOutput[jj], ii + jj);
+      }
+    }
+    
+    // idle voices jump to the control targets so that they
+    // start from the current knob settings once they run
+    if(controlTick && !cvPatched){
+      int activeX4 = _precision == DSP_PRECISION_DOUBLE ? 0 : (channels + 3) / 4;
+      int activeDouble = _precision == DSP_PRECISION_DOUBLE ? channels : 0;
+      for(int ii = activeX4; ii < 4; ii++){
+	skf[ii].SetFilterControlRamp(Float4(cutoffTarget), Float4(resoTarget), 1);
+      }
+      for(int ii = activeDouble; ii < 16; ii++){
+	skfDouble[ii].SetFilterControlRamp((double)(cutoffTarget), (double)(resoTarget), 1);
+      }
     }
     
     // set output to be polyphonic
@@ -141,45 +236,70 @@ struct SKF : Module {
   void onSampleRateChange() override {
     float sr = APP->engine->getSampleRate();
     
-    for(int ii = 0; ii < 16; ii++){    
+    for(int ii = 0; ii < 4; ii++){    
       skf[ii].SetFilterSampleRate(sr);
     }
+    for(int ii = 0; ii < 16; ii++){    
+      skfDouble[ii].SetFilterSampleRate(sr);
+    }
   }
 
   void onReset() override {
     float sr = APP->engine->getSampleRate();
     
-    for(int ii = 0; ii < 16; ii++){    
+    for(int ii = 0; ii < 4; ii++){    
       skf[ii].ResetFilterState();
       skf[ii].SetFilterSampleRate(sr);
-      skf[ii].SetFilterCutoff((double)(0.25));
-      skf[ii].SetFilterResonance((double)(0.0));
+      skf[ii].SetFilterCutoff(Float4(0.25f));
+      skf[ii].SetFilterResonance(Float4(0.0f));
       skf[ii].SetFilterMode(SK_LOWPASS_MODE);
       skf[ii].SetFilterIntegrationMethod(_integrationMethod);
       skf[ii].SetFilterOversamplingFactor(_oversampling);
       skf[ii].SetFilterDecimatorOrder(_decimatorOrder);
     }
+    for(int ii = 0; ii < 16; ii++){    
+      skfDouble[ii].ResetFilterState();
+      skfDouble[ii].SetFilterSampleRate(sr);
+      skfDouble[ii].SetFilterCutoff(0.25f);
+      skfDouble[ii].SetFilterResonance(0.0f);
+      skfDouble[ii].SetFilterMode(SK_LOWPASS_MODE);
+      skfDouble[ii].SetFilterIntegrationMethod(_integrationMethod);
+      skfDouble[ii].SetFilterOversamplingFactor(_oversampling);
+      skfDouble[ii].SetFilterDecimatorOrder(_decimatorOrder);
+    }
   }
 
   void onAdd() override {
     float sr = APP->engine->getSampleRate();
     
-    for(int ii = 0; ii < 16; ii++){    
+    for(int ii = 0; ii < 4; ii++){    
       skf[ii].ResetFilterState();
       skf[ii].SetFilterSampleRate(sr);
-      skf[ii].SetFilterCutoff((double)(0.25));
-      skf[ii].SetFilterResonance((double)(0.0));
+      skf[ii].SetFilterCutoff(Float4(0.25f));
+      skf[ii].SetFilterResonance(Float4(0.0f));
       skf[ii].SetFilterMode(SK_LOWPASS_MODE);
       skf[ii].SetFilterIntegrationMethod(_integrationMethod);
       skf[ii].SetFilterOversamplingFactor(_oversampling);
       skf[ii].SetFilterDecimatorOrder(_decimatorOrder);
     }
+    for(int ii = 0; ii < 16; ii++){    
+      skfDouble[ii].ResetFilterState();
+      skfDouble[ii].SetFilterSampleRate(sr);
+      skfDouble[ii].SetFilterCutoff(0.25f);
+      skfDouble[ii].SetFilterResonance(0.0f);
+      skfDouble[ii].SetFilterMode(SK_LOWPASS_MODE);
+      skfDouble[ii].SetFilterIntegrationMethod(_integrationMethod);
+      skfDouble[ii].SetFilterOversamplingFactor(_oversampling);
+      skfDouble[ii].SetFilterDecimatorOrder(_decimatorOrder);
+    }
   }
   
   json_t* dataToJson() override {
     json_t* rootJ = json_object();
     
     json_object_set_new(rootJ, "integrationMethod", json_integer((int)(_integrationMethod)));
+    json_object_set_new(rootJ, "precision", json_integer((int)(_precision)));
+    json_object_set_new(rootJ, "controlRate", json_integer(_controlRate));
     json_object_set_new(rootJ, "oversampling", json_integer(_oversampling));
     json_object_set_new(rootJ, "decimatorOrder", json_integer(_decimatorOrder));
     
@@ -187,13 +307,26 @@ struct SKF : Module {
   }
 
   void dataFromJson(json_t* rootJ) override {
+    // patches saved before the precision option ran in double
+    json_t* precisionJ = json_object_get(rootJ, "precision");
+    _precision = precisionJ ? (DSPPrecision)(json_integer_value(precisionJ)) : DSP_PRECISION_DOUBLE;
+
+    // patches saved before the control rate option ran at audio rate
+    json_t* controlRateJ = json_object_get(rootJ, "controlRate");
+    _controlRate = controlRateJ ? json_integer_value(controlRateJ) : 1;
+
+    // clamp to the rates offered in the menu
+    _controlRate = (_controlRate <= 1 ? 1 : _controlRate <= 8 ? 8 : _controlRate <= 16 ? 16 : 32);
+
     json_t* integrationMethodJ = json_object_get(rootJ, "integrationMethod");
     if (integrationMethodJ && (_integrationMethod != (SKIntegrationMethod)(json_integer_value(integrationMethodJ)))) {
       _integrationMethod = (SKIntegrationMethod)(json_integer_value(integrationMethodJ));
       
       // set new integration method
-      for(int ii = 0; ii < 16; ii++)
+      for(int ii = 0; ii < 4; ii++)
 	skf[ii].SetFilterIntegrationMethod(_integrationMethod);
+      for(int ii = 0; ii < 16; ii++)
+	skfDouble[ii].SetFilterIntegrationMethod(_integrationMethod);
     }
     
     json_t* oversamplingJ = json_object_get(rootJ, "oversampling");
@@ -201,8 +334,10 @@ struct SKF : Module {
       _oversampling = json_integer_value(oversamplingJ);
 
       // set new oversampling factor
-      for(int ii = 0; ii < 16; ii++)
+      for(int ii = 0; ii < 4; ii++)
 	skf[ii].SetFilterOversamplingFactor(_oversampling);
+      for(int ii = 0; ii < 16; ii++)
+	skfDouble[ii].SetFilterOversamplingFactor(_oversampling);
     }
     
     json_t* decimatorOrderJ = json_object_get(rootJ, "decimatorOrder");
@@ -210,8 +345,10 @@ struct SKF : Module {
       _decimatorOrder = json_integer_value(decimatorOrderJ);
 
       // set new decimator order
-      for(int ii = 0; ii < 16; ii++)
+      for(int ii = 0; ii < 4; ii++)
 	skf[ii].SetFilterDecimatorOrder(_decimatorOrder);
+      for(int ii = 0; ii < 16; ii++)
+	skfDouble[ii].SetFilterDecimatorOrder(_decimatorOrder);
     }
   }
 };
@@ -256,9 +393,12 @@ struct SKFWidget : ModuleWidget {
 
     void onAction(const event::Action& e) override {
       _module->_oversampling = _oversampling;
-      for(int ii = 0; ii < 16; ii++){    
+      for(int ii = 0; ii < 4; ii++){    
 	_module->skf[ii].SetFilterOversamplingFactor(_module->_oversampling);
       }
+      for(int ii = 0; ii < 16; ii++){    
+	_module->skfDouble[ii].SetFilterOversamplingFactor(_module->_oversampling);
+      }
     }
 
     void step() override {
@@ -280,9 +420,12 @@ struct SKFWidget : ModuleWidget {
 
     void onAction(const event::Action& e) override {
       _module->_decimatorOrder = _decimatorOrder;
-      for(int ii = 0; ii < 16; ii++){    
+      for(int ii = 0; ii < 4; ii++){    
 	_module->skf[ii].SetFilterDecimatorOrder(_module->_decimatorOrder);
       }
+      for(int ii = 0; ii < 16; ii++){    
+	_module->skfDouble[ii].SetFilterDecimatorOrder(_module->_decimatorOrder);
+      }
     }
 
     void step() override {
@@ -304,9 +447,12 @@ struct SKFWidget : ModuleWidget {
 
     void onAction(const event::Action& e) override {
       _module->_integrationMethod = _integrationMethod;
-      for(int ii = 0; ii < 16; ii++){ 
+      for(int ii = 0; ii < 4; ii++){ 
 	_module->skf[ii].SetFilterIntegrationMethod(_module->_integrationMethod);
       }
+      for(int ii = 0; ii < 16; ii++){ 
+	_module->skfDouble[ii].SetFilterIntegrationMethod(_module->_integrationMethod);
+      }
     }
 
     void step() override {
@@ -315,16 +461,68 @@ struct SKFWidget : ModuleWidget {
     }
   };
   
+  struct PrecisionMenuItem : MenuItem {
+    SKF* _module;
+    const int _precision;
+
+    PrecisionMenuItem(SKF* module, const char* label, DSPPrecision precision)
+      : _module(module)
+      , _precision(precision)
+    {
+      this->text = label;
+    }
+
+    void onAction(const event::Action& e) override {
+      // voices of the new precision start from rest
+      for(int ii = 0; ii < 4; ii++){    
+	_module->skf[ii].ResetFilterState();
+      }
+      for(int ii = 0; ii < 16; ii++){    
+	_module->skfDouble[ii].ResetFilterState();
+      }
+      _module->_precision = (DSPPrecision)(_precision);
+    }
+
+    void step() override {
+      MenuItem::step();
+      rightText = _module->_precision == _precision ? "✔" : "";
+    }
+  };
+  
+  struct ControlRateMenuItem : MenuItem {
+    SKF* _module;
+    const int _controlRate;
+
+    ControlRateMenuItem(SKF* module, const char* label, int controlRate)
+      : _module(module)
+      , _controlRate(controlRate)
+    {
+      this->text = label;
+    }
+
+    void onAction(const event::Action& e) override {
+      _module->_controlRate = _controlRate;
+    }
+
+    void step() override {
+      MenuItem::step();
+      rightText = _module->_controlRate == _controlRate ? "✔" : "";
+    }
+  };
+  
   void appendContextMenu(Menu* menu) override {
     SKF* a = dynamic_cast<SKF*>(module);
     assert(a);
     
     menu->addChild(new MenuSeparator());
     menu->addChild(createMenuLabel("Oversampling"));
+    menu->addChild(new OversamplingMenuItem(a, "Oversampling: auto", OVERSAMPLER_AUTO));
     menu->addChild(new OversamplingMenuItem(a, "Oversampling: off", 1));
     menu->addChild(new OversamplingMenuItem(a, "Oversampling: x2", 2));
     menu->addChild(new OversamplingMenuItem(a, "Oversampling: x4", 4));
     menu->addChild(new OversamplingMenuItem(a, "Oversampling: x8", 8));
+    menu->addChild(new OversamplingMenuItem(a, "Oversampling: x16", 16));
+    menu->addChild(new OversamplingMenuItem(a, "Oversampling: x32", 32));
 
     menu->addChild(new MenuSeparator());
     menu->addChild(createMenuLabel("Decimator order"));
@@ -335,6 +533,18 @@ struct SKFWidget : ModuleWidget {
     menu->addChild(new MenuSeparator());
     menu->addChild(createMenuLabel("Integration Method"));
     menu->addChild(new IntegrationMenuItem(a, "Trapezoidal", SK_TRAPEZOIDAL));
+
+    menu->addChild(new MenuSeparator());
+    menu->addChild(createMenuLabel("DSP precision"));
+    menu->addChild(new PrecisionMenuItem(a, "Float (SIMD)", DSP_PRECISION_FLOAT));
+    menu->addChild(new PrecisionMenuItem(a, "Double", DSP_PRECISION_DOUBLE));
+
+    menu->addChild(new MenuSeparator());
+    menu->addChild(createMenuLabel("Knob rate"));
+    menu->addChild(new ControlRateMenuItem(a, "Audio rate", 1));
+    menu->addChild(new ControlRateMenuItem(a, "Every 8 samples", 8));
+    menu->addChild(new ControlRateMenuItem(a, "Every 16 samples", 16));
+    menu->addChild(new ControlRateMenuItem(a, "Every 32 samples", 32));
   }
 };
 
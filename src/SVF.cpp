@@ -21,6 +21,8 @@
 
 #include "plugin.hpp"
 #include "svfilter.h"
+#include "paramcache.h"
+#include "controlrate.h"
 
 struct SVF_1 : Module {
   enum ParamIds {
@@ -40,6 +42,10 @@ struct SVF_1 : Module {
   };
   enum OutputIds {
      OUTPUT_OUTPUT,
+     LP_OUTPUT,
+     BP_OUTPUT,
+     HP_OUTPUT,
+     NOTCH_OUTPUT,
      NUM_OUTPUTS
   };
   enum LightIds {
@@ -48,11 +54,27 @@ struct SVF_1 : Module {
 
   int _oversampling = 2;
   int _decimatorOrder = 16;
+  DSPPrecision _precision = DSP_PRECISION_FLOAT;
+  int _controlRate = 16;
   
   SVFIntegrationMethod _integrationMethod = SVF_INV_TRAPEZOIDAL;
   
-  // create svf class instances
-  SVFilter svf[16];
+  // create svf class instances, four voices each
+  SVFilterX4 svf[4];
+
+  // double precision voices, one per channel
+  SVFilter svfDouble[16];
+
+  // gain compensation follows the gain knob
+  ParamCache gainCompParam;
+
+  // cutoff and resonance knobs are sampled at control rate
+  // and ramped linearly in between, cv stays at audio rate
+  ControlRateDivider controlDivider;
+  ControlRamp cutoffRamp;
+  ControlRamp resoRamp;
+  float cutoffTarget = 0.f;
+  float resoTarget = 0.f;
   
   SVF_1() {
     config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -66,6 +88,10 @@ struct SVF_1 : Module {
     configInput(EXPCV_INPUT, "Exponential CV");
     configInput(INPUT_INPUT, "Audio");
     configOutput(OUTPUT_OUTPUT, "Filter");
+    configOutput(LP_OUTPUT, "Lowpass");
+    configOutput(BP_OUTPUT, "Bandpass");
+    configOutput(HP_OUTPUT, "Highpass");
+    configOutput(NOTCH_OUTPUT, "Notch");
     configBypass(INPUT_INPUT, OUTPUT_OUTPUT);
   }
 
@@ -79,105 +105,231 @@ struct SVF_1 : Module {
     }    
     
     // parameters
-    float cutoff = params[FREQ_PARAM].getValue();
     float lincv_atten = params[LINCV_ATTEN_PARAM].getValue();
     float expcv_atten = params[EXPCV_ATTEN_PARAM].getValue();
-    float reso = params[RESO_PARAM].getValue();
     float gain = params[GAIN_PARAM].getValue();
     float gainComp = params[GAIN_PARAM].getValue() - 0.5;
 
     // shape panel input for a pseudoexponential response
-    cutoff = 0.001+2.25*(cutoff * cutoff * cutoff * cutoff);
     gain *= gain * gain * gain;
     lincv_atten *= lincv_atten*lincv_atten;
     expcv_atten *= expcv_atten*expcv_atten;
     
     // compute gain compensation to normalize output on high drive levels
-    if(gainComp < 0.0) {
-      gainComp = 0.0;
+    gainComp = gainCompParam.Get(gainComp, [](float x){
+	if(x < 0.0) {
+	  x = 0.0;
+	}
+	return 5.0 * (1.0 - 2.0 * std::log(1.0 + 0.925*x));
+      });
+    
+    // decimate only the responses with a connected output
+    int responseMask = 0;
+    for(int rr = 0; rr < SVF_NUM_RESPONSES; rr++){
+      if(outputs[LP_OUTPUT + rr].isConnected()){
+	responseMask |= 1 << rr;
+      }
+    }
+    
+    // sample and shape cutoff and resonance knobs at control rate
+    bool controlTick = controlDivider.Tick(_controlRate);
+    if(controlTick){
+      float cutoffKnob = params[FREQ_PARAM].getValue();
+      cutoffTarget = 0.001+2.25*(cutoffKnob * cutoffKnob * cutoffKnob * cutoffKnob);
+      resoTarget = params[RESO_PARAM].getValue();
+      cutoffRamp.SetTarget(cutoffTarget, _controlRate);
+      resoRamp.SetTarget(resoTarget, _controlRate);
+    }
+    float cutoff = cutoffRamp.Next();
+    float reso = resoRamp.Next();
+    
+    // without cutoff cv the voices compute their integration rate on
+    // control ticks and ramp it themselves, patched cv stays at audio rate
+    bool cvPatched = inputs[LINCV_INPUT].isConnected() || inputs[EXPCV_INPUT].isConnected();
+    
+    // with mono cv inputs all voices share
+    // the same cutoff, compute it once per sample
+    bool monoCV = inputs[LINCV_INPUT].getChannels() <= 1 && inputs[EXPCV_INPUT].getChannels() <= 1;
+    if(cvPatched && monoCV){
+      cutoff += lincv_atten*inputs[LINCV_INPUT].getVoltage()/10.f;
+      cutoff *= FloatExp2(expcv_atten*inputs[EXPCV_INPUT].getVoltage());
     }
-    gainComp = 5.0 * (1.0 - 2.0 * std::log(1.0 + 0.925*gainComp));
     
-    for(int ii = 0; ii < channels; ii++){      
-      float channelCutoff = cutoff;
+    // process four channels per filter instance
+    for(int ii = 0; ii < channels; ii += 4){
+      float channelCutoff[4];
+      float channelExpCV[4];
+      float channelInput[4];
+      float channelOutput[4];
+      float channelResponse[SVF_NUM_RESPONSES][4];
       
-      // sum in linear cv
-      if(inputs[LINCV_INPUT].getChannels() == 1){
-	channelCutoff += lincv_atten*inputs[LINCV_INPUT].getVoltage()/10.f;
+      for(int jj = 0; jj < 4; jj++){
+	int ch = ii + jj;
+	
+	channelCutoff[jj] = cutoff;
+
+	if(!monoCV){
+	  // sum in linear cv
+	  if(inputs[LINCV_INPUT].getChannels() == 1){
+	    channelCutoff[jj] += lincv_atten*inputs[LINCV_INPUT].getVoltage()/10.f;
+	  }
+	  else{
+	    channelCutoff[jj] += lincv_atten*inputs[LINCV_INPUT].getVoltage(ch)/10.f;
+	  }
+	
+	  // exponential cv
+	  if(inputs[EXPCV_INPUT].getChannels() == 1){
+	    channelExpCV[jj] = expcv_atten*inputs[EXPCV_INPUT].getVoltage();
+	  }
+	  else{
+	    channelExpCV[jj] = expcv_atten*inputs[EXPCV_INPUT].getVoltage(ch);
+	  }
+	}
+
+	// unused lanes run silent
+	channelInput[jj] = ch < channels ? inputs[INPUT_INPUT].getVoltage(ch) * gain : 0.f;
       }
-      else{
-	channelCutoff += lincv_atten*inputs[LINCV_INPUT].getVoltage(ii)/10.f;
+
+      // apply exponential cv to all four lanes at once
+      if(!monoCV){
+	Float4Store(channelCutoff, Float4Load(channelCutoff) * Float4Exp2(Float4Load(channelExpCV)));
       }
       
-      // apply exponential cv
-      if(inputs[EXPCV_INPUT].getChannels() == 1){
-	channelCutoff = channelCutoff * std::pow(2.f, expcv_atten*inputs[EXPCV_INPUT].getVoltage());
+      if(_precision == DSP_PRECISION_DOUBLE){
+	// double precision voices tick one channel at a time
+	for(int jj = 0; jj < 4 && ii + jj < channels; jj++){
+	  if(cvPatched){
+	    svfDouble[ii + jj].SetFilterCutoff((double)(channelCutoff[jj]));
+	    svfDouble[ii + jj].SetFilterResonance((double)(reso));
+	  }
+	  else if(controlTick){
+	    svfDouble[ii + jj].SetFilterControlRamp((double)(cutoffTarget), (double)(resoTarget), _controlRate);
+	  }
+	  svfDouble[ii + jj].SetFilterMode((SVFFilterMode)(params[MODE_PARAM].getValue()));
+	  svfDouble[ii + jj].SetFilterResponseMask(responseMask);
+	  svfDouble[ii + jj].filter(channelInput[jj]);
+	  channelOutput[jj] = (float)(svfDouble[ii + jj].GetFilterOutput() * gainComp);
+	  for(int rr = 0; rr < SVF_NUM_RESPONSES; rr++){
+	    channelResponse[rr][jj] = (float)(svfDouble[ii + jj].GetFilterResponse((SVFFilterMode)(rr)) * gainComp);
+	  }
+	}
       }
       else{
-	channelCutoff = channelCutoff * std::pow(2.f, expcv_atten*inputs[EXPCV_INPUT].getVoltage(ii));
+	// set filter parameters
+	if(cvPatched){
+	  svf[ii/4].SetFilterCutoff(Float4Load(channelCutoff));
+	  svf[ii/4].SetFilterResonance(Float4(reso));
+	}
+	else if(controlTick){
+	  svf[ii/4].SetFilterControlRamp(Float4(cutoffTarget), Float4(resoTarget), _controlRate);
+	}
+	svf[ii/4].SetFilterMode((SVFFilterMode)(params[MODE_PARAM].getValue()));
+	svf[ii/4].SetFilterResponseMask(responseMask);
+    
+	// tick filter state
+	svf[ii/4].filter(Float4Load(channelInput));
+      
+	// set output
+	Float4Store(channelOutput, svf[ii/4].GetFilterOutput() * gainComp);
+	for(int rr = 0; rr < SVF_NUM_RESPONSES; rr++){
+	  Float4Store(channelResponse[rr], svf[ii/4].GetFilterResponse((SVFFilterMode)(rr)) * gainComp);
+	}
       }
       
-      // set filter parameters
-      svf[ii].SetFilterCutoff((double)(channelCutoff));
-      svf[ii].SetFilterResonance((double)(reso));
-      svf[ii].SetFilterMode((SVFFilterMode)(params[MODE_PARAM].getValue()));
+      for(int jj = 0; jj < 4 && ii + jj < channels; jj++){
+	outputs[OUTPUT_OUTPUT].setVoltage(channelOutput[jj], ii + jj);
+	for(int rr = 0; rr < SVF_NUM_RESPONSES; rr++){
+	  outputs[LP_OUTPUT + rr].setVoltage(channelResponse[rr][jj], ii + jj);
+	}
+      }
+    }
     
-      // tick filter state
-#ifdef FLOATDSP
-      svf[ii].filter((float)(inputs[INPUT_INPUT].getVoltage(ii) * gain));
-#else
-      svf[ii].filter((double)(inputs[INPUT_INPUT].getVoltage(ii) * gain));
-#endif
-      
-      // set output
-      outputs[OUTPUT_OUTPUT].setVoltage((float)(svf[ii].GetFilterOutput() * gainComp), ii);
+    // idle voices jump to the control targets so that they
+    // start from the current knob settings once they run
+    if(controlTick && !cvPatched){
+      int activeX4 = _precision == DSP_PRECISION_DOUBLE ? 0 : (channels + 3) / 4;
+      int activeDouble = _precision == DSP_PRECISION_DOUBLE ? channels : 0;
+      for(int ii = activeX4; ii < 4; ii++){
+	svf[ii].SetFilterControlRamp(Float4(cutoffTarget), Float4(resoTarget), 1);
+      }
+      for(int ii = activeDouble; ii < 16; ii++){
+	svfDouble[ii].SetFilterControlRamp((double)(cutoffTarget), (double)(resoTarget), 1);
+      }
     }
-
-    // set output to be polyphonic
+    
+    // set outputs to be polyphonic
     outputs[OUTPUT_OUTPUT].setChannels(channels);    
+    for(int rr = 0; rr < SVF_NUM_RESPONSES; rr++){
+      outputs[LP_OUTPUT + rr].setChannels(channels);
+    }
   }
 
   void onSampleRateChange() override {
     float sr = APP->engine->getSampleRate();
-    for(int ii = 0; ii < 16; ii++){    
+    for(int ii = 0; ii < 4; ii++){    
       svf[ii].SetFilterSampleRate(sr);
     }
+    for(int ii = 0; ii < 16; ii++){    
+      svfDouble[ii].SetFilterSampleRate(sr);
+    }
   }
 
   void onReset() override {
     float sr = APP->engine->getSampleRate();
     
-    for(int ii = 0; ii < 16; ii++){    
+    for(int ii = 0; ii < 4; ii++){    
       svf[ii].ResetFilterState();
       svf[ii].SetFilterSampleRate(sr);
-      svf[ii].SetFilterCutoff((double)(0.25));
-      svf[ii].SetFilterResonance((double)(0.0));
+      svf[ii].SetFilterCutoff(Float4(0.25f));
+      svf[ii].SetFilterResonance(Float4(0.0f));
       svf[ii].SetFilterMode(SVF_LOWPASS_MODE);
       svf[ii].SetFilterIntegrationMethod(_integrationMethod);
       svf[ii].SetFilterOversamplingFactor(_oversampling);
       svf[ii].SetFilterDecimatorOrder(_decimatorOrder);
     }
+    for(int ii = 0; ii < 16; ii++){    
+      svfDouble[ii].ResetFilterState();
+      svfDouble[ii].SetFilterSampleRate(sr);
+      svfDouble[ii].SetFilterCutoff(0.25f);
+      svfDouble[ii].SetFilterResonance(0.0f);
+      svfDouble[ii].SetFilterMode(SVF_LOWPASS_MODE);
+      svfDouble[ii].SetFilterIntegrationMethod(_integrationMethod);
+      svfDouble[ii].SetFilterOversamplingFactor(_oversampling);
+      svfDouble[ii].SetFilterDecimatorOrder(_decimatorOrder);
+    }
   }
 
   void onAdd() override {
     float sr = APP->engine->getSampleRate();
     
-    for(int ii = 0; ii < 16; ii++){    
+    for(int ii = 0; ii < 4; ii++){    
       svf[ii].ResetFilterState();
       svf[ii].SetFilterSampleRate(sr);
-      svf[ii].SetFilterCutoff((double)(0.25));
-      svf[ii].SetFilterResonance((double)(0.0));
+      svf[ii].SetFilterCutoff(Float4(0.25f));
+      svf[ii].SetFilterResonance(Float4(0.0f));
       svf[ii].SetFilterMode(SVF_LOWPASS_MODE);
       svf[ii].SetFilterIntegrationMethod(_integrationMethod);
       svf[ii].SetFilterOversamplingFactor(_oversampling);
       svf[ii].SetFilterDecimatorOrder(_decimatorOrder);
     }
+    for(int ii = 0; ii < 16; ii++){    
+      svfDouble[ii].ResetFilterState();
+      svfDouble[ii].SetFilterSampleRate(sr);
+      svfDouble[ii].SetFilterCutoff(0.25f);
+      svfDouble[ii].SetFilterResonance(0.0f);
+      svfDouble[ii].SetFilterMode(SVF_LOWPASS_MODE);
+      svfDouble[ii].SetFilterIntegrationMethod(_integrationMethod);
+      svfDouble[ii].SetFilterOversamplingFactor(_oversampling);
+      svfDouble[ii].SetFilterDecimatorOrder(_decimatorOrder);
+    }
   }
   
   json_t* dataToJson() override {
     json_t* rootJ = json_object();
     
     json_object_set_new(rootJ, "integrationMethod", json_integer((int)(_integrationMethod)));
+    json_object_set_new(rootJ, "precision", json_integer((int)(_precision)));
+    json_object_set_new(rootJ, "controlRate", json_integer(_controlRate));
     json_object_set_new(rootJ, "oversampling", json_integer(_oversampling));
     json_object_set_new(rootJ, "decimatorOrder", json_integer(_decimatorOrder));
     
@@ -185,13 +337,26 @@ struct SVF_1 : Module {
   }
 
   void dataFromJson(json_t* rootJ) override {
+    // patches saved before the precision option ran in double
+    json_t* precisionJ = json_object_get(rootJ, "precision");
+    _precision = precisionJ ? (DSPPrecision)(json_integer_value(precisionJ)) : DSP_PRECISION_DOUBLE;
+
+    // patches saved before the control rate option ran at audio rate
+    json_t* controlRateJ = json_object_get(rootJ, "controlRate");
+    _controlRate = controlRateJ ? json_integer_value(controlRateJ) : 1;
+
+    // clamp to the rates offered in the menu
+    _controlRate = (_controlRate <= 1 ? 1 : _controlRate <= 8 ? 8 : _controlRate <= 16 ? 16 : 32);
+
     json_t* integrationMethodJ = json_object_get(rootJ, "integrationMethod");
     if (integrationMethodJ && (_integrationMethod != (SVFIntegrationMethod)(json_integer_value(integrationMethodJ)))) {
       _integrationMethod = (SVFIntegrationMethod)(json_integer_value(integrationMethodJ));
       
       // set new integration method
-      for(int ii = 0; ii < 16; ii++)
+      for(int ii = 0; ii < 4; ii++)
 	svf[ii].SetFilterIntegrationMethod(_integrationMethod);
+      for(int ii = 0; ii < 16; ii++)
+	svfDouble[ii].SetFilterIntegrationMethod(_integrationMethod);
     }
     
     json_t* oversamplingJ = json_object_get(rootJ, "oversampling");
@@ -199,8 +364,10 @@ struct SVF_1 : Module {
       _oversampling = json_integer_value(oversamplingJ);
 
       // set new oversampling factor
-      for(int ii = 0; ii < 16; ii++)
+      for(int ii = 0; ii < 4; ii++)
 	svf[ii].SetFilterOversamplingFactor(_oversampling);
+      for(int ii = 0; ii < 16; ii++)
+	svfDouble[ii].SetFilterOversamplingFactor(_oversampling);
     }
     
     json_t* decimatorOrderJ = json_object_get(rootJ, "decimatorOrder");
@@ -208,8 +375,10 @@ struct SVF_1 : Module {
       _decimatorOrder = json_integer_value(decimatorOrderJ);
 
       // set new decimator order
-      for(int ii = 0; ii < 16; ii++)
+      for(int ii = 0; ii < 4; ii++)
 	svf[ii].SetFilterDecimatorOrder(_decimatorOrder);
+      for(int ii = 0; ii < 16; ii++)
+	svfDouble[ii].SetFilterDecimatorOrder(_decimatorOrder);
     }
   }
 };
@@ -238,6 +407,11 @@ struct SVFWidget : ModuleWidget {
     addInput(createInputCentered<PJ301MPort>(mm2px(Vec(8.96, 104.7)), module, SVF_1::INPUT_INPUT));
     
     addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(21.681, 104.7)), module, SVF_1::OUTPUT_OUTPUT));
+    
+    addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(35.56, 52.44)), module, SVF_1::LP_OUTPUT));
+    addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(35.56, 69.86)), module, SVF_1::BP_OUTPUT));
+    addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(35.56, 87.28)), module, SVF_1::HP_OUTPUT));
+    addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(35.56, 104.7)), module, SVF_1::NOTCH_OUTPUT));
   }
 
   struct OversamplingMenuItem : MenuItem {
@@ -253,9 +427,12 @@ struct SVFWidget : ModuleWidget {
 
     void onAction(const event::Action& e) override {
       _module->_oversampling = _oversampling;
-      for(int ii = 0; ii < 16; ii++){    
+      for(int ii = 0; ii < 4; ii++){    
 	_module->svf[ii].SetFilterOversamplingFactor(_module->_oversampling);
       }
+      for(int ii = 0; ii < 16; ii++){    
+	_module->svfDouble[ii].SetFilterOversamplingFactor(_module->_oversampling);
+      }
     }
 
     void step() override {
@@ -277,9 +454,12 @@ struct SVFWidget : ModuleWidget {
 
     void onAction(const event::Action& e) override {
       _module->_decimatorOrder = _decimatorOrder;
-      for(int ii = 0; ii < 16; ii++){    
+      for(int ii = 0; ii < 4; ii++){    
 	_module->svf[ii].SetFilterDecimatorOrder(_module->_decimatorOrder);
       }
+      for(int ii = 0; ii < 16; ii++){    
+	_module->svfDouble[ii].SetFilterDecimatorOrder(_module->_decimatorOrder);
+      }
     }
 
     void step() override {
@@ -301,9 +481,12 @@ struct SVFWidget : ModuleWidget {
 
     void onAction(const event::Action& e) override {
       _module->_integrationMethod = _integrationMethod;
-      for(int ii = 0; ii < 16; ii++){
+      for(int ii = 0; ii < 4; ii++){
 	_module->svf[ii].SetFilterIntegrationMethod(_module->_integrationMethod);
       }
+      for(int ii = 0; ii < 16; ii++){
+	_module->svfDouble[ii].SetFilterIntegrationMethod(_module->_integrationMethod);
+      }
     }
 
     void step() override {
@@ -312,16 +495,68 @@ struct SVFWidget : ModuleWidget {
     }
   };
   
+  struct PrecisionMenuItem : MenuItem {
+    SVF_1* _module;
+    const int _precision;
+
+    PrecisionMenuItem(SVF_1* module, const char* label, DSPPrecision precision)
+      : _module(module)
+      , _precision(precision)
+    {
+      this->text = label;
+    }
+
+    void onAction(const event::Action& e) override {
+      // voices of the new precision start from rest
+      for(int ii = 0; ii < 4; ii++){    
+	_module->svf[ii].ResetFilterState();
+      }
+      for(int ii = 0; ii < 16; ii++){    
+	_module->svfDouble[ii].ResetFilterState();
+      }
+      _module->_precision = (DSPPrecision)(_precision);
+    }
+
+    void step() override {
+      MenuItem::step();
+      rightText = _module->_precision == _precision ? "✔" : "";
+    }
+  };
+  
+  struct ControlRateMenuItem : MenuItem {
+    SVF_1* _module;
+    const int _controlRate;
+
+    ControlRateMenuItem(SVF_1* module, const char* label, int controlRate)
+      : _module(module)
+      , _controlRate(controlRate)
+    {
+      this->text = label;
+    }
+
+    void onAction(const event::Action& e) override {
+      _module->_controlRate = _controlRate;
+    }
+
+    void step() override {
+      MenuItem::step();
+      rightText = _module->_controlRate == _controlRate ? "✔" : "";
+    }
+  };
+  
   void appendContextMenu(Menu* menu) override {
     SVF_1* a = dynamic_cast<SVF_1*>(module);
     assert(a);
     
     menu->addChild(new MenuSeparator());
     menu->addChild(createMenuLabel("Oversampling"));
+    menu->addChild(new OversamplingMenuItem(a, "Oversampling: auto", OVERSAMPLER_AUTO));
     menu->addChild(new OversamplingMenuItem(a, "Oversampling: off", 1));
     menu->addChild(new OversamplingMenuItem(a, "Oversampling: x2", 2));
     menu->addChild(new OversamplingMenuItem(a, "Oversampling: x4", 4));
     menu->addChild(new OversamplingMenuItem(a, "Oversampling: x8", 8));
+    menu->addChild(new OversamplingMenuItem(a, "Oversampling: x16", 16));
+    menu->addChild(new OversamplingMenuItem(a, "Oversampling: x32", 32));
 
     menu->addChild(new MenuSeparator());
     menu->addChild(createMenuLabel("Decimator order"));
@@ -333,6 +568,18 @@ struct SVFWidget : ModuleWidget {
     menu->addChild(createMenuLabel("Integration Method"));
     menu->addChild(new IntegrationMenuItem(a, "Trapezoidal", SVF_TRAPEZOIDAL));
     menu->addChild(new IntegrationMenuItem(a, "Inverse Trapezoidal", SVF_INV_TRAPEZOIDAL));
+
+    menu->addChild(new MenuSeparator());
+    menu->addChild(createMenuLabel("DSP precision"));
+    menu->addChild(new PrecisionMenuItem(a, "Float (SIMD)", DSP_PRECISION_FLOAT));
+    menu->addChild(new PrecisionMenuItem(a, "Double", DSP_PRECISION_DOUBLE));
+
+    menu->addChild(new MenuSeparator());
+    menu->addChild(createMenuLabel("Knob rate"));
+    menu->addChild(new ControlRateMenuItem(a, "Audio rate", 1));
+    menu->addChild(new ControlRateMenuItem(a, "Every 8 samples", 8));
+    menu->addChild(new ControlRateMenuItem(a, "Every 16 samples", 16));
+    menu->addChild(new ControlRateMenuItem(a, "Every 32 samples", 32));
   }
 };
 
@@ -0,0 +1,366 @@
+/*
+ *  (C) 2026 Janne Heikkarainen <janne808@radiofreerobotron.net>
+ *
+ *  All rights reserved.
+ *
+ *  This file is part of Kocmoc VCV Rack plugin.
+ *
+ *  Kocmoc VCV Rack plugin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Kocmoc VCV Rack plugin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kocmoc VCV Rack plugin.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <osdialog.h>
+#include "plugin.hpp"
+#include "convolver.h"
+#include "wavfile.h"
+
+// longest impulse response read from file in seconds
+#define TAPS_MAX_IR_LENGTH 10
+
+// default convolution block size
+#define TAPS_DEFAULT_BLOCK_SIZE 128
+
+// impulse response kernel and per voice convolution state,
+// built on the ui thread and handed over to the engine whole
+struct TAPSConvolution {
+  ConvolutionKernel kernel;
+  FFTConvolver convolver[16];
+
+  TAPSConvolution(const float* impulseResponse, int length, int blockSize)
+    : kernel(impulseResponse, length, blockSize)
+  {
+    for(int ii = 0; ii < 16; ii++){
+      convolver[ii].SetKernel(&kernel);
+    }
+  }
+};
+
+struct TAPS : Module {
+  enum ParamIds {
+     GAIN_PARAM,
+     DRY_WET_PARAM,
+     NUM_PARAMS
+  };
+  enum InputIds {
+     INPUT_INPUT,
+     NUM_INPUTS
+  };
+  enum OutputIds {
+     OUTPUT_OUTPUT,
+     NUM_OUTPUTS
+  };
+  enum LightIds {
+     NUM_LIGHTS
+  };
+
+  int _blockSize = TAPS_DEFAULT_BLOCK_SIZE;
+  std::string _path;
+
+  // impulse response as read from file
+  std::vector<float> irSamples;
+  double irSampleRate = 0.0;
+
+  // convolution state handover between ui and engine threads,
+  // the engine only swaps pointers and the ui frees retired state
+  TAPSConvolution* active = NULL;
+  std::atomic<TAPSConvolution*> pending;
+  std::atomic<TAPSConvolution*> retired;
+  std::atomic<bool> rebuild;
+  
+  TAPS() {
+    config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+    configParam(GAIN_PARAM, 0.f, 2.f, 1.f, "Gain");
+    configParam(DRY_WET_PARAM, 0.f, 1.f, 1.f, "Dry/Wet");
+    configInput(INPUT_INPUT, "Audio");
+    configOutput(OUTPUT_OUTPUT, "Convolution");
+    configBypass(INPUT_INPUT, OUTPUT_OUTPUT);
+
+    pending.store(NULL);
+    retired.store(NULL);
+    rebuild.store(false);
+  }
+
+  ~TAPS() override {
+    delete active;
+    delete pending.load();
+    delete retired.load();
+  }
+
+  void process(const ProcessArgs& args) override {
+    // pick up new convolution state once the previous one has been freed
+    if(pending.load() && !retired.load()){
+      retired.store(active);
+      active = pending.exchange(NULL);
+    }
+    
+    // get channels from primary input 
+    int channels = inputs[INPUT_INPUT].getChannels();
+
+    // process at minimum single monophonic channel
+    if(channels == 0){
+      channels = 1;
+    }    
+    
+    // parameters
+    float gain = params[GAIN_PARAM].getValue();
+    float drywet = params[DRY_WET_PARAM].getValue();
+
+    // pass input through until an impulse response is loaded
+    if(!active || !active->kernel.GetPartitionCount()){
+      for(int ii = 0; ii < channels; ii++){
+	outputs[OUTPUT_OUTPUT].setVoltage(inputs[INPUT_INPUT].getVoltage(ii), ii);
+      }
+      outputs[OUTPUT_OUTPUT].setChannels(channels);
+      return;
+    }
+    
+    for(int ii = 0; ii < channels; ii++){
+      FFTConvolver& convolver = active->convolver[ii];
+
+      // dry signal delayed by the block latency to line up with the convolution
+      float dry = convolver.GetDelayedInput();
+      float wet = gain * convolver.Process(inputs[INPUT_INPUT].getVoltage(ii));
+      
+      // set output
+      outputs[OUTPUT_OUTPUT].setVoltage((1.f - drywet) * dry + drywet * wet, ii);
+    }
+    
+    // set output to be polyphonic
+    outputs[OUTPUT_OUTPUT].setChannels(channels);    
+  }
+
+  // read impulse response from wav file, called from the ui thread
+  bool LoadImpulseResponse(const std::string& path){
+    WavFile wav;
+    if(!wav.Open(path.c_str())){
+      return false;
+    }
+
+    int frames = wav.GetFrames();
+    int maxFrames = (int)(TAPS_MAX_IR_LENGTH * wav.GetSampleRate());
+    if(frames > maxFrames){
+      frames = maxFrames;
+    }
+    
+    irSamples.resize(frames);
+    irSampleRate = wav.GetSampleRate();
+    frames = wav.ReadMono(irSamples.data(), frames);
+    irSamples.resize(frames);
+    _path = path;
+    
+    BuildConvolution();
+    return true;
+  }
+
+  void ClearImpulseResponse(){
+    irSamples.clear();
+    _path.clear();
+    
+    BuildConvolution();
+  }
+  
+  // resample impulse response to engine rate and hand over
+  // a new convolution state, called from the ui thread
+  void BuildConvolution(){
+    double sampleRate = APP->engine->getSampleRate();
+    std::vector<float> ir;
+
+    if(!irSamples.empty()){
+      // linear interpolation resampling
+      double ratio = irSampleRate / sampleRate;
+      int length = (int)((irSamples.size() - 1) / ratio) + 1;
+      ir.resize(length);
+      for(int ii = 0; ii < length; ii++){
+	double t = ii * ratio;
+	int n = (int)(t);
+	double frac = t - n;
+	float x0 = irSamples[n];
+	float x1 = n + 1 < (int)(irSamples.size()) ? irSamples[n + 1] : 0.f;
+	ir[ii] = (float)((1.0 - frac) * x0 + frac * x1);
+      }
+
+      // normalize to unit energy so that broadband
+      // signals keep their level through the convolution
+      double energy = 0.0;
+      for(int ii = 0; ii < length; ii++){
+	energy += (double)(ir[ii]) * ir[ii];
+      }
+      if(energy > 0.0){
+	float scale = (float)(1.0 / std::sqrt(energy));
+	for(int ii = 0; ii < length; ii++){
+	  ir[ii] *= scale;
+	}
+      }
+    }
+    
+    TAPSConvolution* convolution = new TAPSConvolution(ir.data(), (int)(ir.size()), _blockSize);
+
+    // replace any state the engine has not picked up yet
+    delete pending.exchange(convolution);
+  }
+
+  // free convolution state released by the engine, called from the ui thread
+  void FreeRetired(){
+    delete retired.exchange(NULL);
+  }
+  
+  void onSampleRateChange() override {
+    rebuild.store(true);
+  }
+  
+  void onReset() override {
+    _blockSize = TAPS_DEFAULT_BLOCK_SIZE;
+    rebuild.store(true);
+  }
+  
+  json_t* dataToJson() override {
+    json_t* rootJ = json_object();
+    
+    json_object_set_new(rootJ, "blockSize", json_integer(_blockSize));
+    json_object_set_new(rootJ, "path", json_string(_path.c_str()));
+    
+    return rootJ;
+  }
+
+  void dataFromJson(json_t* rootJ) override {
+    json_t* blockSizeJ = json_object_get(rootJ, "blockSize");
+    if (blockSizeJ)
+      _blockSize = json_integer_value(blockSizeJ);
+
+    json_t* pathJ = json_object_get(rootJ, "path");
+    if (pathJ && json_is_string(pathJ)){
+      std::string path = json_string_value(pathJ);
+      if(!path.empty() && !LoadImpulseResponse(path)){
+	// keep the reference to an impulse response missing
+	// on this machine so that saving the patch keeps it
+	ClearImpulseResponse();
+	_path = path;
+      }
+    }
+  }
+};
+
+struct TAPSWidget : ModuleWidget {
+  TAPSWidget(TAPS* module) {
+    setModule(module);
+    setPanel(APP->window->loadSvg(asset::plugin(pluginInstance, "res/TAPS.svg")));
+
+    addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+
+    addParam(createParam<RoundSmallBlackKnob>(mm2px(Vec(6.281, 30.0)), module, TAPS::GAIN_PARAM));
+    addParam(createParam<RoundSmallBlackKnob>(mm2px(Vec(6.281, 54.0)), module, TAPS::DRY_WET_PARAM));
+
+    addInput(createInputCentered<PJ301MPort>(mm2px(Vec(10.281, 82.0)), module, TAPS::INPUT_INPUT));
+    addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(10.281, 103.3)), module, TAPS::OUTPUT_OUTPUT));
+  }
+
+  void step() override {
+    TAPS* a = dynamic_cast<TAPS*>(module);
+    if(a){
+      // rebuild convolution state on engine request
+      if(a->rebuild.exchange(false)){
+	a->BuildConvolution();
+      }
+      a->FreeRetired();
+    }
+    
+    ModuleWidget::step();
+  }
+  
+  struct LoadMenuItem : MenuItem {
+    TAPS* _module;
+
+    LoadMenuItem(TAPS* module, const char* label)
+      : _module(module)
+    {
+      this->text = label;
+    }
+
+    void onAction(const event::Action& e) override {
+      std::string dir = _module->_path.empty() ? "" : system::getDirectory(_module->_path);
+      osdialog_filters* filters = osdialog_filters_parse("WAV:wav");
+      char* path = osdialog_file(OSDIALOG_OPEN, dir.empty() ? NULL : dir.c_str(), NULL, filters);
+      osdialog_filters_free(filters);
+      
+      if(path){
+	_module->LoadImpulseResponse(path);
+	std::free(path);
+      }
+    }
+  };
+  
+  struct ClearMenuItem : MenuItem {
+    TAPS* _module;
+
+    ClearMenuItem(TAPS* module, const char* label)
+      : _module(module)
+    {
+      this->text = label;
+    }
+
+    void onAction(const event::Action& e) override {
+      _module->ClearImpulseResponse();
+    }
+  };
+  
+  struct BlockSizeMenuItem : MenuItem {
+    TAPS* _module;
+    const int _blockSize;
+
+    BlockSizeMenuItem(TAPS* module, const char* label, int blockSize)
+      : _module(module)
+      , _blockSize(blockSize)
+    {
+      this->text = label;
+    }
+
+    void onAction(const event::Action& e) override {
+      _module->_blockSize = _blockSize;
+      _module->BuildConvolution();
+    }
+
+    void step() override {
+      MenuItem::step();
+      rightText = _module->_blockSize == _blockSize ? "✔" : "";
+    }
+  };
+  
+  void appendContextMenu(Menu* menu) override {
+    TAPS* a = dynamic_cast<TAPS*>(module);
+    assert(a);
+    
+    menu->addChild(new MenuSeparator());
+    menu->addChild(createMenuLabel("Impulse response"));
+    menu->addChild(createMenuLabel(a->_path.empty() ? "(none)" : system::getFilename(a->_path)));
+    menu->addChild(new LoadMenuItem(a, "Load WAV file..."));
+    menu->addChild(new ClearMenuItem(a, "Clear"));
+
+    menu->addChild(new MenuSeparator());
+    menu->addChild(createMenuLabel("Block size"));
+    menu->addChild(new BlockSizeMenuItem(a, "Block size: 32", 32));
+    menu->addChild(new BlockSizeMenuItem(a, "Block size: 64", 64));
+    menu->addChild(new BlockSizeMenuItem(a, "Block size: 128", 128));
+    menu->addChild(new BlockSizeMenuItem(a, "Block size: 256", 256));
+    menu->addChild(new BlockSizeMenuItem(a, "Block size: 512", 512));
+    menu->addChild(new BlockSizeMenuItem(a, "Block size: 1024", 1024));
+  }
+};
+
+Model* modelTAPS = createModel<TAPS, TAPSWidget>("TAPS");
@@ -0,0 +1,95 @@
+/*
+ *  (C) 2026 Janne Heikkarainen <janne808@radiofreerobotron.net>
+ *
+ *  All rights reserved.
+ *
+ *  This file is part of Kocmoc VCV Rack plugin.
+ *
+ *  Kocmoc VCV Rack plugin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Kocmoc VCV Rack plugin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kocmoc VCV Rack plugin.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __kocmoccontrolrateh__
+#define __kocmoccontrolrateh__
+
+// counts host samples between control rate updates
+class ControlRateDivider{
+public:
+  ControlRateDivider(){
+    Reset();
+  }
+
+  // next tick updates
+  void Reset(){
+    count = 0;
+  }
+
+  // returns true once every rate samples
+  inline bool Tick(int rate){
+    if(--count <= 0){
+      count = rate;
+      return true;
+    }
+    return false;
+  }
+
+private:
+  int count;
+};
+
+// linear ramp of a control value toward the latest control rate
+// sample, the first target after a reset is taken as is
+class ControlRamp{
+public:
+  ControlRamp(){
+    value = target = increment = 0.0f;
+    Reset();
+  }
+
+  // jump to the next target
+  void Reset(){
+    valid = false;
+    remaining = 0;
+  }
+
+  // ramp to new target over the given number of samples
+  inline void SetTarget(float newTarget, int steps){
+    target = newTarget;
+    if(!valid || steps <= 1){
+      value = target;
+      remaining = 0;
+      valid = true;
+    }
+    else{
+      increment = (target - value) / (float)(steps);
+      remaining = steps;
+    }
+  }
+
+  // advance ramp by one sample
+  inline float Next(){
+    if(remaining > 0){
+      value = --remaining ? value + increment : target;
+    }
+    return value;
+  }
+
+private:
+  bool valid;
+  int remaining;
+  float value;
+  float target;
+  float increment;
+};
+
+#endif
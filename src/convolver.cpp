@@ -0,0 +1,273 @@
+/*
+ *  (C) 2026 Janne Heikkarainen <janne808@radiofreerobotron.net>
+ *
+ *  All rights reserved.
+ *
+ *  This file is part of Kocmoc VCV Rack plugin.
+ *
+ *  Kocmoc VCV Rack plugin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Kocmoc VCV Rack plugin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kocmoc VCV Rack plugin.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include "convolver.h"
+
+// round block size to a power of two within limits
+static int ConvolverBlockSize(int n){
+  int blockSize = CONVOLVER_MIN_BLOCK_SIZE;
+  while(blockSize < n && blockSize < CONVOLVER_MAX_BLOCK_SIZE){
+    blockSize <<= 1;
+  }
+  return blockSize;
+}
+
+// constructor
+ConvolutionKernel::ConvolutionKernel(const float* impulseResponse, int newLength, int newBlockSize){
+  re = im = 0;
+  SetImpulseResponse(impulseResponse, newLength, newBlockSize);
+}
+
+// default constructor
+ConvolutionKernel::ConvolutionKernel(){
+  length = 0;
+  blockSize = CONVOLVER_MIN_BLOCK_SIZE;
+  partitionCount = 0;
+  binCount = blockSize + 1;
+  re = im = 0;
+}
+
+// destructor
+ConvolutionKernel::~ConvolutionKernel(){
+  FreeBuffers();
+}
+
+void ConvolutionKernel::FreeBuffers(){
+  if(re){
+    delete[] re;
+    delete[] im;
+  }
+  re = im = 0;
+}
+
+void ConvolutionKernel::SetImpulseResponse(const float* impulseResponse, int newLength, int newBlockSize){
+  FreeBuffers();
+
+  length = newLength > 0 ? newLength : 0;
+  blockSize = ConvolverBlockSize(newBlockSize);
+  partitionCount = (length + blockSize - 1) / blockSize;
+  binCount = blockSize + 1;
+
+  if(partitionCount == 0){
+    return;
+  }
+  
+  re = new float[partitionCount * binCount];
+  im = new float[partitionCount * binCount];
+
+  RealFFT fft(2 * blockSize);
+  float *block = new float[2 * blockSize];
+
+  // fold inverse transform scaling into the kernel
+  float scale = 1.0f / (float)(2 * blockSize);
+  
+  for(int pp = 0; pp < partitionCount; pp++){
+    // zero-padded partition
+    int offset = pp * blockSize;
+    int n = length - offset < blockSize ? length - offset : blockSize;
+    for(int ii = 0; ii < 2 * blockSize; ii++){
+      block[ii] = ii < n ? scale * impulseResponse[offset + ii] : 0.0f;
+    }
+
+    fft.Forward(block, re + pp * binCount, im + pp * binCount);
+  }
+
+  delete[] block;
+}
+
+int ConvolutionKernel::GetLength() const{
+  return length;
+}
+
+int ConvolutionKernel::GetBlockSize() const{
+  return blockSize;
+}
+
+int ConvolutionKernel::GetPartitionCount() const{
+  return partitionCount;
+}
+
+int ConvolutionKernel::GetBinCount() const{
+  return binCount;
+}
+
+const float* ConvolutionKernel::GetPartitionReal(int partition) const{
+  return re + partition * binCount;
+}
+
+const float* ConvolutionKernel::GetPartitionImag(int partition) const{
+  return im + partition * binCount;
+}
+
+// constructor
+FFTConvolver::FFTConvolver(const ConvolutionKernel* newKernel){
+  kernel = 0;
+  inputBuffer = outputBuffer = 0;
+  fdlRe = fdlIm = 0;
+  accRe = accIm = timeBuffer = 0;
+  
+  SetKernel(newKernel);
+}
+
+// default constructor
+FFTConvolver::FFTConvolver(){
+  kernel = 0;
+  inputBuffer = outputBuffer = 0;
+  fdlRe = fdlIm = 0;
+  accRe = accIm = timeBuffer = 0;
+  blockSize = partitionCount = binCount = 0;
+  blockIndex = fdlIndex = 0;
+}
+
+// destructor
+FFTConvolver::~FFTConvolver(){
+  FreeBuffers();
+}
+
+void FFTConvolver::FreeBuffers(){
+  if(inputBuffer){
+    delete[] inputBuffer;
+    delete[] outputBuffer;
+    delete[] fdlRe;
+    delete[] fdlIm;
+    delete[] accRe;
+    delete[] accIm;
+    delete[] timeBuffer;
+  }
+  inputBuffer = outputBuffer = 0;
+  fdlRe = fdlIm = 0;
+  accRe = accIm = timeBuffer = 0;
+}
+
+void FFTConvolver::SetKernel(const ConvolutionKernel* newKernel){
+  FreeBuffers();
+
+  // an empty kernel disables the convolver
+  if(!newKernel || newKernel->GetPartitionCount() == 0){
+    kernel = 0;
+    blockSize = partitionCount = binCount = 0;
+    blockIndex = fdlIndex = 0;
+    return;
+  }
+  
+  kernel = newKernel;
+  blockSize = kernel->GetBlockSize();
+  partitionCount = kernel->GetPartitionCount();
+  binCount = kernel->GetBinCount();
+  fft.SetLength(2 * blockSize);
+  
+  inputBuffer = new float[2 * blockSize];
+  outputBuffer = new float[blockSize];
+  fdlRe = new float[partitionCount * binCount];
+  fdlIm = new float[partitionCount * binCount];
+  accRe = new float[binCount];
+  accIm = new float[binCount];
+  timeBuffer = new float[2 * blockSize];
+
+  Reset();
+}
+
+void FFTConvolver::Reset(){
+  if(!kernel){
+    return;
+  }
+  
+  memset(inputBuffer, 0, 2 * blockSize * sizeof(float));
+  memset(outputBuffer, 0, blockSize * sizeof(float));
+  memset(fdlRe, 0, partitionCount * binCount * sizeof(float));
+  memset(fdlIm, 0, partitionCount * binCount * sizeof(float));
+  blockIndex = 0;
+  fdlIndex = 0;
+}
+
+int FFTConvolver::GetLatency(){
+  return blockSize;
+}
+
+void FFTConvolver::ProcessBlock(const float* input, float* output, int n){
+  if(!kernel){
+    memset(output, 0, n * sizeof(float));
+    return;
+  }
+  
+  while(n > 0){
+    // copy up to the end of the current block
+    int m = blockSize - blockIndex;
+    if(m > n){
+      m = n;
+    }
+    
+    memcpy(inputBuffer + blockSize + blockIndex, input, m * sizeof(float));
+    memcpy(output, outputBuffer + blockIndex, m * sizeof(float));
+    
+    blockIndex += m;
+    input += m;
+    output += m;
+    n -= m;
+
+    if(blockIndex == blockSize){
+      ProcessPartitions();
+      blockIndex = 0;
+    }
+  }
+}
+
+void FFTConvolver::ProcessPartitions(){
+  // transform last two input blocks into the delay line
+  float *xRe = fdlRe + fdlIndex * binCount;
+  float *xIm = fdlIm + fdlIndex * binCount;
+  fft.Forward(inputBuffer, xRe, xIm);
+
+  // sum products of delayed input spectra and kernel partitions
+  memset(accRe, 0, binCount * sizeof(float));
+  memset(accIm, 0, binCount * sizeof(float));
+
+  int slot = fdlIndex;
+  for(int pp = 0; pp < partitionCount; pp++){
+    const float* __restrict hRe = kernel->GetPartitionReal(pp);
+    const float* __restrict hIm = kernel->GetPartitionImag(pp);
+    const float* __restrict sRe = fdlRe + slot * binCount;
+    const float* __restrict sIm = fdlIm + slot * binCount;
+    float* __restrict aRe = accRe;
+    float* __restrict aIm = accIm;
+    
+    for(int kk = 0; kk < binCount; kk++){
+      aRe[kk] += sRe[kk] * hRe[kk] - sIm[kk] * hIm[kk];
+      aIm[kk] += sRe[kk] * hIm[kk] + sIm[kk] * hRe[kk];
+    }
+
+    // step back to the previous input spectrum
+    if(--slot < 0){
+      slot = partitionCount - 1;
+    }
+  }
+
+  // keep the alias free second half of the inverse transform
+  fft.Inverse(accRe, accIm, timeBuffer);
+  memcpy(outputBuffer, timeBuffer + blockSize, blockSize * sizeof(float));
+
+  // slide input window and advance delay line
+  memcpy(inputBuffer, inputBuffer + blockSize, blockSize * sizeof(float));
+  if(++fdlIndex == partitionCount){
+    fdlIndex = 0;
+  }
+}
@@ -0,0 +1,141 @@
+/*
+ *  (C) 2026 Janne Heikkarainen <janne808@radiofreerobotron.net>
+ *
+ *  All rights reserved.
+ *
+ *  This file is part of Kocmoc VCV Rack plugin.
+ *
+ *  Kocmoc VCV Rack plugin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Kocmoc VCV Rack plugin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kocmoc VCV Rack plugin.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __dspconvolverh__
+#define __dspconvolverh__
+
+#include "fft.h"
+
+// smallest and largest convolution block size
+#define CONVOLVER_MIN_BLOCK_SIZE 32
+#define CONVOLVER_MAX_BLOCK_SIZE 4096
+
+// impulse response split into uniform partitions of block size
+// samples, each stored as the spectrum of a zero-padded block of
+// twice the block size, shared by any number of convolvers
+class ConvolutionKernel{
+public:
+  // constructor/destructor
+  ConvolutionKernel(const float* impulseResponse, int newLength, int newBlockSize);
+  ConvolutionKernel();
+  ~ConvolutionKernel();
+
+  // partition and transform impulse response
+  void SetImpulseResponse(const float* impulseResponse, int newLength, int newBlockSize);
+
+  // get kernel parameters
+  int GetLength() const;
+  int GetBlockSize() const;
+  int GetPartitionCount() const;
+  int GetBinCount() const;
+
+  // get partition spectrum
+  const float* GetPartitionReal(int partition) const;
+  const float* GetPartitionImag(int partition) const;
+  
+private:
+  void FreeBuffers();
+  
+  // kernel parameters
+  int length;
+  int blockSize;
+  int partitionCount;
+  int binCount;
+
+  // partition spectra
+  float *re;
+  float *im;
+};
+
+// uniformly partitioned overlap-save FFT convolution
+// with a latency of one block
+class FFTConvolver{
+public:
+  // constructor/destructor
+  FFTConvolver(const ConvolutionKernel* newKernel);
+  FFTConvolver();
+  ~FFTConvolver();
+
+  // set kernel and allocate convolution state
+  void SetKernel(const ConvolutionKernel* newKernel);
+  
+  // clear convolution state
+  void Reset();
+
+  // convolve signal, one sample at a time
+  inline float Process(float input){
+    if(!kernel){
+      return 0.0f;
+    }
+    
+    float output = outputBuffer[blockIndex];
+    inputBuffer[blockSize + blockIndex] = input;
+
+    if(++blockIndex == blockSize){
+      ProcessPartitions();
+      blockIndex = 0;
+    }
+    
+    return output;
+  }
+
+  // convolve block of signal
+  void ProcessBlock(const float* input, float* output, int n);
+  
+  // input delayed by the convolver latency to line up
+  // with the next output, valid before Process is called
+  inline float GetDelayedInput(){
+    return kernel ? inputBuffer[blockIndex] : 0.0f;
+  }
+
+  // get latency in samples
+  int GetLatency();
+  
+private:
+  void FreeBuffers();
+  
+  // transform input block and sum partition products
+  void ProcessPartitions();
+
+  const ConvolutionKernel* kernel;
+  RealFFT fft;
+  
+  int blockSize;
+  int partitionCount;
+  int binCount;
+  
+  // last two input blocks and current output block
+  float *inputBuffer;
+  float *outputBuffer;
+  int blockIndex;
+  
+  // frequency domain delay line of input block spectra
+  float *fdlRe;
+  float *fdlIm;
+  int fdlIndex;
+
+  // spectrum accumulator and inverse transform buffer
+  float *accRe;
+  float *accIm;
+  float *timeBuffer;
+};
+
+#endif
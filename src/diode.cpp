@@ -24,18 +24,9 @@
 #include <cmath>
 #include "diode.h"
 
-#ifdef FLOATDSP
-#include "iir32.h"
-#else
-#include "iir.h"
-#endif
-
 #include "fastmath.h"
 #include "fastrand.h"
 
-// steepness of downsample filter response
-#define IIR_DOWNSAMPLE_ORDER 16
-
 // downsampling passthrough bandwidth
 #define IIR_DOWNSAMPLING_BANDWIDTH 0.725
 
@@ -45,15 +36,31 @@
 // check for newton-raphson breaking limit
 #define DIODE_NEWTON_BREAKING_LIMIT 1
 
+// newton-raphson step size breaking limit
+// relative to signal level, float and double paths
+#ifdef DIODE_NEWTON_BREAKING_LIMIT
+#define DIODE_NEWTON_TOLERANCE 1.0e-5f
+#define DIODE_NEWTON_TOLERANCE_DOUBLE 1.0e-9
+#else
+#define DIODE_NEWTON_TOLERANCE 0.0f
+#define DIODE_NEWTON_TOLERANCE_DOUBLE 0.0
+#endif
+
 // thermal phase noise amplitude
 #define DIODE_THERMAL_NOISE_AMPLITUDE 5.0e-2
 
+// thermal phase noise hold time in samples at control rate
+#define DIODE_NOISE_CONTROL_RATE 32
+
 // feedback DC decoupling integration rate
 #define DIODE_FEEDBACK_DC_DECOUPLING_INTEGRATION_RATE 0.005
 
 // maximum integration rate
 #define DIODE_MAX_INTEGRATION_RATE 0.9
 
+// maximum integration rate of the implicit solver
+#define DIODE_MAX_IMPLICIT_INTEGRATION_RATE 3.0
+
 // constructor
 Diode::Diode(double newCutoff, double newResonance, int newOversamplingFactor,
 	     DiodeFilterMode newFilterMode, double newSampleRate,
@@ -62,25 +69,37 @@ Diode::Diode(double newCutoff, double newResonance, int newOversamplingFactor,
   cutoffFrequency = newCutoff;
   Resonance = newResonance;
   filterMode = newFilterMode;
-  sampleRate = newSampleRate;
-  oversamplingFactor = newOversamplingFactor;
-  decimatorOrder = newDecimatorOrder;
+
+  // set up oversampling
+  oversampler.SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  oversampler.SetSampleRate(newSampleRate);
+  oversampler.SetOversamplingFactor(newOversamplingFactor);
+  oversampler.SetDecimatorOrder(newDecimatorOrder);
+  
+  integrationMethod = newIntegrationMethod;
+
+  // automatic oversampling starts from x1
+  autoOversampling = (newOversamplingFactor == OVERSAMPLER_AUTO);
+  governor.SetSampleRate(newSampleRate);
+  governor.Reset(oversampler.GetOversamplingFactor());
   
   SetFilterIntegrationRate();
+  dt_t1 = dt;
+
+  // thermal noise at audio rate
+  controlRateNoise = false;
+  noiseHold = 0;
 
   // initialize filter state
   p0 = p1 = p2 = p3 = out = ut_1 = 0.0f;
 
   hp0 = hp1 = hp2 = hp3 = hp4 = hp5 = 0.0;
   
-  integrationMethod = newIntegrationMethod;
-  
-  // instantiate downsampling filter
-#ifdef FLOATDSP
-  iir = new IIRLowpass32(sampleRate * oversamplingFactor, IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0, decimatorOrder);
-#else
-  iir = new IIRLowpass(sampleRate * oversamplingFactor, IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0, decimatorOrder);
-#endif
+  // initialize antialiasing state
+  ResetAntialiasingState();
+
+  // select filter kernel
+  SelectFilterKernel();
 
   // instantiate PRNG seed
   s = rand() | 1u;
@@ -92,25 +111,30 @@ Diode::Diode(){
   cutoffFrequency = 0.25;
   Resonance = 0.5;
   filterMode = DIODE_LOWPASS4_MODE;
-  sampleRate = 44100.0;
-  oversamplingFactor = 2;
-  decimatorOrder = IIR_DOWNSAMPLE_ORDER;
+
+  // set up oversampling
+  oversampler.SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  autoOversampling = false;
   
+  integrationMethod = DIODE_PREDICTOR_CORRECTOR_FULL_TANH;
+
   SetFilterIntegrationRate();
+  dt_t1 = dt;
   
+  // thermal noise at audio rate
+  controlRateNoise = false;
+  noiseHold = 0;
+
   // initialize filter state
   p0 = p1 = p2 = p3 = out = ut_1 = 0.0f;
 
   hp0 = hp1 = hp2 = hp3 = hp4 = hp5 = 0.0;
   
-  integrationMethod = DIODE_PREDICTOR_CORRECTOR_FULL_TANH;
-  
-  // instantiate downsampling filter
-#ifdef FLOATDSP
-  iir = new IIRLowpass32(sampleRate * oversamplingFactor, IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0, decimatorOrder);
-#else
-  iir = new IIRLowpass(sampleRate * oversamplingFactor, IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0, decimatorOrder);
-#endif
+  // initialize antialiasing state
+  ResetAntialiasingState();
+
+  // select filter kernel
+  SelectFilterKernel();
 
   // instantiate PRNG seed
   s = rand() | 1u;
@@ -118,7 +142,6 @@ Diode::Diode(){
 
 // default destructor
 Diode::~Diode(){
-  delete iir;
 }
 
 void Diode::ResetFilterState(){
@@ -127,16 +150,43 @@ void Diode::ResetFilterState(){
   Resonance = 0.0;
 
   SetFilterIntegrationRate();
+  dt_t1 = dt;
   
+  // initialize filter and decimator state
+  ClearFilterState();
+  
+  // wake from sleep
+  sleepDetector.Reset();
+
+  // restart oversampling governor
+  governor.Reset(oversampler.GetOversamplingFactor());
+}
+
+void Diode::ClearFilterState(){
   // initialize filter state
   p0 = p1 = p2 = p3 = out = ut_1 = 0.0;
 
   hp0 = hp1 = hp2 = hp3 = hp4 = hp5 = 0.0;
+  ResetAntialiasingState();
   
-  // set oversampling
-  iir->SetFilterSamplerate(sampleRate * oversamplingFactor);
-  iir->SetFilterCutoff(IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0);
-  iir->SetFilterOrder(decimatorOrder);  
+  // clear decimator state, the decimator design stays
+  oversampler.ClearState();
+}
+
+void Diode::EnterSleep(){
+  // stay awake until the filter state has decayed as well
+  if(fabs(p0) > SLEEP_THRESHOLD ||
+     fabs(p1) > SLEEP_THRESHOLD ||
+     fabs(p2) > SLEEP_THRESHOLD ||
+     fabs(p3) > SLEEP_THRESHOLD){
+    return;
+  }
+
+  // settle to rest at the current parameters
+  ClearFilterState();
+  dt_t1 = dt;
+
+  sleepDetector.Sleep();
 }
 
 void Diode::SetFilterCutoff(double newCutoff){
@@ -149,59 +199,118 @@ void Diode::SetFilterResonance(double newResonance){
   Resonance = newResonance;
 }
 
+void Diode::SetFilterControlRamp(double newCutoff, double newResonance, int steps){
+  double dt_start = dt;
+  double resonance_start = Resonance;
+
+  // integration rate at the new target
+  cutoffFrequency = newCutoff;
+  SetFilterIntegrationRate();
+  dtTarget = dt;
+  resonanceTarget = newResonance;
+
+  // single step ramps jump to the target
+  if(steps <= 1){
+    Resonance = newResonance;
+    return;
+  }
+  dtIncrement = (dtTarget - dt_start) / (double)(steps);
+  resonanceIncrement = (resonanceTarget - resonance_start) / (double)(steps);
+  dt = dt_start;
+  Resonance = resonance_start;
+  controlRampRemaining = steps;
+}
+
 void Diode::SetFilterMode(DiodeFilterMode newFilterMode){
   filterMode = newFilterMode;
 }
 
 void Diode::SetFilterSampleRate(double newSampleRate){
-  sampleRate = newSampleRate;
-  iir->SetFilterSamplerate(sampleRate * (double)(oversamplingFactor));
-  iir->SetFilterCutoff(IIR_DOWNSAMPLING_BANDWIDTH*sampleRate / 2.0);
-  iir->SetFilterOrder(decimatorOrder);
+  oversampler.SetSampleRate(newSampleRate);
+  governor.SetSampleRate(newSampleRate);
 
   SetFilterIntegrationRate();
+  dt_t1 = dt;
 }
 
 void Diode::SetFilterIntegrationMethod(DiodeIntegrationMethod method){
   integrationMethod = method;
+  ResetAntialiasingState();
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+  SelectFilterKernel();
 }
 
 void Diode::SetFilterOversamplingFactor(int newOversamplingFactor){
-  oversamplingFactor = newOversamplingFactor;
-  iir->SetFilterSamplerate(sampleRate * oversamplingFactor);
-  iir->SetFilterCutoff(IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0);
-  iir->SetFilterOrder(decimatorOrder);
+  // automatic oversampling starts from the current factor
+  autoOversampling = (newOversamplingFactor == OVERSAMPLER_AUTO);
+  if(autoOversampling){
+    governor.Reset(oversampler.GetOversamplingFactor());
+    return;
+  }
+
+  SwitchOversamplingFactor(newOversamplingFactor);
+}
+
+void Diode::SwitchOversamplingFactor(int newOversamplingFactor){
+  oversampler.SetOversamplingFactor(newOversamplingFactor);
+
+  // continue decimation from the current output level, priming
+  // restores the dc steady state only so switching is reduced-glitch
+  oversampler.Prime(out);
 
   SetFilterIntegrationRate();
+  dt_t1 = dt;
+  SelectFilterKernel();
 }
 
 void Diode::SetFilterDecimatorOrder(int newDecimatorOrder){
-  decimatorOrder = newDecimatorOrder;
-  iir->SetFilterOrder(decimatorOrder);
+  oversampler.SetDecimatorOrder(newDecimatorOrder);
+}
+
+void Diode::SetFilterControlRateNoise(bool newControlRateNoise){
+  controlRateNoise = newControlRateNoise;
+  noiseHold = 0;
 }
 
 void Diode::SetFilterIntegrationRate(){
   // normalize cutoff freq to samplerate
-  dt = 44100.0 / (sampleRate * oversamplingFactor) * cutoffFrequency;
+  dt = oversampler.GetIntegrationRate(cutoffFrequency);
 
-  // clamp integration rate
+  // clamp integration rate,
+  // the implicit solver stays stable at higher rates
+  double maxRate = (integrationMethod == DIODE_TRAPEZOIDAL_FULL_TANH ?
+		    DIODE_MAX_IMPLICIT_INTEGRATION_RATE : DIODE_MAX_INTEGRATION_RATE);
   if(dt < 0.0){
     dt = 0.0;
   }
-  else if(dt > DIODE_MAX_INTEGRATION_RATE){
-    dt = DIODE_MAX_INTEGRATION_RATE;
+  else if(dt > maxRate){
+    dt = maxRate;
   }
+
+  // direct updates stop the control rate ramp
+  controlRampRemaining = 0;
 }
 
 #ifdef FLOATDSP
 float Diode::GetDecouplingIntegrationRate(){
-  return 44100.0f / (sampleRate * oversamplingFactor) * (DIODE_FEEDBACK_DC_DECOUPLING_INTEGRATION_RATE * (1.0f - (Resonance * 0.08f)));
+  return oversampler.GetIntegrationRate(DIODE_FEEDBACK_DC_DECOUPLING_INTEGRATION_RATE * (1.0f - (Resonance * 0.08f)));
 }
 #else
 double Diode::GetDecouplingIntegrationRate(){
-  return 44100.0 / (sampleRate * oversamplingFactor) * (DIODE_FEEDBACK_DC_DECOUPLING_INTEGRATION_RATE * (1.0 - (Resonance * 0.08)));
+  return oversampler.GetIntegrationRate(DIODE_FEEDBACK_DC_DECOUPLING_INTEGRATION_RATE * (1.0 - (Resonance * 0.08)));
 }
 #endif
+void Diode::ResetAntialiasingState(){
+  // arguments as if the state had been held
+  xt_1[0] = ut_1 - 24.0 * Resonance * hp3;
+  xt_1[1] = xt_1[2] = p0 - p1;
+  xt_1[3] = xt_1[4] = p1 - p2;
+  xt_1[5] = xt_1[6] = p2 - p3;
+  xt_1[7] = p3;
+}
+
 double Diode::GetFilterCutoff(){
   return cutoffFrequency;
 }
@@ -211,11 +320,15 @@ double Diode::GetFilterResonance(){
 }
 
 int Diode::GetFilterOversamplingFactor(){
-  return oversamplingFactor;
+  return oversampler.GetOversamplingFactor();
 }
 
 int Diode::GetFilterDecimatorOrder(){
-  return decimatorOrder;
+  return oversampler.GetDecimatorOrder();
+}
+
+bool Diode::GetFilterControlRateNoise(){
+  return controlRateNoise;
 }
 
 #ifdef FLOATDSP
@@ -233,7 +346,7 @@ DiodeFilterMode Diode::GetFilterMode(){
 }
 
 double Diode::GetFilterSampleRate(){
-  return sampleRate;
+  return oversampler.GetSampleRate();
 }
 
 DiodeIntegrationMethod Diode::GetFilterIntegrationMethod(){
@@ -251,24 +364,40 @@ double Diode::GetNormalizedNoiseValue(){
 #endif
 
 #ifdef FLOATDSP
-void Diode::DiodeFilter(float input){
+template <DiodeIntegrationMethod method, int factor>
+void Diode::DiodeFilterKernel(float input){
   // feedback amount
   float fb = 24.f * Resonance;
 
   // noise term
   input += 1.0e-6f * GetNormalizedNoiseValue();
   
-  // inject thermal phase noise to filter stages
-  float alpha_0 = 1.0f + DIODE_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
-  float alpha_1 = 1.0f + DIODE_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
-  float alpha_2 = 1.0f + DIODE_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
-  float alpha_3 = 1.0f + DIODE_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+  // inject thermal phase noise to filter stages,
+  // held across a block at control rate
+  if(--noiseHold <= 0){
+    alpha_0 = 1.0f + DIODE_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+    alpha_1 = 1.0f + DIODE_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+    alpha_2 = 1.0f + DIODE_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+    alpha_3 = 1.0f + DIODE_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+    noiseHold = controlRateNoise ? DIODE_NOISE_CONTROL_RATE : 1;
+  }
   
+  // oversampling factor
+  const int oversamplingFactor = factor ? factor : oversampler.GetOversamplingFactor();
+
+  // integration rate ramps from the previous host sample
+  // to the current one across the substeps
+  float dt_step = (float)(dt - dt_t1) / (float)(oversamplingFactor);
+  float dt_n = (float)(dt_t1);
+
   // integrate filter state
   // with oversampling
   for(int nn = 0; nn < oversamplingFactor; nn++){
+    // ramp integration rate
+    dt_n += dt_step;
+
     // switch integration method
-    switch(integrationMethod){
+    switch(method){
     case DIODE_EULER_FULL_TANH:
       // semi-implicit euler integration
       // with full tanh stages
@@ -276,10 +405,10 @@ void Diode::DiodeFilter(float input){
 	// decoupling rate
 	float dt_hp = GetDecouplingIntegrationRate();
 	
-	p0 = p0 + alpha_0 * dt * (FloatTanhPade45(input - fb * hp3) - FloatTanhPade45(p0 - p1));
-	p1 = p1 + alpha_1 * 0.5f * dt * (FloatTanhPade45(p0 - p1) - FloatTanhPade45(p1 - p2));
-	p2 = p2 + alpha_2 * 0.5f * dt * (FloatTanhPade45(p1 - p2) - FloatTanhPade45(p2 - p3));
-	p3 = p3 + alpha_3 * 0.5f * dt * (FloatTanhPade45(p2 - p3) - FloatTanhPade45(p3));
+	p0 = p0 + alpha_0 * dt_n * (FloatTanhPade45(input - fb * hp3) - FloatTanhPade45(p0 - p1));
+	p1 = p1 + alpha_1 * 0.5f * dt_n * (FloatTanhPade45(p0 - p1) - FloatTanhPade45(p1 - p2));
+	p2 = p2 + alpha_2 * 0.5f * dt_n * (FloatTanhPade45(p1 - p2) - FloatTanhPade45(p2 - p3));
+	p3 = p3 + alpha_3 * 0.5f * dt_n * (FloatTanhPade45(p2 - p3) - FloatTanhPade45(p3));
 
 	hp0 = hp0 + dt_hp * (p3 - hp0);
 	hp1 = p3 - hp0;
@@ -312,10 +441,10 @@ void Diode::DiodeFilter(float input){
 	float dt_hp = GetDecouplingIntegrationRate();
 	
 	// predictor
-	p0_prime = p0 + alpha_0 * dt * (tanh_ut1_fb_hp3 - tanh_p0_p1);
-	p1_prime = p1 + alpha_1 * 0.5f * dt * (tanh_p0_p1 - tanh_p1_p2);
-	p2_prime = p2 + alpha_2 * 0.5f * dt * (tanh_p1_p2 - tanh_p2_p3);
-	p3_prime = p3 + alpha_3 * 0.5f * dt * (tanh_p2_p3 - tanh_p3);
+	p0_prime = p0 + alpha_0 * dt_n * (tanh_ut1_fb_hp3 - tanh_p0_p1);
+	p1_prime = p1 + alpha_1 * 0.5f * dt_n * (tanh_p0_p1 - tanh_p1_p2);
+	p2_prime = p2 + alpha_2 * 0.5f * dt_n * (tanh_p1_p2 - tanh_p2_p3);
+	p3_prime = p3 + alpha_3 * 0.5f * dt_n * (tanh_p2_p3 - tanh_p3);
 
 	hp0_prime = hp0 + dt_hp * (p3 - hp0);
 	hp1_prime = p3_prime - hp0_prime;
@@ -330,10 +459,10 @@ void Diode::DiodeFilter(float input){
 	float tanh_p3_prime = FloatTanhPade45(p3_prime);
 	
 	// corrector
-	p0_new = p0 + alpha_0 * 0.5f * dt * ((tanh_ut1_fb_hp3 - tanh_p0_p1) + (tanh_input_fb_hp3_prime - tanh_p0_prime_p1_prime));
-	p1_new = p1 + alpha_1 * 0.5f * 0.5f * dt * ((tanh_p0_p1 - tanh_p1_p2) + (tanh_p0_prime_p1_prime - tanh_p1_prime_p2_prime));
-	p2_new = p2 + alpha_2 * 0.5f * 0.5f * dt * ((tanh_p1_p2 - tanh_p2_p3) + (tanh_p1_prime_p2_prime - tanh_p2_prime_p3_prime));
-	p3_new = p3 + alpha_3 * 0.5f * 0.5f * dt * ((tanh_p2_p3 - tanh_p3) + (tanh_p2_prime_p3_prime - tanh_p3_prime));
+	p0_new = p0 + alpha_0 * 0.5f * dt_n * ((tanh_ut1_fb_hp3 - tanh_p0_p1) + (tanh_input_fb_hp3_prime - tanh_p0_prime_p1_prime));
+	p1_new = p1 + alpha_1 * 0.5f * 0.5f * dt_n * ((tanh_p0_p1 - tanh_p1_p2) + (tanh_p0_prime_p1_prime - tanh_p1_prime_p2_prime));
+	p2_new = p2 + alpha_2 * 0.5f * 0.5f * dt_n * ((tanh_p1_p2 - tanh_p2_p3) + (tanh_p1_prime_p2_prime - tanh_p2_prime_p3_prime));
+	p3_new = p3 + alpha_3 * 0.5f * 0.5f * dt_n * ((tanh_p2_p3 - tanh_p3) + (tanh_p2_prime_p3_prime - tanh_p3_prime));
 
 	hp0_new = hp0 + 0.5f * dt_hp * (hp1_prime + (p3_prime - hp0_prime));
 	hp1_new = p3_new - hp0_new;
@@ -355,6 +484,165 @@ void Diode::DiodeFilter(float input){
       }
       break;
       
+    case DIODE_EULER_ADAA_TANH:
+      // semi-implicit euler integration
+      // with antiderivative antialiased tanh stages
+      {
+	// decoupling rate
+	float dt_hp = GetDecouplingIntegrationRate();
+	
+	float x[8];
+
+	x[0] = input - fb * hp3;
+	x[1] = p0 - p1;
+	p0 = p0 + alpha_0 * dt_n * (FloatTanhPade45ADAA(x[0], xt_1[0]) - FloatTanhPade45ADAA(x[1], xt_1[1]));
+
+	x[2] = p0 - p1;
+	x[3] = p1 - p2;
+	p1 = p1 + alpha_1 * 0.5f * dt_n * (FloatTanhPade45ADAA(x[2], xt_1[2]) - FloatTanhPade45ADAA(x[3], xt_1[3]));
+
+	x[4] = p1 - p2;
+	x[5] = p2 - p3;
+	p2 = p2 + alpha_2 * 0.5f * dt_n * (FloatTanhPade45ADAA(x[4], xt_1[4]) - FloatTanhPade45ADAA(x[5], xt_1[5]));
+
+	x[6] = p2 - p3;
+	x[7] = p3;
+	p3 = p3 + alpha_3 * 0.5f * dt_n * (FloatTanhPade45ADAA(x[6], xt_1[6]) - FloatTanhPade45ADAA(x[7], xt_1[7]));
+
+	// tanh arguments at t-1
+	for(int ii = 0; ii < 8; ii++){
+	  xt_1[ii] = x[ii];
+	}
+
+	hp0 = hp0 + dt_hp * (p3 - hp0);
+	hp1 = p3 - hp0;
+	
+	hp2 = hp2 + dt_hp * (hp1 - hp2);
+	hp3 = hp1 - hp2;
+
+	hp4 = hp4 + dt_hp * (p1 - hp4);
+	hp5 = p1 - hp4;
+      }
+      break;
+      
+    case DIODE_TRAPEZOIDAL_FULL_TANH:
+      // implicit trapezoidal integration
+      // with full tanh stages
+      {
+	// decoupling rate
+	float dt_hp = GetDecouplingIntegrationRate();
+
+	// stage gains for half a step
+	float g0 = 0.5f * alpha_0 * dt_n;
+	float g1 = 0.25f * alpha_1 * dt_n;
+	float g2 = 0.25f * alpha_2 * dt_n;
+	float g3 = 0.25f * alpha_3 * dt_n;
+
+	// trapezoidal decoupling stages are linear,
+	// feedback at t is hp3 = k * p3 + m
+	float h = 0.5f * dt_hp;
+	float h_1 = 1.0f / (1.0f + h);
+	float c0 = (hp0 * (1.0f - h) + h * p3) * h_1;
+	float c2 = (hp2 * (1.0f - h) + h * hp1) * h_1;
+	float k = h_1 * h_1;
+	float m = -1.0f * c0 * h_1 - c2;
+
+	// explicit half of the step
+	float tanh_p0_p1 = FloatTanhPade45(p0 - p1);
+	float tanh_p1_p2 = FloatTanhPade45(p1 - p2);
+	float tanh_p2_p3 = FloatTanhPade45(p2 - p3);
+	float b0 = p0 + g0 * (FloatTanhPade45(ut_1 - fb * hp3) - tanh_p0_p1);
+	float b1 = p1 + g1 * (tanh_p0_p1 - tanh_p1_p2);
+	float b2 = p2 + g2 * (tanh_p1_p2 - tanh_p2_p3);
+	float b3 = p3 + g3 * (tanh_p2_p3 - FloatTanhPade45(p3));
+
+	// starting point is the explicit euler step
+	float x0 = 2.0f * b0 - p0;
+	float x1 = 2.0f * b1 - p1;
+	float x2 = 2.0f * b2 - p2;
+	float x3 = 2.0f * b3 - p3;
+
+	// newton-raphson over the four stages,
+	// the jacobian is tridiagonal apart from the feedback
+	// term and is solved by elimination towards the input stage
+	for(int ii = 0; ii < DIODE_MAX_NEWTON_STEPS; ii++){
+	  float tanh_u = FloatTanhPade45(input - fb * (k * x3 + m));
+	  float tanh_x01 = FloatTanhPade45(x0 - x1);
+	  float tanh_x12 = FloatTanhPade45(x1 - x2);
+	  float tanh_x23 = FloatTanhPade45(x2 - x3);
+	  float tanh_x3 = FloatTanhPade45(x3);
+
+	  // residuals
+	  float r0 = x0 - b0 - g0 * (tanh_u - tanh_x01);
+	  float r1 = x1 - b1 - g1 * (tanh_x01 - tanh_x12);
+	  float r2 = x2 - b2 - g2 * (tanh_x12 - tanh_x23);
+	  float r3 = x3 - b3 - g3 * (tanh_x23 - tanh_x3);
+
+	  // tanh derivatives
+	  float d_u = 1.0f - tanh_u * tanh_u;
+	  float d01 = 1.0f - tanh_x01 * tanh_x01;
+	  float d12 = 1.0f - tanh_x12 * tanh_x12;
+	  float d23 = 1.0f - tanh_x23 * tanh_x23;
+	  float d3 = 1.0f - tanh_x3 * tanh_x3;
+
+	  // jacobian diagonal
+	  float a0 = 1.0f + g0 * d01;
+	  float a1 = 1.0f + g1 * (d01 + d12);
+	  float a2 = 1.0f + g2 * (d12 + d23);
+	  float a3 = 1.0f + g3 * (d23 + d3);
+
+	  // eliminate upper diagonal from the output stage
+	  float a3_1 = 1.0f / a3;
+	  float a2_1 = 1.0f / (a2 - g2 * d23 * g3 * d23 * a3_1);
+	  float r2_e = r2 + g2 * d23 * r3 * a3_1;
+	  float a1_1 = 1.0f / (a1 - g1 * d12 * g2 * d12 * a2_1);
+	  float r1_e = r1 + g1 * d12 * r2_e * a2_1;
+
+	  // stage steps as affine functions of the input stage step
+	  float e1 = r1_e * a1_1;
+	  float f1 = g1 * d01 * a1_1;
+	  float e2 = (r2_e + g2 * d12 * e1) * a2_1;
+	  float f2 = g2 * d12 * f1 * a2_1;
+	  float e3 = (r3 + g3 * d23 * e2) * a3_1;
+	  float f3 = g3 * d23 * f2 * a3_1;
+
+	  // input stage row with the feedback term
+	  float c_fb = g0 * d_u * fb * k;
+	  float dx0 = (r0 + g0 * d01 * e1 - c_fb * e3) / (a0 - g0 * d01 * f1 + c_fb * f3);
+	  float dx1 = e1 + f1 * dx0;
+	  float dx2 = e2 + f2 * dx0;
+	  float dx3 = e3 + f3 * dx0;
+
+	  x0 -= dx0;
+	  x1 -= dx1;
+	  x2 -= dx2;
+	  x3 -= dx3;
+
+#ifdef DIODE_NEWTON_BREAKING_LIMIT
+	  // relative breaking limit
+	  float dx = fmax(fmax(fabs(dx0), fabs(dx1)), fmax(fabs(dx2), fabs(dx3)));
+	  float x = fmax(fmax(fabs(x0), fabs(x1)), fmax(fabs(x2), fabs(x3)));
+	  if(dx < DIODE_NEWTON_TOLERANCE * (1.0f + x)){
+	    break;
+	  }
+#endif
+	}
+	
+	p0 = x0;
+	p1 = x1;
+	p2 = x2;
+	p3 = x3;
+
+	hp0 = c0 + h * h_1 * p3;
+	hp1 = p3 - hp0;
+	hp2 = c2 + h * h_1 * hp1;
+	hp3 = hp1 - hp2;
+
+	hp4 = hp4 + dt_hp * (p1 - hp4);
+	hp5 = p1 - hp4;
+      }
+      break;
+      
     default:
       break;
     }
@@ -375,30 +663,47 @@ void Diode::DiodeFilter(float input){
     }
 
     // downsampling filter
-    if(oversamplingFactor > 1){
-      out = iir->IIRfilter32(out);
-    }
+    out = oversampler.Decimate<factor>(out);
   }
+  
+  // integration rate at t-1
+  dt_t1 = dt;
 }
 #else
-void Diode::DiodeFilter(double input){
+template <DiodeIntegrationMethod method, int factor>
+void Diode::DiodeFilterKernel(double input){
   // feedback amount
   double fb = 24.0 * Resonance;
 
   // noise term
   input += 1.0e-6 * GetNormalizedNoiseValue();
 
-  // inject thermal phase noise to filter stages
-  double alpha_0 = 1.0 + DIODE_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
-  double alpha_1 = 1.0 + DIODE_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
-  double alpha_2 = 1.0 + DIODE_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
-  double alpha_3 = 1.0 + DIODE_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+  // inject thermal phase noise to filter stages,
+  // held across a block at control rate
+  if(--noiseHold <= 0){
+    alpha_0 = 1.0 + DIODE_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+    alpha_1 = 1.0 + DIODE_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+    alpha_2 = 1.0 + DIODE_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+    alpha_3 = 1.0 + DIODE_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+    noiseHold = controlRateNoise ? DIODE_NOISE_CONTROL_RATE : 1;
+  }
   
+  // oversampling factor
+  const int oversamplingFactor = factor ? factor : oversampler.GetOversamplingFactor();
+
+  // integration rate ramps from the previous host sample
+  // to the current one across the substeps
+  double dt_step = (dt - dt_t1) / (double)(oversamplingFactor);
+  double dt_n = dt_t1;
+
   // integrate filter state
   // with oversampling
   for(int nn = 0; nn < oversamplingFactor; nn++){
+    // ramp integration rate
+    dt_n += dt_step;
+
     // switch integration method
-    switch(integrationMethod){
+    switch(method){
     case DIODE_EULER_FULL_TANH:
       // semi-implicit euler integration
       // with full tanh stages
@@ -406,10 +711,10 @@ void Diode::DiodeFilter(double input){
 	// decoupling rate
 	double dt_hp = GetDecouplingIntegrationRate();
 	
-	p0 = p0 + alpha_0 * dt * (TanhPade45(input - fb * hp3) - TanhPade45(p0 - p1));
-	p1 = p1 + alpha_1 * 0.5 * dt * (TanhPade45(p0 - p1) - TanhPade45(p1 - p2));
-	p2 = p2 + alpha_2 * 0.5 * dt * (TanhPade45(p1 - p2) - TanhPade45(p2 - p3));
-	p3 = p3 + alpha_3 * 0.5 * dt * (TanhPade45(p2 - p3) - TanhPade45(p3));
+	p0 = p0 + alpha_0 * dt_n * (TanhPade45(input - fb * hp3) - TanhPade45(p0 - p1));
+	p1 = p1 + alpha_1 * 0.5 * dt_n * (TanhPade45(p0 - p1) - TanhPade45(p1 - p2));
+	p2 = p2 + alpha_2 * 0.5 * dt_n * (TanhPade45(p1 - p2) - TanhPade45(p2 - p3));
+	p3 = p3 + alpha_3 * 0.5 * dt_n * (TanhPade45(p2 - p3) - TanhPade45(p3));
 
 	hp0 = hp0 + dt_hp * (p3 - hp0);
 	hp1 = p3 - hp0;
@@ -442,10 +747,10 @@ void Diode::DiodeFilter(double input){
 	double dt_hp = GetDecouplingIntegrationRate();
 	
 	// predictor
-	p0_prime = p0 + alpha_0 * dt * (tanh_ut1_fb_hp3 - tanh_p0_p1);
-	p1_prime = p1 + alpha_1 * 0.5 * dt * (tanh_p0_p1 - tanh_p1_p2);
-	p2_prime = p2 + alpha_2 * 0.5 * dt * (tanh_p1_p2 - tanh_p2_p3);
-	p3_prime = p3 + alpha_3 * 0.5 * dt * (tanh_p2_p3 - tanh_p3);
+	p0_prime = p0 + alpha_0 * dt_n * (tanh_ut1_fb_hp3 - tanh_p0_p1);
+	p1_prime = p1 + alpha_1 * 0.5 * dt_n * (tanh_p0_p1 - tanh_p1_p2);
+	p2_prime = p2 + alpha_2 * 0.5 * dt_n * (tanh_p1_p2 - tanh_p2_p3);
+	p3_prime = p3 + alpha_3 * 0.5 * dt_n * (tanh_p2_p3 - tanh_p3);
 
 	hp0_prime = hp0 + dt_hp * (p3 - hp0);
 	hp1_prime = p3_prime - hp0_prime;
@@ -461,10 +766,10 @@ void Diode::DiodeFilter(double input){
 	double tanh_p3_prime = TanhPade32(p3_prime);
 	
 	// corrector
-	p0_new = p0 + alpha_0 * 0.5 * dt * ((tanh_ut1_fb_hp3 - tanh_p0_p1) + (tanh_input_fb_hp3_prime - tanh_p0_prime_p1_prime));
-	p1_new = p1 + alpha_1 * 0.5 * 0.5 * dt * ((tanh_p0_p1 - tanh_p1_p2) + (tanh_p0_prime_p1_prime - tanh_p1_prime_p2_prime));
-	p2_new = p2 + alpha_2 * 0.5 * 0.5 * dt * ((tanh_p1_p2 - tanh_p2_p3) + (tanh_p1_prime_p2_prime - tanh_p2_prime_p3_prime));
-	p3_new = p3 + alpha_3 * 0.5 * 0.5 * dt * ((tanh_p2_p3 - tanh_p3) + (tanh_p2_prime_p3_prime - tanh_p3_prime));
+	p0_new = p0 + alpha_0 * 0.5 * dt_n * ((tanh_ut1_fb_hp3 - tanh_p0_p1) + (tanh_input_fb_hp3_prime - tanh_p0_prime_p1_prime));
+	p1_new = p1 + alpha_1 * 0.5 * 0.5 * dt_n * ((tanh_p0_p1 - tanh_p1_p2) + (tanh_p0_prime_p1_prime - tanh_p1_prime_p2_prime));
+	p2_new = p2 + alpha_2 * 0.5 * 0.5 * dt_n * ((tanh_p1_p2 - tanh_p2_p3) + (tanh_p1_prime_p2_prime - tanh_p2_prime_p3_prime));
+	p3_new = p3 + alpha_3 * 0.5 * 0.5 * dt_n * ((tanh_p2_p3 - tanh_p3) + (tanh_p2_prime_p3_prime - tanh_p3_prime));
 
 	hp0_new = hp0 + 0.5 * dt_hp * (hp1_prime + (p3_prime - hp0_prime));
 	hp1_new = p3_new - hp0_new;
@@ -487,6 +792,165 @@ void Diode::DiodeFilter(double input){
       }
       break;
       
+    case DIODE_EULER_ADAA_TANH:
+      // semi-implicit euler integration
+      // with antiderivative antialiased tanh stages
+      {
+	// decoupling rate
+	double dt_hp = GetDecouplingIntegrationRate();
+	
+	double x[8];
+
+	x[0] = input - fb * hp3;
+	x[1] = p0 - p1;
+	p0 = p0 + alpha_0 * dt_n * (TanhPade45ADAA(x[0], xt_1[0]) - TanhPade45ADAA(x[1], xt_1[1]));
+
+	x[2] = p0 - p1;
+	x[3] = p1 - p2;
+	p1 = p1 + alpha_1 * 0.5 * dt_n * (TanhPade45ADAA(x[2], xt_1[2]) - TanhPade45ADAA(x[3], xt_1[3]));
+
+	x[4] = p1 - p2;
+	x[5] = p2 - p3;
+	p2 = p2 + alpha_2 * 0.5 * dt_n * (TanhPade45ADAA(x[4], xt_1[4]) - TanhPade45ADAA(x[5], xt_1[5]));
+
+	x[6] = p2 - p3;
+	x[7] = p3;
+	p3 = p3 + alpha_3 * 0.5 * dt_n * (TanhPade45ADAA(x[6], xt_1[6]) - TanhPade45ADAA(x[7], xt_1[7]));
+
+	// tanh arguments at t-1
+	for(int ii = 0; ii < 8; ii++){
+	  xt_1[ii] = x[ii];
+	}
+
+	hp0 = hp0 + dt_hp * (p3 - hp0);
+	hp1 = p3 - hp0;
+	
+	hp2 = hp2 + dt_hp * (hp1 - hp2);
+	hp3 = hp1 - hp2;
+
+	hp4 = hp4 + dt_hp * (p1 - hp4);
+	hp5 = p1 - hp4;
+      }
+      break;
+      
+    case DIODE_TRAPEZOIDAL_FULL_TANH:
+      // implicit trapezoidal integration
+      // with full tanh stages
+      {
+	// decoupling rate
+	double dt_hp = GetDecouplingIntegrationRate();
+
+	// stage gains for half a step
+	double g0 = 0.5 * alpha_0 * dt_n;
+	double g1 = 0.25 * alpha_1 * dt_n;
+	double g2 = 0.25 * alpha_2 * dt_n;
+	double g3 = 0.25 * alpha_3 * dt_n;
+
+	// trapezoidal decoupling stages are linear,
+	// feedback at t is hp3 = k * p3 + m
+	double h = 0.5 * dt_hp;
+	double h_1 = 1.0 / (1.0 + h);
+	double c0 = (hp0 * (1.0 - h) + h * p3) * h_1;
+	double c2 = (hp2 * (1.0 - h) + h * hp1) * h_1;
+	double k = h_1 * h_1;
+	double m = -1.0 * c0 * h_1 - c2;
+
+	// explicit half of the step
+	double tanh_p0_p1 = TanhPade45(p0 - p1);
+	double tanh_p1_p2 = TanhPade45(p1 - p2);
+	double tanh_p2_p3 = TanhPade45(p2 - p3);
+	double b0 = p0 + g0 * (TanhPade45(ut_1 - fb * hp3) - tanh_p0_p1);
+	double b1 = p1 + g1 * (tanh_p0_p1 - tanh_p1_p2);
+	double b2 = p2 + g2 * (tanh_p1_p2 - tanh_p2_p3);
+	double b3 = p3 + g3 * (tanh_p2_p3 - TanhPade45(p3));
+
+	// starting point is the explicit euler step
+	double x0 = 2.0 * b0 - p0;
+	double x1 = 2.0 * b1 - p1;
+	double x2 = 2.0 * b2 - p2;
+	double x3 = 2.0 * b3 - p3;
+
+	// newton-raphson over the four stages,
+	// the jacobian is tridiagonal apart from the feedback
+	// term and is solved by elimination towards the input stage
+	for(int ii = 0; ii < DIODE_MAX_NEWTON_STEPS; ii++){
+	  double tanh_u = TanhPade45(input - fb * (k * x3 + m));
+	  double tanh_x01 = TanhPade45(x0 - x1);
+	  double tanh_x12 = TanhPade45(x1 - x2);
+	  double tanh_x23 = TanhPade45(x2 - x3);
+	  double tanh_x3 = TanhPade45(x3);
+
+	  // residuals
+	  double r0 = x0 - b0 - g0 * (tanh_u - tanh_x01);
+	  double r1 = x1 - b1 - g1 * (tanh_x01 - tanh_x12);
+	  double r2 = x2 - b2 - g2 * (tanh_x12 - tanh_x23);
+	  double r3 = x3 - b3 - g3 * (tanh_x23 - tanh_x3);
+
+	  // tanh derivatives
+	  double d_u = 1.0 - tanh_u * tanh_u;
+	  double d01 = 1.0 - tanh_x01 * tanh_x01;
+	  double d12 = 1.0 - tanh_x12 * tanh_x12;
+	  double d23 = 1.0 - tanh_x23 * tanh_x23;
+	  double d3 = 1.0 - tanh_x3 * tanh_x3;
+
+	  // jacobian diagonal
+	  double a0 = 1.0 + g0 * d01;
+	  double a1 = 1.0 + g1 * (d01 + d12);
+	  double a2 = 1.0 + g2 * (d12 + d23);
+	  double a3 = 1.0 + g3 * (d23 + d3);
+
+	  // eliminate upper diagonal from the output stage
+	  double a3_1 = 1.0 / a3;
+	  double a2_1 = 1.0 / (a2 - g2 * d23 * g3 * d23 * a3_1);
+	  double r2_e = r2 + g2 * d23 * r3 * a3_1;
+	  double a1_1 = 1.0 / (a1 - g1 * d12 * g2 * d12 * a2_1);
+	  double r1_e = r1 + g1 * d12 * r2_e * a2_1;
+
+	  // stage steps as affine functions of the input stage step
+	  double e1 = r1_e * a1_1;
+	  double f1 = g1 * d01 * a1_1;
+	  double e2 = (r2_e + g2 * d12 * e1) * a2_1;
+	  double f2 = g2 * d12 * f1 * a2_1;
+	  double e3 = (r3 + g3 * d23 * e2) * a3_1;
+	  double f3 = g3 * d23 * f2 * a3_1;
+
+	  // input stage row with the feedback term
+	  double c_fb = g0 * d_u * fb * k;
+	  double dx0 = (r0 + g0 * d01 * e1 - c_fb * e3) / (a0 - g0 * d01 * f1 + c_fb * f3);
+	  double dx1 = e1 + f1 * dx0;
+	  double dx2 = e2 + f2 * dx0;
+	  double dx3 = e3 + f3 * dx0;
+
+	  x0 -= dx0;
+	  x1 -= dx1;
+	  x2 -= dx2;
+	  x3 -= dx3;
+
+#ifdef DIODE_NEWTON_BREAKING_LIMIT
+	  // relative breaking limit
+	  double dx = fmax(fmax(fabs(dx0), fabs(dx1)), fmax(fabs(dx2), fabs(dx3)));
+	  double x = fmax(fmax(fabs(x0), fabs(x1)), fmax(fabs(x2), fabs(x3)));
+	  if(dx < DIODE_NEWTON_TOLERANCE_DOUBLE * (1.0 + x)){
+	    break;
+	  }
+#endif
+	}
+	
+	p0 = x0;
+	p1 = x1;
+	p2 = x2;
+	p3 = x3;
+
+	hp0 = c0 + h * h_1 * p3;
+	hp1 = p3 - hp0;
+	hp2 = c2 + h * h_1 * hp1;
+	hp3 = hp1 - hp2;
+
+	hp4 = hp4 + dt_hp * (p1 - hp4);
+	hp5 = p1 - hp4;
+      }
+      break;
+      
     default:
       break;
     }
@@ -507,13 +971,54 @@ void Diode::DiodeFilter(double input){
     }
 
     // downsampling filter
-    if(oversamplingFactor > 1){
-      out = iir->IIRfilter(out);
-    }
+    out = oversampler.Decimate<factor>(out);
   }
+  
+  // integration rate at t-1
+  dt_t1 = dt;
 }
 #endif
 
+template <DiodeIntegrationMethod method>
+Diode::FilterKernel Diode::GetFilterKernel(int factor){
+  switch(factor){
+  case 1:
+    return &Diode::DiodeFilterKernel<method, 1>;
+  case 2:
+    return &Diode::DiodeFilterKernel<method, 2>;
+  case 4:
+    return &Diode::DiodeFilterKernel<method, 4>;
+  case 8:
+    return &Diode::DiodeFilterKernel<method, 8>;
+  case 16:
+    return &Diode::DiodeFilterKernel<method, 16>;
+  case 32:
+    return &Diode::DiodeFilterKernel<method, 32>;
+  default:
+    return &Diode::DiodeFilterKernel<method, 0>;
+  }
+}
+
+void Diode::SelectFilterKernel(){
+  switch(integrationMethod){
+  case DIODE_EULER_FULL_TANH:
+    filterKernel = GetFilterKernel<DIODE_EULER_FULL_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  case DIODE_PREDICTOR_CORRECTOR_FULL_TANH:
+    filterKernel = GetFilterKernel<DIODE_PREDICTOR_CORRECTOR_FULL_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  case DIODE_EULER_ADAA_TANH:
+    filterKernel = GetFilterKernel<DIODE_EULER_ADAA_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  case DIODE_TRAPEZOIDAL_FULL_TANH:
+    filterKernel = GetFilterKernel<DIODE_TRAPEZOIDAL_FULL_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  default:
+    filterKernel = GetFilterKernel<DIODE_EULER_FULL_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  }
+}
+
 double Diode::GetFilterLowpass(){
   return hp1;
 }
@@ -527,3 +1032,654 @@ double Diode::GetFilterHighpass(){
 }
 
 
+
+#ifdef FLOATDSP
+void Diode::ProcessBlock(const float* input, float* output,
+			 const float* cutoff, const float* resonance, int n){
+#else
+void Diode::ProcessBlock(const double* input, double* output,
+			 const double* cutoff, const double* resonance, int n){
+#endif
+  for(int ii = 0; ii < n; ii++){
+    // integration rate follows cutoff changes only
+    if(cutoff[ii] != cutoffFrequency){
+      cutoffFrequency = cutoff[ii];
+      SetFilterIntegrationRate();
+    }
+    Resonance = resonance[ii];
+
+    // tick filter state
+    DiodeFilter(input[ii]);
+    output[ii] = out;
+  }
+}
+
+// constructor
+DiodeX4::DiodeX4(float4 newCutoff, float4 newResonance, int newOversamplingFactor,
+		 DiodeFilterMode newFilterMode, double newSampleRate,
+		 DiodeIntegrationMethod newIntegrationMethod, int newDecimatorOrder){
+  // initialize filter parameters
+  cutoffFrequency = newCutoff;
+  Resonance = newResonance;
+  filterMode = newFilterMode;
+
+  // set up oversampling
+  oversampler.SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  oversampler.SetSampleRate(newSampleRate);
+  oversampler.SetOversamplingFactor(newOversamplingFactor);
+  oversampler.SetDecimatorOrder(newDecimatorOrder);
+
+  // automatic oversampling starts from x1
+  autoOversampling = (newOversamplingFactor == OVERSAMPLER_AUTO);
+  governor.SetSampleRate(newSampleRate);
+  governor.Reset(oversampler.GetOversamplingFactor());
+  
+  integrationMethod = newIntegrationMethod;
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+
+  // thermal noise at audio rate
+  controlRateNoise = false;
+  noiseHold = 0;
+
+  // initialize filter state
+  p0 = p1 = p2 = p3 = out = ut_1 = Float4(0.0f);
+
+  hp0 = hp1 = hp2 = hp3 = hp4 = hp5 = Float4(0.0f);
+  
+  // initialize antialiasing state
+  ResetAntialiasingState();
+
+  // select filter kernel
+  SelectFilterKernel();
+}
+
+// default constructor
+DiodeX4::DiodeX4(){
+  // initialize filter parameters
+  cutoffFrequency = Float4(0.25f);
+  Resonance = Float4(0.5f);
+  filterMode = DIODE_LOWPASS4_MODE;
+
+  // set up oversampling
+  oversampler.SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  autoOversampling = false;
+  
+  integrationMethod = DIODE_PREDICTOR_CORRECTOR_FULL_TANH;
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+  
+  // thermal noise at audio rate
+  controlRateNoise = false;
+  noiseHold = 0;
+
+  // initialize filter state
+  p0 = p1 = p2 = p3 = out = ut_1 = Float4(0.0f);
+
+  hp0 = hp1 = hp2 = hp3 = hp4 = hp5 = Float4(0.0f);
+  
+  // initialize antialiasing state
+  ResetAntialiasingState();
+
+  // select filter kernel
+  SelectFilterKernel();
+}
+
+// default destructor
+DiodeX4::~DiodeX4(){
+}
+
+void DiodeX4::ResetFilterState(){
+  // initialize filter parameters
+  cutoffFrequency = Float4(0.25f);
+  Resonance = Float4(0.0f);
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+  
+  // initialize filter and decimator state
+  ClearFilterState();
+  
+  // wake from sleep
+  sleepDetector.Reset();
+
+  // restart oversampling governor
+  governor.Reset(oversampler.GetOversamplingFactor());
+}
+
+void DiodeX4::ClearFilterState(){
+  // initialize filter state
+  p0 = p1 = p2 = p3 = out = ut_1 = Float4(0.0f);
+
+  hp0 = hp1 = hp2 = hp3 = hp4 = hp5 = Float4(0.0f);
+  ResetAntialiasingState();
+  
+  // clear decimator state, the decimator design stays
+  oversampler.ClearState();
+}
+
+void DiodeX4::EnterSleep(){
+  // stay awake until the filter state has decayed as well
+  float4 level = Float4Max(Float4Max(Float4Abs(p0), Float4Abs(p1)),
+			   Float4Max(Float4Abs(p2), Float4Abs(p3)));
+  if(Int4Any(level > SLEEP_THRESHOLD)){
+    return;
+  }
+
+  // settle to rest at the current parameters
+  ClearFilterState();
+  dt_t1 = dt;
+
+  sleepDetector.Sleep();
+}
+
+void DiodeX4::SetFilterCutoff(float4 newCutoff){
+  cutoffFrequency = newCutoff;
+
+  SetFilterIntegrationRate();
+}
+
+void DiodeX4::SetFilterResonance(float4 newResonance){
+  Resonance = newResonance;
+}
+
+void DiodeX4::SetFilterControlRamp(float4 newCutoff, float4 newResonance, int steps){
+  float4 dt_start = dt;
+  float4 resonance_start = Resonance;
+
+  // integration rate at the new target
+  cutoffFrequency = newCutoff;
+  SetFilterIntegrationRate();
+  dtTarget = dt;
+  resonanceTarget = newResonance;
+
+  // single step ramps jump to the target
+  if(steps <= 1){
+    Resonance = newResonance;
+    return;
+  }
+  dtIncrement = (dtTarget - dt_start) / (float)(steps);
+  resonanceIncrement = (resonanceTarget - resonance_start) / (float)(steps);
+  dt = dt_start;
+  Resonance = resonance_start;
+  controlRampRemaining = steps;
+}
+
+void DiodeX4::SetFilterMode(DiodeFilterMode newFilterMode){
+  filterMode = newFilterMode;
+}
+
+void DiodeX4::SetFilterSampleRate(double newSampleRate){
+  oversampler.SetSampleRate(newSampleRate);
+  governor.SetSampleRate(newSampleRate);
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+}
+
+void DiodeX4::SetFilterIntegrationMethod(DiodeIntegrationMethod method){
+  integrationMethod = method;
+  ResetAntialiasingState();
+  SelectFilterKernel();
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+}
+
+void DiodeX4::SetFilterOversamplingFactor(int newOversamplingFactor){
+  // automatic oversampling starts from the current factor
+  autoOversampling = (newOversamplingFactor == OVERSAMPLER_AUTO);
+  if(autoOversampling){
+    governor.Reset(oversampler.GetOversamplingFactor());
+    return;
+  }
+
+  SwitchOversamplingFactor(newOversamplingFactor);
+}
+
+void DiodeX4::SwitchOversamplingFactor(int newOversamplingFactor){
+  oversampler.SetOversamplingFactor(newOversamplingFactor);
+
+  // continue decimation from the current output level, priming
+  // restores the dc steady state only so switching is reduced-glitch
+  oversampler.Prime(out);
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+  SelectFilterKernel();
+}
+
+void DiodeX4::SetFilterDecimatorOrder(int newDecimatorOrder){
+  oversampler.SetDecimatorOrder(newDecimatorOrder);
+}
+
+void DiodeX4::SetFilterControlRateNoise(bool newControlRateNoise){
+  controlRateNoise = newControlRateNoise;
+  noiseHold = 0;
+}
+
+void DiodeX4::SetFilterIntegrationRate(){
+  // normalize cutoff freq to samplerate
+  dt = (float)(oversampler.GetIntegrationRate(1.0)) * cutoffFrequency;
+
+  // clamp integration rate,
+  // the implicit solver stays stable at higher rates
+  float maxRate = (float)(integrationMethod == DIODE_TRAPEZOIDAL_FULL_TANH ?
+			  DIODE_MAX_IMPLICIT_INTEGRATION_RATE : DIODE_MAX_INTEGRATION_RATE);
+  dt = Float4Min(Float4Max(dt, Float4(0.0f)), Float4(maxRate));
+
+  // direct updates stop the control rate ramp
+  controlRampRemaining = 0;
+}
+
+float4 DiodeX4::GetDecouplingIntegrationRate(){
+  return (float)(oversampler.GetIntegrationRate(DIODE_FEEDBACK_DC_DECOUPLING_INTEGRATION_RATE)) * (1.0f - (Resonance * 0.08f));
+}
+
+void DiodeX4::ResetAntialiasingState(){
+  // arguments as if the state had been held
+  xt_1[0] = ut_1 - 24.0f * Resonance * hp3;
+  xt_1[1] = xt_1[2] = p0 - p1;
+  xt_1[3] = xt_1[4] = p1 - p2;
+  xt_1[5] = xt_1[6] = p2 - p3;
+  xt_1[7] = p3;
+}
+
+float4 DiodeX4::GetFilterCutoff(){
+  return cutoffFrequency;
+}
+
+float4 DiodeX4::GetFilterResonance(){
+  return Resonance;
+}
+
+int DiodeX4::GetFilterOversamplingFactor(){
+  return oversampler.GetOversamplingFactor();
+}
+
+int DiodeX4::GetFilterDecimatorOrder(){
+  return oversampler.GetDecimatorOrder();
+}
+
+bool DiodeX4::GetFilterControlRateNoise(){
+  return controlRateNoise;
+}
+
+float4 DiodeX4::GetFilterOutput(){
+  return out;
+}
+
+DiodeFilterMode DiodeX4::GetFilterMode(){
+  return filterMode;
+}
+
+double DiodeX4::GetFilterSampleRate(){
+  return oversampler.GetSampleRate();
+}
+
+DiodeIntegrationMethod DiodeX4::GetFilterIntegrationMethod(){
+  return integrationMethod;
+}
+
+float4 DiodeX4::GetNormalizedNoiseValue(){
+  return noise.Next();
+}
+
+template <DiodeIntegrationMethod method, int factor>
+void DiodeX4::DiodeFilterKernel(float4 input){
+  // feedback amount
+  float4 fb = 24.f * Resonance;
+
+  // decoupling rate
+  float4 dt_hp = GetDecouplingIntegrationRate();
+  
+  // noise term
+  input += 1.0e-6f * GetNormalizedNoiseValue();
+  
+  // inject thermal phase noise to filter stages,
+  // held across a block at control rate
+  if(--noiseHold <= 0){
+    alpha_0 = 1.0f + (float)(DIODE_THERMAL_NOISE_AMPLITUDE) * GetNormalizedNoiseValue();
+    alpha_1 = 1.0f + (float)(DIODE_THERMAL_NOISE_AMPLITUDE) * GetNormalizedNoiseValue();
+    alpha_2 = 1.0f + (float)(DIODE_THERMAL_NOISE_AMPLITUDE) * GetNormalizedNoiseValue();
+    alpha_3 = 1.0f + (float)(DIODE_THERMAL_NOISE_AMPLITUDE) * GetNormalizedNoiseValue();
+    noiseHold = controlRateNoise ? DIODE_NOISE_CONTROL_RATE : 1;
+  }
+  
+  // oversampling factor
+  const int oversamplingFactor = factor ? factor : oversampler.GetOversamplingFactor();
+
+  // integration rate ramps from the previous host sample
+  // to the current one across the substeps
+  float4 dt_step = (dt - dt_t1) / (float)(oversamplingFactor);
+  float4 dt_n = dt_t1;
+
+  // integrate filter state
+  // with oversampling
+  for(int nn = 0; nn < oversamplingFactor; nn++){
+    // ramp integration rate
+    dt_n += dt_step;
+
+    // switch integration method
+    switch(method){
+    case DIODE_EULER_FULL_TANH:
+      // semi-implicit euler integration
+      // with full tanh stages
+      {
+	p0 = p0 + alpha_0 * dt_n * (FloatTanhPade45(input - fb * hp3) - FloatTanhPade45(p0 - p1));
+	p1 = p1 + alpha_1 * 0.5f * dt_n * (FloatTanhPade45(p0 - p1) - FloatTanhPade45(p1 - p2));
+	p2 = p2 + alpha_2 * 0.5f * dt_n * (FloatTanhPade45(p1 - p2) - FloatTanhPade45(p2 - p3));
+	p3 = p3 + alpha_3 * 0.5f * dt_n * (FloatTanhPade45(p2 - p3) - FloatTanhPade45(p3));
+
+	hp0 = hp0 + dt_hp * (p3 - hp0);
+	hp1 = p3 - hp0;
+	
+	hp2 = hp2 + dt_hp * (hp1 - hp2);
+	hp3 = hp1 - hp2;
+
+	hp4 = hp4 + dt_hp * (p1 - hp4);
+	hp5 = p1 - hp4;
+      }
+      break;
+      
+    case DIODE_PREDICTOR_CORRECTOR_FULL_TANH:
+      // predictor-corrector integration
+      // with full tanh stages
+      {
+	float4 p0_prime, p1_prime, p2_prime, p3_prime;
+	float4 p0_new, p1_new, p2_new, p3_new;
+	float4 hp0_prime, hp1_prime, hp2_prime, hp3_prime;
+	float4 hp0_new, hp1_new, hp2_new, hp3_new;
+	
+	// euler step nonlinearities
+	float4 tanh_ut1_fb_hp3 = FloatTanhPade45(ut_1 - fb * hp3);
+	float4 tanh_p0_p1 = FloatTanhPade45(p0 - p1);
+	float4 tanh_p1_p2 = FloatTanhPade45(p1 - p2);
+	float4 tanh_p2_p3 = FloatTanhPade45(p2 - p3);
+	float4 tanh_p3 = FloatTanhPade45(p3);
+	
+	// predictor
+	p0_prime = p0 + alpha_0 * dt_n * (tanh_ut1_fb_hp3 - tanh_p0_p1);
+	p1_prime = p1 + alpha_1 * 0.5f * dt_n * (tanh_p0_p1 - tanh_p1_p2);
+	p2_prime = p2 + alpha_2 * 0.5f * dt_n * (tanh_p1_p2 - tanh_p2_p3);
+	p3_prime = p3 + alpha_3 * 0.5f * dt_n * (tanh_p2_p3 - tanh_p3);
+
+	hp0_prime = hp0 + dt_hp * (p3 - hp0);
+	hp1_prime = p3_prime - hp0_prime;
+	hp2_prime = hp2 + dt_hp * (hp1 - hp2);
+	hp3_prime = hp1_prime - hp2_prime;
+
+	// trapezoidal step nonlinearities
+	float4 tanh_input_fb_hp3_prime = FloatTanhPade45(input - fb * hp3_prime);
+	float4 tanh_p0_prime_p1_prime = FloatTanhPade45(p0_prime - p1_prime);
+	float4 tanh_p1_prime_p2_prime = FloatTanhPade45(p1_prime - p2_prime);
+	float4 tanh_p2_prime_p3_prime = FloatTanhPade45(p2_prime - p3_prime);
+	float4 tanh_p3_prime = FloatTanhPade45(p3_prime);
+	
+	// corrector
+	p0_new = p0 + alpha_0 * 0.5f * dt_n * ((tanh_ut1_fb_hp3 - tanh_p0_p1) + (tanh_input_fb_hp3_prime - tanh_p0_prime_p1_prime));
+	p1_new = p1 + alpha_1 * 0.5f * 0.5f * dt_n * ((tanh_p0_p1 - tanh_p1_p2) + (tanh_p0_prime_p1_prime - tanh_p1_prime_p2_prime));
+	p2_new = p2 + alpha_2 * 0.5f * 0.5f * dt_n * ((tanh_p1_p2 - tanh_p2_p3) + (tanh_p1_prime_p2_prime - tanh_p2_prime_p3_prime));
+	p3_new = p3 + alpha_3 * 0.5f * 0.5f * dt_n * ((tanh_p2_p3 - tanh_p3) + (tanh_p2_prime_p3_prime - tanh_p3_prime));
+
+	hp0_new = hp0 + 0.5f * dt_hp * (hp1_prime + (p3_prime - hp0_prime));
+	hp1_new = p3_new - hp0_new;
+	hp2_new = hp2 + 0.5f * dt_hp * (hp3_prime + (hp1_prime - hp2_prime));
+	hp3_new = hp1_new - hp2_new; 
+
+	hp0 = hp0_new;
+	hp1 = hp1_new;
+	hp2 = hp2_new;
+	hp3 = hp3_new;
+	
+	p0 = p0_new;
+	p1 = p1_new;
+	p2 = p2_new;
+	p3 = p3_new;
+
+	hp4 = hp4 + dt_hp * (p1 - hp4);
+	hp5 = p1 - hp4;
+      }
+      break;
+      
+    case DIODE_EULER_ADAA_TANH:
+      // semi-implicit euler integration
+      // with antiderivative antialiased tanh stages
+      {
+	float4 x[8];
+
+	x[0] = input - fb * hp3;
+	x[1] = p0 - p1;
+	p0 = p0 + alpha_0 * dt_n * (FloatTanhPade45ADAA(x[0], xt_1[0]) - FloatTanhPade45ADAA(x[1], xt_1[1]));
+
+	x[2] = p0 - p1;
+	x[3] = p1 - p2;
+	p1 = p1 + alpha_1 * 0.5f * dt_n * (FloatTanhPade45ADAA(x[2], xt_1[2]) - FloatTanhPade45ADAA(x[3], xt_1[3]));
+
+	x[4] = p1 - p2;
+	x[5] = p2 - p3;
+	p2 = p2 + alpha_2 * 0.5f * dt_n * (FloatTanhPade45ADAA(x[4], xt_1[4]) - FloatTanhPade45ADAA(x[5], xt_1[5]));
+
+	x[6] = p2 - p3;
+	x[7] = p3;
+	p3 = p3 + alpha_3 * 0.5f * dt_n * (FloatTanhPade45ADAA(x[6], xt_1[6]) - FloatTanhPade45ADAA(x[7], xt_1[7]));
+
+	// tanh arguments at t-1
+	for(int ii = 0; ii < 8; ii++){
+	  xt_1[ii] = x[ii];
+	}
+
+	hp0 = hp0 + dt_hp * (p3 - hp0);
+	hp1 = p3 - hp0;
+	
+	hp2 = hp2 + dt_hp * (hp1 - hp2);
+	hp3 = hp1 - hp2;
+
+	hp4 = hp4 + dt_hp * (p1 - hp4);
+	hp5 = p1 - hp4;
+      }
+      break;
+      
+    case DIODE_TRAPEZOIDAL_FULL_TANH:
+      // implicit trapezoidal integration
+      // with full tanh stages
+      {
+	// stage gains for half a step
+	float4 g0 = 0.5f * alpha_0 * dt_n;
+	float4 g1 = 0.25f * alpha_1 * dt_n;
+	float4 g2 = 0.25f * alpha_2 * dt_n;
+	float4 g3 = 0.25f * alpha_3 * dt_n;
+
+	// trapezoidal decoupling stages are linear,
+	// feedback at t is hp3 = k * p3 + m
+	float4 h = 0.5f * dt_hp;
+	float4 h_1 = 1.0f / (1.0f + h);
+	float4 c0 = (hp0 * (1.0f - h) + h * p3) * h_1;
+	float4 c2 = (hp2 * (1.0f - h) + h * hp1) * h_1;
+	float4 k = h_1 * h_1;
+	float4 m = -1.0f * c0 * h_1 - c2;
+
+	// explicit half of the step
+	float4 tanh_p0_p1 = FloatTanhPade45(p0 - p1);
+	float4 tanh_p1_p2 = FloatTanhPade45(p1 - p2);
+	float4 tanh_p2_p3 = FloatTanhPade45(p2 - p3);
+	float4 b0 = p0 + g0 * (FloatTanhPade45(ut_1 - fb * hp3) - tanh_p0_p1);
+	float4 b1 = p1 + g1 * (tanh_p0_p1 - tanh_p1_p2);
+	float4 b2 = p2 + g2 * (tanh_p1_p2 - tanh_p2_p3);
+	float4 b3 = p3 + g3 * (tanh_p2_p3 - FloatTanhPade45(p3));
+
+	// starting point is the explicit euler step
+	float4 x0 = 2.0f * b0 - p0;
+	float4 x1 = 2.0f * b1 - p1;
+	float4 x2 = 2.0f * b2 - p2;
+	float4 x3 = 2.0f * b3 - p3;
+
+	// lane-masked newton-raphson over the four stages,
+	// the jacobian is tridiagonal apart from the feedback
+	// term and is solved by elimination towards the input stage
+	int4 active = {-1, -1, -1, -1};
+	
+	for(int ii = 0; ii < DIODE_MAX_NEWTON_STEPS; ii++){
+	  float4 tanh_u = FloatTanhPade45(input - fb * (k * x3 + m));
+	  float4 tanh_x01 = FloatTanhPade45(x0 - x1);
+	  float4 tanh_x12 = FloatTanhPade45(x1 - x2);
+	  float4 tanh_x23 = FloatTanhPade45(x2 - x3);
+	  float4 tanh_x3 = FloatTanhPade45(x3);
+
+	  // residuals
+	  float4 r0 = x0 - b0 - g0 * (tanh_u - tanh_x01);
+	  float4 r1 = x1 - b1 - g1 * (tanh_x01 - tanh_x12);
+	  float4 r2 = x2 - b2 - g2 * (tanh_x12 - tanh_x23);
+	  float4 r3 = x3 - b3 - g3 * (tanh_x23 - tanh_x3);
+
+	  // tanh derivatives
+	  float4 d_u = 1.0f - tanh_u * tanh_u;
+	  float4 d01 = 1.0f - tanh_x01 * tanh_x01;
+	  float4 d12 = 1.0f - tanh_x12 * tanh_x12;
+	  float4 d23 = 1.0f - tanh_x23 * tanh_x23;
+	  float4 d3 = 1.0f - tanh_x3 * tanh_x3;
+
+	  // jacobian diagonal
+	  float4 a0 = 1.0f + g0 * d01;
+	  float4 a1 = 1.0f + g1 * (d01 + d12);
+	  float4 a2 = 1.0f + g2 * (d12 + d23);
+	  float4 a3 = 1.0f + g3 * (d23 + d3);
+
+	  // eliminate upper diagonal from the output stage
+	  float4 a3_1 = 1.0f / a3;
+	  float4 a2_1 = 1.0f / (a2 - g2 * d23 * g3 * d23 * a3_1);
+	  float4 r2_e = r2 + g2 * d23 * r3 * a3_1;
+	  float4 a1_1 = 1.0f / (a1 - g1 * d12 * g2 * d12 * a2_1);
+	  float4 r1_e = r1 + g1 * d12 * r2_e * a2_1;
+
+	  // stage steps as affine functions of the input stage step
+	  float4 e1 = r1_e * a1_1;
+	  float4 f1 = g1 * d01 * a1_1;
+	  float4 e2 = (r2_e + g2 * d12 * e1) * a2_1;
+	  float4 f2 = g2 * d12 * f1 * a2_1;
+	  float4 e3 = (r3 + g3 * d23 * e2) * a3_1;
+	  float4 f3 = g3 * d23 * f2 * a3_1;
+
+	  // input stage row with the feedback term
+	  float4 c_fb = g0 * d_u * fb * k;
+	  float4 dx0 = (r0 + g0 * d01 * e1 - c_fb * e3) / (a0 - g0 * d01 * f1 + c_fb * f3);
+	  float4 dx1 = e1 + f1 * dx0;
+	  float4 dx2 = e2 + f2 * dx0;
+	  float4 dx3 = e3 + f3 * dx0;
+
+	  // update active lanes only
+	  x0 -= Float4Select(active, dx0, Float4(0.0f));
+	  x1 -= Float4Select(active, dx1, Float4(0.0f));
+	  x2 -= Float4Select(active, dx2, Float4(0.0f));
+	  x3 -= Float4Select(active, dx3, Float4(0.0f));
+
+	  // relative breaking limit
+	  float4 dx = Float4Max(Float4Max(Float4Abs(dx0), Float4Abs(dx1)),
+				Float4Max(Float4Abs(dx2), Float4Abs(dx3)));
+	  float4 x = Float4Max(Float4Max(Float4Abs(x0), Float4Abs(x1)),
+			       Float4Max(Float4Abs(x2), Float4Abs(x3)));
+	  active &= dx >= DIODE_NEWTON_TOLERANCE * (1.0f + x);
+	  if(!Int4Any(active)){
+	    break;
+	  }
+	}
+	
+	p0 = x0;
+	p1 = x1;
+	p2 = x2;
+	p3 = x3;
+
+	hp0 = c0 + h * h_1 * p3;
+	hp1 = p3 - hp0;
+	hp2 = c2 + h * h_1 * hp1;
+	hp3 = hp1 - hp2;
+
+	hp4 = hp4 + dt_hp * (p1 - hp4);
+	hp5 = p1 - hp4;
+      }
+      break;
+      
+    default:
+      break;
+    }
+
+    // input at t-1
+    ut_1 = input;
+
+    //switch filter mode
+    switch(filterMode){
+    case DIODE_LOWPASS4_MODE:
+      out = hp1;
+      break;
+    case DIODE_LOWPASS2_MODE:
+      out = 0.25f * p1;
+      break;
+    default:
+      out = Float4(0.0f);
+    }
+
+    // downsampling filter
+    out = oversampler.Decimate<factor>(out);
+  }
+  
+  // integration rate at t-1
+  dt_t1 = dt;
+}
+
+template <DiodeIntegrationMethod method>
+DiodeX4::FilterKernel DiodeX4::GetFilterKernel(int factor){
+  switch(factor){
+  case 1:
+    return &DiodeX4::DiodeFilterKernel<method, 1>;
+  case 2:
+    return &DiodeX4::DiodeFilterKernel<method, 2>;
+  case 4:
+    return &DiodeX4::DiodeFilterKernel<method, 4>;
+  case 8:
+    return &DiodeX4::DiodeFilterKernel<method, 8>;
+  case 16:
+    return &DiodeX4::DiodeFilterKernel<method, 16>;
+  case 32:
+    return &DiodeX4::DiodeFilterKernel<method, 32>;
+  default:
+    return &DiodeX4::DiodeFilterKernel<method, 0>;
+  }
+}
+
+void DiodeX4::SelectFilterKernel(){
+  switch(integrationMethod){
+  case DIODE_EULER_FULL_TANH:
+    filterKernel = GetFilterKernel<DIODE_EULER_FULL_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  case DIODE_PREDICTOR_CORRECTOR_FULL_TANH:
+    filterKernel = GetFilterKernel<DIODE_PREDICTOR_CORRECTOR_FULL_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  case DIODE_EULER_ADAA_TANH:
+    filterKernel = GetFilterKernel<DIODE_EULER_ADAA_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  case DIODE_TRAPEZOIDAL_FULL_TANH:
+    filterKernel = GetFilterKernel<DIODE_TRAPEZOIDAL_FULL_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  default:
+    filterKernel = GetFilterKernel<DIODE_EULER_FULL_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  }
+}
+
+void DiodeX4::ProcessBlock(const float4* input, float4* output,
+			   const float4* cutoff, const float4* resonance, int n){
+  for(int ii = 0; ii < n; ii++){
+    // integration rate follows cutoff changes only
+    if(Int4Any(cutoff[ii] != cutoffFrequency)){
+      cutoffFrequency = cutoff[ii];
+      SetFilterIntegrationRate();
+    }
+    Resonance = resonance[ii];
+
+    // tick filter state through sleep and oversampling control
+    DiodeFilter(input[ii]);
+    output[ii] = out;
+  }
+}
@@ -22,11 +22,9 @@
 #ifndef __dspdiodeh__
 #define __dspdiodeh__
 
-#ifdef FLOATDSP
-#include "iir32.h"
-#else
-#include "iir.h"
-#endif
+#include "oversampler.h"
+#include "fastrand.h"
+#include "sleep.h"
 
 // filter modes
 enum DiodeFilterMode {
@@ -38,8 +36,14 @@ enum DiodeFilterMode {
 enum DiodeIntegrationMethod {
    DIODE_EULER_FULL_TANH,
    DIODE_PREDICTOR_CORRECTOR_FULL_TANH,
+   DIODE_EULER_ADAA_TANH,
+   DIODE_TRAPEZOIDAL_FULL_TANH
 };
 
+// highest resonance at which silent voices may sleep,
+// self-oscillation starts near 0.87
+#define DIODE_SLEEP_MAX_RESONANCE 0.8f
+
 class Diode{
 public:
   // constructor/destructor
@@ -52,11 +56,16 @@ public:
   // set filter parameters
   void SetFilterCutoff(double newCutoff);
   void SetFilterResonance(double newResonance);
+
+  // ramp cutoff and resonance to control rate targets over the given
+  // number of samples, the integration rate is computed once per call
+  void SetFilterControlRamp(double newCutoff, double newResonance, int steps);
   void SetFilterMode(DiodeFilterMode newFilterMode);
   void SetFilterSampleRate(double newSampleRate);
   void SetFilterIntegrationMethod(DiodeIntegrationMethod method);
   void SetFilterOversamplingFactor(int newOversamplingFactor);
   void SetFilterDecimatorOrder(int decimatorOrder);
+  void SetFilterControlRateNoise(bool newControlRateNoise);
   
   // get filter parameters
   double GetFilterCutoff();
@@ -66,6 +75,7 @@ public:
   DiodeIntegrationMethod GetFilterIntegrationMethod();
   int GetFilterOversamplingFactor();  
   int GetFilterDecimatorOrder();
+  bool GetFilterControlRateNoise();
 
   // normalized noise
 #ifdef FLOATDSP
@@ -79,9 +89,49 @@ public:
   
   // tick filter state
 #ifdef FLOATDSP
-  void DiodeFilter(float input);
+  inline void DiodeFilter(float input){
+#else
+  inline void DiodeFilter(double input){
+#endif
+    // step integration rate and resonance along the control rate ramp
+    if(controlRampRemaining > 0){
+      if(--controlRampRemaining){
+	dt += dtIncrement;
+	Resonance += resonanceIncrement;
+      }
+      else{
+	dt = dtTarget;
+	Resonance = resonanceTarget;
+      }
+    }
+    
+    // resonance able to self-oscillate keeps the voice awake
+    bool selfOscillating = Resonance > DIODE_SLEEP_MAX_RESONANCE;
+    
+    // silent voice sleeps until input returns
+    if(sleepDetector.Asleep(input, selfOscillating)){
+      return;
+    }
+    
+    // automatic oversampling follows signal and filter state
+    if(autoOversampling && governor.Update(cutoffFrequency, Resonance, input)){
+      SwitchOversamplingFactor(governor.GetOversamplingFactor());
+    }
+    (this->*filterKernel)(input);
+
+    // voice sleeps once input, output and state have decayed
+    if(sleepDetector.Update(input, out, selfOscillating)){
+      EnterSleep();
+    }
+  }
+
+  // process a block with per-sample cutoff and resonance
+#ifdef FLOATDSP
+  void ProcessBlock(const float* input, float* output,
+		    const float* cutoff, const float* resonance, int n);
 #else
-  void DiodeFilter(double input);
+  void ProcessBlock(const double* input, double* output,
+		    const double* cutoff, const double* resonance, int n);
 #endif
   
   // get filter responses
@@ -103,6 +153,37 @@ private:
   // set integration rate
   void SetFilterIntegrationRate();
 
+  // settle decayed state to rest and put voice to sleep
+  void EnterSleep();
+
+  // clear filter and decimator state, parameters stay
+  void ClearFilterState();
+
+  // filter kernel specialized on integration method and oversampling factor
+#ifdef FLOATDSP
+  typedef void (Diode::*FilterKernel)(float input);
+  
+  template <DiodeIntegrationMethod method, int factor>
+  void DiodeFilterKernel(float input);
+#else
+  typedef void (Diode::*FilterKernel)(double input);
+  
+  template <DiodeIntegrationMethod method, int factor>
+  void DiodeFilterKernel(double input);
+#endif
+
+  template <DiodeIntegrationMethod method>
+  static FilterKernel GetFilterKernel(int factor);
+  
+  // select kernel for current integration method and oversampling factor
+  void SelectFilterKernel();
+
+  // change oversampling factor without restarting the decimator
+  void SwitchOversamplingFactor(int newOversamplingFactor);
+
+  // resync antialiased nonlinearities to filter state
+  void ResetAntialiasingState();
+
   // get decoupling rate
 #ifdef FLOATDSP
   float GetDecouplingIntegrationRate();
@@ -114,11 +195,26 @@ private:
   double cutoffFrequency;
   double Resonance;
   DiodeFilterMode filterMode;
-  double sampleRate;
   double dt;
+  double dt_t1;
+
+  // control rate ramp
+  double dtTarget;
+  double dtIncrement;
+  double resonanceTarget;
+  double resonanceIncrement;
+  int controlRampRemaining;
   DiodeIntegrationMethod integrationMethod;
-  int oversamplingFactor;
-  int decimatorOrder;
+  FilterKernel filterKernel;
+
+  // thermal stage modulation, optionally held at control rate
+  bool controlRateNoise;
+  int noiseHold;
+#ifdef FLOATDSP
+  float alpha_0, alpha_1, alpha_2, alpha_3;
+#else
+  double alpha_0, alpha_1, alpha_2, alpha_3;
+#endif
   
   // filter state
 #ifdef FLOATDSP
@@ -130,6 +226,13 @@ private:
   double ut_1;
   double hp0, hp1, hp2, hp3, hp4, hp5;
 #endif
+
+  // tanh stage arguments at t-1
+#ifdef FLOATDSP
+  float xt_1[8];
+#else
+  double xt_1[8];
+#endif
   
   // filter output
 #ifdef FLOATDSP
@@ -138,12 +241,174 @@ private:
   double out;
 #endif
   
-  // IIR downsampling filter
-#ifdef FLOATDSP
-  IIRLowpass32 *iir;
-#else
-  IIRLowpass *iir;
-#endif
+  // oversampling and decimation
+  Oversampler oversampler;
+
+  // silent voice sleep
+  SleepDetector sleepDetector;
+
+  // automatic oversampling
+  bool autoOversampling;
+  OversamplingGovernor governor;
+};
+
+// four voice diode ladder filter with the state of each
+// voice held in one lane of a SIMD register
+class DiodeX4{
+public:
+  // constructor/destructor
+  DiodeX4(float4 newCutoff, float4 newResonance, int newOversamplingFactor,
+	  DiodeFilterMode newFilterMode, double newSampleRate,
+	  DiodeIntegrationMethod newIntegrationMethod, int newDecimatorOrder);
+  DiodeX4();
+  ~DiodeX4();
+
+  // set filter parameters
+  void SetFilterCutoff(float4 newCutoff);
+  void SetFilterResonance(float4 newResonance);
+
+  // ramp cutoff and resonance to control rate targets over the given
+  // number of samples, the integration rate is computed once per call
+  void SetFilterControlRamp(float4 newCutoff, float4 newResonance, int steps);
+  void SetFilterMode(DiodeFilterMode newFilterMode);
+  void SetFilterSampleRate(double newSampleRate);
+  void SetFilterIntegrationMethod(DiodeIntegrationMethod method);
+  void SetFilterOversamplingFactor(int newOversamplingFactor);
+  void SetFilterDecimatorOrder(int decimatorOrder);
+  void SetFilterControlRateNoise(bool newControlRateNoise);
+  
+  // get filter parameters
+  float4 GetFilterCutoff();
+  float4 GetFilterResonance();
+  DiodeFilterMode GetFilterMode();  
+  double GetFilterSampleRate();
+  DiodeIntegrationMethod GetFilterIntegrationMethod();
+  int GetFilterOversamplingFactor();  
+  int GetFilterDecimatorOrder();
+  bool GetFilterControlRateNoise();
+
+  // normalized noise
+  float4 GetNormalizedNoiseValue();
+
+  // thermal noise generator bank
+  NoiseBankX4 noise;
+  
+  // tick filter state
+  inline void DiodeFilter(float4 input){
+    // step integration rate and resonance along the control rate ramp
+    if(controlRampRemaining > 0){
+      if(--controlRampRemaining){
+	dt += dtIncrement;
+	Resonance += resonanceIncrement;
+      }
+      else{
+	dt = dtTarget;
+	Resonance = resonanceTarget;
+      }
+    }
+    
+    // resonance able to self-oscillate keeps the voices awake
+    bool selfOscillating = Int4Any(Resonance > DIODE_SLEEP_MAX_RESONANCE);
+    
+    // silent voices sleep until input returns
+    if(sleepDetector.Asleep(input, selfOscillating)){
+      return;
+    }
+    
+    // automatic oversampling follows signal and filter state
+    if(autoOversampling && governor.Update(cutoffFrequency, Resonance, input)){
+      SwitchOversamplingFactor(governor.GetOversamplingFactor());
+    }
+    (this->*filterKernel)(input);
+
+    // voices sleep once input, output and state have decayed
+    if(sleepDetector.Update(input, out, selfOscillating)){
+      EnterSleep();
+    }
+  }
+
+  // process a block with per-sample cutoff and resonance
+  void ProcessBlock(const float4* input, float4* output,
+		    const float4* cutoff, const float4* resonance, int n);
+  
+  // get filter output
+  float4 GetFilterOutput();
+  
+  // reset state
+  void ResetFilterState();
+
+private:
+  // set integration rate
+  void SetFilterIntegrationRate();
+
+  // settle decayed state to rest and put voice to sleep
+  void EnterSleep();
+
+  // clear filter and decimator state, parameters stay
+  void ClearFilterState();
+
+  // filter kernel specialized on integration method and oversampling factor
+  typedef void (DiodeX4::*FilterKernel)(float4 input);
+  
+  template <DiodeIntegrationMethod method, int factor>
+  void DiodeFilterKernel(float4 input);
+
+  template <DiodeIntegrationMethod method>
+  static FilterKernel GetFilterKernel(int factor);
+  
+  // select kernel for current integration method and oversampling factor
+  void SelectFilterKernel();
+
+  // change oversampling factor without restarting the decimator
+  void SwitchOversamplingFactor(int newOversamplingFactor);
+
+  // resync antialiased nonlinearities to filter state
+  void ResetAntialiasingState();
+
+  // get decoupling rate
+  float4 GetDecouplingIntegrationRate();
+  
+  // filter parameters
+  float4 cutoffFrequency;
+  float4 Resonance;
+  DiodeFilterMode filterMode;
+  float4 dt;
+  float4 dt_t1;
+
+  // control rate ramp
+  float4 dtTarget;
+  float4 dtIncrement;
+  float4 resonanceTarget;
+  float4 resonanceIncrement;
+  int controlRampRemaining;
+  DiodeIntegrationMethod integrationMethod;
+  FilterKernel filterKernel;
+
+  // thermal stage modulation, optionally held at control rate
+  bool controlRateNoise;
+  int noiseHold;
+  float4 alpha_0, alpha_1, alpha_2, alpha_3;
+  
+  // filter state
+  float4 p0, p1, p2, p3;
+  float4 ut_1;
+  float4 hp0, hp1, hp2, hp3, hp4, hp5;
+
+  // tanh stage arguments at t-1
+  float4 xt_1[8];
+  
+  // filter output
+  float4 out;
+  
+  // oversampling and decimation
+  OversamplerX4 oversampler;
+
+  // silent voice sleep
+  SleepDetectorX4 sleepDetector;
+
+  // automatic oversampling
+  bool autoOversampling;
+  OversamplingGovernorX4 governor;
 };
 
 #endif
@@ -22,6 +22,142 @@
 #ifndef __kocmocfastmathh__
 #define __kocmocfastmathh__
 
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// difference quotient breaking limit for antiderivative antialiasing
+#define TANH_ADAA_TOLERANCE 1.0e-5
+
+// fast 2^x for pitch and cutoff cv, split into an integer
+// exponent written to the exponent bits and a cephes polynomial
+// on the fraction in -0.5..0.5. relative error stays under
+// 1.0e-7 (about one ulp) over the clamped -126..126 range
+inline float FloatExp2(float x) {
+  // clamp to the normal float range
+  if(x > 126.0f) {
+    x = 126.0f;
+  }
+  else if(x < -126.0f) {
+    x = -126.0f;
+  }
+
+  // round to nearest integer exponent, conversion truncates
+  // toward zero so step down where that rounded up
+  float r = x + 0.5f;
+  int32_t e = (int32_t)(r);
+  if((float)(e) > r) {
+    e--;
+  }
+  float f = x - (float)(e);
+
+  // polynomial for 2^f
+  float y = 1.535336188319500e-4f;
+  y = y * f + 1.339887440266574e-3f;
+  y = y * f + 9.618437357674640e-3f;
+  y = y * f + 5.550332471162809e-2f;
+  y = y * f + 2.402264791363012e-1f;
+  y = y * f + 6.931472028550421e-1f;
+  y = y * f + 1.0f;
+
+  // scale by 2^e through the exponent bits
+  int32_t bits = (e + 127) << 23;
+  float scale;
+  std::memcpy(&scale, &bits, sizeof scale);
+  
+  return y * scale;
+}
+
+// natural logarithm for positive x, range reduced to a
+// mantissa in sqrt(0.5)..sqrt(2) and a cephes polynomial
+inline float FloatLog(float x) {
+  // split into exponent and mantissa in 0.5..1
+  int32_t bits;
+  std::memcpy(&bits, &x, sizeof bits);
+  float e = (float)(((bits >> 23) & 0xFF) - 126);
+  bits = (bits & 0x007FFFFF) | 0x3F000000;
+  float m;
+  std::memcpy(&m, &bits, sizeof m);
+
+  // shift mantissa to sqrt(0.5)..sqrt(2)
+  if(m < 0.70710678f) {
+    e -= 1.0f;
+    m += m;
+  }
+  m -= 1.0f;
+
+  // polynomial for log(1 + m)
+  float z = m * m;
+  float y = 7.0376836292e-2f;
+  y = y * m - 1.1514610310e-1f;
+  y = y * m + 1.1676998740e-1f;
+  y = y * m - 1.2420140846e-1f;
+  y = y * m + 1.4249322787e-1f;
+  y = y * m - 1.6668057665e-1f;
+  y = y * m + 2.0000714765e-1f;
+  y = y * m - 2.4999993993e-1f;
+  y = y * m + 3.3333331174e-1f;
+  y = y * m * z;
+
+  // add exponent in two parts for accuracy
+  y += -2.12194440e-4f * e;
+  y += -0.5f * z;
+  return m + y + 0.693359375f * e;
+}
+
+// log(1 + x) for x > -1, corrected for the rounding
+// of 1 + x to stay accurate for small x
+inline float FloatLog1p(float x) {
+  float w = 1.0f + x;
+  float d = w - 1.0f;
+
+  if(d == 0.0f) {
+    return x;
+  }
+  return FloatLog(w) * (x / d);
+}
+
+// fast sinh, taylor series under 0.5 and exponentials
+// through FloatExp2 above. relative error stays under
+// 1.0e-6 for |x| < 12
+inline float FloatSinh(float x) {
+  float a = std::fabs(x);
+
+  // small arguments avoid the cancellation of the exponentials
+  if(a < 0.5f) {
+    float z = x * x;
+    return x + x * z * (1.0f / 6.0f + z * (1.0f / 120.0f + z * (1.0f / 5040.0f + z * (1.0f / 362880.0f))));
+  }
+
+  float e = FloatExp2(1.442695041f * a);
+  float y = 0.5f * (e - 1.0f / e);
+  return x < 0.0f ? -y : y;
+}
+
+// fast asinh as log1p(|x| + x^2 / (1 + sqrt(1 + x^2))),
+// relative error stays under 2.5e-7
+inline float FloatASinh(float x) {
+  float a = std::fabs(x);
+  float y = FloatLog1p(a + a * a / (1.0f + std::sqrt(a * a + 1.0f)));
+  return x < 0.0f ? -y : y;
+}
+
+// sinh from a single exponential, taylor series under 0.5
+inline double SinhExp(double x) {
+  double a = std::fabs(x);
+
+  // small arguments avoid the cancellation of the exponentials
+  if(a < 0.5) {
+    double z = x * x;
+    return x + x * z * (1.0 / 6.0 + z * (1.0 / 120.0 + z * (1.0 / 5040.0 + z * (1.0 / 362880.0 +
+	   z * (1.0 / 39916800.0 + z * (1.0 / 6227020800.0))))));
+  }
+
+  double e = std::exp(a);
+  double y = 0.5 * (e - 1.0 / e);
+  return x < 0.0 ? -y : y;
+}
+
 // pade 3/2 approximant for sinh
 inline float FloatSinhPade32(float x) {
   // return approximant
@@ -119,6 +255,31 @@ inline double dASinhPade54(double x) {
   return n / (d * d);
 }
 
+// pade 5/4 approximant for asinh and its derivative
+// sharing the denominator, for newton-raphson steps
+inline float FloatASinhPade54dASinh(float x, float& derivative) {
+  float x2 = x * x;
+  float d = 9675.0f * x2 * x2 + 58100.0f * x2 + 61488.0f;
+  float n = 44536605.0f * x2 * x2 * x2 * x2 + 339381280.0f * x2 * x2 * x2 +
+              2410740304.0f * x2 * x2 + 5254518528.0f * x2 + 3780774144.0f;
+  float d_inv = 1.0f / d;
+
+  derivative = n * d_inv * d_inv;
+  return x * (69049.0f * x2 * x2 + 717780.0f * x2 + 922320.0f) * (1.0f / 15.0f) * d_inv;
+}
+
+// pade 5/4 approximant for asinh and its derivative
+inline double ASinhPade54dASinh(double x, double& derivative) {
+  double x2 = x * x;
+  double d = 9675.0 * x2 * x2 + 58100.0 * x2 + 61488.0;
+  double n = 44536605.0 * x2 * x2 * x2 * x2 + 339381280.0 * x2 * x2 * x2 +
+               2410740304.0 * x2 * x2 + 5254518528.0 * x2 + 3780774144.0;
+  double d_inv = 1.0 / d;
+
+  derivative = n * d_inv * d_inv;
+  return x * (69049.0 * x2 * x2 + 717780.0 * x2 + 922320.0) * (1.0 / 15.0) * d_inv;
+}
+
 // pade 2/3 approximant for tanh
 inline float FloatTanhPade23(float x) {
   // return approximant
@@ -172,6 +333,113 @@ inline double TanhPade54(double x) {
            (945.0 + 420.0 * x * x + 15.0 * x * x * x * x);
 }
 
+// antiderivative of pade 2/3 approximant for tanh
+inline float FloatTanhPade23AD(float x) {
+  return 1.5f * std::log(x * x + 3.0f);
+}
+
+// antiderivative of pade 2/3 approximant for tanh
+inline double TanhPade23AD(double x) {
+  return 1.5 * std::log(x * x + 3.0);
+}
+
+// antiderivative of pade 4/5 approximant for tanh,
+// denominator factors to (x^2 + 2.4688...)(x^2 + 42.531...)
+inline float FloatTanhPade45AD(float x) {
+  return 1.0023383f * std::log(x * x + 2.4687744f) + 3.9976617f * std::log(x * x + 42.531226f);
+}
+
+// antiderivative of pade 4/5 approximant for tanh
+inline double TanhPade45AD(double x) {
+  return 1.0023382711020465 * std::log(x * x + 2.46877437598987) +
+           3.9976617288979535 * std::log(x * x + 42.53122562401013);
+}
+
+// antiderivative of pade 3/2 approximant for tanh,
+// continued linearly past the clamping points
+inline double TanhPade32AD(double x) {
+  if(x > 3.0) {
+    return 0.75 + 25.0 / 24.0 * std::log(69.0) + 24.0 / 23.0 * (x - 3.0);
+  }
+  else if(x < -3.0) {
+    return 0.75 + 25.0 / 24.0 * std::log(69.0) - 24.0 / 23.0 * (x + 3.0);
+  }
+  else {
+    return x * x / 12.0 + 25.0 / 24.0 * std::log(15.0 + 6.0 * x * x);
+  }
+}
+
+// first order antiderivative antialiased pade 2/3 tanh,
+// x_1 is the argument at the previous step
+inline float FloatTanhPade23ADAA(float x, float x_1) {
+  float dx = x - x_1;
+
+  // fall back to midpoint for ill-conditioned quotient
+  if(std::fabs(dx) < TANH_ADAA_TOLERANCE) {
+    return FloatTanhPade23(0.5f * (x + x_1));
+  }
+
+  // antiderivative difference as a single log ratio
+  return 1.5f * std::log1p(dx * (x + x_1) / (x_1 * x_1 + 3.0f)) / dx;
+}
+
+// first order antiderivative antialiased pade 2/3 tanh
+inline double TanhPade23ADAA(double x, double x_1) {
+  double dx = x - x_1;
+
+  // fall back to midpoint for ill-conditioned quotient
+  if(std::fabs(dx) < TANH_ADAA_TOLERANCE) {
+    return TanhPade23(0.5 * (x + x_1));
+  }
+
+  // antiderivative difference as a single log ratio
+  return 1.5 * std::log1p(dx * (x + x_1) / (x_1 * x_1 + 3.0)) / dx;
+}
+
+// first order antiderivative antialiased pade 4/5 tanh
+inline float FloatTanhPade45ADAA(float x, float x_1) {
+  float dx = x - x_1;
+
+  // fall back to midpoint for ill-conditioned quotient
+  if(std::fabs(dx) < TANH_ADAA_TOLERANCE) {
+    return FloatTanhPade45(0.5f * (x + x_1));
+  }
+
+  // antiderivative difference as log ratios of the factors
+  float du = dx * (x + x_1);
+  float u_1 = x_1 * x_1;
+  return (1.0023383f * std::log1p(du / (u_1 + 2.4687744f)) +
+	  3.9976617f * std::log1p(du / (u_1 + 42.531226f))) / dx;
+}
+
+// first order antiderivative antialiased pade 4/5 tanh
+inline double TanhPade45ADAA(double x, double x_1) {
+  double dx = x - x_1;
+
+  // fall back to midpoint for ill-conditioned quotient
+  if(std::fabs(dx) < TANH_ADAA_TOLERANCE) {
+    return TanhPade45(0.5 * (x + x_1));
+  }
+
+  // antiderivative difference as log ratios of the factors
+  double du = dx * (x + x_1);
+  double u_1 = x_1 * x_1;
+  return (1.0023382711020465 * std::log1p(du / (u_1 + 2.46877437598987)) +
+	  3.9976617288979535 * std::log1p(du / (u_1 + 42.53122562401013))) / dx;
+}
+
+// first order antiderivative antialiased pade 3/2 tanh
+inline double TanhPade32ADAA(double x, double x_1) {
+  double dx = x - x_1;
+
+  // fall back to midpoint for ill-conditioned quotient
+  if(std::fabs(dx) < TANH_ADAA_TOLERANCE) {
+    return TanhPade32(0.5 * (x + x_1));
+  }
+
+  return (TanhPade32AD(x) - TanhPade32AD(x_1)) / dx;
+}
+
 inline double SinhExpTaylor(double x, int N) {
   double n=1.0, d=1.0, s=-1.0, t=1.0, exp_plus=1.0, exp_minus=1.0;
   
@@ -23,7 +23,15 @@
 #define __kocmocfastrandhh__
 
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include "fastsimd.h"
+
+// noise bank block size in four lane values
+#define NOISE_BANK_SIZE 64
+
+// independent generators per noise bank
+#define NOISE_BANK_GENERATORS 8
 
 static inline float frand(uint32_t& s) {
     s ^= s << 13;
@@ -35,4 +43,59 @@ static inline float frand(uint32_t& s) {
     return f - 1.0f;
 }
 
+// four independent xorshift generators, one per lane
+static inline float4 frand4(uint4& s) {
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    uint4 u = (s >> 9) | 0x3F800000u;
+    return (float4)u - 1.0f;
+}
+
+// bank of four lane xorshift generators filling a block of
+// normalized noise for four voices. the generators run
+// independently so the fill loop has no serial dependency
+class NoiseBankX4{
+public:
+  NoiseBankX4(){
+    Seed();
+  }
+
+  // seed every generator lane
+  void Seed(){
+    for(int ii = 0; ii < NOISE_BANK_GENERATORS; ii++){
+      for(int jj = 0; jj < 4; jj++){
+	s[ii][jj] = rand() | 1u;
+      }
+    }
+    index = NOISE_BANK_SIZE;
+  }
+
+  // next normalized noise value
+  inline float4 Next(){
+    if(index >= NOISE_BANK_SIZE){
+      Fill();
+    }
+    return buffer[index++];
+  }
+
+private:
+  // generate a new block
+  void Fill(){
+    for(int ii = 0; ii < NOISE_BANK_SIZE; ii += NOISE_BANK_GENERATORS){
+      for(int jj = 0; jj < NOISE_BANK_GENERATORS; jj++){
+	buffer[ii + jj] = 2.0f * frand4(s[jj]) - 1.0f;
+      }
+    }
+    index = 0;
+  }
+
+  // generator state
+  uint4 s[NOISE_BANK_GENERATORS];
+
+  // noise block and read position
+  float4 buffer[NOISE_BANK_SIZE];
+  int index;
+};
+
 #endif // __kocmocfastrandhh__
@@ -0,0 +1,260 @@
+/*
+ *  (C) 2026 Janne Heikkarainen <janne808@radiofreerobotron.net>
+ *
+ *  All rights reserved.
+ *
+ *  This file is part of Kocmoc VCV Rack plugin.
+ *
+ *  Kocmoc VCV Rack plugin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Kocmoc VCV Rack plugin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kocmoc VCV Rack plugin.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __kocmocfastsimdh__
+#define __kocmocfastsimdh__
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#include "fastmath.h"
+
+// four lane vectors using compiler vector extensions,
+// lowered to SSE on x86 and NEON on ARM
+typedef float float4 __attribute__((vector_size(16)));
+typedef int32_t int4 __attribute__((vector_size(16)));
+typedef uint32_t uint4 __attribute__((vector_size(16)));
+
+// broadcast scalar to all lanes
+inline float4 Float4(float x) {
+  float4 v = {x, x, x, x};
+  return v;
+}
+
+// unaligned load and store
+inline float4 Float4Load(const float* p) {
+  float4 v;
+  std::memcpy(&v, p, sizeof v);
+  return v;
+}
+
+inline void Float4Store(float* p, float4 v) {
+  std::memcpy(p, &v, sizeof v);
+}
+
+// lane-wise select of a where mask is set and b elsewhere,
+// comparisons return lanes of all ones or all zeros
+inline float4 Float4Select(int4 mask, float4 a, float4 b) {
+  return (float4)((mask & (int4)a) | (~mask & (int4)b));
+}
+
+// lane-wise minimum and maximum
+inline float4 Float4Min(float4 a, float4 b) {
+  return Float4Select(a < b, a, b);
+}
+
+inline float4 Float4Max(float4 a, float4 b) {
+  return Float4Select(a > b, a, b);
+}
+
+// lane-wise absolute value
+inline float4 Float4Abs(float4 x) {
+  return (float4)((int4)x & 0x7FFFFFFF);
+}
+
+// maximum across lanes
+inline float Float4HMax(float4 x) {
+  float a = x[0] > x[1] ? x[0] : x[1];
+  float b = x[2] > x[3] ? x[2] : x[3];
+  return a > b ? a : b;
+}
+
+// true if any or all mask lanes are set
+inline bool Int4Any(int4 mask) {
+  return (mask[0] | mask[1] | mask[2] | mask[3]) != 0;
+}
+
+inline bool Int4All(int4 mask) {
+  return (mask[0] & mask[1] & mask[2] & mask[3]) != 0;
+}
+
+// lane-wise square root
+inline float4 Float4Sqrt(float4 x) {
+  float4 y;
+  for(int ii = 0; ii < 4; ii++){
+    y[ii] = std::sqrt(x[ii]);
+  }
+  return y;
+}
+
+// lane-wise fast 2^x, same range reduction and
+// polynomial as the scalar FloatExp2
+inline float4 Float4Exp2(float4 x) {
+  // clamp to the normal float range
+  x = Float4Min(Float4Max(x, Float4(-126.0f)), Float4(126.0f));
+
+  // round to nearest integer exponent, conversion truncates
+  // toward zero so step down where that rounded up
+  float4 r = x + 0.5f;
+  int4 i = __builtin_convertvector(r, int4);
+  i += (int4)(__builtin_convertvector(i, float4) > r);
+  float4 f = x - __builtin_convertvector(i, float4);
+
+  // polynomial for 2^f
+  float4 y = Float4(1.535336188319500e-4f);
+  y = y * f + 1.339887440266574e-3f;
+  y = y * f + 9.618437357674640e-3f;
+  y = y * f + 5.550332471162809e-2f;
+  y = y * f + 2.402264791363012e-1f;
+  y = y * f + 6.931472028550421e-1f;
+  y = y * f + 1.0f;
+
+  // scale by 2^i through the exponent bits
+  return y * (float4)((i + 127) << 23);
+}
+
+// lane-wise natural logarithm for positive x, range reduced
+// to a mantissa in sqrt(0.5)..sqrt(2) and a cephes polynomial
+inline float4 Float4Log(float4 x) {
+  // split into exponent and mantissa in 0.5..1
+  int4 bits = (int4)x;
+  float4 e = __builtin_convertvector(((bits >> 23) & 0xFF) - 126, float4);
+  float4 m = (float4)((bits & 0x007FFFFF) | 0x3F000000);
+
+  // shift mantissa to sqrt(0.5)..sqrt(2)
+  int4 mask = m < 0.70710678f;
+  e = Float4Select(mask, e - 1.0f, e);
+  m = Float4Select(mask, m + m, m) - 1.0f;
+
+  // polynomial for log(1 + m)
+  float4 z = m * m;
+  float4 y = Float4(7.0376836292e-2f);
+  y = y * m - 1.1514610310e-1f;
+  y = y * m + 1.1676998740e-1f;
+  y = y * m - 1.2420140846e-1f;
+  y = y * m + 1.4249322787e-1f;
+  y = y * m - 1.6668057665e-1f;
+  y = y * m + 2.0000714765e-1f;
+  y = y * m - 2.4999993993e-1f;
+  y = y * m + 3.3333331174e-1f;
+  y = y * m * z;
+
+  // add exponent in two parts for accuracy
+  y += -2.12194440e-4f * e;
+  y += -0.5f * z;
+  return m + y + 0.693359375f * e;
+}
+
+// lane-wise log(1 + x) for x > -1, corrected for the
+// rounding of 1 + x to stay accurate for small x
+inline float4 Float4Log1p(float4 x) {
+  float4 w = 1.0f + x;
+  float4 d = w - 1.0f;
+  int4 mask = d == 0.0f;
+  float4 d_safe = Float4Select(mask, Float4(1.0f), d);
+
+  return Float4Select(mask, x, Float4Log(w) * (x / d_safe));
+}
+
+// lane-wise fast sinh, same split as the scalar FloatSinh
+inline float4 Float4Sinh(float4 x) {
+  float4 a = Float4Abs(x);
+
+  // taylor series for small arguments
+  float4 z = x * x;
+  float4 ys = x + x * z * (1.0f / 6.0f + z * (1.0f / 120.0f + z * (1.0f / 5040.0f + z * (1.0f / 362880.0f))));
+
+  // exponentials elsewhere, sign restored from x
+  float4 e = Float4Exp2(1.442695041f * a);
+  float4 yl = 0.5f * (e - 1.0f / e);
+  yl = (float4)(((int4)yl) | ((int4)x & ~0x7FFFFFFF));
+
+  return Float4Select(a < 0.5f, ys, yl);
+}
+
+// lane-wise fast asinh, same form as the scalar FloatASinh
+inline float4 Float4ASinh(float4 x) {
+  float4 a = Float4Abs(x);
+  float4 y = Float4Log1p(a + a * a / (1.0f + Float4Sqrt(a * a + 1.0f)));
+
+  // restore sign from x
+  return (float4)(((int4)y) | ((int4)x & ~0x7FFFFFFF));
+}
+
+// pade 4/5 approximant for tanh
+inline float4 FloatTanhPade45(float4 x) {
+  // return approximant
+  return (5.0f * x * (2.0f * x * x + 21.0f)) / (x * x * (x * x + 45.0f) + 105.0f);
+}
+
+// first order antiderivative antialiased pade 4/5 tanh,
+// x_1 is the argument at the previous step
+inline float4 FloatTanhPade45ADAA(float4 x, float4 x_1) {
+  float4 dx = x - x_1;
+
+  // lanes with ill-conditioned quotient fall back to midpoint
+  int4 mask = Float4Abs(dx) < (float)(TANH_ADAA_TOLERANCE);
+  float4 dx_safe = Float4Select(mask, Float4(1.0f), dx);
+
+  // antiderivative difference as log ratios of the factors
+  float4 du = dx_safe * (x + x_1);
+  float4 u_1 = x_1 * x_1;
+  float4 y = (1.0023383f * Float4Log1p(du / (u_1 + 2.4687744f)) +
+	      3.9976617f * Float4Log1p(du / (u_1 + 42.531226f))) / dx_safe;
+
+  return Float4Select(mask, FloatTanhPade45(0.5f * (x + x_1)), y);
+}
+
+// pade 5/4 approximant for sinh
+inline float4 FloatSinhPade54(float4 x) {
+  // return approximant
+  return (x * (x * x * (551.0f * x * x + 22260.0f) + 166320.0f)) / (15.0f * (x * x * (5.0f * x * x - 364.0f) + 11088.0f));
+}
+
+// pade 5/4 approximant for cosh
+inline float4 FloatCoshPade54(float4 x) {
+  // return approximant
+  return (x * x * (313.0f * x * x + 6900.0f) + 15120.0f) /
+           (x * x * (13.0f * x * x - 660.0f) + 15120.0f);
+}
+
+// pade 5/4 approximant for asinh
+inline float4 FloatASinhPade54(float4 x) {
+  // return approximant
+  return (x * (69049.0f * x * x * x * x + 717780.0f * x * x + 922320.0f)) /
+           (15.0f * (9675.0f * x * x * x * x + 58100.0f * x * x + 61488.0f));
+}
+
+// pade 5/4 approximant for derivative of asinh
+inline float4 FloatdASinhPade54(float4 x) {
+  float4 n = 44536605.0f * x * x * x * x * x * x * x * x + 339381280.0f * x * x * x * x * x * x +
+               2410740304.0f * x * x * x * x + 5254518528.0f * x * x + 3780774144.0f;
+  float4 d = 9675.0f * x * x * x * x + 58100.0f * x * x + 61488.0f;
+
+  // return approximant
+  return n / (d * d);
+}
+
+// pade 5/4 approximant for asinh and its derivative
+// sharing the denominator, for newton-raphson steps
+inline float4 FloatASinhPade54dASinh(float4 x, float4& derivative) {
+  float4 x2 = x * x;
+  float4 d = 9675.0f * x2 * x2 + 58100.0f * x2 + 61488.0f;
+  float4 n = 44536605.0f * x2 * x2 * x2 * x2 + 339381280.0f * x2 * x2 * x2 +
+               2410740304.0f * x2 * x2 + 5254518528.0f * x2 + 3780774144.0f;
+  float4 d_inv = 1.0f / d;
+
+  derivative = n * d_inv * d_inv;
+  return x * (69049.0f * x2 * x2 + 717780.0f * x2 + 922320.0f) * (1.0f / 15.0f) * d_inv;
+}
+
+#endif // __kocmocfastsimdh__
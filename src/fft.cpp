@@ -0,0 +1,194 @@
+/*
+ *  (C) 2026 Janne Heikkarainen <janne808@radiofreerobotron.net>
+ *
+ *  All rights reserved.
+ *
+ *  This file is part of Kocmoc VCV Rack plugin.
+ *
+ *  Kocmoc VCV Rack plugin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Kocmoc VCV Rack plugin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kocmoc VCV Rack plugin.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include "fft.h"
+
+// minimum transform length
+#define FFT_MIN_LENGTH 4
+
+// constructor
+RealFFT::RealFFT(int newLength){
+  length = 0;
+  bitReverse = 0;
+  cosTable = sinTable = 0;
+  splitCos = splitSin = 0;
+  workRe = workIm = 0;
+  
+  SetLength(newLength);
+}
+
+// default constructor
+RealFFT::RealFFT(){
+  length = 0;
+  bitReverse = 0;
+  cosTable = sinTable = 0;
+  splitCos = splitSin = 0;
+  workRe = workIm = 0;
+  
+  SetLength(64);
+}
+
+// destructor
+RealFFT::~RealFFT(){
+  FreeBuffers();
+}
+
+void RealFFT::SetLength(int newLength){
+  // round up to a power of two
+  int n = FFT_MIN_LENGTH;
+  while(n < newLength){
+    n <<= 1;
+  }
+
+  if(n == length){
+    return;
+  }
+  
+  FreeBuffers();
+  length = n;
+  halfLength = n / 2;
+  AllocateBuffers();
+}
+
+int RealFFT::GetLength(){
+  return length;
+}
+
+void RealFFT::AllocateBuffers(){
+  bitReverse = new int[halfLength];
+  cosTable = new float[halfLength / 2];
+  sinTable = new float[halfLength / 2];
+  splitCos = new float[halfLength + 1];
+  splitSin = new float[halfLength + 1];
+  workRe = new float[halfLength];
+  workIm = new float[halfLength];
+
+  // bit reversal permutation
+  int bits = 0;
+  while((1 << bits) < halfLength){
+    bits++;
+  }
+  for(int ii = 0; ii < halfLength; ii++){
+    int r = 0;
+    for(int jj = 0; jj < bits; jj++){
+      r |= ((ii >> jj) & 1) << (bits - 1 - jj);
+    }
+    bitReverse[ii] = r;
+  }
+
+  // twiddle factors
+  for(int ii = 0; ii < halfLength / 2; ii++){
+    cosTable[ii] = (float)(std::cos(2.0 * M_PI * ii / halfLength));
+    sinTable[ii] = (float)(std::sin(2.0 * M_PI * ii / halfLength));
+  }
+  for(int ii = 0; ii <= halfLength; ii++){
+    splitCos[ii] = (float)(std::cos(2.0 * M_PI * ii / length));
+    splitSin[ii] = (float)(std::sin(2.0 * M_PI * ii / length));
+  }
+}
+
+void RealFFT::FreeBuffers(){
+  if(bitReverse){
+    delete[] bitReverse;
+    delete[] cosTable;
+    delete[] sinTable;
+    delete[] splitCos;
+    delete[] splitSin;
+    delete[] workRe;
+    delete[] workIm;
+  }
+  bitReverse = 0;
+  cosTable = sinTable = 0;
+  splitCos = splitSin = 0;
+  workRe = workIm = 0;
+}
+
+// in-place decimation in time butterflies on bit reversed
+// work buffers, sign -1 for forward and +1 for inverse
+void RealFFT::ComplexFFT(float sign){
+  for(int size = 2; size <= halfLength; size <<= 1){
+    int half = size / 2;
+    int step = halfLength / size;
+    for(int kk = 0; kk < half; kk++){
+      float wr = cosTable[kk * step];
+      float wi = sign * sinTable[kk * step];
+      for(int ii = kk; ii < halfLength; ii += size){
+	int jj = ii + half;
+	float tr = wr * workRe[jj] - wi * workIm[jj];
+	float ti = wr * workIm[jj] + wi * workRe[jj];
+	workRe[jj] = workRe[ii] - tr;
+	workIm[jj] = workIm[ii] - ti;
+	workRe[ii] += tr;
+	workIm[ii] += ti;
+      }
+    }
+  }
+}
+
+void RealFFT::Forward(const float* input, float* re, float* im){
+  // pack even and odd samples into a half length complex signal
+  for(int ii = 0; ii < halfLength; ii++){
+    workRe[bitReverse[ii]] = input[2 * ii];
+    workIm[bitReverse[ii]] = input[2 * ii + 1];
+  }
+
+  ComplexFFT(-1.0f);
+
+  // split even and odd spectra and combine
+  for(int kk = 0; kk <= halfLength; kk++){
+    int k0 = (kk == halfLength) ? 0 : kk;
+    int k1 = (kk == 0) ? 0 : halfLength - kk;
+
+    float er = 0.5f * (workRe[k0] + workRe[k1]);
+    float ei = 0.5f * (workIm[k0] - workIm[k1]);
+    float or_ = 0.5f * (workIm[k0] + workIm[k1]);
+    float oi = -0.5f * (workRe[k0] - workRe[k1]);
+
+    re[kk] = er + splitCos[kk] * or_ + splitSin[kk] * oi;
+    im[kk] = ei + splitCos[kk] * oi - splitSin[kk] * or_;
+  }
+}
+
+void RealFFT::Inverse(const float* re, const float* im, float* output){
+  // recombine even and odd spectra into a half length complex spectrum
+  for(int kk = 0; kk < halfLength; kk++){
+    int k1 = halfLength - kk;
+    
+    float er = re[kk] + re[k1];
+    float ei = im[kk] - im[k1];
+    float dr = re[kk] - re[k1];
+    float di = im[kk] + im[k1];
+    float or_ = dr * splitCos[kk] - di * splitSin[kk];
+    float oi = dr * splitSin[kk] + di * splitCos[kk];
+
+    workRe[bitReverse[kk]] = er - oi;
+    workIm[bitReverse[kk]] = ei + or_;
+  }
+
+  ComplexFFT(1.0f);
+
+  // unpack even and odd samples
+  for(int ii = 0; ii < halfLength; ii++){
+    output[2 * ii] = workRe[ii];
+    output[2 * ii + 1] = workIm[ii];
+  }
+}
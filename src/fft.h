@@ -0,0 +1,76 @@
+/*
+ *  (C) 2026 Janne Heikkarainen <janne808@radiofreerobotron.net>
+ *
+ *  All rights reserved.
+ *
+ *  This file is part of Kocmoc VCV Rack plugin.
+ *
+ *  Kocmoc VCV Rack plugin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Kocmoc VCV Rack plugin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kocmoc VCV Rack plugin.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __dspffth__
+#define __dspffth__
+
+// real-valued radix-2 FFT of power of two length,
+// computed as a half length complex FFT with split
+// real and imaginary spectrum arrays of length/2 + 1 bins
+class RealFFT{
+public:
+  // constructor/destructor
+  RealFFT(int newLength);
+  RealFFT();
+  ~RealFFT();
+
+  // set transform length, rounded up to a power of two
+  void SetLength(int newLength);
+
+  // get transform length
+  int GetLength();
+
+  // forward transform of length real samples
+  void Forward(const float* input, float* re, float* im);
+
+  // unnormalized inverse transform, the output
+  // is scaled by length compared to the input
+  void Inverse(const float* re, const float* im, float* output);
+  
+private:
+  // allocate twiddle tables and work buffers
+  void AllocateBuffers();
+  void FreeBuffers();
+
+  // in-place half length complex transform
+  void ComplexFFT(float sign);
+  
+  // transform length
+  int length;
+  int halfLength;
+
+  // bit reversal permutation of half length
+  int *bitReverse;
+
+  // complex twiddle factors of half length transform
+  float *cosTable;
+  float *sinTable;
+  
+  // real to complex split twiddle factors
+  float *splitCos;
+  float *splitSin;
+
+  // complex work buffers
+  float *workRe;
+  float *workIm;
+};
+
+#endif
@@ -22,6 +22,73 @@
 #include <cmath>
 #include "fir.h"
 
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// symmetric coefficient folded dot product
+// h holds the first (order + 1) / 2 coefficients of the
+// symmetric impulse response and x the contiguous delay line
+static inline double FIRSymmetricDotProduct(const double* h, const double* x, int order){
+  // index of the last sample in the delay line
+  const double* xr = x + order - 1;
+  
+  // number of folded coefficient pairs
+  int pairs = order / 2;
+  int n = 0;
+  double output = 0.0;
+  
+#if defined(__AVX__)
+  __m256d acc = _mm256_setzero_pd();
+  for(; n + 4 <= pairs; n += 4){
+    // load four samples from both ends of the delay line
+    __m256d a = _mm256_loadu_pd(x + n);
+    __m256d b = _mm256_loadu_pd(xr - n - 3);
+
+    // reverse tail samples
+    b = _mm256_permute2f128_pd(b, b, 1);
+    b = _mm256_permute_pd(b, 0x5);
+
+    // multiply and accumulate folded pairs
+    acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(h + n), _mm256_add_pd(a, b)));
+  }
+
+  // horizontal sum
+  __m128d acc2 = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+  acc2 = _mm_add_sd(acc2, _mm_unpackhi_pd(acc2, acc2));
+  output = _mm_cvtsd_f64(acc2);
+#elif defined(__SSE2__)
+  __m128d acc = _mm_setzero_pd();
+  for(; n + 2 <= pairs; n += 2){
+    // load two samples from both ends of the delay line
+    __m128d a = _mm_loadu_pd(x + n);
+    __m128d b = _mm_loadu_pd(xr - n - 1);
+
+    // reverse tail samples
+    b = _mm_shuffle_pd(b, b, 1);
+
+    // multiply and accumulate folded pairs
+    acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(h + n), _mm_add_pd(a, b)));
+  }
+
+  // horizontal sum
+  acc = _mm_add_sd(acc, _mm_unpackhi_pd(acc, acc));
+  output = _mm_cvtsd_f64(acc);
+#endif
+
+  // remaining folded pairs
+  for(; n < pairs; n++){
+    output += h[n] * (x[n] + xr[-n]);
+  }
+
+  // center tap of odd length filter
+  if(order & 1){
+    output += h[pairs] * x[pairs];
+  }
+  
+  return output;
+}
+
 // constructor
 FIRLowpass::FIRLowpass(double newSamplerate, double newCutoff, int newOrder)
 {
@@ -31,9 +98,7 @@ FIRLowpass::FIRLowpass(double newSamplerate, double newCutoff, int newOrder)
   order = newOrder;
   
   // allocate dsp vectors
-  h_d = new double[order];
-  h = new double[order];
-  w = new double[order];
+  AllocateBuffers();
 
   // initialize ring buffer delay line
   InitializeRingbuffer();
@@ -51,9 +116,7 @@ FIRLowpass::FIRLowpass()
   order=128;
   
   // allocate dsp vectors
-  h_d = new double[order];
-  h = new double[order];
-  w = new double[order];
+  AllocateBuffers();
 
   // initialize ring buffer delay line
   InitializeRingbuffer();
@@ -65,23 +128,34 @@ FIRLowpass::FIRLowpass()
 // destructor
 FIRLowpass::~FIRLowpass(){
   // free dsp vectors
-  delete[] h_d;
-  delete[] h;
-  delete[] w;
+  FreeBuffers();
 }
 
-void FIRLowpass::SetFilterOrder(int newOrder){
-  order = newOrder;
+void FIRLowpass::AllocateBuffers(){
+  // allocate dsp vectors
+  h_d = new double[order];
+  h = new double[order];
+  w = new double[order];
 
+  // allocate mirrored delay line
+  ringBuffer = new double[2 * order];
+}
+
+void FIRLowpass::FreeBuffers(){
   // free dsp vectors
   delete[] h_d;
   delete[] h;
   delete[] w;
-  
-  // allocate dsp vectors
-  h_d = new double[order];
-  h = new double[order];
-  w = new double[order];
+
+  // free delay line
+  delete[] ringBuffer;
+}
+
+void FIRLowpass::SetFilterOrder(int newOrder){
+  // reallocate dsp vectors
+  FreeBuffers();
+  order = newOrder;
+  AllocateBuffers();
 
   // compute new impulse response
   ComputeImpulseResponse();
@@ -115,39 +189,38 @@ double* FIRLowpass::GetImpulseResponse(){
 void FIRLowpass::InitializeRingbuffer(){
   // initialize ring buffer delay line
   ringBufferIndex = 0;
-  ringBuffer = new double[order];
 
-  for(int n=0; n<order; n++){
+  for(int n=0; n<2*order; n++){
     ringBuffer[n] = 0.0;
   }
 }
 
 double FIRLowpass::FIRfilter(double input){
-  // update delay line
-  ringBuffer[ringBufferIndex++] = input;
+  // update both halves of the mirrored delay line
+  ringBuffer[ringBufferIndex] = input;
+  ringBuffer[ringBufferIndex + order] = input;
+  ringBufferIndex++;
   if(ringBufferIndex > (order - 1)){
     ringBufferIndex -= order;
   }
 
-  // compute convolution
-  double output = 0.0;
-  int ii;
-  for(int n = 0; n < order; n++){
-    // wrap around index
-    ii = (ringBufferIndex - (n + 1));
-    if(ii < 0)
-      ii += order;
-    
-    // multiply and accumulate
-    output += h[n] * ringBuffer[ii]; 
-  }
+  // compute convolution over the last order samples
+  // which start right after the newest sample
+  return FIRSymmetricDotProduct(h, ringBuffer + ringBufferIndex, order);
+}
 
-  return output;
+void FIRLowpass::FIRfilterBlock(const double* input, double* output, int n){
+  for(int ii=0; ii<n; ii++){
+    output[ii] = FIRfilter(input[ii]);
+  }
 }
 
 void FIRLowpass::ComputeImpulseResponse(){
   // index as -M..M
   double ii;
+
+  // center of the linear phase impulse response
+  double center = (double)(order - 1) / 2.0;
   
   // set cutoff frequency in radians
   omega_c = cutoff/samplerate;
@@ -155,7 +228,7 @@ void FIRLowpass::ComputeImpulseResponse(){
   // compute truncated ideal impulse response
   for(int n=0; n<order; n++){
     // compute index as -M..M and avoid NaN at impulse peak
-    ii = (double)(n) - 1.0 - (double)(floor((double)(order)/2.0)) + 1.0e-9;
+    ii = (double)(n) - center + 1.0e-9;
 
     // sample sinc function
     h_d[n] = std::sin((double)(2.0 * M_PI * omega_c * ii))/(double)(2.0 * M_PI * omega_c * ii);
@@ -164,7 +237,7 @@ void FIRLowpass::ComputeImpulseResponse(){
   // compute windowing function
   for(int n=0; n<order; n++){
     // compute index as -M..M and avoid NaN at impulse peak
-    ii = (double)(n) - 1.0 - (double)(floor((double)(order) / 2.0)) + 1.0e-9;
+    ii = (double)(n) - center + 1.0e-9;
 
     // hanning window function
     w[n] = std::cos(M_PI * ii/(double)(order));
@@ -172,9 +245,11 @@ void FIRLowpass::ComputeImpulseResponse(){
   }
 
   // compute windowed ideal impulse function
-  for(int n=0; n<order; n++){
+  for(int n=0; n<(order + 1)/2; n++){
     // window truncated ideal impulse response
     h[n] = w[n] * h_d[n];
+
+    // mirror the exactly symmetric tail
+    h[order - 1 - n] = h[n];
   }
 }
-
@@ -37,6 +37,9 @@ public:
   // FIR filter signal 
   double FIRfilter(double input);
 
+  // FIR filter block of signal
+  void FIRfilterBlock(const double* input, double* output, int n);
+
   // get impulse response
   double* GetImpulseResponse();
 
@@ -44,6 +47,10 @@ public:
   void InitializeRingbuffer();
   
 private:
+  // allocate dsp vectors and delay line
+  void AllocateBuffers();
+  void FreeBuffers();
+
   // compute windowed ideal impulse response
   void ComputeImpulseResponse();
 
@@ -58,7 +65,9 @@ private:
   double *h;
   double *w;
 
-  // ring buffer delay line
+  // mirrored ring buffer delay line of length 2*order,
+  // every sample is written twice so that the last order
+  // samples are always found contiguous in memory
   double *ringBuffer;
   int ringBufferIndex;
 };
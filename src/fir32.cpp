@@ -0,0 +1,257 @@
+/*
+ *  (C) 2026 Janne Heikkarainen <janne808@radiofreerobotron.net>
+ *
+ *  All rights reserved.
+ *
+ *  This file is part of Kocmoc VCV Rack plugin.
+ *
+ *  Kocmoc VCV Rack plugin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Kocmoc VCV Rack plugin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kocmoc VCV Rack plugin.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include "fir32.h"
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// symmetric coefficient folded dot product
+// h holds the first (order + 1) / 2 coefficients of the
+// symmetric impulse response and x the contiguous delay line
+static inline float FIRSymmetricDotProduct32(const float* h, const float* x, int order){
+  // index of the last sample in the delay line
+  const float* xr = x + order - 1;
+  
+  // number of folded coefficient pairs
+  int pairs = order / 2;
+  int n = 0;
+  float output = 0.0f;
+  
+#if defined(__AVX__)
+  __m256 acc = _mm256_setzero_ps();
+  for(; n + 8 <= pairs; n += 8){
+    // load eight samples from both ends of the delay line
+    __m256 a = _mm256_loadu_ps(x + n);
+    __m256 b = _mm256_loadu_ps(xr - n - 7);
+
+    // reverse tail samples
+    b = _mm256_permute2f128_ps(b, b, 1);
+    b = _mm256_permute_ps(b, _MM_SHUFFLE(0, 1, 2, 3));
+
+    // multiply and accumulate folded pairs
+    acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(h + n), _mm256_add_ps(a, b)));
+  }
+
+  // horizontal sum
+  __m128 acc4 = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+  acc4 = _mm_add_ps(acc4, _mm_movehl_ps(acc4, acc4));
+  acc4 = _mm_add_ss(acc4, _mm_shuffle_ps(acc4, acc4, 1));
+  output = _mm_cvtss_f32(acc4);
+#elif defined(__SSE2__)
+  __m128 acc = _mm_setzero_ps();
+  for(; n + 4 <= pairs; n += 4){
+    // load four samples from both ends of the delay line
+    __m128 a = _mm_loadu_ps(x + n);
+    __m128 b = _mm_loadu_ps(xr - n - 3);
+
+    // reverse tail samples
+    b = _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 1, 2, 3));
+
+    // multiply and accumulate folded pairs
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(h + n), _mm_add_ps(a, b)));
+  }
+
+  // horizontal sum
+  acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+  acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+  output = _mm_cvtss_f32(acc);
+#endif
+
+  // remaining folded pairs
+  for(; n < pairs; n++){
+    output += h[n] * (x[n] + xr[-n]);
+  }
+
+  // center tap of odd length filter
+  if(order & 1){
+    output += h[pairs] * x[pairs];
+  }
+  
+  return output;
+}
+
+// constructor
+FIRLowpass32::FIRLowpass32(double newSamplerate, double newCutoff, int newOrder)
+{
+  // initialize filter design parameters
+  samplerate = newSamplerate;
+  cutoff = newCutoff;
+  order = newOrder;
+  
+  // allocate dsp vectors
+  AllocateBuffers();
+
+  // initialize ring buffer delay line
+  InitializeRingbuffer();
+
+  // compute impulse response
+  ComputeImpulseResponse();
+}
+
+// default constructor
+FIRLowpass32::FIRLowpass32()
+{
+  // set default design parameters
+  samplerate=(double)(44100.0);
+  cutoff=(double)(440.0);
+  order=128;
+  
+  // allocate dsp vectors
+  AllocateBuffers();
+
+  // initialize ring buffer delay line
+  InitializeRingbuffer();
+
+  // compute impulse response
+  ComputeImpulseResponse();
+}
+
+// destructor
+FIRLowpass32::~FIRLowpass32(){
+  // free dsp vectors
+  FreeBuffers();
+}
+
+void FIRLowpass32::AllocateBuffers(){
+  // allocate dsp vectors
+  h_d = new double[order];
+  h = new float[order];
+  w = new double[order];
+
+  // allocate mirrored delay line
+  ringBuffer = new float[2 * order];
+}
+
+void FIRLowpass32::FreeBuffers(){
+  // free dsp vectors
+  delete[] h_d;
+  delete[] h;
+  delete[] w;
+
+  // free delay line
+  delete[] ringBuffer;
+}
+
+void FIRLowpass32::SetFilterOrder(int newOrder){
+  // reallocate dsp vectors
+  FreeBuffers();
+  order = newOrder;
+  AllocateBuffers();
+
+  // compute new impulse response
+  ComputeImpulseResponse();
+
+  // initialize ring buffer delay line
+  InitializeRingbuffer();
+}
+
+void FIRLowpass32::SetFilterSamplerate(double newSamplerate){
+  samplerate = newSamplerate;
+
+  // compute new impulse response
+  ComputeImpulseResponse();
+
+  // initialize ring buffer delay line
+  InitializeRingbuffer();
+}
+
+void FIRLowpass32::SetFilterCutoff(double newCutoff){
+  cutoff = newCutoff;
+
+  // compute new impulse response
+  ComputeImpulseResponse();
+
+}
+
+float* FIRLowpass32::GetImpulseResponse(){
+  return h;
+}
+
+void FIRLowpass32::InitializeRingbuffer(){
+  // initialize ring buffer delay line
+  ringBufferIndex = 0;
+
+  for(int n=0; n<2*order; n++){
+    ringBuffer[n] = 0.0f;
+  }
+}
+
+float FIRLowpass32::FIRfilter32(float input){
+  // update both halves of the mirrored delay line
+  ringBuffer[ringBufferIndex] = input;
+  ringBuffer[ringBufferIndex + order] = input;
+  ringBufferIndex++;
+  if(ringBufferIndex > (order - 1)){
+    ringBufferIndex -= order;
+  }
+
+  // compute convolution over the last order samples
+  // which start right after the newest sample
+  return FIRSymmetricDotProduct32(h, ringBuffer + ringBufferIndex, order);
+}
+
+void FIRLowpass32::FIRfilterBlock32(const float* input, float* output, int n){
+  for(int ii=0; ii<n; ii++){
+    output[ii] = FIRfilter32(input[ii]);
+  }
+}
+
+void FIRLowpass32::ComputeImpulseResponse(){
+  // index as -M..M
+  double ii;
+
+  // center of the linear phase impulse response
+  double center = (double)(order - 1) / 2.0;
+  
+  // set cutoff frequency in radians
+  omega_c = cutoff/samplerate;
+
+  // compute truncated ideal impulse response
+  for(int n=0; n<order; n++){
+    // compute index as -M..M and avoid NaN at impulse peak
+    ii = (double)(n) - center + 1.0e-9;
+
+    // sample sinc function
+    h_d[n] = std::sin((double)(2.0 * M_PI * omega_c * ii))/(double)(2.0 * M_PI * omega_c * ii);
+  }
+
+  // compute windowing function
+  for(int n=0; n<order; n++){
+    // compute index as -M..M and avoid NaN at impulse peak
+    ii = (double)(n) - center + 1.0e-9;
+
+    // hanning window function
+    w[n] = std::cos(M_PI * ii/(double)(order));
+    w[n] *= w[n];
+  }
+
+  // compute windowed ideal impulse function
+  for(int n=0; n<(order + 1)/2; n++){
+    // window truncated ideal impulse response
+    h[n] = (float)(w[n] * h_d[n]);
+
+    // mirror the exactly symmetric tail
+    h[order - 1 - n] = h[n];
+  }
+}
@@ -0,0 +1,75 @@
+/*
+ *  (C) 2026 Janne Heikkarainen <janne808@radiofreerobotron.net>
+ *
+ *  All rights reserved.
+ *
+ *  This file is part of Kocmoc VCV Rack plugin.
+ *
+ *  Kocmoc VCV Rack plugin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Kocmoc VCV Rack plugin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kocmoc VCV Rack plugin.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __dspfir32h__
+#define __dspfir32h__
+
+class FIRLowpass32{
+public:
+  // constructor/destructor
+  FIRLowpass32(double newSamplerate, double newCutoff, int newOrder);
+  FIRLowpass32();
+  ~FIRLowpass32();
+
+  // set filter parameters
+  void SetFilterOrder(int newOrder);
+  void SetFilterSamplerate(double newSamplerate);
+  void SetFilterCutoff(double newCutoff);
+  
+  // FIR filter signal 
+  float FIRfilter32(float input);
+
+  // FIR filter block of signal
+  void FIRfilterBlock32(const float* input, float* output, int n);
+
+  // get impulse response
+  float* GetImpulseResponse();
+
+  // clean filter ring buffer
+  void InitializeRingbuffer();
+  
+private:
+  // allocate dsp vectors and delay line
+  void AllocateBuffers();
+  void FreeBuffers();
+
+  // compute windowed ideal impulse response
+  void ComputeImpulseResponse();
+
+  // filter design variables
+  double samplerate;
+  double cutoff;
+  int order;
+  
+  // dsp variables
+  double omega_c;
+  double *h_d;
+  float *h;
+  double *w;
+
+  // mirrored ring buffer delay line of length 2*order,
+  // every sample is written twice so that the last order
+  // samples are always found contiguous in memory
+  float *ringBuffer;
+  int ringBufferIndex;
+};
+
+#endif
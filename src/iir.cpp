@@ -22,7 +22,9 @@
 #include <cmath>
 #include "iir.h"
 
-#define IIR_MAX_ORDER 32
+// dc offset added to the cascade input in transposed form
+// to keep the state out of the subnormal range in silence
+#define IIR_DENORMAL_OFFSET 1e-20
 
 // constructor
 IIRLowpass::IIRLowpass(double newSamplerate, double newCutoff, int newOrder)
@@ -30,20 +32,14 @@ IIRLowpass::IIRLowpass(double newSamplerate, double newCutoff, int newOrder)
   // initialize filter design parameters
   samplerate = newSamplerate;
   cutoff = newCutoff;
-  order = newOrder;
-
-  // allocate dsp vectors
-  a1 = new double[IIR_MAX_ORDER/2];
-  a2 = new double[IIR_MAX_ORDER/2];
-  K = new double[IIR_MAX_ORDER/2];
-  pa_real = new double[IIR_MAX_ORDER/2];
-  pa_imag = new double[IIR_MAX_ORDER/2];
-  p_real = new double[IIR_MAX_ORDER/2];
-  p_imag = new double[IIR_MAX_ORDER/2];
-
-  // allocate cascaded biquad buffer
-  z = new double[IIR_MAX_ORDER];
-  
+  if(newOrder > IIR_MAX_ORDER){
+    order = IIR_MAX_ORDER;
+  }
+  else{
+    order = newOrder;
+  }
+  structure = IIR_DIRECT_FORM_II;
+
   // initialize cascade delayline
   InitializeBiquadCascade();
   
@@ -58,18 +54,7 @@ IIRLowpass::IIRLowpass()
   samplerate=(double)(44100.0);
   cutoff=(double)(440.0);
   order=IIR_MAX_ORDER;
-  
-  // allocate dsp vectors
-  a1 = new double[IIR_MAX_ORDER/2];
-  a2 = new double[IIR_MAX_ORDER/2];
-  K = new double[IIR_MAX_ORDER/2];
-  pa_real = new double[IIR_MAX_ORDER/2];
-  pa_imag = new double[IIR_MAX_ORDER/2];
-  p_real = new double[IIR_MAX_ORDER/2];
-  p_imag = new double[IIR_MAX_ORDER/2];
-
-  // allocate cascaded biquad buffer
-  z = new double[IIR_MAX_ORDER];
+  structure = IIR_DIRECT_FORM_II;
   
   // initialize cascade delayline
   InitializeBiquadCascade();
@@ -80,17 +65,6 @@ IIRLowpass::IIRLowpass()
 
 // destructor
 IIRLowpass::~IIRLowpass(){
-  // free dsp vectors
-  delete[] a1;
-  delete[] a2;
-  delete[] K;
-  delete[] pa_real;
-  delete[] pa_imag;
-  delete[] p_real;
-  delete[] p_imag;
-  
-  // free cascaded biquad buffer
-  delete[] z;
 }
 
 void IIRLowpass::SetFilterOrder(int newOrder){
@@ -128,6 +102,17 @@ void IIRLowpass::SetFilterCutoff(double newCutoff){
   ComputeCoefficients();
 }
 
+void IIRLowpass::SetFilterStructure(IIRStructure newStructure){
+  structure = newStructure;
+
+  // initialize cascade delayline
+  InitializeBiquadCascade();
+}
+
+IIRStructure IIRLowpass::GetFilterStructure(){
+  return structure;
+}
+
 void IIRLowpass::InitializeBiquadCascade(){
   for(int ii=0; ii<order/2; ii++){
     z[ii*2+1] = 0.0;
@@ -136,6 +121,10 @@ void IIRLowpass::InitializeBiquadCascade(){
 }
 
 double IIRLowpass::IIRfilter(double input){
+  if(structure == IIR_TRANSPOSED_DIRECT_FORM_II){
+    return TransposedIIRfilter(input);
+  }
+  
   double out=input;
   double in;
 
@@ -155,6 +144,26 @@ double IIRLowpass::IIRfilter(double input){
   return out;
 }
 
+double IIRLowpass::TransposedIIRfilter(double input){
+  double out=input + IIR_DENORMAL_OFFSET;
+  double in;
+
+  // process biquad cascade
+  for(int ii=0; ii<order/2; ii++) {
+    // scale biquad input
+    in = K[ii]*out;
+
+    // compute biquad output
+    out = in + z[ii*2];
+
+    // update state variables
+    z[ii*2] = 2.0*in - a1[ii]*out + z[ii*2+1];
+    z[ii*2+1] = in - a2[ii]*out;
+  }
+  
+  return out;
+}
+
 double* IIRLowpass::GetFilterCoeffA1(){
   return a1;
 }
@@ -168,6 +177,12 @@ double* IIRLowpass::GetFilterCoeffK(){
 }
 
 void IIRLowpass::ComputeCoefficients(){
+  // analog and z-plane poles, only needed during design
+  double pa_real[IIR_MAX_ORDER/2];
+  double pa_imag[IIR_MAX_ORDER/2];
+  double p_real[IIR_MAX_ORDER/2];
+  double p_imag[IIR_MAX_ORDER/2];
+  
   // place butterworth style analog filter poles
   double theta;
 
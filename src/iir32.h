@@ -22,6 +22,20 @@
 #ifndef __dspiir32h__
 #define __dspiir32h__
 
+// maximum decimator order
+#ifndef IIR_MAX_ORDER
+#define IIR_MAX_ORDER 32
+#endif
+
+// biquad cascade structure
+#ifndef __dspiirstructure__
+#define __dspiirstructure__
+enum IIRStructure {
+   IIR_DIRECT_FORM_II,
+   IIR_TRANSPOSED_DIRECT_FORM_II
+};
+#endif
+
 class IIRLowpass32{
 public:
   // constructor/destructor
@@ -33,6 +47,10 @@ public:
   void SetFilterOrder(int newOrder);
   void SetFilterSamplerate(double newSamplerate);
   void SetFilterCutoff(double newCutoff);
+  void SetFilterStructure(IIRStructure newStructure);
+
+  // get filter structure
+  IIRStructure GetFilterStructure();
 
   // initialize biquad cascade delayline
   void InitializeBiquadCascade();
@@ -49,22 +67,23 @@ private:
   // compute biquad cascade coefficients
   void ComputeCoefficients();
 
+  // transposed direct form II biquad cascade
+  float TransposedIIRfilter32(float input);
+
   // filter design variables
   double samplerate;
   double cutoff;
   int order;
+  IIRStructure structure;
   
-  // dsp variables
-  float *a1;
-  float *a2;
-  float *K;
-  double *pa_real;
-  double *pa_imag;
-  double *p_real;
-  double *p_imag;
+  // biquad cascade coefficients
+  float a1[IIR_MAX_ORDER/2];
+  float a2[IIR_MAX_ORDER/2];
+  float K[IIR_MAX_ORDER/2];
   
-  // cascaded biquad buffers
-  float *z;
+  // cascaded biquad buffers, delays for direct form II
+  // and state variables for transposed direct form II
+  float z[IIR_MAX_ORDER];
 };
 
 #endif
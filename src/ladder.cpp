@@ -24,17 +24,9 @@
 #include <cmath>
 #include "ladder.h"
 
-#ifdef FLOATDSP
-#include "iir32.h"
-#else
-#include "iir.h"
-#endif
-
 #include "fastmath.h"
 #include "fastrand.h"
-
-// steepness of downsample filter response
-#define IIR_DOWNSAMPLE_ORDER 16
+#include "newton.h"
 
 // downsampling passthrough bandwidth
 #define IIR_DOWNSAMPLING_BANDWIDTH 0.75
@@ -45,9 +37,45 @@
 // check for newton-raphson breaking limit
 #define LADDER_NEWTON_BREAKING_LIMIT 1
 
+// newton-raphson step size breaking limit
+// relative to signal level, float and double paths
+#ifdef LADDER_NEWTON_BREAKING_LIMIT
+#define LADDER_NEWTON_TOLERANCE 1.0e-5f
+#define LADDER_NEWTON_TOLERANCE_DOUBLE 1.0e-9
+#else
+#define LADDER_NEWTON_TOLERANCE 0.0f
+#define LADDER_NEWTON_TOLERANCE_DOUBLE 0.0
+#endif
+
 // thermal phase noise amplitude
 #define LADDER_THERMAL_NOISE_AMPLITUDE 5.0e-3
 
+// thermal phase noise hold time in samples at control rate
+#define LADDER_NOISE_CONTROL_RATE 32
+
+// pole mixing weights of the input node and the four stage taps
+static const float poleMixWeights[LADDER_NUM_POLE_MIX_RESPONSES][5] = {
+  {0.0f, 1.0f, 0.0f, 0.0f, 0.0f},
+  {0.0f, 0.0f, 1.0f, 0.0f, 0.0f},
+  {0.0f, 0.0f, 0.0f, 1.0f, 0.0f},
+  {0.0f, 0.0f, 0.0f, 0.0f, 1.0f},
+  {1.0f, -1.0f, 0.0f, 0.0f, 0.0f},
+  {1.0f, -2.0f, 1.0f, 0.0f, 0.0f},
+  {1.0f, -3.0f, 3.0f, -1.0f, 0.0f},
+  {1.0f, -4.0f, 6.0f, -4.0f, 1.0f},
+  {0.0f, 2.0f, -2.0f, 0.0f, 0.0f},
+  {0.0f, 0.0f, 4.0f, -8.0f, 4.0f},
+  {1.0f, -2.0f, 2.0f, 0.0f, 0.0f}
+};
+
+// default pole mixing responses
+static const LadderPoleMixResponse poleMixDefaults[LADDER_POLE_MIX_OUTPUTS] = {
+  LADDER_POLE_MIX_LP2,
+  LADDER_POLE_MIX_BP2,
+  LADDER_POLE_MIX_HP2,
+  LADDER_POLE_MIX_NOTCH
+};
+
 // constructor
 Ladder::Ladder(double newCutoff, double newResonance, int newOversamplingFactor,
 	       LadderFilterMode newFilterMode, double newSampleRate,
@@ -56,23 +84,48 @@ Ladder::Ladder(double newCutoff, double newResonance, int newOversamplingFactor,
   cutoffFrequency = newCutoff;
   Resonance = newResonance;
   filterMode = newFilterMode;
-  sampleRate = newSampleRate;
-  oversamplingFactor = newOversamplingFactor;
-  decimatorOrder = newDecimatorOrder;
+
+  // set up oversampling
+  oversampler.SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  oversampler.SetSampleRate(newSampleRate);
+  oversampler.SetOversamplingFactor(newOversamplingFactor);
+  oversampler.SetDecimatorOrder(newDecimatorOrder);
+
+  // set up pole mixing
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMixOversampler[ii].SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+    poleMixOversampler[ii].SetSampleRate(newSampleRate);
+    poleMixOversampler[ii].SetOversamplingFactor(newOversamplingFactor);
+    poleMixOversampler[ii].SetDecimatorOrder(newDecimatorOrder);
+    poleMixResponse[ii] = poleMixDefaults[ii];
+  }
+  poleMixMask = 0;
+  
+  // automatic oversampling starts from x1
+  autoOversampling = (newOversamplingFactor == OVERSAMPLER_AUTO);
+  governor.SetSampleRate(newSampleRate);
+  governor.Reset(oversampler.GetOversamplingFactor());
   
   SetFilterIntegrationRate();
+  dt_t1 = dt;
+
+  // thermal noise at audio rate
+  controlRateNoise = false;
+  noiseHold = 0;
 
   // initialize filter state
   p0 = p1 = p2 = p3 = out = ut_1 = 0.0f;
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMix[ii] = 0.0f;
+  }
   
   integrationMethod = newIntegrationMethod;
-  
-  // instantiate downsampling filter
-#ifdef FLOATDSP
-  iir = new IIRLowpass32(sampleRate * oversamplingFactor, IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0, decimatorOrder);
-#else
-  iir = new IIRLowpass(sampleRate * oversamplingFactor, IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0, decimatorOrder);
-#endif
+
+  // initialize antialiasing state
+  ResetAntialiasingState();
+
+  // select filter kernel
+  SelectFilterKernel();
 
   // instantiate PRNG seed
   s = rand() | 1u;
@@ -84,23 +137,38 @@ Ladder::Ladder(){
   cutoffFrequency = 0.25;
   Resonance = 0.5;
   filterMode = LADDER_LOWPASS_MODE;
-  sampleRate = 44100.0;
-  oversamplingFactor = 2;
-  decimatorOrder = IIR_DOWNSAMPLE_ORDER;
+
+  // set up oversampling
+  oversampler.SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  autoOversampling = false;
+
+  // set up pole mixing
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMixOversampler[ii].SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+    poleMixResponse[ii] = poleMixDefaults[ii];
+  }
+  poleMixMask = 0;
   
   SetFilterIntegrationRate();
+  dt_t1 = dt;
   
+  // thermal noise at audio rate
+  controlRateNoise = false;
+  noiseHold = 0;
+
   // initialize filter state
   p0 = p1 = p2 = p3 = out = ut_1 = 0.0f;
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMix[ii] = 0.0f;
+  }
   
   integrationMethod = LADDER_PREDICTOR_CORRECTOR_FULL_TANH;
-  
-  // instantiate downsampling filter
-#ifdef FLOATDSP
-  iir = new IIRLowpass32(sampleRate * oversamplingFactor, IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0, decimatorOrder);
-#else
-  iir = new IIRLowpass(sampleRate * oversamplingFactor, IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0, decimatorOrder);
-#endif
+
+  // initialize antialiasing state
+  ResetAntialiasingState();
+
+  // select filter kernel
+  SelectFilterKernel();
 
   // instantiate PRNG seed
   s = rand() | 1u;
@@ -108,7 +176,6 @@ Ladder::Ladder(){
 
 // default destructor
 Ladder::~Ladder(){
-  delete iir;
 }
 
 void Ladder::ResetFilterState(){
@@ -117,14 +184,47 @@ void Ladder::ResetFilterState(){
   Resonance = 0.0;
 
   SetFilterIntegrationRate();
+  dt_t1 = dt;
+  
+  // initialize filter and decimator state
+  ClearFilterState();
   
+  // wake from sleep
+  sleepDetector.Reset();
+
+  // restart oversampling governor
+  governor.Reset(oversampler.GetOversamplingFactor());
+}
+
+void Ladder::ClearFilterState(){
   // initialize filter state
   p0 = p1 = p2 = p3 = out = ut_1 = 0.0f;
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMix[ii] = 0.0f;
+  }
+  ResetAntialiasingState();
   
-  // set oversampling
-  iir->SetFilterSamplerate(sampleRate * oversamplingFactor);
-  iir->SetFilterCutoff(IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0);
-  iir->SetFilterOrder(decimatorOrder);  
+  // clear decimator state, the decimator design stays
+  oversampler.ClearState();
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMixOversampler[ii].ClearState();
+  }
+}
+
+void Ladder::EnterSleep(){
+  // stay awake until the filter state has decayed as well
+  if(fabs(p0) > SLEEP_THRESHOLD ||
+     fabs(p1) > SLEEP_THRESHOLD ||
+     fabs(p2) > SLEEP_THRESHOLD ||
+     fabs(p3) > SLEEP_THRESHOLD){
+    return;
+  }
+
+  // settle to rest at the current parameters
+  ClearFilterState();
+  dt_t1 = dt;
+
+  sleepDetector.Sleep();
 }
 
 void Ladder::SetFilterCutoff(double newCutoff){
@@ -137,40 +237,99 @@ void Ladder::SetFilterResonance(double newResonance){
   Resonance = newResonance;
 }
 
+void Ladder::SetFilterControlRamp(double newCutoff, double newResonance, int steps){
+  double dt_start = dt;
+  double resonance_start = Resonance;
+
+  // integration rate at the new target
+  cutoffFrequency = newCutoff;
+  SetFilterIntegrationRate();
+  dtTarget = dt;
+  resonanceTarget = newResonance;
+
+  // single step ramps jump to the target
+  if(steps <= 1){
+    Resonance = newResonance;
+    return;
+  }
+  dtIncrement = (dtTarget - dt_start) / (double)(steps);
+  resonanceIncrement = (resonanceTarget - resonance_start) / (double)(steps);
+  dt = dt_start;
+  Resonance = resonance_start;
+  controlRampRemaining = steps;
+}
+
 void Ladder::SetFilterMode(LadderFilterMode newFilterMode){
   filterMode = newFilterMode;
 }
 
 void Ladder::SetFilterSampleRate(double newSampleRate){
-  sampleRate = newSampleRate;
-  iir->SetFilterSamplerate(sampleRate * (double)(oversamplingFactor));
-  iir->SetFilterCutoff(IIR_DOWNSAMPLING_BANDWIDTH*sampleRate / 2.0);
-  iir->SetFilterOrder(decimatorOrder);
+  oversampler.SetSampleRate(newSampleRate);
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMixOversampler[ii].SetSampleRate(newSampleRate);
+  }
+  governor.SetSampleRate(newSampleRate);
 
   SetFilterIntegrationRate();
+  dt_t1 = dt;
 }
 
 void Ladder::SetFilterIntegrationMethod(LadderIntegrationMethod method){
   integrationMethod = method;
+  ResetAntialiasingState();
+  SelectFilterKernel();
 }
 
 void Ladder::SetFilterOversamplingFactor(int newOversamplingFactor){
-  oversamplingFactor = newOversamplingFactor;
-  iir->SetFilterSamplerate(sampleRate * oversamplingFactor);
-  iir->SetFilterCutoff(IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0);
-  iir->SetFilterOrder(decimatorOrder);
+  // automatic oversampling starts from the current factor
+  autoOversampling = (newOversamplingFactor == OVERSAMPLER_AUTO);
+  if(autoOversampling){
+    governor.Reset(oversampler.GetOversamplingFactor());
+    return;
+  }
+
+  SwitchOversamplingFactor(newOversamplingFactor);
+}
+
+void Ladder::SwitchOversamplingFactor(int newOversamplingFactor){
+  oversampler.SetOversamplingFactor(newOversamplingFactor);
+
+  // continue decimation from the current output level, priming
+  // restores the dc steady state only so switching is reduced-glitch
+  oversampler.Prime(out);
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMixOversampler[ii].SetOversamplingFactor(newOversamplingFactor);
+    poleMixOversampler[ii].Prime(poleMix[ii]);
+  }
 
   SetFilterIntegrationRate();
+  dt_t1 = dt;
+  SelectFilterKernel();
 }
 
 void Ladder::SetFilterDecimatorOrder(int newDecimatorOrder){
-  decimatorOrder = newDecimatorOrder;
-  iir->SetFilterOrder(decimatorOrder);
+  oversampler.SetDecimatorOrder(newDecimatorOrder);
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMixOversampler[ii].SetDecimatorOrder(newDecimatorOrder);
+  }
+}
+
+void Ladder::SetFilterPoleMixResponse(int output, LadderPoleMixResponse response){
+  poleMixResponse[output] = response;
+}
+
+void Ladder::SetFilterPoleMixMask(int newPoleMixMask){
+  poleMixMask = newPoleMixMask;
+}
+
+void Ladder::SetFilterControlRateNoise(bool newControlRateNoise){
+  controlRateNoise = newControlRateNoise;
+  noiseHold = 0;
 }
 
 void Ladder::SetFilterIntegrationRate(){
   // normalize cutoff freq to samplerate
-  dt = 44100.0f / (sampleRate * oversamplingFactor) * cutoffFrequency;
+  dt = oversampler.GetIntegrationRate(cutoffFrequency);
 
   // clamp integration rate
   if(dt < 0.0f){
@@ -179,6 +338,32 @@ void Ladder::SetFilterIntegrationRate(){
   else if(dt > 0.7f){
     dt = 0.7f;
   }
+
+  // direct updates stop the control rate ramp
+  controlRampRemaining = 0;
+}
+
+void Ladder::ResetAntialiasingState(){
+  // nonlinearities as if the state had been held
+  xt_1 = ut_1 - 6.0 * Resonance * p3;
+#ifdef FLOATDSP
+  tp0 = FloatTanhPade45(p0);
+  tp1 = FloatTanhPade45(p1);
+  tp2 = FloatTanhPade45(p2);
+  tp3 = FloatTanhPade45(p3);
+#else
+  tp0 = TanhPade32(p0);
+  tp1 = TanhPade32(p1);
+  tp2 = TanhPade32(p2);
+  tp3 = TanhPade32(p3);
+#endif
+
+  // newton-raphson solution as if the state had been held
+#ifdef FLOATDSP
+  xk_t1 = xk_t2 = FloatTanhPade45(xt_1);
+#else
+  xk_t1 = xk_t2 = TanhPade32(xt_1);
+#endif
 }
 
 double Ladder::GetFilterCutoff(){
@@ -190,11 +375,23 @@ double Ladder::GetFilterResonance(){
 }
 
 int Ladder::GetFilterOversamplingFactor(){
-  return oversamplingFactor;
+  return oversampler.GetOversamplingFactor();
 }
 
 int Ladder::GetFilterDecimatorOrder(){
-  return decimatorOrder;
+  return oversampler.GetDecimatorOrder();
+}
+
+bool Ladder::GetFilterControlRateNoise(){
+  return controlRateNoise;
+}
+
+LadderPoleMixResponse Ladder::GetFilterPoleMixResponse(int output){
+  return poleMixResponse[output];
+}
+
+int Ladder::GetFilterPoleMixMask(){
+  return poleMixMask;
 }
 
 #ifdef FLOATDSP
@@ -207,12 +404,22 @@ double Ladder::GetFilterOutput(){
 }
 #endif
 
+#ifdef FLOATDSP
+float Ladder::GetFilterPoleMix(int output){
+  return poleMix[output];
+}
+#else
+double Ladder::GetFilterPoleMix(int output){
+  return poleMix[output];
+}
+#endif
+
 LadderFilterMode Ladder::GetFilterMode(){
   return filterMode;
 }
 
 double Ladder::GetFilterSampleRate(){
-  return sampleRate;
+  return oversampler.GetSampleRate();
 }
 
 LadderIntegrationMethod Ladder::GetFilterIntegrationMethod(){
@@ -230,35 +437,57 @@ double Ladder::GetNormalizedNoiseValue(){
 #endif
 
 #ifdef FLOATDSP
-void Ladder::LadderFilter(float input){
+template <LadderIntegrationMethod method, int factor>
+void Ladder::LadderFilterKernel(float input){
   // feedback amount
   float fb = 6.0f * Resonance;
 
-  // integration rate
-  float dt2 = dt;
-
   // noise term
   input += 1.0e-6f * GetNormalizedNoiseValue();
   
-  // inject thermal phase noise to filter stages
-  float alpha_0 = 1.0f + LADDER_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
-  float alpha_1 = 1.0f + LADDER_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
-  float alpha_2 = 1.0f + LADDER_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
-  float alpha_3 = 1.0f + LADDER_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+  // inject thermal phase noise to filter stages,
+  // held across a block at control rate
+  if(--noiseHold <= 0){
+    alpha_0 = 1.0f + LADDER_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+    alpha_1 = 1.0f + LADDER_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+    alpha_2 = 1.0f + LADDER_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+    alpha_3 = 1.0f + LADDER_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+    noiseHold = controlRateNoise ? LADDER_NOISE_CONTROL_RATE : 1;
+  }
   
+  // oversampling factor
+  const int oversamplingFactor = factor ? factor : oversampler.GetOversamplingFactor();
+
+  // integration rate ramps from the previous host sample
+  // to the current one across the substeps
+  float dt_step = (float)(dt - dt_t1) / (float)(oversamplingFactor);
+  float dt_n = (float)(dt_t1);
+
+  // trapezoidal stage input gain b = dt/(2 + dt) at both ends of the
+  // ramp, interpolated across the substeps so that no substep divides
+  float b_n = 0.0f;
+  float b_step = 0.0f;
+  if(method == LADDER_TRAPEZOIDAL_FEEDBACK_TANH){
+    b_n = (float)(dt_t1) / (2.0f + (float)(dt_t1));
+    b_step = ((float)(dt) / (2.0f + (float)(dt)) - b_n) / (float)(oversamplingFactor);
+  }
+
   // integrate filter state
   // with oversampling
   for(int nn = 0; nn < oversamplingFactor; nn++){
+    // ramp integration rate
+    dt_n += dt_step;
+
     // switch integration method
-    switch(integrationMethod){
+    switch(method){
     case LADDER_EULER_FULL_TANH:
       // semi-implicit euler integration
       // with full tanh stages
       {
-	p0 = p0 + alpha_0 * dt2 * (FloatTanhPade45(input - fb * p3) - FloatTanhPade45(p0));
-	p1 = p1 + alpha_1 * dt2 * (FloatTanhPade45(p0) - FloatTanhPade45(p1));
-	p2 = p2 + alpha_2 * dt2 * (FloatTanhPade45(p1) - FloatTanhPade45(p2));
-	p3 = p3 + alpha_3 * dt2 * (FloatTanhPade45(p2) - FloatTanhPade45(p3));
+	p0 = p0 + alpha_0 * dt_n * (FloatTanhPade45(input - fb * p3) - FloatTanhPade45(p0));
+	p1 = p1 + alpha_1 * dt_n * (FloatTanhPade45(p0) - FloatTanhPade45(p1));
+	p2 = p2 + alpha_2 * dt_n * (FloatTanhPade45(p1) - FloatTanhPade45(p2));
+	p3 = p3 + alpha_3 * dt_n * (FloatTanhPade45(p2) - FloatTanhPade45(p3));
       }
       break;
       
@@ -280,10 +509,10 @@ void Ladder::LadderFilter(float input){
 	float p3_euler = tanh_p2 - tanh_p3;
 	
 	// predictor
-	float p0_prime = p0 + alpha_0 * dt * p0_euler;
-	float p1_prime = p1 + alpha_1 * dt * p1_euler;
-	float p2_prime = p2 + alpha_2 * dt * p2_euler;
-	float p3_prime = p3 + alpha_3 * dt * p3_euler;
+	float p0_prime = p0 + alpha_0 * dt_n * p0_euler;
+	float p1_prime = p1 + alpha_1 * dt_n * p1_euler;
+	float p2_prime = p2 + alpha_2 * dt_n * p2_euler;
+	float p3_prime = p3 + alpha_3 * dt_n * p3_euler;
 
 	// trapezoidal step nonlinearities
 	float tanh_input_fb_p3_prime = FloatTanhPade45(input - fb * p3_prime);
@@ -299,10 +528,10 @@ void Ladder::LadderFilter(float input){
 	float p3_trap = tanh_p2_prime - tanh_p3_prime;
 	
 	// corrector
-	p0 = p0 + 0.5f * alpha_0 * dt * (p0_euler + p0_trap);
-	p1 = p1 + 0.5f * alpha_1 * dt * (p1_euler + p1_trap);
-	p2 = p2 + 0.5f * alpha_2 * dt * (p2_euler + p2_trap);
-	p3 = p3 + 0.5f * alpha_3 * dt * (p3_euler + p3_trap);
+	p0 = p0 + 0.5f * alpha_0 * dt_n * (p0_euler + p0_trap);
+	p1 = p1 + 0.5f * alpha_1 * dt_n * (p1_euler + p1_trap);
+	p2 = p2 + 0.5f * alpha_2 * dt_n * (p2_euler + p2_trap);
+	p3 = p3 + 0.5f * alpha_3 * dt_n * (p3_euler + p3_trap);
       }
       break;
       
@@ -313,17 +542,17 @@ void Ladder::LadderFilter(float input){
 	float p0_prime, p1_prime, p2_prime, p3_prime, p3t_1;
 
 	// predictor
-	p0_prime = p0 + alpha_0 * dt2 * (FloatTanhPade45(ut_1 - fb * p3) - p0);
-	p1_prime = p1 + alpha_1 * dt2 * (p0 - p1);
-	p2_prime = p2 + alpha_2 * dt2 * (p1 - p2);
-	p3_prime = p3 + alpha_3 * dt2 * (p2 - p3);
+	p0_prime = p0 + alpha_0 * dt_n * (FloatTanhPade45(ut_1 - fb * p3) - p0);
+	p1_prime = p1 + alpha_1 * dt_n * (p0 - p1);
+	p2_prime = p2 + alpha_2 * dt_n * (p1 - p2);
+	p3_prime = p3 + alpha_3 * dt_n * (p2 - p3);
 
 	// corrector
 	p3t_1 = p3;
-	p3 = p3 + 0.5f * alpha_0 * dt2 * ((p2 - p3) + (p2_prime - p3_prime));
-	p2 = p2 + 0.5f * alpha_1 * dt2 * ((p1 - p2) + (p1_prime - p2_prime));
-	p1 = p1 + 0.5f * alpha_2 * dt2 * ((p0 - p1) + (p0_prime - p1_prime));
-	p0 = p0 + 0.5f * alpha_3 * dt2 * ((FloatTanhPade45(ut_1 - fb * p3t_1) - p0) +
+	p3 = p3 + 0.5f * alpha_0 * dt_n * ((p2 - p3) + (p2_prime - p3_prime));
+	p2 = p2 + 0.5f * alpha_1 * dt_n * ((p1 - p2) + (p1_prime - p2_prime));
+	p1 = p1 + 0.5f * alpha_2 * dt_n * ((p0 - p1) + (p0_prime - p1_prime));
+	p0 = p0 + 0.5f * alpha_3 * dt_n * ((FloatTanhPade45(ut_1 - fb * p3t_1) - p0) +
 			                  (FloatTanhPade45(input - fb * p3) - p0_prime));
       }
       break;
@@ -333,17 +562,28 @@ void Ladder::LadderFilter(float input){
       // with feedback tanh stage only
       {
 	float x_k, x_k2, g, b, c, C_t, D_t, ut, ut_2;
+	float w1, w2, w3, b4;
 	float p0_prime, p1_prime, p2_prime, p3_prime;
 
 	ut = FloatTanhPade45(ut_1 - fb * p3);
-    	b = (0.5f * dt2) / (1.0f + 0.5f * dt2);
-	c = (1.0f - 0.5f * dt2) / (1.0f + 0.5f * dt2);
-	g = -1.0f * fb * b * b * b * b;
-	x_k = ut;
-	D_t = c * p3 + (b + c * b) * p2 + (b * b + b * b * c) * p1 +
-	               (b * b * b + b * b * b * c) * p0 + b * b * b * b * ut;
+
+	// linear stage discretization, the state gain and the
+	// last stage response to p2, p1, p0 and the feedback
+	// input follow from the interpolated input gain
+	b_n += b_step;
+	b = b_n;
+	c = 1.0f - 2.0f * b;
+	w1 = b * (1.0f + c);
+	w2 = b * w1;
+	w3 = b * w2;
+	b4 = (b * b) * (b * b);
+	g = -1.0f * fb * b4;
+	D_t = c * p3 + w1 * p2 + w2 * p1 + w3 * p0 + b4 * ut;
 	C_t = FloatTanhPade45(input - fb * D_t);
 
+	// starting point is extrapolated from the last two solutions
+	x_k = 2.0f * xk_t1 - xk_t2;
+
 	// newton-raphson 
 	for(int ii=0; ii < LADDER_MAX_NEWTON_STEPS; ii++) {
 	  float tanh_g_xk, tanh_g_xk2;
@@ -356,13 +596,17 @@ void Ladder::LadderFilter(float input){
 	  
 #ifdef LADDER_NEWTON_BREAKING_LIMIT
 	  // breaking limit
-	  if(fabs(x_k2 - x_k) < 1.0e-9f) {
+	  if(fabs(x_k2 - x_k) < LADDER_NEWTON_TOLERANCE * (1.0f + fabs(x_k2))) {
 	    x_k = x_k2;
 	    break;
 	  }
 #endif	  
 	  x_k = x_k2;
 	}
+
+	// keep solution history for the next initial guess
+	xk_t2 = xk_t1;
+	xk_t1 = x_k;
 	
 	ut_2 = x_k;
 
@@ -378,6 +622,37 @@ void Ladder::LadderFilter(float input){
       }
       break;
       
+    case LADDER_EULER_ADAA_TANH:
+      // semi-implicit euler integration
+      // with antiderivative antialiased tanh stages
+      {
+	float x, p_t1;
+
+	// feedback nonlinearity
+	x = input - fb * p3;
+	float tanh_x = FloatTanhPade45ADAA(x, xt_1);
+	xt_1 = x;
+
+	// each stage nonlinearity is reused as the
+	// input nonlinearity of the next stage
+	p_t1 = p0;
+	p0 = p0 + alpha_0 * dt_n * (tanh_x - tp0);
+	tp0 = FloatTanhPade45ADAA(p0, p_t1);
+
+	p_t1 = p1;
+	p1 = p1 + alpha_1 * dt_n * (tp0 - tp1);
+	tp1 = FloatTanhPade45ADAA(p1, p_t1);
+
+	p_t1 = p2;
+	p2 = p2 + alpha_2 * dt_n * (tp1 - tp2);
+	tp2 = FloatTanhPade45ADAA(p2, p_t1);
+
+	p_t1 = p3;
+	p3 = p3 + alpha_3 * dt_n * (tp2 - tp3);
+	tp3 = FloatTanhPade45ADAA(p3, p_t1);
+      }
+      break;
+      
     default:
       break;
     }
@@ -401,38 +676,77 @@ void Ladder::LadderFilter(float input){
     }
 
     // downsampling filter
-    if(oversamplingFactor > 1){
-      out = iir->IIRfilter32(out);
+    out = oversampler.Decimate<factor>(out);
+
+    // mix the input node and stage taps for the requested outputs
+    if(poleMixMask){
+      float y[5] = {FloatTanhPade45(input - fb * p3), p0, p1, p2, p3};
+      
+      for(int rr = 0; rr < LADDER_POLE_MIX_OUTPUTS; rr++){
+	if(poleMixMask & (1 << rr)){
+	  const float* w = poleMixWeights[poleMixResponse[rr]];
+	  float mix = w[0] * y[0] + w[1] * y[1] + w[2] * y[2] + w[3] * y[3] + w[4] * y[4];
+	  poleMix[rr] = poleMixOversampler[rr].Decimate<factor>(mix);
+	}
+      }
     }
   }
+  
+  // integration rate at t-1
+  dt_t1 = dt;
 }
 #else
-void Ladder::LadderFilter(double input){
+template <LadderIntegrationMethod method, int factor>
+void Ladder::LadderFilterKernel(double input){
   // feedback amount
   double fb = 6.0 * Resonance;
 
   // noise term
   input += 1.0e-6 * GetNormalizedNoiseValue();
   
-  // inject thermal phase noise to filter stages
-  double alpha_0 = 1.0 + LADDER_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
-  double alpha_1 = 1.0 + LADDER_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
-  double alpha_2 = 1.0 + LADDER_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
-  double alpha_3 = 1.0 + LADDER_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+  // inject thermal phase noise to filter stages,
+  // held across a block at control rate
+  if(--noiseHold <= 0){
+    alpha_0 = 1.0 + LADDER_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+    alpha_1 = 1.0 + LADDER_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+    alpha_2 = 1.0 + LADDER_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+    alpha_3 = 1.0 + LADDER_THERMAL_NOISE_AMPLITUDE * GetNormalizedNoiseValue();
+    noiseHold = controlRateNoise ? LADDER_NOISE_CONTROL_RATE : 1;
+  }
   
+  // oversampling factor
+  const int oversamplingFactor = factor ? factor : oversampler.GetOversamplingFactor();
+
+  // integration rate ramps from the previous host sample
+  // to the current one across the substeps
+  double dt_step = (dt - dt_t1) / (double)(oversamplingFactor);
+  double dt_n = dt_t1;
+
+  // trapezoidal stage input gain b = dt/(2 + dt) at both ends of the
+  // ramp, interpolated across the substeps so that no substep divides
+  double b_n = 0.0;
+  double b_step = 0.0;
+  if(method == LADDER_TRAPEZOIDAL_FEEDBACK_TANH){
+    b_n = dt_t1 / (2.0 + dt_t1);
+    b_step = (dt / (2.0 + dt) - b_n) / (double)(oversamplingFactor);
+  }
+
   // integrate filter state
   // with oversampling
   for(int nn = 0; nn < oversamplingFactor; nn++){
+    // ramp integration rate
+    dt_n += dt_step;
+
     // switch integration method
-    switch(integrationMethod){
+    switch(method){
     case LADDER_EULER_FULL_TANH:
       // semi-implicit euler integration
       // with full tanh stages
       {
-	p0 = p0 + alpha_0 * dt * (TanhPade32(input - fb * p3) - TanhPade32(p0));
-	p1 = p1 + alpha_1 * dt * (TanhPade32(p0) - TanhPade32(p1));
-	p2 = p2 + alpha_2 * dt * (TanhPade32(p1) - TanhPade32(p2));
-	p3 = p3 + alpha_3 * dt * (TanhPade32(p2) - TanhPade32(p3));
+	p0 = p0 + alpha_0 * dt_n * (TanhPade32(input - fb * p3) - TanhPade32(p0));
+	p1 = p1 + alpha_1 * dt_n * (TanhPade32(p0) - TanhPade32(p1));
+	p2 = p2 + alpha_2 * dt_n * (TanhPade32(p1) - TanhPade32(p2));
+	p3 = p3 + alpha_3 * dt_n * (TanhPade32(p2) - TanhPade32(p3));
       }
       break;
       
@@ -454,10 +768,10 @@ void Ladder::LadderFilter(double input){
 	double p3_euler = tanh_p2 - tanh_p3;
 	
 	// predictor
-	double p0_prime = p0 + alpha_0 * dt * p0_euler;
-	double p1_prime = p1 + alpha_1 * dt * p1_euler;
-	double p2_prime = p2 + alpha_2 * dt * p2_euler;
-	double p3_prime = p3 + alpha_3 * dt * p3_euler;
+	double p0_prime = p0 + alpha_0 * dt_n * p0_euler;
+	double p1_prime = p1 + alpha_1 * dt_n * p1_euler;
+	double p2_prime = p2 + alpha_2 * dt_n * p2_euler;
+	double p3_prime = p3 + alpha_3 * dt_n * p3_euler;
 
 	// trapezoidal step nonlinearities
 	double tanh_input_fb_p3_prime = TanhPade32(input - fb * p3_prime);
@@ -473,10 +787,10 @@ void Ladder::LadderFilter(double input){
 	double p3_trap = tanh_p2_prime - tanh_p3_prime;
 	
 	// corrector
-	p0 = p0 + 0.5 * alpha_0 * dt * (p0_euler + p0_trap);
-	p1 = p1 + 0.5 * alpha_1 * dt * (p1_euler + p1_trap);
-	p2 = p2 + 0.5 * alpha_2 * dt * (p2_euler + p2_trap);
-	p3 = p3 + 0.5 * alpha_3 * dt * (p3_euler + p3_trap);
+	p0 = p0 + 0.5 * alpha_0 * dt_n * (p0_euler + p0_trap);
+	p1 = p1 + 0.5 * alpha_1 * dt_n * (p1_euler + p1_trap);
+	p2 = p2 + 0.5 * alpha_2 * dt_n * (p2_euler + p2_trap);
+	p3 = p3 + 0.5 * alpha_3 * dt_n * (p3_euler + p3_trap);
       }
       break;
       
@@ -487,17 +801,17 @@ void Ladder::LadderFilter(double input){
 	double p0_prime, p1_prime, p2_prime, p3_prime, p3t_1;
 
 	// predictor
-	p0_prime = p0 + alpha_0 * dt * (TanhPade32(ut_1 - fb * p3) - p0);
-	p1_prime = p1 + alpha_1 * dt * (p0 - p1);
-	p2_prime = p2 + alpha_2 * dt * (p1 - p2);
-	p3_prime = p3 + alpha_3 * dt * (p2 - p3);
+	p0_prime = p0 + alpha_0 * dt_n * (TanhPade32(ut_1 - fb * p3) - p0);
+	p1_prime = p1 + alpha_1 * dt_n * (p0 - p1);
+	p2_prime = p2 + alpha_2 * dt_n * (p1 - p2);
+	p3_prime = p3 + alpha_3 * dt_n * (p2 - p3);
 
 	// corrector
 	p3t_1 = p3;
-	p3 = p3 + 0.5 * alpha_0 * dt * ((p2 - p3) + (p2_prime - p3_prime));
-	p2 = p2 + 0.5 * alpha_1 * dt * ((p1 - p2) + (p1_prime - p2_prime));
-	p1 = p1 + 0.5 * alpha_2 * dt * ((p0 - p1) + (p0_prime - p1_prime));
-	p0 = p0 + 0.5 * alpha_3 * dt * ((TanhPade32(ut_1 - fb * p3t_1) - p0) +
+	p3 = p3 + 0.5 * alpha_0 * dt_n * ((p2 - p3) + (p2_prime - p3_prime));
+	p2 = p2 + 0.5 * alpha_1 * dt_n * ((p1 - p2) + (p1_prime - p2_prime));
+	p1 = p1 + 0.5 * alpha_2 * dt_n * ((p0 - p1) + (p0_prime - p1_prime));
+	p0 = p0 + 0.5 * alpha_3 * dt_n * ((TanhPade32(ut_1 - fb * p3t_1) - p0) +
 			       (TanhPade32(input - fb * p3_prime) - p0_prime));
       }
       break;
@@ -507,17 +821,28 @@ void Ladder::LadderFilter(double input){
       // with feedback tanh stage only
       {
 	double x_k, x_k2, g, b, c, C_t, D_t, ut, ut_2;
+	double w1, w2, w3, b4;
 	double p0_prime, p1_prime, p2_prime, p3_prime;
 
 	ut = TanhPade32(ut_1 - fb * p3);
-    	b = (0.5 * dt) / (1.0 + 0.5 * dt);
-	c = (1.0 - 0.5 * dt) / (1.0 + 0.5 * dt);
-	g = -fb * b * b * b * b;
-	x_k = ut;
-	D_t = c * p3 + (b + c * b) * p2 + (b * b + b * b * c) * p1 +
-	               (b * b * b + b * b * b * c) * p0 + b * b * b * b * ut;
+
+	// linear stage discretization, the state gain and the
+	// last stage response to p2, p1, p0 and the feedback
+	// input follow from the interpolated input gain
+	b_n += b_step;
+	b = b_n;
+	c = 1.0 - 2.0 * b;
+	w1 = b * (1.0 + c);
+	w2 = b * w1;
+	w3 = b * w2;
+	b4 = (b * b) * (b * b);
+	g = -fb * b4;
+	D_t = c * p3 + w1 * p2 + w2 * p1 + w3 * p0 + b4 * ut;
 	C_t = TanhPade32(input - fb * D_t);
 
+	// starting point is extrapolated from the last two solutions
+	x_k = 2.0 * xk_t1 - xk_t2;
+
 	// newton-raphson 
 	for(int ii=0; ii < LADDER_MAX_NEWTON_STEPS; ii++) {
 	  double tanh_g_xk, tanh_g_xk2;
@@ -530,13 +855,17 @@ void Ladder::LadderFilter(double input){
 	  
 #ifdef LADDER_NEWTON_BREAKING_LIMIT
 	  // breaking limit
-	  if(fabs(x_k2 - x_k) < 1.0e-9) {
+	  if(fabs(x_k2 - x_k) < LADDER_NEWTON_TOLERANCE_DOUBLE * (1.0 + fabs(x_k2))) {
 	    x_k = x_k2;
 	    break;
 	  }
 #endif	  
 	  x_k = x_k2;
 	}
+
+	// keep solution history for the next initial guess
+	xk_t2 = xk_t1;
+	xk_t1 = x_k;
 	
 	ut_2 = x_k;
 
@@ -552,6 +881,37 @@ void Ladder::LadderFilter(double input){
       }
       break;
       
+    case LADDER_EULER_ADAA_TANH:
+      // semi-implicit euler integration
+      // with antiderivative antialiased tanh stages
+      {
+	double x, p_t1;
+
+	// feedback nonlinearity
+	x = input - fb * p3;
+	double tanh_x = TanhPade32ADAA(x, xt_1);
+	xt_1 = x;
+
+	// each stage nonlinearity is reused as the
+	// input nonlinearity of the next stage
+	p_t1 = p0;
+	p0 = p0 + alpha_0 * dt_n * (tanh_x - tp0);
+	tp0 = TanhPade32ADAA(p0, p_t1);
+
+	p_t1 = p1;
+	p1 = p1 + alpha_1 * dt_n * (tp0 - tp1);
+	tp1 = TanhPade32ADAA(p1, p_t1);
+
+	p_t1 = p2;
+	p2 = p2 + alpha_2 * dt_n * (tp1 - tp2);
+	tp2 = TanhPade32ADAA(p2, p_t1);
+
+	p_t1 = p3;
+	p3 = p3 + alpha_3 * dt_n * (tp2 - tp3);
+	tp3 = TanhPade32ADAA(p3, p_t1);
+      }
+      break;
+      
     default:
       break;
     }
@@ -575,13 +935,70 @@ void Ladder::LadderFilter(double input){
     }
 
     // downsampling filter
-    if(oversamplingFactor > 1){
-      out = iir->IIRfilter(out);
+    out = oversampler.Decimate<factor>(out);
+
+    // mix the input node and stage taps for the requested outputs
+    if(poleMixMask){
+      double y[5] = {TanhPade32(input - fb * p3), p0, p1, p2, p3};
+      
+      for(int rr = 0; rr < LADDER_POLE_MIX_OUTPUTS; rr++){
+	if(poleMixMask & (1 << rr)){
+	  const float* w = poleMixWeights[poleMixResponse[rr]];
+	  double mix = w[0] * y[0] + w[1] * y[1] + w[2] * y[2] + w[3] * y[3] + w[4] * y[4];
+	  poleMix[rr] = poleMixOversampler[rr].Decimate<factor>(mix);
+	}
+      }
     }
   }
+  
+  // integration rate at t-1
+  dt_t1 = dt;
 }
 #endif
 
+template <LadderIntegrationMethod method>
+Ladder::FilterKernel Ladder::GetFilterKernel(int factor){
+  switch(factor){
+  case 1:
+    return &Ladder::LadderFilterKernel<method, 1>;
+  case 2:
+    return &Ladder::LadderFilterKernel<method, 2>;
+  case 4:
+    return &Ladder::LadderFilterKernel<method, 4>;
+  case 8:
+    return &Ladder::LadderFilterKernel<method, 8>;
+  case 16:
+    return &Ladder::LadderFilterKernel<method, 16>;
+  case 32:
+    return &Ladder::LadderFilterKernel<method, 32>;
+  default:
+    return &Ladder::LadderFilterKernel<method, 0>;
+  }
+}
+
+void Ladder::SelectFilterKernel(){
+  switch(integrationMethod){
+  case LADDER_EULER_FULL_TANH:
+    filterKernel = GetFilterKernel<LADDER_EULER_FULL_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  case LADDER_PREDICTOR_CORRECTOR_FULL_TANH:
+    filterKernel = GetFilterKernel<LADDER_PREDICTOR_CORRECTOR_FULL_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  case LADDER_PREDICTOR_CORRECTOR_FEEDBACK_TANH:
+    filterKernel = GetFilterKernel<LADDER_PREDICTOR_CORRECTOR_FEEDBACK_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  case LADDER_TRAPEZOIDAL_FEEDBACK_TANH:
+    filterKernel = GetFilterKernel<LADDER_TRAPEZOIDAL_FEEDBACK_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  case LADDER_EULER_ADAA_TANH:
+    filterKernel = GetFilterKernel<LADDER_EULER_ADAA_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  default:
+    filterKernel = GetFilterKernel<LADDER_EULER_FULL_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  }
+}
+
 double Ladder::GetFilterLowpass(){
   return p3;
 }
@@ -595,3 +1012,646 @@ double Ladder::GetFilterHighpass(){
 }
 
 
+
+#ifdef FLOATDSP
+void Ladder::ProcessBlock(const float* input, float* output,
+			  const float* cutoff, const float* resonance, int n){
+#else
+void Ladder::ProcessBlock(const double* input, double* output,
+			  const double* cutoff, const double* resonance, int n){
+#endif
+  for(int ii = 0; ii < n; ii++){
+    // integration rate follows cutoff changes only
+    if(cutoff[ii] != cutoffFrequency){
+      cutoffFrequency = cutoff[ii];
+      SetFilterIntegrationRate();
+    }
+    Resonance = resonance[ii];
+
+    // tick filter state
+    LadderFilter(input[ii]);
+    output[ii] = out;
+  }
+}
+
+// constructor
+LadderX4::LadderX4(float4 newCutoff, float4 newResonance, int newOversamplingFactor,
+		   LadderFilterMode newFilterMode, double newSampleRate,
+		   LadderIntegrationMethod newIntegrationMethod, int newDecimatorOrder){
+  // initialize filter parameters
+  cutoffFrequency = newCutoff;
+  Resonance = newResonance;
+  filterMode = newFilterMode;
+
+  // set up oversampling
+  oversampler.SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  oversampler.SetSampleRate(newSampleRate);
+  oversampler.SetOversamplingFactor(newOversamplingFactor);
+  oversampler.SetDecimatorOrder(newDecimatorOrder);
+
+  // set up pole mixing
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMixOversampler[ii].SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+    poleMixOversampler[ii].SetSampleRate(newSampleRate);
+    poleMixOversampler[ii].SetOversamplingFactor(newOversamplingFactor);
+    poleMixOversampler[ii].SetDecimatorOrder(newDecimatorOrder);
+    poleMixResponse[ii] = poleMixDefaults[ii];
+  }
+  poleMixMask = 0;
+
+  // automatic oversampling starts from x1
+  autoOversampling = (newOversamplingFactor == OVERSAMPLER_AUTO);
+  governor.SetSampleRate(newSampleRate);
+  governor.Reset(oversampler.GetOversamplingFactor());
+  
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+
+  // thermal noise at audio rate
+  controlRateNoise = false;
+  noiseHold = 0;
+
+  // initialize filter state
+  p0 = p1 = p2 = p3 = out = ut_1 = Float4(0.0f);
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMix[ii] = Float4(0.0f);
+  }
+  
+  integrationMethod = newIntegrationMethod;
+
+  // initialize antialiasing state
+  ResetAntialiasingState();
+
+  // select filter kernel
+  SelectFilterKernel();
+}
+
+// default constructor
+LadderX4::LadderX4(){
+  // initialize filter parameters
+  cutoffFrequency = Float4(0.25f);
+  Resonance = Float4(0.5f);
+  filterMode = LADDER_LOWPASS_MODE;
+
+  // set up oversampling
+  oversampler.SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  autoOversampling = false;
+
+  // set up pole mixing
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMixOversampler[ii].SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+    poleMixResponse[ii] = poleMixDefaults[ii];
+  }
+  poleMixMask = 0;
+  
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+  
+  // thermal noise at audio rate
+  controlRateNoise = false;
+  noiseHold = 0;
+
+  // initialize filter state
+  p0 = p1 = p2 = p3 = out = ut_1 = Float4(0.0f);
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMix[ii] = Float4(0.0f);
+  }
+  
+  integrationMethod = LADDER_PREDICTOR_CORRECTOR_FULL_TANH;
+
+  // initialize antialiasing state
+  ResetAntialiasingState();
+
+  // select filter kernel
+  SelectFilterKernel();
+}
+
+// default destructor
+LadderX4::~LadderX4(){
+}
+
+void LadderX4::ResetFilterState(){
+  // initialize filter parameters
+  cutoffFrequency = Float4(0.25f);
+  Resonance = Float4(0.0f);
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+  
+  // initialize filter and decimator state
+  ClearFilterState();
+  
+  // wake from sleep
+  sleepDetector.Reset();
+
+  // restart oversampling governor
+  governor.Reset(oversampler.GetOversamplingFactor());
+}
+
+void LadderX4::ClearFilterState(){
+  // initialize filter state
+  p0 = p1 = p2 = p3 = out = ut_1 = Float4(0.0f);
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMix[ii] = Float4(0.0f);
+  }
+  ResetAntialiasingState();
+  
+  // clear decimator state, the decimator design stays
+  oversampler.ClearState();
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMixOversampler[ii].ClearState();
+  }
+}
+
+void LadderX4::EnterSleep(){
+  // stay awake until the filter state has decayed as well
+  float4 level = Float4Max(Float4Max(Float4Abs(p0), Float4Abs(p1)),
+			   Float4Max(Float4Abs(p2), Float4Abs(p3)));
+  if(Int4Any(level > SLEEP_THRESHOLD)){
+    return;
+  }
+
+  // settle to rest at the current parameters
+  ClearFilterState();
+  dt_t1 = dt;
+
+  sleepDetector.Sleep();
+}
+
+void LadderX4::SetFilterCutoff(float4 newCutoff){
+  cutoffFrequency = newCutoff;
+
+  SetFilterIntegrationRate();
+}
+
+void LadderX4::SetFilterResonance(float4 newResonance){
+  Resonance = newResonance;
+}
+
+void LadderX4::SetFilterControlRamp(float4 newCutoff, float4 newResonance, int steps){
+  float4 dt_start = dt;
+  float4 resonance_start = Resonance;
+
+  // integration rate at the new target
+  cutoffFrequency = newCutoff;
+  SetFilterIntegrationRate();
+  dtTarget = dt;
+  resonanceTarget = newResonance;
+
+  // single step ramps jump to the target
+  if(steps <= 1){
+    Resonance = newResonance;
+    return;
+  }
+  dtIncrement = (dtTarget - dt_start) / (float)(steps);
+  resonanceIncrement = (resonanceTarget - resonance_start) / (float)(steps);
+  dt = dt_start;
+  Resonance = resonance_start;
+  controlRampRemaining = steps;
+}
+
+void LadderX4::SetFilterMode(LadderFilterMode newFilterMode){
+  filterMode = newFilterMode;
+}
+
+void LadderX4::SetFilterSampleRate(double newSampleRate){
+  oversampler.SetSampleRate(newSampleRate);
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMixOversampler[ii].SetSampleRate(newSampleRate);
+  }
+  governor.SetSampleRate(newSampleRate);
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+}
+
+void LadderX4::SetFilterIntegrationMethod(LadderIntegrationMethod method){
+  integrationMethod = method;
+  ResetAntialiasingState();
+  SelectFilterKernel();
+}
+
+void LadderX4::SetFilterOversamplingFactor(int newOversamplingFactor){
+  // automatic oversampling starts from the current factor
+  autoOversampling = (newOversamplingFactor == OVERSAMPLER_AUTO);
+  if(autoOversampling){
+    governor.Reset(oversampler.GetOversamplingFactor());
+    return;
+  }
+
+  SwitchOversamplingFactor(newOversamplingFactor);
+}
+
+void LadderX4::SwitchOversamplingFactor(int newOversamplingFactor){
+  oversampler.SetOversamplingFactor(newOversamplingFactor);
+
+  // continue decimation from the current output level, priming
+  // restores the dc steady state only so switching is reduced-glitch
+  oversampler.Prime(out);
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMixOversampler[ii].SetOversamplingFactor(newOversamplingFactor);
+    poleMixOversampler[ii].Prime(poleMix[ii]);
+  }
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+  SelectFilterKernel();
+}
+
+void LadderX4::SetFilterDecimatorOrder(int newDecimatorOrder){
+  oversampler.SetDecimatorOrder(newDecimatorOrder);
+  for(int ii = 0; ii < LADDER_POLE_MIX_OUTPUTS; ii++){
+    poleMixOversampler[ii].SetDecimatorOrder(newDecimatorOrder);
+  }
+}
+
+void LadderX4::SetFilterPoleMixResponse(int output, LadderPoleMixResponse response){
+  poleMixResponse[output] = response;
+}
+
+void LadderX4::SetFilterPoleMixMask(int newPoleMixMask){
+  poleMixMask = newPoleMixMask;
+}
+
+void LadderX4::SetFilterControlRateNoise(bool newControlRateNoise){
+  controlRateNoise = newControlRateNoise;
+  noiseHold = 0;
+}
+
+void LadderX4::SetFilterIntegrationRate(){
+  // normalize cutoff freq to samplerate
+  dt = (float)(oversampler.GetIntegrationRate(1.0)) * cutoffFrequency;
+
+  // clamp integration rate
+  dt = Float4Min(Float4Max(dt, Float4(0.0f)), Float4(0.7f));
+
+  // direct updates stop the control rate ramp
+  controlRampRemaining = 0;
+}
+
+void LadderX4::ResetAntialiasingState(){
+  // nonlinearities as if the state had been held
+  xt_1 = ut_1 - 6.0f * Resonance * p3;
+  tp0 = FloatTanhPade45(p0);
+  tp1 = FloatTanhPade45(p1);
+  tp2 = FloatTanhPade45(p2);
+  tp3 = FloatTanhPade45(p3);
+
+  // newton-raphson solution as if the state had been held
+  xk_t1 = xk_t2 = FloatTanhPade45(xt_1);
+}
+
+float4 LadderX4::GetFilterCutoff(){
+  return cutoffFrequency;
+}
+
+float4 LadderX4::GetFilterResonance(){
+  return Resonance;
+}
+
+int LadderX4::GetFilterOversamplingFactor(){
+  return oversampler.GetOversamplingFactor();
+}
+
+int LadderX4::GetFilterDecimatorOrder(){
+  return oversampler.GetDecimatorOrder();
+}
+
+bool LadderX4::GetFilterControlRateNoise(){
+  return controlRateNoise;
+}
+
+LadderPoleMixResponse LadderX4::GetFilterPoleMixResponse(int output){
+  return poleMixResponse[output];
+}
+
+int LadderX4::GetFilterPoleMixMask(){
+  return poleMixMask;
+}
+
+float4 LadderX4::GetFilterOutput(){
+  return out;
+}
+
+float4 LadderX4::GetFilterPoleMix(int output){
+  return poleMix[output];
+}
+
+LadderFilterMode LadderX4::GetFilterMode(){
+  return filterMode;
+}
+
+double LadderX4::GetFilterSampleRate(){
+  return oversampler.GetSampleRate();
+}
+
+LadderIntegrationMethod LadderX4::GetFilterIntegrationMethod(){
+  return integrationMethod;
+}
+
+float4 LadderX4::GetNormalizedNoiseValue(){
+  return noise.Next();
+}
+
+template <LadderIntegrationMethod method, int factor>
+void LadderX4::LadderFilterKernel(float4 input){
+  // feedback amount
+  float4 fb = 6.0f * Resonance;
+
+  // noise term
+  input += 1.0e-6f * GetNormalizedNoiseValue();
+  
+  // inject thermal phase noise to filter stages,
+  // held across a block at control rate
+  if(--noiseHold <= 0){
+    alpha_0 = 1.0f + (float)(LADDER_THERMAL_NOISE_AMPLITUDE) * GetNormalizedNoiseValue();
+    alpha_1 = 1.0f + (float)(LADDER_THERMAL_NOISE_AMPLITUDE) * GetNormalizedNoiseValue();
+    alpha_2 = 1.0f + (float)(LADDER_THERMAL_NOISE_AMPLITUDE) * GetNormalizedNoiseValue();
+    alpha_3 = 1.0f + (float)(LADDER_THERMAL_NOISE_AMPLITUDE) * GetNormalizedNoiseValue();
+    noiseHold = controlRateNoise ? LADDER_NOISE_CONTROL_RATE : 1;
+  }
+  
+  // oversampling factor
+  const int oversamplingFactor = factor ? factor : oversampler.GetOversamplingFactor();
+
+  // integration rate ramps from the previous host sample
+  // to the current one across the substeps
+  float4 dt_step = (dt - dt_t1) / (float)(oversamplingFactor);
+  float4 dt_n = dt_t1;
+
+  // trapezoidal stage input gain b = dt/(2 + dt) at both ends of the
+  // ramp, interpolated across the substeps so that no substep divides
+  float4 b_n = Float4(0.0f);
+  float4 b_step = Float4(0.0f);
+  if(method == LADDER_TRAPEZOIDAL_FEEDBACK_TANH){
+    b_n = dt_t1 / (2.0f + dt_t1);
+    b_step = (dt / (2.0f + dt) - b_n) / (float)(oversamplingFactor);
+  }
+
+  // integrate filter state
+  // with oversampling
+  for(int nn = 0; nn < oversamplingFactor; nn++){
+    // ramp integration rate
+    dt_n += dt_step;
+
+    // switch integration method
+    switch(method){
+    case LADDER_EULER_FULL_TANH:
+      // semi-implicit euler integration
+      // with full tanh stages
+      {
+	p0 = p0 + alpha_0 * dt_n * (FloatTanhPade45(input - fb * p3) - FloatTanhPade45(p0));
+	p1 = p1 + alpha_1 * dt_n * (FloatTanhPade45(p0) - FloatTanhPade45(p1));
+	p2 = p2 + alpha_2 * dt_n * (FloatTanhPade45(p1) - FloatTanhPade45(p2));
+	p3 = p3 + alpha_3 * dt_n * (FloatTanhPade45(p2) - FloatTanhPade45(p3));
+      }
+      break;
+      
+    case LADDER_PREDICTOR_CORRECTOR_FULL_TANH:
+      // predictor-corrector integration
+      // with full tanh stages
+      {
+	// euler step nonlinearities
+	float4 tanh_ut1_fb_p3 = FloatTanhPade45(ut_1 - fb * p3);
+	float4 tanh_p0 = FloatTanhPade45(p0);
+	float4 tanh_p1 = FloatTanhPade45(p1);
+	float4 tanh_p2 = FloatTanhPade45(p2);
+	float4 tanh_p3 = FloatTanhPade45(p3);
+
+	// euler step differences
+	float4 p0_euler = tanh_ut1_fb_p3 - tanh_p0;
+	float4 p1_euler = tanh_p0 - tanh_p1;
+	float4 p2_euler = tanh_p1 - tanh_p2;
+	float4 p3_euler = tanh_p2 - tanh_p3;
+	
+	// predictor
+	float4 p0_prime = p0 + alpha_0 * dt_n * p0_euler;
+	float4 p1_prime = p1 + alpha_1 * dt_n * p1_euler;
+	float4 p2_prime = p2 + alpha_2 * dt_n * p2_euler;
+	float4 p3_prime = p3 + alpha_3 * dt_n * p3_euler;
+
+	// trapezoidal step nonlinearities
+	float4 tanh_input_fb_p3_prime = FloatTanhPade45(input - fb * p3_prime);
+	float4 tanh_p0_prime = FloatTanhPade45(p0_prime);
+	float4 tanh_p1_prime = FloatTanhPade45(p1_prime);
+	float4 tanh_p2_prime = FloatTanhPade45(p2_prime);
+	float4 tanh_p3_prime = FloatTanhPade45(p3_prime);
+
+	// trapezoidal step differences
+	float4 p0_trap = tanh_input_fb_p3_prime - tanh_p0_prime;
+	float4 p1_trap = tanh_p0_prime - tanh_p1_prime;
+	float4 p2_trap = tanh_p1_prime - tanh_p2_prime;
+	float4 p3_trap = tanh_p2_prime - tanh_p3_prime;
+	
+	// corrector
+	p0 = p0 + 0.5f * alpha_0 * dt_n * (p0_euler + p0_trap);
+	p1 = p1 + 0.5f * alpha_1 * dt_n * (p1_euler + p1_trap);
+	p2 = p2 + 0.5f * alpha_2 * dt_n * (p2_euler + p2_trap);
+	p3 = p3 + 0.5f * alpha_3 * dt_n * (p3_euler + p3_trap);
+      }
+      break;
+      
+    case LADDER_PREDICTOR_CORRECTOR_FEEDBACK_TANH:
+      // predictor-corrector integration
+      // with feedback tanh stage only
+      {
+	float4 p0_prime, p1_prime, p2_prime, p3_prime, p3t_1;
+
+	// predictor
+	p0_prime = p0 + alpha_0 * dt_n * (FloatTanhPade45(ut_1 - fb * p3) - p0);
+	p1_prime = p1 + alpha_1 * dt_n * (p0 - p1);
+	p2_prime = p2 + alpha_2 * dt_n * (p1 - p2);
+	p3_prime = p3 + alpha_3 * dt_n * (p2 - p3);
+
+	// corrector
+	p3t_1 = p3;
+	p3 = p3 + 0.5f * alpha_0 * dt_n * ((p2 - p3) + (p2_prime - p3_prime));
+	p2 = p2 + 0.5f * alpha_1 * dt_n * ((p1 - p2) + (p1_prime - p2_prime));
+	p1 = p1 + 0.5f * alpha_2 * dt_n * ((p0 - p1) + (p0_prime - p1_prime));
+	p0 = p0 + 0.5f * alpha_3 * dt_n * ((FloatTanhPade45(ut_1 - fb * p3t_1) - p0) +
+					 (FloatTanhPade45(input - fb * p3) - p0_prime));
+      }
+      break;
+      
+    case LADDER_TRAPEZOIDAL_FEEDBACK_TANH:
+      // implicit trapezoidal integration
+      // with feedback tanh stage only
+      {
+	float4 x_k, g, b, c, C_t, D_t, ut, ut_2;
+	float4 w1, w2, w3, b4;
+	float4 p0_prime, p1_prime, p2_prime, p3_prime;
+
+	ut = FloatTanhPade45(ut_1 - fb * p3);
+
+	// linear stage discretization, the state gain and the
+	// last stage response to p2, p1, p0 and the feedback
+	// input follow from the interpolated input gain
+	b_n += b_step;
+	b = b_n;
+	c = 1.0f - 2.0f * b;
+	w1 = b * (1.0f + c);
+	w2 = b * w1;
+	w3 = b * w2;
+	b4 = (b * b) * (b * b);
+	g = -1.0f * fb * b4;
+	D_t = c * p3 + w1 * p2 + w2 * p1 + w3 * p0 + b4 * ut;
+	C_t = FloatTanhPade45(input - fb * D_t);
+
+	// lane-masked newton-raphson,
+	// starting point is extrapolated from the last two solutions
+	x_k = NewtonX4([&](float4 x) {
+	    float4 tanh_g_xk = FloatTanhPade45(g * x);
+	    float4 tanh_g_xk2 = g * (1.0f - tanh_g_xk * tanh_g_xk);
+
+	    return (x + x * tanh_g_xk * C_t - tanh_g_xk - C_t) /
+	             (1.0f + C_t * (tanh_g_xk + x * tanh_g_xk2) - tanh_g_xk2);
+	  }, 2.0f * xk_t1 - xk_t2, LADDER_MAX_NEWTON_STEPS, LADDER_NEWTON_TOLERANCE);
+	xk_t2 = xk_t1;
+	xk_t1 = x_k;
+	
+	ut_2 = x_k;
+
+	p0_prime = p0;
+	p1_prime = p1;
+	p2_prime = p2;
+	p3_prime = p3;
+
+	p0 = c * p0_prime + b * (ut + ut_2);
+	p1 = c * p1_prime + b * (p0_prime + p0);
+	p2 = c * p2_prime + b * (p1_prime + p1);
+	p3 = c * p3_prime + b * (p2_prime + p2);
+      }
+      break;
+      
+    case LADDER_EULER_ADAA_TANH:
+      // semi-implicit euler integration
+      // with antiderivative antialiased tanh stages
+      {
+	float4 x, p_t1;
+
+	// feedback nonlinearity
+	x = input - fb * p3;
+	float4 tanh_x = FloatTanhPade45ADAA(x, xt_1);
+	xt_1 = x;
+
+	// each stage nonlinearity is reused as the
+	// input nonlinearity of the next stage
+	p_t1 = p0;
+	p0 = p0 + alpha_0 * dt_n * (tanh_x - tp0);
+	tp0 = FloatTanhPade45ADAA(p0, p_t1);
+
+	p_t1 = p1;
+	p1 = p1 + alpha_1 * dt_n * (tp0 - tp1);
+	tp1 = FloatTanhPade45ADAA(p1, p_t1);
+
+	p_t1 = p2;
+	p2 = p2 + alpha_2 * dt_n * (tp1 - tp2);
+	tp2 = FloatTanhPade45ADAA(p2, p_t1);
+
+	p_t1 = p3;
+	p3 = p3 + alpha_3 * dt_n * (tp2 - tp3);
+	tp3 = FloatTanhPade45ADAA(p3, p_t1);
+      }
+      break;
+      
+    default:
+      break;
+    }
+
+    // input at t-1
+    ut_1 = input;
+
+    //switch filter mode
+    switch(filterMode){
+    case LADDER_LOWPASS_MODE:
+      out = p3;
+      break;
+    case LADDER_BANDPASS_MODE:
+      out = p1 - p3;
+      break;
+    case LADDER_HIGHPASS_MODE:
+      out = FloatTanhPade45(input - p0 - fb * p3);
+      break;
+    default:
+      out = Float4(0.0f);
+    }
+
+    // downsampling filter
+    out = oversampler.Decimate<factor>(out);
+
+    // mix the input node and stage taps for the requested outputs
+    if(poleMixMask){
+      float4 y[5] = {FloatTanhPade45(input - fb * p3), p0, p1, p2, p3};
+      
+      for(int rr = 0; rr < LADDER_POLE_MIX_OUTPUTS; rr++){
+	if(poleMixMask & (1 << rr)){
+	  const float* w = poleMixWeights[poleMixResponse[rr]];
+	  float4 mix = w[0] * y[0] + w[1] * y[1] + w[2] * y[2] + w[3] * y[3] + w[4] * y[4];
+	  poleMix[rr] = poleMixOversampler[rr].Decimate<factor>(mix);
+	}
+      }
+    }
+  }
+  
+  // integration rate at t-1
+  dt_t1 = dt;
+}
+
+template <LadderIntegrationMethod method>
+LadderX4::FilterKernel LadderX4::GetFilterKernel(int factor){
+  switch(factor){
+  case 1:
+    return &LadderX4::LadderFilterKernel<method, 1>;
+  case 2:
+    return &LadderX4::LadderFilterKernel<method, 2>;
+  case 4:
+    return &LadderX4::LadderFilterKernel<method, 4>;
+  case 8:
+    return &LadderX4::LadderFilterKernel<method, 8>;
+  case 16:
+    return &LadderX4::LadderFilterKernel<method, 16>;
+  case 32:
+    return &LadderX4::LadderFilterKernel<method, 32>;
+  default:
+    return &LadderX4::LadderFilterKernel<method, 0>;
+  }
+}
+
+void LadderX4::SelectFilterKernel(){
+  switch(integrationMethod){
+  case LADDER_EULER_FULL_TANH:
+    filterKernel = GetFilterKernel<LADDER_EULER_FULL_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  case LADDER_PREDICTOR_CORRECTOR_FULL_TANH:
+    filterKernel = GetFilterKernel<LADDER_PREDICTOR_CORRECTOR_FULL_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  case LADDER_PREDICTOR_CORRECTOR_FEEDBACK_TANH:
+    filterKernel = GetFilterKernel<LADDER_PREDICTOR_CORRECTOR_FEEDBACK_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  case LADDER_TRAPEZOIDAL_FEEDBACK_TANH:
+    filterKernel = GetFilterKernel<LADDER_TRAPEZOIDAL_FEEDBACK_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  case LADDER_EULER_ADAA_TANH:
+    filterKernel = GetFilterKernel<LADDER_EULER_ADAA_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  default:
+    filterKernel = GetFilterKernel<LADDER_EULER_FULL_TANH>(oversampler.GetOversamplingFactor());
+    break;
+  }
+}
+
+void LadderX4::ProcessBlock(const float4* input, float4* output,
+			    const float4* cutoff, const float4* resonance, int n){
+  for(int ii = 0; ii < n; ii++){
+    // integration rate follows cutoff changes only
+    if(Int4Any(cutoff[ii] != cutoffFrequency)){
+      cutoffFrequency = cutoff[ii];
+      SetFilterIntegrationRate();
+    }
+    Resonance = resonance[ii];
+
+    // tick filter state through sleep and oversampling control
+    LadderFilter(input[ii]);
+    output[ii] = out;
+  }
+}
@@ -22,11 +22,9 @@
 #ifndef __dspladderh__
 #define __dspladderh__
 
-#ifdef FLOATDSP
-#include "iir32.h"
-#else
-#include "iir.h"
-#endif
+#include "oversampler.h"
+#include "fastrand.h"
+#include "sleep.h"
 
 // filter modes
 enum LadderFilterMode {
@@ -35,14 +33,38 @@ enum LadderFilterMode {
    LADDER_HIGHPASS_MODE
 };
 
+// pole mixing responses from the input node and stage taps
+enum LadderPoleMixResponse {
+   LADDER_POLE_MIX_LP1,
+   LADDER_POLE_MIX_LP2,
+   LADDER_POLE_MIX_LP3,
+   LADDER_POLE_MIX_LP4,
+   LADDER_POLE_MIX_HP1,
+   LADDER_POLE_MIX_HP2,
+   LADDER_POLE_MIX_HP3,
+   LADDER_POLE_MIX_HP4,
+   LADDER_POLE_MIX_BP2,
+   LADDER_POLE_MIX_BP4,
+   LADDER_POLE_MIX_NOTCH,
+   LADDER_NUM_POLE_MIX_RESPONSES
+};
+
+// number of simultaneous pole mixing outputs
+#define LADDER_POLE_MIX_OUTPUTS 4
+
 // integration methods
 enum LadderIntegrationMethod {
    LADDER_EULER_FULL_TANH,
    LADDER_PREDICTOR_CORRECTOR_FULL_TANH,
    LADDER_PREDICTOR_CORRECTOR_FEEDBACK_TANH,
-   LADDER_TRAPEZOIDAL_FEEDBACK_TANH
+   LADDER_TRAPEZOIDAL_FEEDBACK_TANH,
+   LADDER_EULER_ADAA_TANH
 };
 
+// highest resonance at which silent voices may sleep,
+// self-oscillation starts near 0.67
+#define LADDER_SLEEP_MAX_RESONANCE 0.6f
+
 class Ladder{
 public:
   // constructor/destructor
@@ -55,11 +77,18 @@ public:
   // set filter parameters
   void SetFilterCutoff(double newCutoff);
   void SetFilterResonance(double newResonance);
+
+  // ramp cutoff and resonance to control rate targets over the given
+  // number of samples, the integration rate is computed once per call
+  void SetFilterControlRamp(double newCutoff, double newResonance, int steps);
   void SetFilterMode(LadderFilterMode newFilterMode);
   void SetFilterSampleRate(double newSampleRate);
   void SetFilterIntegrationMethod(LadderIntegrationMethod method);
   void SetFilterOversamplingFactor(int newOversamplingFactor);
   void SetFilterDecimatorOrder(int decimatorOrder);
+  void SetFilterControlRateNoise(bool newControlRateNoise);
+  void SetFilterPoleMixResponse(int output, LadderPoleMixResponse response);
+  void SetFilterPoleMixMask(int newPoleMixMask);
   
   // get filter parameters
   double GetFilterCutoff();
@@ -69,6 +98,9 @@ public:
   LadderIntegrationMethod GetFilterIntegrationMethod();
   int GetFilterOversamplingFactor();  
   int GetFilterDecimatorOrder();
+  bool GetFilterControlRateNoise();
+  LadderPoleMixResponse GetFilterPoleMixResponse(int output);
+  int GetFilterPoleMixMask();
   
   // normalized noise
 #ifdef FLOATDSP
@@ -82,9 +114,49 @@ public:
   
   // tick filter state
 #ifdef FLOATDSP
-  void LadderFilter(float input);
+  inline void LadderFilter(float input){
 #else
-  void LadderFilter(double input);
+  inline void LadderFilter(double input){
+#endif
+    // step integration rate and resonance along the control rate ramp
+    if(controlRampRemaining > 0){
+      if(--controlRampRemaining){
+	dt += dtIncrement;
+	Resonance += resonanceIncrement;
+      }
+      else{
+	dt = dtTarget;
+	Resonance = resonanceTarget;
+      }
+    }
+    
+    // resonance able to self-oscillate keeps the voice awake
+    bool selfOscillating = Resonance > LADDER_SLEEP_MAX_RESONANCE;
+    
+    // silent voice sleeps until input returns
+    if(sleepDetector.Asleep(input, selfOscillating)){
+      return;
+    }
+    
+    // automatic oversampling follows signal and filter state
+    if(autoOversampling && governor.Update(cutoffFrequency, Resonance, input)){
+      SwitchOversamplingFactor(governor.GetOversamplingFactor());
+    }
+    (this->*filterKernel)(input);
+
+    // voice sleeps once input, output and state have decayed
+    if(sleepDetector.Update(input, out, selfOscillating)){
+      EnterSleep();
+    }
+  }
+
+  // process a block with per-sample cutoff and resonance
+#ifdef FLOATDSP
+  void ProcessBlock(const float* input, float* output,
+		    const float* cutoff, const float* resonance, int n);
+#else
+  void ProcessBlock(const double* input, double* output,
+		    const double* cutoff, const double* resonance, int n);
 #endif
   
   // get filter responses
@@ -98,6 +170,13 @@ public:
 #else
   double GetFilterOutput();
 #endif
+
+  // get decimated pole mixing output
+#ifdef FLOATDSP
+  float GetFilterPoleMix(int output);
+#else
+  double GetFilterPoleMix(int output);
+#endif
   
   // reset state
   void ResetFilterState();
@@ -106,15 +185,62 @@ private:
   // set integration rate
   void SetFilterIntegrationRate();
 
+  // settle decayed state to rest and put voice to sleep
+  void EnterSleep();
+
+  // clear filter and decimator state, parameters stay
+  void ClearFilterState();
+
+  // filter kernel specialized on integration method and oversampling factor
+#ifdef FLOATDSP
+  typedef void (Ladder::*FilterKernel)(float input);
+  
+  template <LadderIntegrationMethod method, int factor>
+  void LadderFilterKernel(float input);
+#else
+  typedef void (Ladder::*FilterKernel)(double input);
+  
+  template <LadderIntegrationMethod method, int factor>
+  void LadderFilterKernel(double input);
+#endif
+
+  template <LadderIntegrationMethod method>
+  static FilterKernel GetFilterKernel(int factor);
+  
+  // select kernel for current integration method and oversampling factor
+  void SelectFilterKernel();
+
+  // change oversampling factor without restarting the decimator
+  void SwitchOversamplingFactor(int newOversamplingFactor);
+
+  // resync antialiased nonlinearities and newton-raphson
+  // solution history to filter state
+  void ResetAntialiasingState();
+
   // filter parameters
   double cutoffFrequency;
   double Resonance;
   LadderFilterMode filterMode;
-  double sampleRate;
   double dt;
+  double dt_t1;
+
+  // control rate ramp
+  double dtTarget;
+  double dtIncrement;
+  double resonanceTarget;
+  double resonanceIncrement;
+  int controlRampRemaining;
   LadderIntegrationMethod integrationMethod;
-  int oversamplingFactor;
-  int decimatorOrder;
+  FilterKernel filterKernel;
+
+  // thermal stage modulation, optionally held at control rate
+  bool controlRateNoise;
+  int noiseHold;
+#ifdef FLOATDSP
+  float alpha_0, alpha_1, alpha_2, alpha_3;
+#else
+  double alpha_0, alpha_1, alpha_2, alpha_3;
+#endif
   
   // filter state
 #ifdef FLOATDSP
@@ -124,6 +250,23 @@ private:
   double p0, p1, p2, p3;
   double ut_1;
 #endif
+
+  // feedback tanh argument and antialiased
+  // stage nonlinearities at t-1
+#ifdef FLOATDSP
+  float xt_1;
+  float tp0, tp1, tp2, tp3;
+#else
+  double xt_1;
+  double tp0, tp1, tp2, tp3;
+#endif
+
+  // newton-raphson solutions at t-1 and t-2
+#ifdef FLOATDSP
+  float xk_t1, xk_t2;
+#else
+  double xk_t1, xk_t2;
+#endif
   
   // filter output
 #ifdef FLOATDSP
@@ -132,12 +275,203 @@ private:
   double out;
 #endif
   
-  // IIR downsampling filter
+  // decimated pole mixing outputs
 #ifdef FLOATDSP
-  IIRLowpass32 *iir;
+  float poleMix[LADDER_POLE_MIX_OUTPUTS];
 #else
-  IIRLowpass *iir;
+  double poleMix[LADDER_POLE_MIX_OUTPUTS];
 #endif
+  
+  // oversampling and decimation
+  Oversampler oversampler;
+
+  // silent voice sleep
+  SleepDetector sleepDetector;
+
+  // pole mixing, one mask bit per requested output
+  LadderPoleMixResponse poleMixResponse[LADDER_POLE_MIX_OUTPUTS];
+  int poleMixMask;
+  Oversampler poleMixOversampler[LADDER_POLE_MIX_OUTPUTS];
+
+  // automatic oversampling
+  bool autoOversampling;
+  OversamplingGovernor governor;
+};
+
+// four voice ladder filter with the state of each
+// voice held in one lane of a SIMD register
+class LadderX4{
+public:
+  // constructor/destructor
+  LadderX4(float4 newCutoff, float4 newResonance, int newOversamplingFactor,
+	   LadderFilterMode newFilterMode, double newSampleRate,
+	   LadderIntegrationMethod newIntegrationMethod, int newDecimatorOrder);
+  LadderX4();
+  ~LadderX4();
+
+  // set filter parameters
+  void SetFilterCutoff(float4 newCutoff);
+  void SetFilterResonance(float4 newResonance);
+
+  // ramp cutoff and resonance to control rate targets over the given
+  // number of samples, the integration rate is computed once per call
+  void SetFilterControlRamp(float4 newCutoff, float4 newResonance, int steps);
+  void SetFilterMode(LadderFilterMode newFilterMode);
+  void SetFilterSampleRate(double newSampleRate);
+  void SetFilterIntegrationMethod(LadderIntegrationMethod method);
+  void SetFilterOversamplingFactor(int newOversamplingFactor);
+  void SetFilterDecimatorOrder(int decimatorOrder);
+  void SetFilterControlRateNoise(bool newControlRateNoise);
+  void SetFilterPoleMixResponse(int output, LadderPoleMixResponse response);
+  void SetFilterPoleMixMask(int newPoleMixMask);
+  
+  // get filter parameters
+  float4 GetFilterCutoff();
+  float4 GetFilterResonance();
+  LadderFilterMode GetFilterMode();  
+  double GetFilterSampleRate();
+  LadderIntegrationMethod GetFilterIntegrationMethod();
+  int GetFilterOversamplingFactor();  
+  int GetFilterDecimatorOrder();
+  bool GetFilterControlRateNoise();
+  LadderPoleMixResponse GetFilterPoleMixResponse(int output);
+  int GetFilterPoleMixMask();
+  
+  // normalized noise
+  float4 GetNormalizedNoiseValue();
+  
+  // thermal noise generator bank
+  NoiseBankX4 noise;
+  
+  // tick filter state
+  inline void LadderFilter(float4 input){
+    // step integration rate and resonance along the control rate ramp
+    if(controlRampRemaining > 0){
+      if(--controlRampRemaining){
+	dt += dtIncrement;
+	Resonance += resonanceIncrement;
+      }
+      else{
+	dt = dtTarget;
+	Resonance = resonanceTarget;
+      }
+    }
+    
+    // resonance able to self-oscillate keeps the voices awake
+    bool selfOscillating = Int4Any(Resonance > LADDER_SLEEP_MAX_RESONANCE);
+    
+    // silent voices sleep until input returns
+    if(sleepDetector.Asleep(input, selfOscillating)){
+      return;
+    }
+    
+    // automatic oversampling follows signal and filter state
+    if(autoOversampling && governor.Update(cutoffFrequency, Resonance, input)){
+      SwitchOversamplingFactor(governor.GetOversamplingFactor());
+    }
+    (this->*filterKernel)(input);
+
+    // voices sleep once input, output and state have decayed
+    if(sleepDetector.Update(input, out, selfOscillating)){
+      EnterSleep();
+    }
+  }
+
+  // process a block with per-sample cutoff and resonance
+  void ProcessBlock(const float4* input, float4* output,
+		    const float4* cutoff, const float4* resonance, int n);
+  
+  // get filter output
+  float4 GetFilterOutput();
+
+  // get decimated pole mixing output
+  float4 GetFilterPoleMix(int output);
+  
+  // reset state
+  void ResetFilterState();
+
+private:
+  // set integration rate
+  void SetFilterIntegrationRate();
+
+  // settle decayed state to rest and put voice to sleep
+  void EnterSleep();
+
+  // clear filter and decimator state, parameters stay
+  void ClearFilterState();
+
+  // filter kernel specialized on integration method and oversampling factor
+  typedef void (LadderX4::*FilterKernel)(float4 input);
+  
+  template <LadderIntegrationMethod method, int factor>
+  void LadderFilterKernel(float4 input);
+
+  template <LadderIntegrationMethod method>
+  static FilterKernel GetFilterKernel(int factor);
+  
+  // select kernel for current integration method and oversampling factor
+  void SelectFilterKernel();
+
+  // change oversampling factor without restarting the decimator
+  void SwitchOversamplingFactor(int newOversamplingFactor);
+
+  // resync antialiased nonlinearities and newton-raphson
+  // solution history to filter state
+  void ResetAntialiasingState();
+
+  // filter parameters
+  float4 cutoffFrequency;
+  float4 Resonance;
+  LadderFilterMode filterMode;
+  float4 dt;
+  float4 dt_t1;
+
+  // control rate ramp
+  float4 dtTarget;
+  float4 dtIncrement;
+  float4 resonanceTarget;
+  float4 resonanceIncrement;
+  int controlRampRemaining;
+  LadderIntegrationMethod integrationMethod;
+  FilterKernel filterKernel;
+
+  // thermal stage modulation, optionally held at control rate
+  bool controlRateNoise;
+  int noiseHold;
+  float4 alpha_0, alpha_1, alpha_2, alpha_3;
+  
+  // filter state
+  float4 p0, p1, p2, p3;
+  float4 ut_1;
+
+  // feedback tanh argument and antialiased
+  // stage nonlinearities at t-1
+  float4 xt_1;
+  float4 tp0, tp1, tp2, tp3;
+
+  // newton-raphson solutions at t-1 and t-2
+  float4 xk_t1, xk_t2;
+  
+  // filter output
+  float4 out;
+  
+  // decimated pole mixing outputs
+  float4 poleMix[LADDER_POLE_MIX_OUTPUTS];
+  
+  // oversampling and decimation
+  OversamplerX4 oversampler;
+
+  // silent voice sleep
+  SleepDetectorX4 sleepDetector;
+
+  // pole mixing, one mask bit per requested output
+  LadderPoleMixResponse poleMixResponse[LADDER_POLE_MIX_OUTPUTS];
+  int poleMixMask;
+  OversamplerX4 poleMixOversampler[LADDER_POLE_MIX_OUTPUTS];
+
+  // automatic oversampling
+  bool autoOversampling;
+  OversamplingGovernorX4 governor;
 };
 
 #endif
@@ -0,0 +1,53 @@
+/*
+ *  (C) 2026 Janne Heikkarainen <janne808@radiofreerobotron.net>
+ *
+ *  All rights reserved.
+ *
+ *  This file is part of Kocmoc VCV Rack plugin.
+ *
+ *  Kocmoc VCV Rack plugin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Kocmoc VCV Rack plugin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kocmoc VCV Rack plugin.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __dspnewtonh__
+#define __dspnewtonh__
+
+#include "fastsimd.h"
+
+// lane-masked newton-raphson iteration for four voices.
+// step(x) returns the newton step f(x)/f'(x) for every lane,
+// lanes freeze once their step falls under the breaking limit
+// scaled to the lane signal level and the loop exits when all
+// lanes have converged
+template <typename NewtonStep>
+inline float4 NewtonX4(NewtonStep step, float4 x_k, int maxSteps, float breakingLimit){
+  // lanes still iterating
+  int4 active = {-1, -1, -1, -1};
+  
+  for(int ii = 0; ii < maxSteps; ii++){
+    float4 dx = step(x_k);
+
+    // update active lanes only
+    x_k -= Float4Select(active, dx, Float4(0.0f));
+
+    // relative breaking limit
+    active &= Float4Abs(dx) >= breakingLimit * (1.0f + Float4Abs(x_k));
+    if(!Int4Any(active)){
+      break;
+    }
+  }
+
+  return x_k;
+}
+
+#endif
@@ -0,0 +1,432 @@
+/*
+ *  (C) 2026 Janne Heikkarainen <janne808@radiofreerobotron.net>
+ *
+ *  All rights reserved.
+ *
+ *  This file is part of Kocmoc VCV Rack plugin.
+ *
+ *  Kocmoc VCV Rack plugin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Kocmoc VCV Rack plugin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kocmoc VCV Rack plugin.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "oversampler.h"
+
+#include "iir32.h"
+
+#ifndef FLOATDSP
+#include "iir.h"
+#endif
+
+// steepness of downsample filter response
+#define IIR_DOWNSAMPLE_ORDER 16
+
+// downsampling passthrough bandwidth
+#define IIR_DOWNSAMPLING_BANDWIDTH 0.75
+
+// constructor
+Oversampler::Oversampler(double newSampleRate, int newOversamplingFactor,
+			 int newDecimatorOrder, double newBandwidth){
+  // initialize oversampling parameters
+  sampleRate = newSampleRate;
+  oversamplingFactor = newOversamplingFactor;
+  decimatorOrder = newDecimatorOrder;
+  bandwidth = newBandwidth;
+
+  // design downsampling filters
+  DesignBank();
+  DesignDecimator();
+}
+
+// default constructor
+Oversampler::Oversampler(){
+  // initialize oversampling parameters
+  sampleRate = 44100.0;
+  oversamplingFactor = 2;
+  decimatorOrder = IIR_DOWNSAMPLE_ORDER;
+  bandwidth = IIR_DOWNSAMPLING_BANDWIDTH;
+
+  // design downsampling filters
+  DesignBank();
+  DesignDecimator();
+}
+
+// default destructor
+Oversampler::~Oversampler(){
+}
+
+void Oversampler::SetSampleRate(double newSampleRate){
+  sampleRate = newSampleRate;
+  DesignBank();
+  DesignDecimator();
+}
+
+void Oversampler::SetOversamplingFactor(int newOversamplingFactor){
+  // clamp oversampling factor
+  if(newOversamplingFactor < 1){
+    oversamplingFactor = 1;
+  }
+  else if(newOversamplingFactor > OVERSAMPLER_MAX_FACTOR){
+    oversamplingFactor = OVERSAMPLER_MAX_FACTOR;
+  }
+  else{
+    oversamplingFactor = newOversamplingFactor;
+  }
+
+  // swap in precomputed coefficients, no redesign on the audio thread
+  LoadCoefficients();
+  ClearState();
+}
+
+void Oversampler::SetDecimatorOrder(int newDecimatorOrder){
+  decimatorOrder = newDecimatorOrder;
+  DesignBank();
+  DesignDecimator();
+}
+
+void Oversampler::SetBandwidth(double newBandwidth){
+  bandwidth = newBandwidth;
+  DesignBank();
+  DesignDecimator();
+}
+
+double Oversampler::GetSampleRate(){
+  return sampleRate;
+}
+
+int Oversampler::GetOversamplingFactor(){
+  return oversamplingFactor;
+}
+
+int Oversampler::GetDecimatorOrder(){
+  return decimatorOrder;
+}
+
+double Oversampler::GetBandwidth(){
+  return bandwidth;
+}
+
+double Oversampler::GetIntegrationRate(double cutoffFrequency){
+  // normalize cutoff freq to oversampled samplerate
+  return 44100.0 / (sampleRate * (double)(oversamplingFactor)) * cutoffFrequency;
+}
+
+void Oversampler::Reset(){
+  LoadCoefficients();
+  ClearState();
+}
+
+void Oversampler::ClearState(){
+  for(int ii = 0; ii < IIR_MAX_ORDER; ii++){
+    z[ii] = 0.0;
+  }
+}
+
+#ifdef FLOATDSP
+void Oversampler::Prime(float level){
+  // constant input passes each section at its dc gain,
+  // solve the section state for that fixed point
+  float v = level;
+  
+  for(int ii = 0; ii < sections; ii++){
+    float in = K[ii] * v;
+    float out = (4.0f * K[ii] / (1.0f + a1[ii] + a2[ii])) * v;
+    z[ii*2] = out - in;
+    z[ii*2+1] = in - a2[ii] * out;
+    v = out;
+  }
+}
+#else
+void Oversampler::Prime(double level){
+  // constant input passes each section at its dc gain,
+  // solve the section state for that fixed point
+  double v = level;
+  
+  for(int ii = 0; ii < sections; ii++){
+    double in = K[ii] * v;
+    double out = (4.0 * K[ii] / (1.0 + a1[ii] + a2[ii])) * v;
+    z[ii*2] = out - in;
+    z[ii*2+1] = in - a2[ii] * out;
+    v = out;
+  }
+}
+#endif
+
+void Oversampler::DesignDecimator(){
+  LoadCoefficients();
+  ClearState();
+}
+
+void Oversampler::DesignBank(){
+  sections = (decimatorOrder < IIR_MAX_ORDER ? decimatorOrder : IIR_MAX_ORDER) / 2;
+  
+  for(int nn = 0; nn < OVERSAMPLER_BANK_SIZE; nn++){
+    iir.SetFilterSamplerate(sampleRate * (double)(1 << nn));
+    iir.SetFilterCutoff(bandwidth * sampleRate / 2.0);
+    iir.SetFilterOrder(decimatorOrder);
+
+    // copy cascade coefficients
+    for(int ii = 0; ii < sections; ii++){
+      bankA1[nn][ii] = iir.GetFilterCoeffA1()[ii];
+      bankA2[nn][ii] = iir.GetFilterCoeffA2()[ii];
+      bankK[nn][ii] = iir.GetFilterCoeffK()[ii];
+    }
+  }
+}
+
+void Oversampler::LoadCoefficients(){
+  // bank index of power of two factors
+  int nn = 0;
+  while(nn < OVERSAMPLER_BANK_SIZE - 1 && (1 << nn) < oversamplingFactor){
+    nn++;
+  }
+
+  if((1 << nn) == oversamplingFactor){
+    for(int ii = 0; ii < sections; ii++){
+      a1[ii] = bankA1[nn][ii];
+      a2[ii] = bankA2[nn][ii];
+      K[ii] = bankK[nn][ii];
+    }
+  }
+  else{
+    // factors outside the bank are designed directly
+    iir.SetFilterSamplerate(sampleRate * (double)(oversamplingFactor));
+    iir.SetFilterCutoff(bandwidth * sampleRate / 2.0);
+    iir.SetFilterOrder(decimatorOrder);
+
+    for(int ii = 0; ii < sections; ii++){
+      a1[ii] = iir.GetFilterCoeffA1()[ii];
+      a2[ii] = iir.GetFilterCoeffA2()[ii];
+      K[ii] = iir.GetFilterCoeffK()[ii];
+    }
+  }
+}
+
+// constructor
+OversamplerX4::OversamplerX4(double newSampleRate, int newOversamplingFactor,
+			     int newDecimatorOrder, double newBandwidth){
+  // initialize oversampling parameters
+  sampleRate = newSampleRate;
+  oversamplingFactor = newOversamplingFactor;
+  decimatorOrder = newDecimatorOrder;
+  bandwidth = newBandwidth;
+
+  // design downsampling filters
+  DesignBank();
+  DesignDecimator();
+}
+
+// default constructor
+OversamplerX4::OversamplerX4(){
+  // initialize oversampling parameters
+  sampleRate = 44100.0;
+  oversamplingFactor = 2;
+  decimatorOrder = IIR_DOWNSAMPLE_ORDER;
+  bandwidth = IIR_DOWNSAMPLING_BANDWIDTH;
+
+  // design downsampling filters
+  DesignBank();
+  DesignDecimator();
+}
+
+// default destructor
+OversamplerX4::~OversamplerX4(){
+}
+
+void OversamplerX4::SetSampleRate(double newSampleRate){
+  sampleRate = newSampleRate;
+  DesignBank();
+  DesignDecimator();
+}
+
+void OversamplerX4::SetOversamplingFactor(int newOversamplingFactor){
+  // clamp oversampling factor
+  if(newOversamplingFactor < 1){
+    oversamplingFactor = 1;
+  }
+  else if(newOversamplingFactor > OVERSAMPLER_MAX_FACTOR){
+    oversamplingFactor = OVERSAMPLER_MAX_FACTOR;
+  }
+  else{
+    oversamplingFactor = newOversamplingFactor;
+  }
+
+  // swap in precomputed coefficients, no redesign on the audio thread
+  LoadCoefficients();
+  ClearState();
+}
+
+void OversamplerX4::SetDecimatorOrder(int newDecimatorOrder){
+  decimatorOrder = newDecimatorOrder;
+  DesignBank();
+  DesignDecimator();
+}
+
+void OversamplerX4::SetBandwidth(double newBandwidth){
+  bandwidth = newBandwidth;
+  DesignBank();
+  DesignDecimator();
+}
+
+double OversamplerX4::GetSampleRate(){
+  return sampleRate;
+}
+
+int OversamplerX4::GetOversamplingFactor(){
+  return oversamplingFactor;
+}
+
+int OversamplerX4::GetDecimatorOrder(){
+  return decimatorOrder;
+}
+
+double OversamplerX4::GetBandwidth(){
+  return bandwidth;
+}
+
+double OversamplerX4::GetIntegrationRate(double cutoffFrequency){
+  // normalize cutoff freq to oversampled samplerate
+  return 44100.0 / (sampleRate * (double)(oversamplingFactor)) * cutoffFrequency;
+}
+
+void OversamplerX4::Reset(){
+  LoadCoefficients();
+  ClearState();
+}
+
+void OversamplerX4::ClearState(){
+  for(int ii = 0; ii < IIR_MAX_ORDER; ii++){
+    z[ii] = Float4(0.0f);
+  }
+}
+
+void OversamplerX4::Prime(float4 level){
+  // constant input passes each section at its dc gain,
+  // solve the section state for that fixed point
+  float4 v = level;
+  
+  for(int ii = 0; ii < sections; ii++){
+    float4 in = K[ii] * v;
+    float4 out = (4.0f * K[ii] / (1.0f + a1[ii] + a2[ii])) * v;
+    z[ii*2] = out - in;
+    z[ii*2+1] = in - a2[ii] * out;
+    v = out;
+  }
+}
+
+void OversamplerX4::DesignDecimator(){
+  LoadCoefficients();
+  ClearState();
+}
+
+void OversamplerX4::DesignBank(){
+  sections = (decimatorOrder < IIR_MAX_ORDER ? decimatorOrder : IIR_MAX_ORDER) / 2;
+  
+  for(int nn = 0; nn < OVERSAMPLER_BANK_SIZE; nn++){
+    iir.SetFilterSamplerate(sampleRate * (double)(1 << nn));
+    iir.SetFilterCutoff(bandwidth * sampleRate / 2.0);
+    iir.SetFilterOrder(decimatorOrder);
+
+    // copy cascade coefficients
+    for(int ii = 0; ii < sections; ii++){
+      bankA1[nn][ii] = iir.GetFilterCoeffA1()[ii];
+      bankA2[nn][ii] = iir.GetFilterCoeffA2()[ii];
+      bankK[nn][ii] = iir.GetFilterCoeffK()[ii];
+    }
+  }
+}
+
+void OversamplerX4::LoadCoefficients(){
+  // bank index of power of two factors
+  int nn = 0;
+  while(nn < OVERSAMPLER_BANK_SIZE - 1 && (1 << nn) < oversamplingFactor){
+    nn++;
+  }
+
+  if((1 << nn) == oversamplingFactor){
+    for(int ii = 0; ii < sections; ii++){
+      a1[ii] = bankA1[nn][ii];
+      a2[ii] = bankA2[nn][ii];
+      K[ii] = bankK[nn][ii];
+    }
+  }
+  else{
+    // factors outside the bank are designed directly
+    iir.SetFilterSamplerate(sampleRate * (double)(oversamplingFactor));
+    iir.SetFilterCutoff(bandwidth * sampleRate / 2.0);
+    iir.SetFilterOrder(decimatorOrder);
+
+    for(int ii = 0; ii < sections; ii++){
+      a1[ii] = iir.GetFilterCoeffA1()[ii];
+      a2[ii] = iir.GetFilterCoeffA2()[ii];
+      K[ii] = iir.GetFilterCoeffK()[ii];
+    }
+  }
+}
+
+// constructor
+OversamplingGovernor::OversamplingGovernor(){
+  SetSampleRate(44100.0);
+  Reset(1);
+}
+
+// default destructor
+OversamplingGovernor::~OversamplingGovernor(){
+}
+
+void OversamplingGovernor::SetSampleRate(double newSampleRate){
+  // integration rate of unit cutoff at host rate
+  rate = (float)(44100.0 / newSampleRate);
+
+  // 50 ms level release and 100 ms hold before switching down
+  decay = (float)(std::exp(-1.0 / (0.05 * newSampleRate)));
+  holdTime = (int)(0.1 * newSampleRate);
+}
+
+void OversamplingGovernor::Reset(int newOversamplingFactor){
+  level = 0.0f;
+  hold = holdTime;
+  oversamplingFactor = newOversamplingFactor;
+}
+
+int OversamplingGovernor::GetOversamplingFactor(){
+  return oversamplingFactor;
+}
+
+// constructor
+OversamplingGovernorX4::OversamplingGovernorX4(){
+  SetSampleRate(44100.0);
+  Reset(1);
+}
+
+// default destructor
+OversamplingGovernorX4::~OversamplingGovernorX4(){
+}
+
+void OversamplingGovernorX4::SetSampleRate(double newSampleRate){
+  // integration rate of unit cutoff at host rate
+  rate = (float)(44100.0 / newSampleRate);
+
+  // 50 ms level release and 100 ms hold before switching down
+  decay = (float)(std::exp(-1.0 / (0.05 * newSampleRate)));
+  holdTime = (int)(0.1 * newSampleRate);
+}
+
+void OversamplingGovernorX4::Reset(int newOversamplingFactor){
+  level = Float4(0.0f);
+  hold = holdTime;
+  oversamplingFactor = newOversamplingFactor;
+}
+
+int OversamplingGovernorX4::GetOversamplingFactor(){
+  return oversamplingFactor;
+}
@@ -0,0 +1,417 @@
+/*
+ *  (C) 2026 Janne Heikkarainen <janne808@radiofreerobotron.net>
+ *
+ *  All rights reserved.
+ *
+ *  This file is part of Kocmoc VCV Rack plugin.
+ *
+ *  Kocmoc VCV Rack plugin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Kocmoc VCV Rack plugin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kocmoc VCV Rack plugin.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __dspoversamplerh__
+#define __dspoversamplerh__
+
+#include "fastsimd.h"
+#include "iir32.h"
+
+#ifndef FLOATDSP
+#include "iir.h"
+#endif
+
+// maximum oversampling factor
+#define OVERSAMPLER_MAX_FACTOR 32
+
+// oversampling factor selecting automatic oversampling
+#define OVERSAMPLER_AUTO 0
+
+// maximum automatic oversampling factor
+#define OVERSAMPLER_AUTO_MAX_FACTOR 16
+
+// integration rate per substep targeted by automatic oversampling
+#define OVERSAMPLER_AUTO_TARGET_RATE 0.5f
+
+// number of precomputed power of two decimator designs, x1 to x32
+#define OVERSAMPLER_BANK_SIZE 6
+
+// oversampling with zero-order hold upsampling and
+// IIR lowpass decimation shared by the filter cores
+class Oversampler{
+public:
+  // constructor/destructor
+  Oversampler(double newSampleRate, int newOversamplingFactor,
+	      int newDecimatorOrder, double newBandwidth);
+  Oversampler();
+  ~Oversampler();
+
+  // set oversampling parameters
+  void SetSampleRate(double newSampleRate);
+  void SetOversamplingFactor(int newOversamplingFactor);
+  void SetDecimatorOrder(int newDecimatorOrder);
+  void SetBandwidth(double newBandwidth);
+
+  // get oversampling parameters
+  double GetSampleRate();
+  int GetOversamplingFactor();
+  int GetDecimatorOrder();
+  double GetBandwidth();
+
+  // integration rate normalized to the oversampled rate
+  double GetIntegrationRate(double cutoffFrequency);
+  
+  // reset decimator state
+  void Reset();
+
+  // clear decimator state without redesigning the decimator
+  void ClearState();
+
+  // set decimator state to the steady state of a constant level
+#ifdef FLOATDSP
+  void Prime(float level);
+#else
+  void Prime(double level);
+#endif
+
+  // decimate one oversampled substep
+#ifdef FLOATDSP
+  inline float Decimate(float input){
+#else
+  inline double Decimate(double input){
+#endif
+    if(oversamplingFactor > 1){
+      return Lowpass(input);
+    }
+    return input;
+  }
+
+  // decimate with compile-time oversampling factor,
+  // zero falls back to the runtime factor
+#ifdef FLOATDSP
+  template <int factor>
+  inline float Decimate(float input){
+#else
+  template <int factor>
+  inline double Decimate(double input){
+#endif
+    return (factor > 1 || (factor == 0 && oversamplingFactor > 1)) ? Lowpass(input) : input;
+  }
+  
+private:
+  // load decimator for current parameters and clear its state
+  void DesignDecimator();
+
+  // design decimators of all power of two factors
+  void DesignBank();
+
+  // load decimator coefficients of current factor
+  void LoadCoefficients();
+
+  // transposed direct form II biquad cascade
+#ifdef FLOATDSP
+  inline float Lowpass(float input){
+    // tiny dc offset keeps the state out of the subnormal range
+    float out = input + 1e-20f;
+    
+    for(int ii = 0; ii < sections; ii++){
+      float in = K[ii] * out;
+      out = in + z[ii*2];
+      z[ii*2] = 2.0f * in - a1[ii] * out + z[ii*2+1];
+      z[ii*2+1] = in - a2[ii] * out;
+    }
+    
+    return out;
+  }
+#else
+  inline double Lowpass(double input){
+    // tiny dc offset keeps the state out of the subnormal range
+    double out = input + 1e-20;
+    
+    for(int ii = 0; ii < sections; ii++){
+      double in = K[ii] * out;
+      out = in + z[ii*2];
+      z[ii*2] = 2.0 * in - a1[ii] * out + z[ii*2+1];
+      z[ii*2+1] = in - a2[ii] * out;
+    }
+    
+    return out;
+  }
+#endif
+  
+  // oversampling parameters
+  double sampleRate;
+  int oversamplingFactor;
+  int decimatorOrder;
+  double bandwidth;
+  
+  // decimator design and coefficients
+#ifdef FLOATDSP
+  IIRLowpass32 iir;
+#else
+  IIRLowpass iir;
+#endif
+  int sections;
+#ifdef FLOATDSP
+  float a1[IIR_MAX_ORDER/2];
+  float a2[IIR_MAX_ORDER/2];
+  float K[IIR_MAX_ORDER/2];
+#else
+  double a1[IIR_MAX_ORDER/2];
+  double a2[IIR_MAX_ORDER/2];
+  double K[IIR_MAX_ORDER/2];
+#endif
+
+  // precomputed coefficients of power of two factors
+#ifdef FLOATDSP
+  float bankA1[OVERSAMPLER_BANK_SIZE][IIR_MAX_ORDER/2];
+  float bankA2[OVERSAMPLER_BANK_SIZE][IIR_MAX_ORDER/2];
+  float bankK[OVERSAMPLER_BANK_SIZE][IIR_MAX_ORDER/2];
+#else
+  double bankA1[OVERSAMPLER_BANK_SIZE][IIR_MAX_ORDER/2];
+  double bankA2[OVERSAMPLER_BANK_SIZE][IIR_MAX_ORDER/2];
+  double bankK[OVERSAMPLER_BANK_SIZE][IIR_MAX_ORDER/2];
+#endif
+
+  // transposed direct form II state
+#ifdef FLOATDSP
+  float z[IIR_MAX_ORDER];
+#else
+  double z[IIR_MAX_ORDER];
+#endif
+};
+
+// four lane oversampling with a transposed direct form II
+// IIR lowpass decimator running one voice per lane
+class OversamplerX4{
+public:
+  // constructor/destructor
+  OversamplerX4(double newSampleRate, int newOversamplingFactor,
+		int newDecimatorOrder, double newBandwidth);
+  OversamplerX4();
+  ~OversamplerX4();
+
+  // set oversampling parameters
+  void SetSampleRate(double newSampleRate);
+  void SetOversamplingFactor(int newOversamplingFactor);
+  void SetDecimatorOrder(int newDecimatorOrder);
+  void SetBandwidth(double newBandwidth);
+
+  // get oversampling parameters
+  double GetSampleRate();
+  int GetOversamplingFactor();
+  int GetDecimatorOrder();
+  double GetBandwidth();
+
+  // integration rate normalized to the oversampled rate
+  double GetIntegrationRate(double cutoffFrequency);
+  
+  // reset decimator state
+  void Reset();
+
+  // clear decimator state without redesigning the decimator
+  void ClearState();
+
+  // set decimator state to the steady state of a constant level
+  void Prime(float4 level);
+
+  // decimate one oversampled substep of four voices
+  inline float4 Decimate(float4 input){
+    if(oversamplingFactor > 1){
+      return Lowpass(input);
+    }
+    return input;
+  }
+
+  // decimate with compile-time oversampling factor,
+  // zero falls back to the runtime factor
+  template <int factor>
+  inline float4 Decimate(float4 input){
+    return (factor > 1 || (factor == 0 && oversamplingFactor > 1)) ? Lowpass(input) : input;
+  }
+  
+private:
+  // load decimator for current parameters and clear its state
+  void DesignDecimator();
+
+  // design decimators of all power of two factors
+  void DesignBank();
+
+  // load decimator coefficients of current factor
+  void LoadCoefficients();
+
+  // transposed direct form II biquad cascade
+  inline float4 Lowpass(float4 input){
+    // tiny dc offset keeps the state out of the subnormal range
+    float4 out = input + 1e-20f;
+    
+    for(int ii = 0; ii < sections; ii++){
+      float4 in = K[ii] * out;
+      out = in + z[ii*2];
+      z[ii*2] = 2.0f * in - a1[ii] * out + z[ii*2+1];
+      z[ii*2+1] = in - a2[ii] * out;
+    }
+    
+    return out;
+  }
+  
+  // oversampling parameters
+  double sampleRate;
+  int oversamplingFactor;
+  int decimatorOrder;
+  double bandwidth;
+  
+  // decimator design and coefficients shared by all lanes
+  IIRLowpass32 iir;
+  int sections;
+  float a1[IIR_MAX_ORDER/2];
+  float a2[IIR_MAX_ORDER/2];
+  float K[IIR_MAX_ORDER/2];
+
+  // precomputed coefficients of power of two factors
+  float bankA1[OVERSAMPLER_BANK_SIZE][IIR_MAX_ORDER/2];
+  float bankA2[OVERSAMPLER_BANK_SIZE][IIR_MAX_ORDER/2];
+  float bankK[OVERSAMPLER_BANK_SIZE][IIR_MAX_ORDER/2];
+
+  // per lane transposed direct form II state
+  float4 z[IIR_MAX_ORDER];
+};
+
+// picks the oversampling factor of a single voice from cutoff,
+// resonance and input level, switching up at once and down
+// only after the demand has stayed lower for a hold time
+class OversamplingGovernor{
+public:
+  // constructor/destructor
+  OversamplingGovernor();
+  ~OversamplingGovernor();
+
+  // set host samplerate
+  void SetSampleRate(double newSampleRate);
+
+  // restart from given factor
+  void Reset(int newOversamplingFactor);
+
+  // get current factor
+  int GetOversamplingFactor();
+
+  // track one host sample, true when the factor changed
+  inline bool Update(float cutoff, float resonance, float input){
+    // input peak follower
+    level = std::fmax(std::fabs(input), decay * level);
+
+    // host rate integration rate scaled up by nonlinear drive
+    // and resonance
+    float d = rate * cutoff * (1.0f + 0.25f * level) * (1.0f + resonance);
+
+    // smallest power of two keeping substep rate below target
+    int target = 1;
+    while(target < OVERSAMPLER_AUTO_MAX_FACTOR && (float)(target) * OVERSAMPLER_AUTO_TARGET_RATE < d){
+      target <<= 1;
+    }
+
+    if(target > oversamplingFactor){
+      oversamplingFactor = target;
+      hold = holdTime;
+      return true;
+    }
+    else if(target < oversamplingFactor){
+      if(--hold <= 0){
+	oversamplingFactor = target;
+	hold = holdTime;
+	return true;
+      }
+    }
+    else{
+      hold = holdTime;
+    }
+
+    return false;
+  }
+
+private:
+  // host rate normalization and timing
+  float rate;
+  float decay;
+  int holdTime;
+
+  // governor state
+  float level;
+  int hold;
+  int oversamplingFactor;
+};
+
+// picks the oversampling factor of four voices from cutoff,
+// resonance and input level, switching up at once and down
+// only after the demand has stayed lower for a hold time
+class OversamplingGovernorX4{
+public:
+  // constructor/destructor
+  OversamplingGovernorX4();
+  ~OversamplingGovernorX4();
+
+  // set host samplerate
+  void SetSampleRate(double newSampleRate);
+
+  // restart from given factor
+  void Reset(int newOversamplingFactor);
+
+  // get current factor
+  int GetOversamplingFactor();
+
+  // track one host sample, true when the factor changed
+  inline bool Update(float4 cutoff, float4 resonance, float4 input){
+    // input peak follower
+    level = Float4Max(Float4Abs(input), decay * level);
+
+    // host rate integration rate scaled up by nonlinear drive
+    // and resonance, loudest lane decides
+    float4 demand = rate * cutoff * (1.0f + 0.25f * level) * (1.0f + resonance);
+    float d = Float4HMax(demand);
+
+    // smallest power of two keeping substep rate below target
+    int target = 1;
+    while(target < OVERSAMPLER_AUTO_MAX_FACTOR && (float)(target) * OVERSAMPLER_AUTO_TARGET_RATE < d){
+      target <<= 1;
+    }
+
+    if(target > oversamplingFactor){
+      oversamplingFactor = target;
+      hold = holdTime;
+      return true;
+    }
+    else if(target < oversamplingFactor){
+      if(--hold <= 0){
+	oversamplingFactor = target;
+	hold = holdTime;
+	return true;
+      }
+    }
+    else{
+      hold = holdTime;
+    }
+
+    return false;
+  }
+
+private:
+  // host rate normalization and timing
+  float rate;
+  float decay;
+  int holdTime;
+
+  // governor state
+  float4 level;
+  int hold;
+  int oversamplingFactor;
+};
+
+#endif
@@ -0,0 +1,52 @@
+/*
+ *  (C) 2026 Janne Heikkarainen <janne808@radiofreerobotron.net>
+ *
+ *  All rights reserved.
+ *
+ *  This file is part of Kocmoc VCV Rack plugin.
+ *
+ *  Kocmoc VCV Rack plugin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Kocmoc VCV Rack plugin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kocmoc VCV Rack plugin.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __kocmocparamcacheh__
+#define __kocmocparamcacheh__
+
+// value derived from a panel parameter, the shaping function
+// only runs when the parameter value changes
+class ParamCache{
+public:
+  ParamCache(){
+    valid = false;
+    value = 0.0f;
+    derived = 0.0f;
+  }
+
+  // return shaped value, reshaping only on a new parameter value
+  template <typename Shape>
+  inline float Get(float newValue, Shape shape){
+    if(!valid || newValue != value){
+      value = newValue;
+      derived = shape(newValue);
+      valid = true;
+    }
+    return derived;
+  }
+
+private:
+  bool valid;
+  float value;
+  float derived;
+};
+
+#endif
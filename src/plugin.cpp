@@ -39,6 +39,7 @@ void init(Plugin* p) {
 	p->addModel(modelMUL);
 	p->addModel(modelSKF);
 	p->addModel(modelDDLY);
+	p->addModel(modelTAPS);
 	
 	// Any other plugin initialization may go here.
 	// As an alternative, consider lazy-loading assets and lookup tables when your module is created to reduce startup times of Rack.
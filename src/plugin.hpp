@@ -24,6 +24,12 @@
 
 using namespace rack;
 
+// dsp precision of the filter modules
+enum DSPPrecision {
+   DSP_PRECISION_FLOAT,
+   DSP_PRECISION_DOUBLE
+};
+
 // Declare the Plugin, defined in plugin.cpp
 extern Plugin* pluginInstance;
 
@@ -40,3 +46,4 @@ extern Model* modelPHASR;
 extern Model* modelMUL;
 extern Model* modelSKF;
 extern Model* modelDDLY;
+extern Model* modelTAPS;
@@ -24,17 +24,9 @@
 #include <cmath>
 #include "sallenkey.h"
 
-#ifdef FLOATDSP
-#include "iir32.h"
-#else
-#include "iir.h"
-#endif
-
 #include "fastmath.h"
 #include "fastrand.h"
-
-// steepness of downsample filter response
-#define IIR_DOWNSAMPLE_ORDER 16
+#include "newton.h"
 
 // downsampling passthrough bandwidth
 #define IIR_DOWNSAMPLING_BANDWIDTH 0.9
@@ -45,6 +37,16 @@
 // check for newton-raphson breaking limit
 #define SKF_NEWTON_BREAKING_LIMIT 1
 
+// newton-raphson step size breaking limit
+// relative to signal level, float and double paths
+#ifdef SKF_NEWTON_BREAKING_LIMIT
+#define SKF_NEWTON_TOLERANCE 1.0e-5f
+#define SKF_NEWTON_TOLERANCE_DOUBLE 1.0e-9
+#else
+#define SKF_NEWTON_TOLERANCE 0.0f
+#define SKF_NEWTON_TOLERANCE_DOUBLE 0.0
+#endif
+
 // constructor
 SKFilter::SKFilter(double newCutoff, double newResonance, int newOversamplingFactor,
 		   SKFilterMode newFilterMode, double newSampleRate,
@@ -53,31 +55,33 @@ SKFilter::SKFilter(double newCutoff, double newResonance, int newOversamplingFac
   cutoffFrequency = newCutoff;
   Resonance = newResonance;
   filterMode = newFilterMode;
-  sampleRate = newSampleRate;
-  oversamplingFactor = newOversamplingFactor;
-  decimatorOrder = newDecimatorOrder;
 
+  // set up oversampling
+  oversampler.SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  oversampler.SetSampleRate(newSampleRate);
+  oversampler.SetOversamplingFactor(newOversamplingFactor);
+  oversampler.SetDecimatorOrder(newDecimatorOrder);
+
+  // automatic oversampling starts from x1
+  autoOversampling = (newOversamplingFactor == OVERSAMPLER_AUTO);
+  governor.SetSampleRate(newSampleRate);
+  governor.Reset(oversampler.GetOversamplingFactor());
+  
   SetFilterIntegrationRate();
+  dt_t1 = dt;
 
   // initialize filter state
   p0 = p1 = out = 0.0f;
+  xk_t1 = xk_t2 = 0.0f;
 
   // initialize filter inputs
   input_lp = input_bp = input_hp = 0.0f;
   input_lp_t1 = input_bp_t1 = input_hp_t1 = 0.0f;
   
   integrationMethod = newIntegrationMethod;
-  
-  // instantiate downsampling filter
-#ifdef FLOATDSP
-  iir = new IIRLowpass32(sampleRate * oversamplingFactor,
-		         IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0f,
-		         decimatorOrder);
-#else
-  iir = new IIRLowpass(sampleRate * oversamplingFactor,
-		       IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0,
-		       decimatorOrder);
-#endif
+
+  // select filter kernel
+  SelectFilterKernel();
 
   // instantiate PRNG seed
   s = rand() | 1u;
@@ -89,31 +93,26 @@ SKFilter::SKFilter(){
   cutoffFrequency = 0.25;
   Resonance = 0.5;
   filterMode = SK_LOWPASS_MODE;
-  sampleRate = 44100.0;
-  oversamplingFactor = 2;
-  decimatorOrder = IIR_DOWNSAMPLE_ORDER;
+
+  // set up oversampling
+  oversampler.SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  autoOversampling = false;
 
   SetFilterIntegrationRate();
+  dt_t1 = dt;
   
   // initialize filter state
   p0 = p1 = out = 0.0f;
+  xk_t1 = xk_t2 = 0.0f;
 
   // initialize filter inputs
   input_lp = input_bp = input_hp = 0.0f;
   input_lp_t1 = input_bp_t1 = input_hp_t1 = 0.0f;
   
   integrationMethod = SK_TRAPEZOIDAL;
-  
-  // instantiate downsampling filter
-#ifdef FLOATDSP
-  iir = new IIRLowpass32(sampleRate * oversamplingFactor,
-		         IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0f,
-		         decimatorOrder);
-#else
-  iir = new IIRLowpass(sampleRate * oversamplingFactor,
-		       IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0,
-		       decimatorOrder);
-#endif
+
+  // select filter kernel
+  SelectFilterKernel();
 
   // instantiate PRNG seed
   s = rand() | 1u;
@@ -121,7 +120,6 @@ SKFilter::SKFilter(){
 
 // default destructor
 SKFilter::~SKFilter(){
-  delete iir;
 }
 
 void SKFilter::ResetFilterState(){
@@ -130,18 +128,43 @@ void SKFilter::ResetFilterState(){
   Resonance = 0.5;
 
   SetFilterIntegrationRate();
+  dt_t1 = dt;
   
+  // initialize filter and decimator state
+  ClearFilterState();
+  
+  // wake from sleep
+  sleepDetector.Reset();
+
+  // restart oversampling governor
+  governor.Reset(oversampler.GetOversamplingFactor());
+}
+
+void SKFilter::ClearFilterState(){
   // initialize filter state
   p0 = p1 = out = 0.0f;
+  xk_t1 = xk_t2 = 0.0f;
 
   // initialize filter inputs
   input_lp = input_bp = input_hp = 0.0f;
   input_lp_t1 = input_bp_t1 = input_hp_t1 = 0.0f;
   
-  // set oversampling
-  iir->SetFilterSamplerate(sampleRate * oversamplingFactor);
-  iir->SetFilterCutoff(IIR_DOWNSAMPLING_BANDWIDTH*sampleRate/2.0);
-  iir->SetFilterOrder(decimatorOrder);
+  // clear decimator state, the decimator design stays
+  oversampler.ClearState();
+}
+
+void SKFilter::EnterSleep(){
+  // stay awake until the filter state has decayed as well
+  if(fabs(p0) > SLEEP_THRESHOLD ||
+     fabs(p1) > SLEEP_THRESHOLD){
+    return;
+  }
+
+  // settle to rest at the current parameters
+  ClearFilterState();
+  dt_t1 = dt;
+
+  sleepDetector.Sleep();
 }
 
 void SKFilter::SetFilterCutoff(double newCutoff){
@@ -154,39 +177,75 @@ void SKFilter::SetFilterResonance(double newResonance){
   Resonance = newResonance;
 }
 
+void SKFilter::SetFilterControlRamp(double newCutoff, double newResonance, int steps){
+  double dt_start = dt;
+  double resonance_start = Resonance;
+
+  // integration rate at the new target
+  cutoffFrequency = newCutoff;
+  SetFilterIntegrationRate();
+  dtTarget = dt;
+  resonanceTarget = newResonance;
+
+  // single step ramps jump to the target
+  if(steps <= 1){
+    Resonance = newResonance;
+    return;
+  }
+  dtIncrement = (dtTarget - dt_start) / (double)(steps);
+  resonanceIncrement = (resonanceTarget - resonance_start) / (double)(steps);
+  dt = dt_start;
+  Resonance = resonance_start;
+  controlRampRemaining = steps;
+}
+
 void SKFilter::SetFilterMode(SKFilterMode newFilterMode){
   filterMode = newFilterMode;
 }
 
 void SKFilter::SetFilterSampleRate(double newSampleRate){
-  sampleRate = newSampleRate;
-  iir->SetFilterSamplerate(sampleRate * (double)(oversamplingFactor));
-  iir->SetFilterCutoff(IIR_DOWNSAMPLING_BANDWIDTH*sampleRate/2.0);
+  oversampler.SetSampleRate(newSampleRate);
+  governor.SetSampleRate(newSampleRate);
 
   SetFilterIntegrationRate();
+  dt_t1 = dt;
 }
 
 void SKFilter::SetFilterIntegrationMethod(SKIntegrationMethod method){
   integrationMethod = method;
+  SelectFilterKernel();
 }
 
 void SKFilter::SetFilterOversamplingFactor(int newOversamplingFactor){
-  oversamplingFactor = newOversamplingFactor;
-  iir->SetFilterSamplerate(sampleRate * oversamplingFactor);
-  iir->SetFilterCutoff(IIR_DOWNSAMPLING_BANDWIDTH*sampleRate/2.0);
-  iir->SetFilterOrder(decimatorOrder);
+  // automatic oversampling starts from the current factor
+  autoOversampling = (newOversamplingFactor == OVERSAMPLER_AUTO);
+  if(autoOversampling){
+    governor.Reset(oversampler.GetOversamplingFactor());
+    return;
+  }
+
+  SwitchOversamplingFactor(newOversamplingFactor);
+}
+
+void SKFilter::SwitchOversamplingFactor(int newOversamplingFactor){
+  oversampler.SetOversamplingFactor(newOversamplingFactor);
+
+  // continue decimation from the current output level, priming
+  // restores the dc steady state only so switching is reduced-glitch
+  oversampler.Prime(out);
 
   SetFilterIntegrationRate();
+  dt_t1 = dt;
+  SelectFilterKernel();
 }
 
 void SKFilter::SetFilterDecimatorOrder(int newDecimatorOrder){
-  decimatorOrder = newDecimatorOrder;
-  iir->SetFilterOrder(decimatorOrder);
+  oversampler.SetDecimatorOrder(newDecimatorOrder);
 }
 
 void SKFilter::SetFilterIntegrationRate(){
   // normalize cutoff freq to samplerate
-  dt = 44100.0 / (sampleRate * oversamplingFactor) * cutoffFrequency;
+  dt = oversampler.GetIntegrationRate(cutoffFrequency);
 
   // clamp integration rate
   if(dt < 0.0){
@@ -195,6 +254,9 @@ void SKFilter::SetFilterIntegrationRate(){
   else if(dt > 0.55f){
     dt = 0.55f;
   }
+
+  // direct updates stop the control rate ramp
+  controlRampRemaining = 0;
 }
 
 double SKFilter::GetFilterCutoff(){
@@ -206,11 +268,11 @@ double SKFilter::GetFilterResonance(){
 }
 
 int SKFilter::GetFilterOversamplingFactor(){
-  return oversamplingFactor;
+  return oversampler.GetOversamplingFactor();
 }
 
 int SKFilter::GetFilterDecimatorOrder(){
-  return decimatorOrder;
+  return oversampler.GetDecimatorOrder();
 }
 
 #ifdef FLOATDSP
@@ -228,7 +290,7 @@ SKFilterMode SKFilter::GetFilterMode(){
 }
 
 double SKFilter::GetFilterSampleRate(){
-  return sampleRate;
+  return oversampler.GetSampleRate();
 }
 
 SKIntegrationMethod SKFilter::GetFilterIntegrationMethod(){
@@ -246,7 +308,8 @@ double SKFilter::GetNormalizedNoiseValue(){
 #endif
 
 #ifdef FLOATDSP
-void SKFilter::filter(float input){
+template <SKIntegrationMethod method, int factor>
+void SKFilter::SKFilterKernel(float input){
   // noise term
   float noise;
 
@@ -282,17 +345,28 @@ void SKFilter::filter(float input){
     input_hp = 0.0f;
   }
     
+  // oversampling factor
+  const int oversamplingFactor = factor ? factor : oversampler.GetOversamplingFactor();
+
+  // integration rate ramps from the previous host sample
+  // to the current one across the substeps
+  float dt_step = (float)(dt - dt_t1) / (float)(oversamplingFactor);
+  float dt_n = (float)(dt_t1);
+
   // integrate filter state
   // with oversampling
   for(int nn = 0; nn < oversamplingFactor; nn++){
+    // ramp integration rate
+    dt_n += dt_step;
+
     // switch integration method
-    switch(integrationMethod){
+    switch(method){
     case SK_SEMI_IMPLICIT_EULER:
       // semi-implicit euler integration
       {
 	fb = input_bp + res * p1;
-	p0 += dt * (input_lp - p0 - fb);
-       	p1 += dt * (p0 + fb - p1 - 1.0f / 4.0f * FloatSinhPade54(p0 * 4.0f));
+	p0 += dt_n * (input_lp - p0 - fb);
+       	p1 += dt_n * (p0 + fb - p1 - 1.0f / 4.0f * FloatSinhPade54(p0 * 4.0f));
       	out = p1;
       }
       break;
@@ -302,13 +376,13 @@ void SKFilter::filter(float input){
 	float p0_prime, p1_prime, fb_prime;
 	  
 	fb = input_bp_t1 + res * p1;
-	p0_prime = p0 + dt * (input_lp_t1 - p0 - fb);
-       	p1_prime = p1 + dt * (p0 + fb - p1 - 1.0f / 4.0f * FloatSinhPade54(p1 * 4.0f));	
+	p0_prime = p0 + dt_n * (input_lp_t1 - p0 - fb);
+       	p1_prime = p1 + dt_n * (p0 + fb - p1 - 1.0f / 4.0f * FloatSinhPade54(p1 * 4.0f));	
 	fb_prime = input_bp + res * p1_prime;
 	
-       	p1 += 0.5f * dt * ((p0 + fb - p1 - 1.0f / 4.0f * FloatSinhPade54(p1 * 4.0f)) +
+       	p1 += 0.5f * dt_n * ((p0 + fb - p1 - 1.0f / 4.0f * FloatSinhPade54(p1 * 4.0f)) +
 		           (p0_prime + fb_prime - p1_prime - 1.0f / 4.0f * FloatSinhPade54(p1 * 4.0f)));
-	p0 += 0.5f * dt * ((input_lp_t1 - p0 - fb) +
+	p0 += 0.5f * dt_n * ((input_lp_t1 - p0 - fb) +
 		           (input_lp - p0_prime - fb_prime));
 
 	out = p1;
@@ -319,13 +393,14 @@ void SKFilter::filter(float input){
       {
 	float x_k, x_k2;
 	float fb_t = input_bp_t1 + res * p1;
-	float alpha = dt / 2.0f;
+	float alpha = dt_n / 2.0f;
 	float A = p0 + fb_t - p1 - 1.0f / 4.0f * FloatSinhPade54(4.0f * p1) +
 	           p0 / (1.0f + alpha) + alpha / (1.0f + alpha) * (input_lp_t1 - p0 - fb_t + input_lp);
 	float c = 1.0f - (alpha - alpha * alpha /(1.0f + alpha)) * res + alpha;
 	float D_n = p1 + alpha * A + (alpha - alpha * alpha / (1.0f + alpha)) * input_bp;
 
-	x_k = p1;
+	// starting point is extrapolated from the last two solutions
+	x_k = 2.0f * xk_t1 - xk_t2;
 	
 	// newton-raphson
 	for(int ii=0; ii < SKF_MAX_NEWTON_STEPS; ii++) {
@@ -334,13 +409,17 @@ void SKFilter::filter(float input){
 	  
 #ifdef SKF_NEWTON_BREAKING_LIMIT
 	  // breaking limit
-	  if(fabs(x_k2 - x_k) < 1.0e-9f) {
+	  if(fabs(x_k2 - x_k) < SKF_NEWTON_TOLERANCE * (1.0f + fabs(x_k2))) {
 	    x_k = x_k2;
 	    break;
 	  }
 #endif	  
 	  x_k = x_k2;
 	}
+
+	// keep solution history for the next initial guess
+	xk_t2 = xk_t1;
+	xk_t1 = x_k;
 	
 	p1 = x_k;
 	fb = input_bp + res * p1;
@@ -353,18 +432,20 @@ void SKFilter::filter(float input){
     }
 
     // downsampling filter
-    if(oversamplingFactor > 1){
-      out = iir->IIRfilter32(out);
-    }
+    out = oversampler.Decimate<factor>(out);
   }
   
   // set input at t-1
   input_lp_t1 = input_lp;    
   input_bp_t1 = input_bp;    
   input_hp_t1 = input_hp;    
+  
+  // integration rate at t-1
+  dt_t1 = dt;
 }
 #else
-void SKFilter::filter(double input){
+template <SKIntegrationMethod method, int factor>
+void SKFilter::SKFilterKernel(double input){
   // noise term
   double noise;
 
@@ -400,17 +481,28 @@ void SKFilter::filter(double input){
     input_hp = 0.0;
   }
     
+  // oversampling factor
+  const int oversamplingFactor = factor ? factor : oversampler.GetOversamplingFactor();
+
+  // integration rate ramps from the previous host sample
+  // to the current one across the substeps
+  double dt_step = (dt - dt_t1) / (double)(oversamplingFactor);
+  double dt_n = dt_t1;
+
   // integrate filter state
   // with oversampling
   for(int nn = 0; nn < oversamplingFactor; nn++){
+    // ramp integration rate
+    dt_n += dt_step;
+
     // switch integration method
-    switch(integrationMethod){
+    switch(method){
     case SK_SEMI_IMPLICIT_EULER:
       // semi-implicit euler integration
       {
 	fb = input_bp + res * p1;
-	p0 += dt * (input_lp - p0 - fb);
-       	p1 += dt * (p0 + fb - p1 - 1.0 / 4.0 * SinhPade34(p0 * 4.0));
+	p0 += dt_n * (input_lp - p0 - fb);
+       	p1 += dt_n * (p0 + fb - p1 - 1.0 / 4.0 * SinhPade34(p0 * 4.0));
       	out = p1;
       }
       break;
@@ -420,13 +512,13 @@ void SKFilter::filter(double input){
 	double p0_prime, p1_prime, fb_prime;
 	  
 	fb = input_bp_t1 + res * p1;
-	p0_prime = p0 + dt * (input_lp_t1 - p0 - fb);
-       	p1_prime = p1 + dt * (p0 + fb - p1 - 1.0 / 4.0 * SinhPade34(p1 * 4.0));	
+	p0_prime = p0 + dt_n * (input_lp_t1 - p0 - fb);
+       	p1_prime = p1 + dt_n * (p0 + fb - p1 - 1.0 / 4.0 * SinhPade34(p1 * 4.0));	
 	fb_prime = input_bp + res * p1_prime;
 	
-       	p1 += 0.5 * dt * ((p0 + fb - p1 - 1.0 / 4.0 * SinhPade34(p1 * 4.0)) +
+       	p1 += 0.5 * dt_n * ((p0 + fb - p1 - 1.0 / 4.0 * SinhPade34(p1 * 4.0)) +
 		           (p0_prime + fb_prime - p1_prime - 1.0 / 4.0 * SinhPade34(p1 * 4.0)));
-	p0 += 0.5 * dt * ((input_lp_t1 - p0 - fb) +
+	p0 += 0.5 * dt_n * ((input_lp_t1 - p0 - fb) +
 		           (input_lp - p0_prime - fb_prime));
 
 	out = p1;
@@ -437,13 +529,14 @@ void SKFilter::filter(double input){
       {
 	double x_k, x_k2;
 	double fb_t = input_bp_t1 + res * p1;
-	double alpha = dt / 2.0;
+	double alpha = dt_n / 2.0;
 	double A = p0 + fb_t - p1 - 1.0 / 4.0 * SinhPade54(4.0 * p1) +
 	           p0 / (1.0 + alpha) + alpha / (1 + alpha) * (input_lp_t1 - p0 - fb_t + input_lp);
 	double c = 1.0 - (alpha - alpha * alpha / (1.0 + alpha)) * res + alpha;
 	double D_n = p1 + alpha * A + (alpha - alpha * alpha / (1.0 + alpha)) * input_bp;
 
-	x_k = p1;
+	// starting point is extrapolated from the last two solutions
+	x_k = 2.0 * xk_t1 - xk_t2;
 	
 	// newton-raphson
 	for(int ii=0; ii < SKF_MAX_NEWTON_STEPS; ii++) {
@@ -452,13 +545,17 @@ void SKFilter::filter(double input){
 	  
 #ifdef SKF_NEWTON_BREAKING_LIMIT
 	  // breaking limit
-	  if(fabs(x_k2 - x_k) < 1.0e-9) {
+	  if(fabs(x_k2 - x_k) < SKF_NEWTON_TOLERANCE_DOUBLE * (1.0 + fabs(x_k2))) {
 	    x_k = x_k2;
 	    break;
 	  }
 #endif	  
 	  x_k = x_k2;
 	}
+
+	// keep solution history for the next initial guess
+	xk_t2 = xk_t1;
+	xk_t1 = x_k;
 	
 	p1 = x_k;
 	fb = input_bp + res * p1;
@@ -471,18 +568,56 @@ void SKFilter::filter(double input){
     }
 
     // downsampling filter
-    if(oversamplingFactor > 1){
-      out = iir->IIRfilter(out);
-    }
+    out = oversampler.Decimate<factor>(out);
   }
   
   // set input at t-1
   input_lp_t1 = input_lp;    
   input_bp_t1 = input_bp;    
   input_hp_t1 = input_hp;    
+  
+  // integration rate at t-1
+  dt_t1 = dt;
 }
 #endif
 
+template <SKIntegrationMethod method>
+SKFilter::FilterKernel SKFilter::GetFilterKernel(int factor){
+  switch(factor){
+  case 1:
+    return &SKFilter::SKFilterKernel<method, 1>;
+  case 2:
+    return &SKFilter::SKFilterKernel<method, 2>;
+  case 4:
+    return &SKFilter::SKFilterKernel<method, 4>;
+  case 8:
+    return &SKFilter::SKFilterKernel<method, 8>;
+  case 16:
+    return &SKFilter::SKFilterKernel<method, 16>;
+  case 32:
+    return &SKFilter::SKFilterKernel<method, 32>;
+  default:
+    return &SKFilter::SKFilterKernel<method, 0>;
+  }
+}
+
+void SKFilter::SelectFilterKernel(){
+  switch(integrationMethod){
+  case SK_SEMI_IMPLICIT_EULER:
+    filterKernel = GetFilterKernel<SK_SEMI_IMPLICIT_EULER>(oversampler.GetOversamplingFactor());
+    break;
+  case SK_PREDICTOR_CORRECTOR:
+    filterKernel = GetFilterKernel<SK_PREDICTOR_CORRECTOR>(oversampler.GetOversamplingFactor());
+    break;
+  case SK_TRAPEZOIDAL:
+    filterKernel = GetFilterKernel<SK_TRAPEZOIDAL>(oversampler.GetOversamplingFactor());
+    break;
+  default:
+    filterKernel = GetFilterKernel<SK_SEMI_IMPLICIT_EULER>(oversampler.GetOversamplingFactor());
+    break;
+  }
+}
+
 void SKFilter::SetFilterLowpassInput(double input){
   input_lp = input;
 }
@@ -494,3 +629,429 @@ void SKFilter::SetFilterBandpassInput(double input){
 void SKFilter::SetFilterHighpassInput(double input){
   input_hp = input;
 }
+
+#ifdef FLOATDSP
+void SKFilter::ProcessBlock(const float* input, float* output,
+			    const float* cutoff, const float* resonance, int n){
+#else
+void SKFilter::ProcessBlock(const double* input, double* output,
+			    const double* cutoff, const double* resonance, int n){
+#endif
+  for(int ii = 0; ii < n; ii++){
+    // integration rate follows cutoff changes only
+    if(cutoff[ii] != cutoffFrequency){
+      cutoffFrequency = cutoff[ii];
+      SetFilterIntegrationRate();
+    }
+    Resonance = resonance[ii];
+
+    // tick filter state
+    filter(input[ii]);
+    output[ii] = out;
+  }
+}
+
+// constructor
+SKFilterX4::SKFilterX4(float4 newCutoff, float4 newResonance, int newOversamplingFactor,
+		       SKFilterMode newFilterMode, double newSampleRate,
+		       SKIntegrationMethod newIntegrationMethod, int newDecimatorOrder){
+  // initialize filter parameters
+  cutoffFrequency = newCutoff;
+  Resonance = newResonance;
+  filterMode = newFilterMode;
+
+  // set up oversampling
+  oversampler.SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  oversampler.SetSampleRate(newSampleRate);
+  oversampler.SetOversamplingFactor(newOversamplingFactor);
+  oversampler.SetDecimatorOrder(newDecimatorOrder);
+
+  // automatic oversampling starts from x1
+  autoOversampling = (newOversamplingFactor == OVERSAMPLER_AUTO);
+  governor.SetSampleRate(newSampleRate);
+  governor.Reset(oversampler.GetOversamplingFactor());
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+
+  // initialize filter state
+  p0 = p1 = out = Float4(0.0f);
+  xk_t1 = xk_t2 = Float4(0.0f);
+
+  // initialize filter inputs
+  input_lp = input_bp = input_hp = Float4(0.0f);
+  input_lp_t1 = input_bp_t1 = input_hp_t1 = Float4(0.0f);
+  
+  integrationMethod = newIntegrationMethod;
+
+  // select filter kernel
+  SelectFilterKernel();
+}
+
+// default constructor
+SKFilterX4::SKFilterX4(){
+  // initialize filter parameters
+  cutoffFrequency = Float4(0.25f);
+  Resonance = Float4(0.5f);
+  filterMode = SK_LOWPASS_MODE;
+
+  // set up oversampling
+  oversampler.SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  autoOversampling = false;
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+  
+  // initialize filter state
+  p0 = p1 = out = Float4(0.0f);
+  xk_t1 = xk_t2 = Float4(0.0f);
+
+  // initialize filter inputs
+  input_lp = input_bp = input_hp = Float4(0.0f);
+  input_lp_t1 = input_bp_t1 = input_hp_t1 = Float4(0.0f);
+  
+  integrationMethod = SK_TRAPEZOIDAL;
+
+  // select filter kernel
+  SelectFilterKernel();
+}
+
+// default destructor
+SKFilterX4::~SKFilterX4(){
+}
+
+void SKFilterX4::ResetFilterState(){
+  // initialize filter parameters
+  cutoffFrequency = Float4(0.25f);
+  Resonance = Float4(0.5f);
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+  
+  // initialize filter and decimator state
+  ClearFilterState();
+  
+  // wake from sleep
+  sleepDetector.Reset();
+
+  // restart oversampling governor
+  governor.Reset(oversampler.GetOversamplingFactor());
+}
+
+void SKFilterX4::ClearFilterState(){
+  // initialize filter state
+  p0 = p1 = out = Float4(0.0f);
+  xk_t1 = xk_t2 = Float4(0.0f);
+
+  // initialize filter inputs
+  input_lp = input_bp = input_hp = Float4(0.0f);
+  input_lp_t1 = input_bp_t1 = input_hp_t1 = Float4(0.0f);
+  
+  // clear decimator state, the decimator design stays
+  oversampler.ClearState();
+}
+
+void SKFilterX4::EnterSleep(){
+  // stay awake until the filter state has decayed as well
+  float4 level = Float4Max(Float4Abs(p0), Float4Abs(p1));
+  if(Int4Any(level > SLEEP_THRESHOLD)){
+    return;
+  }
+
+  // settle to rest at the current parameters
+  ClearFilterState();
+  dt_t1 = dt;
+
+  sleepDetector.Sleep();
+}
+
+void SKFilterX4::SetFilterCutoff(float4 newCutoff){
+  cutoffFrequency = newCutoff;
+
+  SetFilterIntegrationRate();
+}
+
+void SKFilterX4::SetFilterResonance(float4 newResonance){
+  Resonance = newResonance;
+}
+
+void SKFilterX4::SetFilterControlRamp(float4 newCutoff, float4 newResonance, int steps){
+  float4 dt_start = dt;
+  float4 resonance_start = Resonance;
+
+  // integration rate at the new target
+  cutoffFrequency = newCutoff;
+  SetFilterIntegrationRate();
+  dtTarget = dt;
+  resonanceTarget = newResonance;
+
+  // single step ramps jump to the target
+  if(steps <= 1){
+    Resonance = newResonance;
+    return;
+  }
+  dtIncrement = (dtTarget - dt_start) / (float)(steps);
+  resonanceIncrement = (resonanceTarget - resonance_start) / (float)(steps);
+  dt = dt_start;
+  Resonance = resonance_start;
+  controlRampRemaining = steps;
+}
+
+void SKFilterX4::SetFilterMode(SKFilterMode newFilterMode){
+  filterMode = newFilterMode;
+}
+
+void SKFilterX4::SetFilterSampleRate(double newSampleRate){
+  oversampler.SetSampleRate(newSampleRate);
+  governor.SetSampleRate(newSampleRate);
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+}
+
+void SKFilterX4::SetFilterIntegrationMethod(SKIntegrationMethod method){
+  integrationMethod = method;
+  SelectFilterKernel();
+}
+
+void SKFilterX4::SetFilterOversamplingFactor(int newOversamplingFactor){
+  // automatic oversampling starts from the current factor
+  autoOversampling = (newOversamplingFactor == OVERSAMPLER_AUTO);
+  if(autoOversampling){
+    governor.Reset(oversampler.GetOversamplingFactor());
+    return;
+  }
+
+  SwitchOversamplingFactor(newOversamplingFactor);
+}
+
+void SKFilterX4::SwitchOversamplingFactor(int newOversamplingFactor){
+  oversampler.SetOversamplingFactor(newOversamplingFactor);
+
+  // continue decimation from the current output level, priming
+  // restores the dc steady state only so switching is reduced-glitch
+  oversampler.Prime(out);
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+  SelectFilterKernel();
+}
+
+void SKFilterX4::SetFilterDecimatorOrder(int newDecimatorOrder){
+  oversampler.SetDecimatorOrder(newDecimatorOrder);
+}
+
+void SKFilterX4::SetFilterIntegrationRate(){
+  // normalize cutoff freq to samplerate
+  dt = (float)(oversampler.GetIntegrationRate(1.0)) * cutoffFrequency;
+
+  // clamp integration rate
+  dt = Float4Min(Float4Max(dt, Float4(0.0f)), Float4(0.55f));
+
+  // direct updates stop the control rate ramp
+  controlRampRemaining = 0;
+}
+
+float4 SKFilterX4::GetFilterCutoff(){
+  return cutoffFrequency;
+}
+
+float4 SKFilterX4::GetFilterResonance(){
+  return Resonance;
+}
+
+int SKFilterX4::GetFilterOversamplingFactor(){
+  return oversampler.GetOversamplingFactor();
+}
+
+int SKFilterX4::GetFilterDecimatorOrder(){
+  return oversampler.GetDecimatorOrder();
+}
+
+float4 SKFilterX4::GetFilterOutput(){
+  return out;
+}
+
+SKFilterMode SKFilterX4::GetFilterMode(){
+  return filterMode;
+}
+
+double SKFilterX4::GetFilterSampleRate(){
+  return oversampler.GetSampleRate();
+}
+
+SKIntegrationMethod SKFilterX4::GetFilterIntegrationMethod(){
+  return integrationMethod;
+}
+
+float4 SKFilterX4::GetNormalizedNoiseValue(){
+  return noise.Next();
+}
+
+template <SKIntegrationMethod method, int factor>
+void SKFilterX4::SKFilterKernel(float4 input){
+  // noise term
+  float4 noise;
+
+  // feedback amount variables
+  float4 res = 4.0f * Resonance;
+  float4 fb = Float4(0.0f);
+
+  // update noise terms
+  noise = 1.0e-6f * GetNormalizedNoiseValue();
+
+  input += noise;
+
+  // set filter mode
+  input_lp = input_bp = input_hp = Float4(0.0f);
+  
+  switch(filterMode){
+  case SK_LOWPASS_MODE:
+    input_lp = input;
+    break;
+  case SK_BANDPASS_MODE:
+    input_bp = input;
+    break;
+  case SK_HIGHPASS_MODE:
+    input_hp = input;
+    break;
+  default:
+    break;
+  }
+    
+  // oversampling factor
+  const int oversamplingFactor = factor ? factor : oversampler.GetOversamplingFactor();
+
+  // integration rate ramps from the previous host sample
+  // to the current one across the substeps
+  float4 dt_step = (dt - dt_t1) / (float)(oversamplingFactor);
+  float4 dt_n = dt_t1;
+
+  // integrate filter state
+  // with oversampling
+  for(int nn = 0; nn < oversamplingFactor; nn++){
+    // ramp integration rate
+    dt_n += dt_step;
+
+    // switch integration method
+    switch(method){
+    case SK_SEMI_IMPLICIT_EULER:
+      // semi-implicit euler integration
+      {
+	fb = input_bp + res * p1;
+	p0 += dt_n * (input_lp - p0 - fb);
+       	p1 += dt_n * (p0 + fb - p1 - 1.0f / 4.0f * FloatSinhPade54(p0 * 4.0f));
+      	out = p1;
+      }
+      break;
+    case SK_PREDICTOR_CORRECTOR:
+      // predictor-corrector integration
+      {
+	float4 p0_prime, p1_prime, fb_prime;
+	  
+	fb = input_bp_t1 + res * p1;
+	p0_prime = p0 + dt_n * (input_lp_t1 - p0 - fb);
+       	p1_prime = p1 + dt_n * (p0 + fb - p1 - 1.0f / 4.0f * FloatSinhPade54(p1 * 4.0f));	
+	fb_prime = input_bp + res * p1_prime;
+	
+       	p1 += 0.5f * dt_n * ((p0 + fb - p1 - 1.0f / 4.0f * FloatSinhPade54(p1 * 4.0f)) +
+		           (p0_prime + fb_prime - p1_prime - 1.0f / 4.0f * FloatSinhPade54(p1 * 4.0f)));
+	p0 += 0.5f * dt_n * ((input_lp_t1 - p0 - fb) +
+		           (input_lp - p0_prime - fb_prime));
+
+	out = p1;
+      }
+      break;
+    case SK_TRAPEZOIDAL:
+      // trapezoidal integration
+      {
+	float4 fb_t = input_bp_t1 + res * p1;
+	float4 alpha = dt_n / 2.0f;
+	float4 A = p0 + fb_t - p1 - 1.0f / 4.0f * FloatSinhPade54(4.0f * p1) +
+	            p0 / (1.0f + alpha) + alpha / (1.0f + alpha) * (input_lp_t1 - p0 - fb_t + input_lp);
+	float4 c = 1.0f - (alpha - alpha * alpha /(1.0f + alpha)) * res + alpha;
+	float4 D_n = p1 + alpha * A + (alpha - alpha * alpha / (1.0f + alpha)) * input_bp;
+
+	// lane-masked newton-raphson,
+	// starting point is extrapolated from the last two solutions
+	p1 = NewtonX4([&](float4 x) {
+	    return (c * x + alpha * 1.0f / 4.0f * FloatSinhPade54(4.0f * x) - D_n) / 
+	             (c + alpha * FloatCoshPade54(4.0f * x));
+	  }, 2.0f * xk_t1 - xk_t2, SKF_MAX_NEWTON_STEPS, SKF_NEWTON_TOLERANCE);
+	xk_t2 = xk_t1;
+	xk_t1 = p1;
+	
+	fb = input_bp + res * p1;
+	p0 = p0 / (1.0f + alpha) + alpha / (1.0f + alpha) * (input_lp_t1 - p0 - fb_t + input_lp - fb);
+	out = p1;
+      }
+      break;
+    default:
+      break;
+    }
+
+    // downsampling filter
+    out = oversampler.Decimate<factor>(out);
+  }
+  
+  // set input at t-1
+  input_lp_t1 = input_lp;    
+  input_bp_t1 = input_bp;    
+  input_hp_t1 = input_hp;    
+  
+  // integration rate at t-1
+  dt_t1 = dt;
+}
+
+template <SKIntegrationMethod method>
+SKFilterX4::FilterKernel SKFilterX4::GetFilterKernel(int factor){
+  switch(factor){
+  case 1:
+    return &SKFilterX4::SKFilterKernel<method, 1>;
+  case 2:
+    return &SKFilterX4::SKFilterKernel<method, 2>;
+  case 4:
+    return &SKFilterX4::SKFilterKernel<method, 4>;
+  case 8:
+    return &SKFilterX4::SKFilterKernel<method, 8>;
+  case 16:
+    return &SKFilterX4::SKFilterKernel<method, 16>;
+  case 32:
+    return &SKFilterX4::SKFilterKernel<method, 32>;
+  default:
+    return &SKFilterX4::SKFilterKernel<method, 0>;
+  }
+}
+
+void SKFilterX4::SelectFilterKernel(){
+  switch(integrationMethod){
+  case SK_SEMI_IMPLICIT_EULER:
+    filterKernel = GetFilterKernel<SK_SEMI_IMPLICIT_EULER>(oversampler.GetOversamplingFactor());
+    break;
+  case SK_PREDICTOR_CORRECTOR:
+    filterKernel = GetFilterKernel<SK_PREDICTOR_CORRECTOR>(oversampler.GetOversamplingFactor());
+    break;
+  case SK_TRAPEZOIDAL:
+    filterKernel = GetFilterKernel<SK_TRAPEZOIDAL>(oversampler.GetOversamplingFactor());
+    break;
+  default:
+    filterKernel = GetFilterKernel<SK_SEMI_IMPLICIT_EULER>(oversampler.GetOversamplingFactor());
+    break;
+  }
+}
+
+void SKFilterX4::ProcessBlock(const float4* input, float4* output,
+			      const float4* cutoff, const float4* resonance, int n){
+  for(int ii = 0; ii < n; ii++){
+    // integration rate follows cutoff changes only
+    if(Int4Any(cutoff[ii] != cutoffFrequency)){
+      cutoffFrequency = cutoff[ii];
+      SetFilterIntegrationRate();
+    }
+    Resonance = resonance[ii];
+
+    // tick filter state through sleep and oversampling control
+    filter(input[ii]);
+    output[ii] = out;
+  }
+}
@@ -22,11 +22,9 @@
 #ifndef __dspskfh__
 #define __dspskfh__
 
-#ifdef FLOATDSP
-#include "iir32.h"
-#else
-#include "iir.h"
-#endif
+#include "oversampler.h"
+#include "fastrand.h"
+#include "sleep.h"
 
 // filter modes
 enum SKFilterMode {
@@ -42,6 +40,10 @@ enum SKIntegrationMethod {
    SK_TRAPEZOIDAL
 };
 
+// highest resonance at which silent voices may sleep,
+// self-oscillation starts near 0.64
+#define SKF_SLEEP_MAX_RESONANCE 0.6f
+
 class SKFilter{
 public:
   // constructor/destructor
@@ -54,6 +56,10 @@ public:
   // set filter parameters
   void SetFilterCutoff(double newCutoff);
   void SetFilterResonance(double newResonance);
+
+  // ramp cutoff and resonance to control rate targets over the given
+  // number of samples, the integration rate is computed once per call
+  void SetFilterControlRamp(double newCutoff, double newResonance, int steps);
   void SetFilterMode(SKFilterMode newFilterMode);
   void SetFilterSampleRate(double newSampleRate);
   void SetFilterIntegrationMethod(SKIntegrationMethod method);
@@ -81,9 +87,49 @@ public:
   
   // tick filter state
 #ifdef FLOATDSP
-  void filter(float input);
+  inline void filter(float input){
 #else
-  void filter(double input);
+  inline void filter(double input){
+#endif
+    // step integration rate and resonance along the control rate ramp
+    if(controlRampRemaining > 0){
+      if(--controlRampRemaining){
+	dt += dtIncrement;
+	Resonance += resonanceIncrement;
+      }
+      else{
+	dt = dtTarget;
+	Resonance = resonanceTarget;
+      }
+    }
+    
+    // resonance able to self-oscillate keeps the voice awake
+    bool selfOscillating = Resonance > SKF_SLEEP_MAX_RESONANCE;
+    
+    // silent voice sleeps until input returns
+    if(sleepDetector.Asleep(input, selfOscillating)){
+      return;
+    }
+    
+    // automatic oversampling follows signal and filter state
+    if(autoOversampling && governor.Update(cutoffFrequency, Resonance, input)){
+      SwitchOversamplingFactor(governor.GetOversamplingFactor());
+    }
+    (this->*filterKernel)(input);
+
+    // voice sleeps once input, output and state have decayed
+    if(sleepDetector.Update(input, out, selfOscillating)){
+      EnterSleep();
+    }
+  }
+
+  // process a block with per-sample cutoff and resonance
+#ifdef FLOATDSP
+  void ProcessBlock(const float* input, float* output,
+		    const float* cutoff, const float* resonance, int n);
+#else
+  void ProcessBlock(const double* input, double* output,
+		    const double* cutoff, const double* resonance, int n);
 #endif
   
   // set filter inputs
@@ -105,15 +151,49 @@ private:
   // set integration rate
   void SetFilterIntegrationRate();
 
+  // settle decayed state to rest and put voice to sleep
+  void EnterSleep();
+
+  // clear filter and decimator state, parameters stay
+  void ClearFilterState();
+
+  // filter kernel specialized on integration method and oversampling factor
+#ifdef FLOATDSP
+  typedef void (SKFilter::*FilterKernel)(float input);
+  
+  template <SKIntegrationMethod method, int factor>
+  void SKFilterKernel(float input);
+#else
+  typedef void (SKFilter::*FilterKernel)(double input);
+  
+  template <SKIntegrationMethod method, int factor>
+  void SKFilterKernel(double input);
+#endif
+
+  template <SKIntegrationMethod method>
+  static FilterKernel GetFilterKernel(int factor);
+  
+  // select kernel for current integration method and oversampling factor
+  void SelectFilterKernel();
+
+  // change oversampling factor without restarting the decimator
+  void SwitchOversamplingFactor(int newOversamplingFactor);
+
   // filter parameters
   double cutoffFrequency;
   double Resonance;
   SKFilterMode filterMode;
-  double sampleRate;
   double dt;
+  double dt_t1;
+
+  // control rate ramp
+  double dtTarget;
+  double dtIncrement;
+  double resonanceTarget;
+  double resonanceIncrement;
+  int controlRampRemaining;
   SKIntegrationMethod integrationMethod;
-  int oversamplingFactor;
-  int decimatorOrder;
+  FilterKernel filterKernel;
   
   // filter state
 #ifdef FLOATDSP
@@ -140,6 +220,13 @@ private:
   double input_bp_t1;
   double input_hp_t1;
 #endif
+
+  // newton-raphson solutions at t-1 and t-2
+#ifdef FLOATDSP
+  float xk_t1, xk_t2;
+#else
+  double xk_t1, xk_t2;
+#endif
   
   // filter output
 #ifdef FLOATDSP
@@ -148,12 +235,168 @@ private:
   double out;
 #endif
   
-  // IIR downsampling filter
-#ifdef FLOATDSP
-  IIRLowpass32 *iir;
-#else
-  IIRLowpass *iir;
-#endif
+  // oversampling and decimation
+  Oversampler oversampler;
+
+  // silent voice sleep
+  SleepDetector sleepDetector;
+
+  // automatic oversampling
+  bool autoOversampling;
+  OversamplingGovernor governor;
+};
+
+// four voice sallen-key filter with the state of each
+// voice held in one lane of a SIMD register
+class SKFilterX4{
+public:
+  // constructor/destructor
+  SKFilterX4(float4 newCutoff, float4 newResonance, int newOversamplingFactor,
+	     SKFilterMode newFilterMode, double newSampleRate,
+	     SKIntegrationMethod newIntegrationMethod, int newDecimatorOrder);
+  SKFilterX4();
+  ~SKFilterX4();
+
+  // set filter parameters
+  void SetFilterCutoff(float4 newCutoff);
+  void SetFilterResonance(float4 newResonance);
+
+  // ramp cutoff and resonance to control rate targets over the given
+  // number of samples, the integration rate is computed once per call
+  void SetFilterControlRamp(float4 newCutoff, float4 newResonance, int steps);
+  void SetFilterMode(SKFilterMode newFilterMode);
+  void SetFilterSampleRate(double newSampleRate);
+  void SetFilterIntegrationMethod(SKIntegrationMethod method);
+  void SetFilterOversamplingFactor(int newOversamplingFactor);
+  void SetFilterDecimatorOrder(int decimatorOrder);
+  
+  // get filter parameters
+  float4 GetFilterCutoff();
+  float4 GetFilterResonance();
+  SKFilterMode GetFilterMode();  
+  double GetFilterSampleRate();
+  SKIntegrationMethod GetFilterIntegrationMethod();
+  int GetFilterOversamplingFactor();  
+  int GetFilterDecimatorOrder();
+  
+  // normalized noise
+  float4 GetNormalizedNoiseValue();
+  
+  // thermal noise generator bank
+  NoiseBankX4 noise;
+  
+  // tick filter state
+  inline void filter(float4 input){
+    // step integration rate and resonance along the control rate ramp
+    if(controlRampRemaining > 0){
+      if(--controlRampRemaining){
+	dt += dtIncrement;
+	Resonance += resonanceIncrement;
+      }
+      else{
+	dt = dtTarget;
+	Resonance = resonanceTarget;
+      }
+    }
+    
+    // resonance able to self-oscillate keeps the voices awake
+    bool selfOscillating = Int4Any(Resonance > SKF_SLEEP_MAX_RESONANCE);
+    
+    // silent voices sleep until input returns
+    if(sleepDetector.Asleep(input, selfOscillating)){
+      return;
+    }
+    
+    // automatic oversampling follows signal and filter state
+    if(autoOversampling && governor.Update(cutoffFrequency, Resonance, input)){
+      SwitchOversamplingFactor(governor.GetOversamplingFactor());
+    }
+    (this->*filterKernel)(input);
+
+    // voices sleep once input, output and state have decayed
+    if(sleepDetector.Update(input, out, selfOscillating)){
+      EnterSleep();
+    }
+  }
+
+  // process a block with per-sample cutoff and resonance
+  void ProcessBlock(const float4* input, float4* output,
+		    const float4* cutoff, const float4* resonance, int n);
+  
+  // get filter output
+  float4 GetFilterOutput();
+  
+  // reset state
+  void ResetFilterState();
+  
+private:
+  // set integration rate
+  void SetFilterIntegrationRate();
+
+  // settle decayed state to rest and put voice to sleep
+  void EnterSleep();
+
+  // clear filter and decimator state, parameters stay
+  void ClearFilterState();
+
+  // filter kernel specialized on integration method and oversampling factor
+  typedef void (SKFilterX4::*FilterKernel)(float4 input);
+  
+  template <SKIntegrationMethod method, int factor>
+  void SKFilterKernel(float4 input);
+
+  template <SKIntegrationMethod method>
+  static FilterKernel GetFilterKernel(int factor);
+  
+  // select kernel for current integration method and oversampling factor
+  void SelectFilterKernel();
+
+  // change oversampling factor without restarting the decimator
+  void SwitchOversamplingFactor(int newOversamplingFactor);
+
+  // filter parameters
+  float4 cutoffFrequency;
+  float4 Resonance;
+  SKFilterMode filterMode;
+  float4 dt;
+  float4 dt_t1;
+
+  // control rate ramp
+  float4 dtTarget;
+  float4 dtIncrement;
+  float4 resonanceTarget;
+  float4 resonanceIncrement;
+  int controlRampRemaining;
+  SKIntegrationMethod integrationMethod;
+  FilterKernel filterKernel;
+  
+  // filter state
+  float4 p0;
+  float4 p1;
+  
+  // filter input
+  float4 input_lp;
+  float4 input_bp;
+  float4 input_hp;
+  float4 input_lp_t1;
+  float4 input_bp_t1;
+  float4 input_hp_t1;
+
+  // newton-raphson solutions at t-1 and t-2
+  float4 xk_t1, xk_t2;
+  
+  // filter output
+  float4 out;
+  
+  // oversampling and decimation
+  OversamplerX4 oversampler;
+
+  // silent voice sleep
+  SleepDetectorX4 sleepDetector;
+
+  // automatic oversampling
+  bool autoOversampling;
+  OversamplingGovernorX4 governor;
 };
 
 #endif
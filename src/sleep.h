@@ -0,0 +1,118 @@
+/*
+ *  (C) 2026 Janne Heikkarainen <janne808@radiofreerobotron.net>
+ *
+ *  All rights reserved.
+ *
+ *  This file is part of Kocmoc VCV Rack plugin.
+ *
+ *  Kocmoc VCV Rack plugin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Kocmoc VCV Rack plugin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kocmoc VCV Rack plugin.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __dspsleeph__
+#define __dspsleeph__
+
+#include <cmath>
+
+#include "fastsimd.h"
+
+// input, output and filter state level of a silent voice
+#define SLEEP_THRESHOLD 1.0e-5f
+
+// silent host samples before a voice goes to sleep
+#define SLEEP_HOLD_SAMPLES 4096
+
+// silence tracking of a single voice. the voice goes to sleep
+// once input and output have stayed under the threshold for the
+// hold time and wakes on the first input sample over it
+class SleepDetector{
+public:
+  SleepDetector(){
+    Reset();
+  }
+
+  void Reset(){
+    asleep = false;
+    quietSamples = 0;
+  }
+
+  // returns true while the voice sleeps
+  inline bool Asleep(double input, bool forceAwake = false){
+    if(asleep && (forceAwake || std::fabs(input) > SLEEP_THRESHOLD)){
+      Reset();
+    }
+    return asleep;
+  }
+
+  // returns true once the voice has been silent for the hold time
+  inline bool Update(double input, double output, bool forceAwake = false){
+    if(forceAwake || std::fabs(input) > SLEEP_THRESHOLD || std::fabs(output) > SLEEP_THRESHOLD){
+      quietSamples = 0;
+      return false;
+    }
+    return ++quietSamples >= SLEEP_HOLD_SAMPLES;
+  }
+
+  // put voice to sleep
+  inline void Sleep(){
+    asleep = true;
+    quietSamples = 0;
+  }
+
+private:
+  bool asleep;
+  int quietSamples;
+};
+
+// silence tracking of four voices held in one SIMD register,
+// the voices sleep and wake together
+class SleepDetectorX4{
+public:
+  SleepDetectorX4(){
+    Reset();
+  }
+
+  void Reset(){
+    asleep = false;
+    quietSamples = 0;
+  }
+
+  // returns true while the voices sleep
+  inline bool Asleep(float4 input, bool forceAwake = false){
+    if(asleep && (forceAwake || Int4Any(Float4Abs(input) > SLEEP_THRESHOLD))){
+      Reset();
+    }
+    return asleep;
+  }
+
+  // returns true once all voices have been silent for the hold time
+  inline bool Update(float4 input, float4 output, bool forceAwake = false){
+    if(forceAwake || Int4Any(Float4Max(Float4Abs(input), Float4Abs(output)) > SLEEP_THRESHOLD)){
+      quietSamples = 0;
+      return false;
+    }
+    return ++quietSamples >= SLEEP_HOLD_SAMPLES;
+  }
+
+  // put voices to sleep
+  inline void Sleep(){
+    asleep = true;
+    quietSamples = 0;
+  }
+
+private:
+  bool asleep;
+  int quietSamples;
+};
+
+#endif
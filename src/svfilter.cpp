@@ -24,17 +24,9 @@
 #include <cmath>
 #include "svfilter.h"
 
-#ifdef FLOATDSP
-#include "iir32.h"
-#else
-#include "iir.h"
-#endif
-
 #include "fastmath.h"
 #include "fastrand.h"
-
-// steepness of downsample filter response
-#define IIR_DOWNSAMPLE_ORDER 16
+#include "newton.h"
 
 // downsampling passthrough bandwidth
 #define IIR_DOWNSAMPLING_BANDWIDTH 0.9
@@ -45,6 +37,16 @@
 // check for newton-raphson breaking limit
 #define SVF_NEWTON_BREAKING_LIMIT 1
 
+// newton-raphson step size breaking limit
+// relative to signal level, float and double paths
+#ifdef SVF_NEWTON_BREAKING_LIMIT
+#define SVF_NEWTON_TOLERANCE 1.0e-5f
+#define SVF_NEWTON_TOLERANCE_DOUBLE 1.0e-9
+#else
+#define SVF_NEWTON_TOLERANCE 0.0f
+#define SVF_NEWTON_TOLERANCE_DOUBLE 0.0
+#endif
+
 // damping factor
 #define SVF_BETA_FACTOR 0.0055
 
@@ -56,27 +58,41 @@ SVFilter::SVFilter(double newCutoff, double newResonance, int newOversamplingFac
   cutoffFrequency = newCutoff;
   Resonance = newResonance;
   filterMode = newFilterMode;
-  sampleRate = newSampleRate;
-  oversamplingFactor = newOversamplingFactor;
-  decimatorOrder = newDecimatorOrder;
 
+  // set up oversampling
+  oversampler.SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  oversampler.SetSampleRate(newSampleRate);
+  oversampler.SetOversamplingFactor(newOversamplingFactor);
+  oversampler.SetDecimatorOrder(newDecimatorOrder);
+
+  // set up response decimation
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    responseOversampler[ii].SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+    responseOversampler[ii].SetSampleRate(newSampleRate);
+    responseOversampler[ii].SetOversamplingFactor(newOversamplingFactor);
+    responseOversampler[ii].SetDecimatorOrder(newDecimatorOrder);
+  }
+  responseMask = 0;
+
+  // automatic oversampling starts from x1
+  autoOversampling = (newOversamplingFactor == OVERSAMPLER_AUTO);
+  governor.SetSampleRate(newSampleRate);
+  governor.Reset(oversampler.GetOversamplingFactor());
+  
   SetFilterIntegrationRate();
+  dt_t1 = dt;
 
   // initialize filter state
   hp = bp = lp = out = u_t1 = 0.0f;
+  xk_t1 = xk_t2 = 0.0f;
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    response[ii] = 0.0f;
+  }
   
   integrationMethod = newIntegrationMethod;
-  
-  // instantiate downsampling filter
-#ifdef FLOATDSP
-  iir = new IIRLowpass32(sampleRate * oversamplingFactor,
-		         IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0f,
-		         decimatorOrder);
-#else
-  iir = new IIRLowpass(sampleRate * oversamplingFactor,
-		       IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0,
-		       decimatorOrder);
-#endif
+
+  // select filter kernel
+  SelectFilterKernel();
 
   // instantiate PRNG seed
   s = rand() | 1u;
@@ -88,27 +104,29 @@ SVFilter::SVFilter(){
   cutoffFrequency = 0.25;
   Resonance = 0.5;
   filterMode = SVF_LOWPASS_MODE;
-  sampleRate = 44100.0;
-  oversamplingFactor = 2;
-  decimatorOrder = IIR_DOWNSAMPLE_ORDER;
+
+  // set up oversampling
+  oversampler.SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  autoOversampling = false;
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    responseOversampler[ii].SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  }
+  responseMask = 0;
   
   SetFilterIntegrationRate();
+  dt_t1 = dt;
   
   // initialize filter state
   hp = bp = lp = out = u_t1 = 0.0f;
+  xk_t1 = xk_t2 = 0.0f;
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    response[ii] = 0.0f;
+  }
   
   integrationMethod = SVF_TRAPEZOIDAL;
-  
-  // instantiate downsampling filter
-#ifdef FLOATDSP
-  iir = new IIRLowpass32(sampleRate * oversamplingFactor,
-		         IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0f,
-		         decimatorOrder);
-#else
-  iir = new IIRLowpass(sampleRate * oversamplingFactor,
-		       IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0,
-		       decimatorOrder);
-#endif
+
+  // select filter kernel
+  SelectFilterKernel();
 
   // instantiate PRNG seed
   s = rand() | 1u;
@@ -116,7 +134,6 @@ SVFilter::SVFilter(){
 
 // default destructor
 SVFilter::~SVFilter(){
-  delete iir;
 }
 
 void SVFilter::ResetFilterState(){
@@ -125,14 +142,45 @@ void SVFilter::ResetFilterState(){
   Resonance = 0.5;
 
   SetFilterIntegrationRate();
+  dt_t1 = dt;
+  
+  // initialize filter and decimator state
+  ClearFilterState();
   
+  // wake from sleep
+  sleepDetector.Reset();
+
+  // restart oversampling governor
+  governor.Reset(oversampler.GetOversamplingFactor());
+}
+
+void SVFilter::ClearFilterState(){
   // initialize filter state
   hp = bp = lp = out = u_t1 = 0.0f;
+  xk_t1 = xk_t2 = 0.0f;
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    response[ii] = 0.0f;
+  }
   
-  // set oversampling
-  iir->SetFilterSamplerate(sampleRate * oversamplingFactor);
-  iir->SetFilterCutoff(IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0);
-  iir->SetFilterOrder(decimatorOrder);
+  // clear decimator state, the decimator design stays
+  oversampler.ClearState();
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    responseOversampler[ii].ClearState();
+  }
+}
+
+void SVFilter::EnterSleep(){
+  // stay awake until the filter state has decayed as well
+  if(fabs(lp) > SLEEP_THRESHOLD ||
+     fabs(bp) > SLEEP_THRESHOLD){
+    return;
+  }
+
+  // settle to rest at the current parameters
+  ClearFilterState();
+  dt_t1 = dt;
+
+  sleepDetector.Sleep();
 }
 
 void SVFilter::SetFilterCutoff(double newCutoff){
@@ -145,46 +193,98 @@ void SVFilter::SetFilterResonance(double newResonance){
   Resonance = newResonance;
 }
 
+void SVFilter::SetFilterControlRamp(double newCutoff, double newResonance, int steps){
+  double dt_start = dt;
+  double resonance_start = Resonance;
+
+  // integration rate at the new target
+  cutoffFrequency = newCutoff;
+  SetFilterIntegrationRate();
+  dtTarget = dt;
+  resonanceTarget = newResonance;
+
+  // single step ramps jump to the target
+  if(steps <= 1){
+    Resonance = newResonance;
+    return;
+  }
+  dtIncrement = (dtTarget - dt_start) / (double)(steps);
+  resonanceIncrement = (resonanceTarget - resonance_start) / (double)(steps);
+  dt = dt_start;
+  Resonance = resonance_start;
+  controlRampRemaining = steps;
+}
+
 void SVFilter::SetFilterMode(SVFFilterMode newFilterMode){
   filterMode = newFilterMode;
 }
 
 void SVFilter::SetFilterSampleRate(double newSampleRate){
-  sampleRate = newSampleRate;
-  iir->SetFilterSamplerate(sampleRate * (double)(oversamplingFactor));
-  iir->SetFilterCutoff(IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0);
-  iir->SetFilterOrder(decimatorOrder);
+  oversampler.SetSampleRate(newSampleRate);
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    responseOversampler[ii].SetSampleRate(newSampleRate);
+  }
+  governor.SetSampleRate(newSampleRate);
 
   SetFilterIntegrationRate();
+  dt_t1 = dt;
 }
 
 void SVFilter::SetFilterIntegrationMethod(SVFIntegrationMethod method){
   integrationMethod = method;
   ResetFilterState();
+  SelectFilterKernel();
 }
 
 void SVFilter::SetFilterOversamplingFactor(int newOversamplingFactor){
-  oversamplingFactor = newOversamplingFactor;
-  iir->SetFilterSamplerate(sampleRate * oversamplingFactor);
-  iir->SetFilterCutoff(IIR_DOWNSAMPLING_BANDWIDTH * sampleRate / 2.0);
-  iir->SetFilterOrder(decimatorOrder);
+  // automatic oversampling starts from the current factor
+  autoOversampling = (newOversamplingFactor == OVERSAMPLER_AUTO);
+  if(autoOversampling){
+    governor.Reset(oversampler.GetOversamplingFactor());
+    return;
+  }
+
+  SwitchOversamplingFactor(newOversamplingFactor);
+}
+
+void SVFilter::SwitchOversamplingFactor(int newOversamplingFactor){
+  oversampler.SetOversamplingFactor(newOversamplingFactor);
+
+  // continue decimation from the current output level, priming
+  // restores the dc steady state only so switching is reduced-glitch
+  oversampler.Prime(out);
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    responseOversampler[ii].SetOversamplingFactor(newOversamplingFactor);
+    responseOversampler[ii].Prime(response[ii]);
+  }
 
   SetFilterIntegrationRate();
+  dt_t1 = dt;
+  SelectFilterKernel();
 }
 
 void SVFilter::SetFilterDecimatorOrder(int newDecimatorOrder){
-  decimatorOrder = newDecimatorOrder;
-  iir->SetFilterOrder(decimatorOrder);
+  oversampler.SetDecimatorOrder(newDecimatorOrder);
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    responseOversampler[ii].SetDecimatorOrder(newDecimatorOrder);
+  }
+}
+
+void SVFilter::SetFilterResponseMask(int newResponseMask){
+  responseMask = newResponseMask;
 }
 
 void SVFilter::SetFilterIntegrationRate(){
   // normalize cutoff freq to samplerate
-  dt = 44100.0f / (sampleRate * (double)(oversamplingFactor)) * cutoffFrequency;
+  dt = oversampler.GetIntegrationRate(cutoffFrequency);
 
   // clamp integration rate
   if(dt < 0.0f){
     dt=0.0f;
   }
+
+  // direct updates stop the control rate ramp
+  controlRampRemaining = 0;
 }
 
 double SVFilter::GetFilterCutoff(){
@@ -205,20 +305,34 @@ double SVFilter::GetFilterOutput(){
 }
 #endif
 
+#ifdef FLOATDSP
+float SVFilter::GetFilterResponse(SVFFilterMode filterResponse){
+  return response[filterResponse];
+}
+#else
+double SVFilter::GetFilterResponse(SVFFilterMode filterResponse){
+  return response[filterResponse];
+}
+#endif
+
 SVFFilterMode SVFilter::GetFilterMode(){
   return filterMode;
 }
 
 double SVFilter::GetFilterSampleRate(){
-  return sampleRate;
+  return oversampler.GetSampleRate();
 }
 
 int SVFilter::GetFilterOversamplingFactor(){
-  return oversamplingFactor;
+  return oversampler.GetOversamplingFactor();
 }
 
 int SVFilter::GetFilterDecimatorOrder(){
-  return decimatorOrder;
+  return oversampler.GetDecimatorOrder();
+}
+
+int SVFilter::GetFilterResponseMask(){
+  return responseMask;
 }
 
 SVFIntegrationMethod SVFilter::GetFilterIntegrationMethod(){
@@ -236,14 +350,16 @@ double SVFilter::GetNormalizedNoiseValue(){
 #endif
 
 #ifdef FLOATDSP
-void SVFilter::filter(float input){
+template <SVFIntegrationMethod method, int factor>
+void SVFilter::SVFilterKernel(float input){
   // noise term
   float noise;
 
   // feedback amount variables
   float fb = 1.0f - (3.5f * Resonance);
 
-  // integration rate
+  // integration rate at t-1 and t
+  float dt2_t1 = dt_t1;
   float dt2 = dt;
   
   // update noise terms
@@ -252,52 +368,60 @@ void SVFilter::filter(float input){
   input += noise;
 
   // clamp integration rate
-  switch(integrationMethod){
+  switch(method){
   case SVF_TRAPEZOIDAL:
-    if(dt2 > 0.65f){
-      dt2 = 0.65f;
-    }
+    dt2_t1 = std::fmin(dt2_t1, 0.65f);
+    dt2 = std::fmin(dt2, 0.65f);
     break;
   case SVF_INV_TRAPEZOIDAL:
-    if(dt2 > 1.0f){
-      dt2 = 1.0f;
-    }
+    dt2_t1 = std::fmin(dt2_t1, 1.0f);
+    dt2 = std::fmin(dt2, 1.0f);
     break;
   default:
-    if(dt2 > 0.25f){
-      dt2 = 0.25f;
-    }
+    dt2_t1 = std::fmin(dt2_t1, 0.25f);
+    dt2 = std::fmin(dt2, 0.25f);
     break;
   }
 
+  // oversampling factor
+  const int oversamplingFactor = factor ? factor : oversampler.GetOversamplingFactor();
+
+  // integration rate ramps from the previous host sample
+  // to the current one across the substeps
+  float dt_step = (dt2 - dt2_t1) / (float)(oversamplingFactor);
+  float dt_n = dt2_t1;
+
   // integrate filter state
   // with oversampling
   for(int nn = 0; nn < oversamplingFactor; nn++){
+    // ramp integration rate
+    dt_n += dt_step;
+
     // switch integration method
-    switch(integrationMethod){
+    switch(method){
     case SVF_SEMI_IMPLICIT_EULER:
       {
 	// loss factor
 	float beta = 1.0f - (SVF_BETA_FACTOR / oversamplingFactor);
 
        	hp = input - lp - fb * bp - FloatSinhPade54(bp);
-	bp += dt2 * hp;
+	bp += dt_n * hp;
 	bp *= beta;
-	lp += dt2 * bp;
+	lp += dt_n * bp;
       }
       break;
     case SVF_TRAPEZOIDAL:
       // trapezoidal integration
       {
-	float alpha = dt2 / 2.0f;
+	float alpha = dt_n / 2.0f;
 	float beta = 1.0f - (SVF_BETA_FACTOR / oversamplingFactor);
-	float alpha2 = dt2 * dt2 / 4.0f + fb * alpha;
-	float D_t = (1.0f - dt2 * dt2 /4.0f) * bp +
+	float alpha2 = dt_n * dt_n / 4.0f + fb * alpha;
+	float D_t = (1.0f - dt_n * dt_n /4.0f) * bp +
 	             alpha * (u_t1 + input - 2.0f * lp - fb * bp - FloatSinhPade54(bp));
 	float x_k, x_k2;
 
-	// starting point is last output
-	x_k = bp;
+	// starting point is extrapolated from the last two solutions
+	x_k = 2.0f * xk_t1 - xk_t2;
 	
 	// newton-raphson
 	for(int ii=0; ii < SVF_MAX_NEWTON_STEPS; ii++) {
@@ -306,7 +430,7 @@ void SVFilter::filter(float input){
 
 #ifdef SVF_NEWTON_BREAKING_LIMIT
 	  // breaking limit
-	  if(fabs(x_k2 - x_k) < 1.0e-9f) {
+	  if(fabs(x_k2 - x_k) < SVF_NEWTON_TOLERANCE * (1.0f + fabs(x_k2))) {
 	    x_k = x_k2;
 	    break;
 	  }
@@ -314,6 +438,10 @@ void SVFilter::filter(float input){
 	  x_k = x_k2;
 	}
 
+	// keep solution history for the next initial guess
+	xk_t2 = xk_t1;
+	xk_t1 = x_k;
+
 	lp += alpha * bp;
 	bp = beta * x_k;
 	lp += alpha * bp;
@@ -323,24 +451,26 @@ void SVFilter::filter(float input){
     case SVF_INV_TRAPEZOIDAL:
       // inverse trapezoidal integration
       {
-	float alpha = dt2 / 2.0f;
+	float alpha = dt_n / 2.0f;
 	float beta = 1.0f - (SVF_BETA_FACTOR / oversamplingFactor);
-	float alpha2 = dt2 * dt2 / 4.0f + fb * alpha;
-	float D_t = (1.0f - dt2 * dt2 / 4.0f) * bp +
-	              alpha * (u_t1 + input - 2.0f * lp - fb * bp - sinh(bp));
+	float alpha2 = dt_n * dt_n / 4.0f + fb * alpha;
+	float D_t = (1.0f - dt_n * dt_n / 4.0f) * bp +
+	              alpha * (u_t1 + input - 2.0f * lp - fb * bp - FloatSinh(bp));
 	float y_k, y_k2;
 
-	// starting point is last output
-	y_k = sinh(bp);
+	// starting point is extrapolated from the last two solutions
+	y_k = 2.0f * xk_t1 - xk_t2;
 	
 	// newton-raphson
 	for(int ii=0; ii < SVF_MAX_NEWTON_STEPS; ii++) {
-	  y_k2 = y_k - (alpha * y_k + FloatASinhPade54(y_k) * (1.0f + alpha2) - D_t)/
-	                  (alpha + (1.0f + alpha2) * FloatdASinhPade54(y_k));
+	  float dasinh;
+	  float asinh_y = FloatASinhPade54dASinh(y_k, dasinh);
+	  y_k2 = y_k - (alpha * y_k + asinh_y * (1.0f + alpha2) - D_t)/
+	                  (alpha + (1.0f + alpha2) * dasinh);
 
 #ifdef SVF_NEWTON_BREAKING_LIMIT
 	  // breaking limit
-	  if(fabs(y_k2 - y_k) < 1.0e-9f) {
+	  if(fabs(y_k2 - y_k) < SVF_NEWTON_TOLERANCE * (1.0f + fabs(y_k2))) {
 	    y_k = y_k2;
 	    break;
 	  }
@@ -349,8 +479,12 @@ void SVFilter::filter(float input){
 	  y_k = y_k2;
 	}
 
+	// keep solution history for the next initial guess
+	xk_t2 = xk_t1;
+	xk_t1 = y_k;
+
      	lp += alpha * bp;
-	bp = beta * asinh(y_k);
+	bp = beta * FloatASinh(y_k);
 	lp += alpha * bp;
       	hp = input - lp - fb * bp;
       }
@@ -369,28 +503,46 @@ void SVFilter::filter(float input){
     case SVF_HIGHPASS_MODE:
       out = hp;
       break;
+    case SVF_NOTCH_MODE:
+      // input minus bandpass at unity peak gain
+      out = input - (1.0f + fb) * bp;
+      break;
     default:
       out = 0.0f;
     }
     
     // downsampling filter
-    if(oversamplingFactor > 1){
-      out = iir->IIRfilter32(out);
+    out = oversampler.Decimate<factor>(out);
+
+    // decimate the responses requested by the module
+    if(responseMask){
+      float y[SVF_NUM_RESPONSES] = {lp, bp, hp, input - (1.0f + fb) * bp};
+      
+      for(int rr = 0; rr < SVF_NUM_RESPONSES; rr++){
+	if(responseMask & (1 << rr)){
+	  response[rr] = responseOversampler[rr].Decimate<factor>(y[rr]);
+	}
+      }
     }
   }
   
   // set input at t-1
   u_t1 = input;    
+  
+  // integration rate at t-1
+  dt_t1 = dt;
 }
 #else
-void SVFilter::filter(double input){
+template <SVFIntegrationMethod method, int factor>
+void SVFilter::SVFilterKernel(double input){
   // noise term
   double noise;
 
   // feedback amount variables
   double fb = 1.0 - (3.5 * Resonance);
 
-  // integration rate
+  // integration rate at t-1 and t
+  double dt2_t1 = dt_t1;
   double dt2 = dt;
   
   // update noise terms
@@ -399,52 +551,60 @@ void SVFilter::filter(double input){
   input += noise;
 
   // clamp integration rate
-  switch(integrationMethod){
+  switch(method){
   case SVF_TRAPEZOIDAL:
-    if(dt2 > 0.65){
-      dt2 = 0.65;
-    }
+    dt2_t1 = std::fmin(dt2_t1, 0.65);
+    dt2 = std::fmin(dt2, 0.65);
     break;
   case SVF_INV_TRAPEZOIDAL:
-    if(dt2 > 1.0){
-      dt2 = 1.0;
-    }
+    dt2_t1 = std::fmin(dt2_t1, 1.0);
+    dt2 = std::fmin(dt2, 1.0);
     break;
   default:
-    if(dt2 > 0.25){
-      dt2 = 0.25;
-    }
+    dt2_t1 = std::fmin(dt2_t1, 0.25);
+    dt2 = std::fmin(dt2, 0.25);
     break;
   }
   
+  // oversampling factor
+  const int oversamplingFactor = factor ? factor : oversampler.GetOversamplingFactor();
+
+  // integration rate ramps from the previous host sample
+  // to the current one across the substeps
+  double dt_step = (dt2 - dt2_t1) / (double)(oversamplingFactor);
+  double dt_n = dt2_t1;
+
   // integrate filter state
   // with oversampling
   for(int nn = 0; nn < oversamplingFactor; nn++){
+    // ramp integration rate
+    dt_n += dt_step;
+
     // switch integration method
-    switch(integrationMethod){
+    switch(method){
     case SVF_SEMI_IMPLICIT_EULER:
       {
 	// loss factor
 	double beta = 1.0 - (SVF_BETA_FACTOR / oversamplingFactor);
 
        	hp = input - lp - fb*bp - SinhPade54(bp);
-	bp += dt2 * hp;
+	bp += dt_n * hp;
 	bp *= beta;
-	lp += dt2 * bp;
+	lp += dt_n * bp;
       }
       break;
     case SVF_TRAPEZOIDAL:
       // trapezoidal integration
       {
-	double alpha = dt2 / 2.0;
+	double alpha = dt_n / 2.0;
 	double beta = 1.0 - (SVF_BETA_FACTOR / oversamplingFactor);
-	double alpha2 = dt2 * dt2 / 4.0 + fb * alpha;
-	double D_t = (1.0 - dt2 * dt2 / 4.0) * bp +
+	double alpha2 = dt_n * dt_n / 4.0 + fb * alpha;
+	double D_t = (1.0 - dt_n * dt_n / 4.0) * bp +
 	              alpha * (u_t1 + input - 2.0 * lp - fb * bp - SinhPade54(bp));
 	double x_k, x_k2;
 
-	// starting point is last output
-	x_k = bp;
+	// starting point is extrapolated from the last two solutions
+	x_k = 2.0 * xk_t1 - xk_t2;
 	
 	// newton-raphson
 	for(int ii=0; ii < SVF_MAX_NEWTON_STEPS; ii++) {
@@ -453,7 +613,7 @@ void SVFilter::filter(double input){
 
 #ifdef SVF_NEWTON_BREAKING_LIMIT
 	  // breaking limit
-	  if(fabs(x_k2 - x_k) < 1.0e-9) {
+	  if(fabs(x_k2 - x_k) < SVF_NEWTON_TOLERANCE_DOUBLE * (1.0 + fabs(x_k2))) {
 	    x_k = x_k2;
 	    break;
 	  }
@@ -461,6 +621,10 @@ void SVFilter::filter(double input){
 	  x_k = x_k2;
 	}
 
+	// keep solution history for the next initial guess
+	xk_t2 = xk_t1;
+	xk_t1 = x_k;
+
 	lp += alpha * bp;
 	bp = beta * x_k;
 	lp += alpha * bp;
@@ -470,24 +634,26 @@ void SVFilter::filter(double input){
     case SVF_INV_TRAPEZOIDAL:
       // inverse trapezoidal integration
       {
-	double alpha = dt2 / 2.0;
+	double alpha = dt_n / 2.0;
 	double beta = 1.0 - (SVF_BETA_FACTOR / oversamplingFactor);
-	double alpha2 = dt2 * dt2 / 4.0 + fb * alpha;
-	double D_t = (1.0 - dt2 * dt2 / 4.0) * bp +
-	              alpha * (u_t1 + input - 2.0 * lp - fb * bp - sinh(bp));
+	double alpha2 = dt_n * dt_n / 4.0 + fb * alpha;
+	double D_t = (1.0 - dt_n * dt_n / 4.0) * bp +
+	              alpha * (u_t1 + input - 2.0 * lp - fb * bp - SinhExp(bp));
 	double y_k, y_k2;
 
-	// starting point is last output
-	y_k = sinh(bp);
+	// starting point is extrapolated from the last two solutions
+	y_k = 2.0 * xk_t1 - xk_t2;
 	
 	// newton-raphson
 	for(int ii=0; ii < SVF_MAX_NEWTON_STEPS; ii++) {
-	  y_k2 = y_k - (alpha * y_k + ASinhPade54(y_k) * (1.0 + alpha2) - D_t)/
-	                  (alpha + (1.0 + alpha2) * dASinhPade54(y_k));
+	  double dasinh;
+	  double asinh_y = ASinhPade54dASinh(y_k, dasinh);
+	  y_k2 = y_k - (alpha * y_k + asinh_y * (1.0 + alpha2) - D_t)/
+	                  (alpha + (1.0 + alpha2) * dasinh);
 
 #ifdef SVF_NEWTON_BREAKING_LIMIT
 	  // breaking limit
-	  if(fabs(y_k2 - y_k) < 1.0e-9) {
+	  if(fabs(y_k2 - y_k) < SVF_NEWTON_TOLERANCE_DOUBLE * (1.0 + fabs(y_k2))) {
 	    y_k = y_k2;
 	    break;
 	  }
@@ -496,6 +662,10 @@ void SVFilter::filter(double input){
 	  y_k = y_k2;
 	}
 
+	// keep solution history for the next initial guess
+	xk_t2 = xk_t1;
+	xk_t1 = y_k;
+
      	lp += alpha * bp;
 	bp = beta * asinh(y_k);
 	lp += alpha * bp;
@@ -516,21 +686,77 @@ void SVFilter::filter(double input){
     case SVF_HIGHPASS_MODE:
       out = hp;
       break;
+    case SVF_NOTCH_MODE:
+      // input minus bandpass at unity peak gain
+      out = input - (1.0 + fb) * bp;
+      break;
     default:
       out = 0.0;
     }
     
     // downsampling filter
-    if(oversamplingFactor > 1){
-      out = iir->IIRfilter(out);
+    out = oversampler.Decimate<factor>(out);
+
+    // decimate the responses requested by the module
+    if(responseMask){
+      double y[SVF_NUM_RESPONSES] = {lp, bp, hp, input - (1.0 + fb) * bp};
+      
+      for(int rr = 0; rr < SVF_NUM_RESPONSES; rr++){
+	if(responseMask & (1 << rr)){
+	  response[rr] = responseOversampler[rr].Decimate<factor>(y[rr]);
+	}
+      }
     }
   }
   
   // set input at t-1
   u_t1 = input;    
+  
+  // integration rate at t-1
+  dt_t1 = dt;
 }
 #endif
 
+template <SVFIntegrationMethod method>
+SVFilter::FilterKernel SVFilter::GetFilterKernel(int factor){
+  switch(factor){
+  case 1:
+    return &SVFilter::SVFilterKernel<method, 1>;
+  case 2:
+    return &SVFilter::SVFilterKernel<method, 2>;
+  case 4:
+    return &SVFilter::SVFilterKernel<method, 4>;
+  case 8:
+    return &SVFilter::SVFilterKernel<method, 8>;
+  case 16:
+    return &SVFilter::SVFilterKernel<method, 16>;
+  case 32:
+    return &SVFilter::SVFilterKernel<method, 32>;
+  default:
+    return &SVFilter::SVFilterKernel<method, 0>;
+  }
+}
+
+void SVFilter::SelectFilterKernel(){
+  switch(integrationMethod){
+  case SVF_SEMI_IMPLICIT_EULER:
+    filterKernel = GetFilterKernel<SVF_SEMI_IMPLICIT_EULER>(oversampler.GetOversamplingFactor());
+    break;
+  case SVF_PREDICTOR_CORRECTOR:
+    filterKernel = GetFilterKernel<SVF_PREDICTOR_CORRECTOR>(oversampler.GetOversamplingFactor());
+    break;
+  case SVF_TRAPEZOIDAL:
+    filterKernel = GetFilterKernel<SVF_TRAPEZOIDAL>(oversampler.GetOversamplingFactor());
+    break;
+  case SVF_INV_TRAPEZOIDAL:
+    filterKernel = GetFilterKernel<SVF_INV_TRAPEZOIDAL>(oversampler.GetOversamplingFactor());
+    break;
+  default:
+    filterKernel = GetFilterKernel<SVF_SEMI_IMPLICIT_EULER>(oversampler.GetOversamplingFactor());
+    break;
+  }
+}
+
 double SVFilter::GetFilterLowpass(){
   return lp;
 }
@@ -543,3 +769,506 @@ double SVFilter::GetFilterHighpass(){
   return hp;
 }
 
+
+#ifdef FLOATDSP
+void SVFilter::ProcessBlock(const float* input, float* output,
+			    const float* cutoff, const float* resonance, int n){
+#else
+void SVFilter::ProcessBlock(const double* input, double* output,
+			    const double* cutoff, const double* resonance, int n){
+#endif
+  for(int ii = 0; ii < n; ii++){
+    // integration rate follows cutoff changes only
+    if(cutoff[ii] != cutoffFrequency){
+      cutoffFrequency = cutoff[ii];
+      SetFilterIntegrationRate();
+    }
+    Resonance = resonance[ii];
+
+    // tick filter state
+    filter(input[ii]);
+    output[ii] = out;
+  }
+}
+
+// constructor
+SVFilterX4::SVFilterX4(float4 newCutoff, float4 newResonance, int newOversamplingFactor,
+		       SVFFilterMode newFilterMode, double newSampleRate,
+		       SVFIntegrationMethod newIntegrationMethod, int newDecimatorOrder){
+  // initialize filter parameters
+  cutoffFrequency = newCutoff;
+  Resonance = newResonance;
+  filterMode = newFilterMode;
+
+  // set up oversampling
+  oversampler.SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  oversampler.SetSampleRate(newSampleRate);
+  oversampler.SetOversamplingFactor(newOversamplingFactor);
+  oversampler.SetDecimatorOrder(newDecimatorOrder);
+
+  // set up response decimation
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    responseOversampler[ii].SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+    responseOversampler[ii].SetSampleRate(newSampleRate);
+    responseOversampler[ii].SetOversamplingFactor(newOversamplingFactor);
+    responseOversampler[ii].SetDecimatorOrder(newDecimatorOrder);
+  }
+  responseMask = 0;
+
+  // automatic oversampling starts from x1
+  autoOversampling = (newOversamplingFactor == OVERSAMPLER_AUTO);
+  governor.SetSampleRate(newSampleRate);
+  governor.Reset(oversampler.GetOversamplingFactor());
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+
+  // initialize filter state
+  hp = bp = lp = out = u_t1 = Float4(0.0f);
+  xk_t1 = xk_t2 = Float4(0.0f);
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    response[ii] = Float4(0.0f);
+  }
+  
+  integrationMethod = newIntegrationMethod;
+
+  // select filter kernel
+  SelectFilterKernel();
+}
+
+// default constructor
+SVFilterX4::SVFilterX4(){
+  // initialize filter parameters
+  cutoffFrequency = Float4(0.25f);
+  Resonance = Float4(0.5f);
+  filterMode = SVF_LOWPASS_MODE;
+
+  // set up oversampling
+  oversampler.SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    responseOversampler[ii].SetBandwidth(IIR_DOWNSAMPLING_BANDWIDTH);
+  }
+  responseMask = 0;
+  autoOversampling = false;
+  
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+  
+  // initialize filter state
+  hp = bp = lp = out = u_t1 = Float4(0.0f);
+  xk_t1 = xk_t2 = Float4(0.0f);
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    response[ii] = Float4(0.0f);
+  }
+  
+  integrationMethod = SVF_TRAPEZOIDAL;
+
+  // select filter kernel
+  SelectFilterKernel();
+}
+
+// default destructor
+SVFilterX4::~SVFilterX4(){
+}
+
+void SVFilterX4::ResetFilterState(){
+  // initialize filter parameters
+  cutoffFrequency = Float4(0.25f);
+  Resonance = Float4(0.5f);
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+  
+  // initialize filter and decimator state
+  ClearFilterState();
+  
+  // wake from sleep
+  sleepDetector.Reset();
+
+  // restart oversampling governor
+  governor.Reset(oversampler.GetOversamplingFactor());
+}
+
+void SVFilterX4::ClearFilterState(){
+  // initialize filter state
+  hp = bp = lp = out = u_t1 = Float4(0.0f);
+  xk_t1 = xk_t2 = Float4(0.0f);
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    response[ii] = Float4(0.0f);
+  }
+  
+  // clear decimator state, the decimator design stays
+  oversampler.ClearState();
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    responseOversampler[ii].ClearState();
+  }
+}
+
+void SVFilterX4::EnterSleep(){
+  // stay awake until the filter state has decayed as well
+  float4 level = Float4Max(Float4Abs(lp), Float4Abs(bp));
+  if(Int4Any(level > SLEEP_THRESHOLD)){
+    return;
+  }
+
+  // settle to rest at the current parameters
+  ClearFilterState();
+  dt_t1 = dt;
+
+  sleepDetector.Sleep();
+}
+
+void SVFilterX4::SetFilterCutoff(float4 newCutoff){
+  cutoffFrequency = newCutoff;
+
+  SetFilterIntegrationRate();
+}
+
+void SVFilterX4::SetFilterResonance(float4 newResonance){
+  Resonance = newResonance;
+}
+
+void SVFilterX4::SetFilterControlRamp(float4 newCutoff, float4 newResonance, int steps){
+  float4 dt_start = dt;
+  float4 resonance_start = Resonance;
+
+  // integration rate at the new target
+  cutoffFrequency = newCutoff;
+  SetFilterIntegrationRate();
+  dtTarget = dt;
+  resonanceTarget = newResonance;
+
+  // single step ramps jump to the target
+  if(steps <= 1){
+    Resonance = newResonance;
+    return;
+  }
+  dtIncrement = (dtTarget - dt_start) / (float)(steps);
+  resonanceIncrement = (resonanceTarget - resonance_start) / (float)(steps);
+  dt = dt_start;
+  Resonance = resonance_start;
+  controlRampRemaining = steps;
+}
+
+void SVFilterX4::SetFilterMode(SVFFilterMode newFilterMode){
+  filterMode = newFilterMode;
+}
+
+void SVFilterX4::SetFilterSampleRate(double newSampleRate){
+  oversampler.SetSampleRate(newSampleRate);
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    responseOversampler[ii].SetSampleRate(newSampleRate);
+  }
+  governor.SetSampleRate(newSampleRate);
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+}
+
+void SVFilterX4::SetFilterIntegrationMethod(SVFIntegrationMethod method){
+  integrationMethod = method;
+  SelectFilterKernel();
+  ResetFilterState();
+}
+
+void SVFilterX4::SetFilterOversamplingFactor(int newOversamplingFactor){
+  // automatic oversampling starts from the current factor
+  autoOversampling = (newOversamplingFactor == OVERSAMPLER_AUTO);
+  if(autoOversampling){
+    governor.Reset(oversampler.GetOversamplingFactor());
+    return;
+  }
+
+  SwitchOversamplingFactor(newOversamplingFactor);
+}
+
+void SVFilterX4::SwitchOversamplingFactor(int newOversamplingFactor){
+  oversampler.SetOversamplingFactor(newOversamplingFactor);
+
+  // continue decimation from the current output level, priming
+  // restores the dc steady state only so switching is reduced-glitch
+  oversampler.Prime(out);
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    responseOversampler[ii].SetOversamplingFactor(newOversamplingFactor);
+    responseOversampler[ii].Prime(response[ii]);
+  }
+
+  SetFilterIntegrationRate();
+  dt_t1 = dt;
+  SelectFilterKernel();
+}
+
+void SVFilterX4::SetFilterDecimatorOrder(int newDecimatorOrder){
+  oversampler.SetDecimatorOrder(newDecimatorOrder);
+  for(int ii = 0; ii < SVF_NUM_RESPONSES; ii++){
+    responseOversampler[ii].SetDecimatorOrder(newDecimatorOrder);
+  }
+}
+
+void SVFilterX4::SetFilterResponseMask(int newResponseMask){
+  responseMask = newResponseMask;
+}
+
+void SVFilterX4::SetFilterIntegrationRate(){
+  // normalize cutoff freq to samplerate
+  dt = (float)(oversampler.GetIntegrationRate(1.0)) * cutoffFrequency;
+
+  // clamp integration rate
+  dt = Float4Max(dt, Float4(0.0f));
+
+  // direct updates stop the control rate ramp
+  controlRampRemaining = 0;
+}
+
+float4 SVFilterX4::GetFilterCutoff(){
+  return cutoffFrequency;
+}
+
+float4 SVFilterX4::GetFilterResonance(){
+  return Resonance;
+}
+
+float4 SVFilterX4::GetFilterOutput(){
+  return out;
+}
+
+float4 SVFilterX4::GetFilterResponse(SVFFilterMode filterResponse){
+  return response[filterResponse];
+}
+
+SVFFilterMode SVFilterX4::GetFilterMode(){
+  return filterMode;
+}
+
+double SVFilterX4::GetFilterSampleRate(){
+  return oversampler.GetSampleRate();
+}
+
+int SVFilterX4::GetFilterOversamplingFactor(){
+  return oversampler.GetOversamplingFactor();
+}
+
+int SVFilterX4::GetFilterDecimatorOrder(){
+  return oversampler.GetDecimatorOrder();
+}
+
+int SVFilterX4::GetFilterResponseMask(){
+  return responseMask;
+}
+
+SVFIntegrationMethod SVFilterX4::GetFilterIntegrationMethod(){
+  return integrationMethod;
+}
+
+float4 SVFilterX4::GetNormalizedNoiseValue(){
+  return noise.Next();
+}
+
+template <SVFIntegrationMethod method, int factor>
+void SVFilterX4::SVFilterKernel(float4 input){
+  // noise term
+  float4 noise;
+
+  // feedback amount variables
+  float4 fb = 1.0f - (3.5f * Resonance);
+
+  // integration rate at t-1 and t
+  float4 dt2_t1 = dt_t1;
+  float4 dt2 = dt;
+  
+  // update noise terms
+  noise = 1.0e-6f * GetNormalizedNoiseValue();
+
+  input += noise;
+
+  // clamp integration rate
+  switch(method){
+  case SVF_TRAPEZOIDAL:
+    dt2_t1 = Float4Min(dt2_t1, Float4(0.65f));
+    dt2 = Float4Min(dt2, Float4(0.65f));
+    break;
+  case SVF_INV_TRAPEZOIDAL:
+    dt2_t1 = Float4Min(dt2_t1, Float4(1.0f));
+    dt2 = Float4Min(dt2, Float4(1.0f));
+    break;
+  default:
+    dt2_t1 = Float4Min(dt2_t1, Float4(0.25f));
+    dt2 = Float4Min(dt2, Float4(0.25f));
+    break;
+  }
+
+  // oversampling factor
+  const int oversamplingFactor = factor ? factor : oversampler.GetOversamplingFactor();
+
+  // loss factor
+  float beta = 1.0f - (SVF_BETA_FACTOR / oversamplingFactor);
+
+  // integration rate ramps from the previous host sample
+  // to the current one across the substeps
+  float4 dt_step = (dt2 - dt2_t1) / (float)(oversamplingFactor);
+  float4 dt_n = dt2_t1;
+
+  // integrate filter state
+  // with oversampling
+  for(int nn = 0; nn < oversamplingFactor; nn++){
+    // ramp integration rate
+    dt_n += dt_step;
+
+    // switch integration method
+    switch(method){
+    case SVF_SEMI_IMPLICIT_EULER:
+      {
+       	hp = input - lp - fb * bp - FloatSinhPade54(bp);
+	bp += dt_n * hp;
+	bp *= beta;
+	lp += dt_n * bp;
+      }
+      break;
+    case SVF_TRAPEZOIDAL:
+      // trapezoidal integration
+      {
+	float4 alpha = dt_n / 2.0f;
+	float4 alpha2 = dt_n * dt_n / 4.0f + fb * alpha;
+	float4 D_t = (1.0f - dt_n * dt_n /4.0f) * bp +
+	              alpha * (u_t1 + input - 2.0f * lp - fb * bp - FloatSinhPade54(bp));
+
+	// lane-masked newton-raphson,
+	// starting point is extrapolated from the last two solutions
+	float4 x_k = NewtonX4([&](float4 x) {
+	    return (x + alpha * FloatSinhPade54(x) + alpha2 * x - D_t) /
+	             (1.0f + alpha * FloatCoshPade54(x) + alpha2);
+	  }, 2.0f * xk_t1 - xk_t2, SVF_MAX_NEWTON_STEPS, SVF_NEWTON_TOLERANCE);
+	xk_t2 = xk_t1;
+	xk_t1 = x_k;
+
+	lp += alpha * bp;
+	bp = beta * x_k;
+	lp += alpha * bp;
+      	hp = input - lp - fb * bp;
+      }
+      break;
+    case SVF_INV_TRAPEZOIDAL:
+      // inverse trapezoidal integration
+      {
+	float4 alpha = dt_n / 2.0f;
+	float4 alpha2 = dt_n * dt_n / 4.0f + fb * alpha;
+	float4 sinh_bp = Float4Sinh(bp);
+	float4 D_t = (1.0f - dt_n * dt_n / 4.0f) * bp +
+	              alpha * (u_t1 + input - 2.0f * lp - fb * bp - sinh_bp);
+
+	// lane-masked newton-raphson,
+	// starting point is extrapolated from the last two solutions
+	float4 y_k = NewtonX4([&](float4 y) {
+	    float4 dasinh;
+	    float4 asinh_y = FloatASinhPade54dASinh(y, dasinh);
+	    return (alpha * y + asinh_y * (1.0f + alpha2) - D_t) /
+	             (alpha + (1.0f + alpha2) * dasinh);
+	  }, 2.0f * xk_t1 - xk_t2, SVF_MAX_NEWTON_STEPS, SVF_NEWTON_TOLERANCE);
+	xk_t2 = xk_t1;
+	xk_t1 = y_k;
+
+     	lp += alpha * bp;
+	bp = beta * Float4ASinh(y_k);
+	lp += alpha * bp;
+      	hp = input - lp - fb * bp;
+      }
+      break;
+    default:
+      break;
+    }
+    
+    switch(filterMode){
+    case SVF_LOWPASS_MODE:
+      out = lp;
+      break;
+    case SVF_BANDPASS_MODE:
+      out = bp;
+      break;
+    case SVF_HIGHPASS_MODE:
+      out = hp;
+      break;
+    case SVF_NOTCH_MODE:
+      // input minus bandpass at unity peak gain
+      out = input - (1.0f + fb) * bp;
+      break;
+    default:
+      out = Float4(0.0f);
+    }
+    
+    // downsampling filter
+    out = oversampler.Decimate<factor>(out);
+
+    // decimate the responses requested by the module
+    if(responseMask){
+      float4 y[SVF_NUM_RESPONSES] = {lp, bp, hp, input - (1.0f + fb) * bp};
+      
+      for(int rr = 0; rr < SVF_NUM_RESPONSES; rr++){
+	if(responseMask & (1 << rr)){
+	  response[rr] = responseOversampler[rr].Decimate<factor>(y[rr]);
+	}
+      }
+    }
+  }
+  
+  // set input at t-1
+  u_t1 = input;    
+  
+  // integration rate at t-1
+  dt_t1 = dt;
+}
+
+template <SVFIntegrationMethod method>
+SVFilterX4::FilterKernel SVFilterX4::GetFilterKernel(int factor){
+  switch(factor){
+  case 1:
+    return &SVFilterX4::SVFilterKernel<method, 1>;
+  case 2:
+    return &SVFilterX4::SVFilterKernel<method, 2>;
+  case 4:
+    return &SVFilterX4::SVFilterKernel<method, 4>;
+  case 8:
+    return &SVFilterX4::SVFilterKernel<method, 8>;
+  case 16:
+    return &SVFilterX4::SVFilterKernel<method, 16>;
+  case 32:
+    return &SVFilterX4::SVFilterKernel<method, 32>;
+  default:
+    return &SVFilterX4::SVFilterKernel<method, 0>;
+  }
+}
+
+void SVFilterX4::SelectFilterKernel(){
+  switch(integrationMethod){
+  case SVF_SEMI_IMPLICIT_EULER:
+    filterKernel = GetFilterKernel<SVF_SEMI_IMPLICIT_EULER>(oversampler.GetOversamplingFactor());
+    break;
+  case SVF_PREDICTOR_CORRECTOR:
+    filterKernel = GetFilterKernel<SVF_PREDICTOR_CORRECTOR>(oversampler.GetOversamplingFactor());
+    break;
+  case SVF_TRAPEZOIDAL:
+    filterKernel = GetFilterKernel<SVF_TRAPEZOIDAL>(oversampler.GetOversamplingFactor());
+    break;
+  case SVF_INV_TRAPEZOIDAL:
+    filterKernel = GetFilterKernel<SVF_INV_TRAPEZOIDAL>(oversampler.GetOversamplingFactor());
+    break;
+  default:
+    filterKernel = GetFilterKernel<SVF_SEMI_IMPLICIT_EULER>(oversampler.GetOversamplingFactor());
+    break;
+  }
+}
+
+void SVFilterX4::ProcessBlock(const float4* input, float4* output,
+			      const float4* cutoff, const float4* resonance, int n){
+  for(int ii = 0; ii < n; ii++){
+    // integration rate follows cutoff changes only
+    if(Int4Any(cutoff[ii] != cutoffFrequency)){
+      cutoffFrequency = cutoff[ii];
+      SetFilterIntegrationRate();
+    }
+    Resonance = resonance[ii];
+
+    // tick filter state through sleep and oversampling control
+    filter(input[ii]);
+    output[ii] = out;
+  }
+}
@@ -22,19 +22,21 @@
 #ifndef __dspsvfh__
 #define __dspsvfh__
 
-#ifdef FLOATDSP
-#include "iir32.h"
-#else
-#include "iir.h"
-#endif
+#include "oversampler.h"
+#include "fastrand.h"
+#include "sleep.h"
 
 // filter modes
 enum SVFFilterMode {
    SVF_LOWPASS_MODE,
    SVF_BANDPASS_MODE,
-   SVF_HIGHPASS_MODE
+   SVF_HIGHPASS_MODE,
+   SVF_NOTCH_MODE
 };
 
+// number of filter responses
+#define SVF_NUM_RESPONSES 4
+
 // integration methods
 enum SVFIntegrationMethod {
    SVF_SEMI_IMPLICIT_EULER,
@@ -43,6 +45,10 @@ enum SVFIntegrationMethod {
    SVF_INV_TRAPEZOIDAL
 };
 
+// highest resonance at which silent voices may sleep,
+// self-oscillation starts near 0.57
+#define SVF_SLEEP_MAX_RESONANCE 0.5f
+
 class SVFilter{
 public:
   // constructor/destructor
@@ -55,11 +61,16 @@ public:
   // set filter parameters
   void SetFilterCutoff(double newCutoff);
   void SetFilterResonance(double newResonance);
+
+  // ramp cutoff and resonance to control rate targets over the given
+  // number of samples, the integration rate is computed once per call
+  void SetFilterControlRamp(double newCutoff, double newResonance, int steps);
   void SetFilterMode(SVFFilterMode newFilterMode);
   void SetFilterSampleRate(double newSampleRate);
   void SetFilterIntegrationMethod(SVFIntegrationMethod method);
   void SetFilterOversamplingFactor(int newOversamplingFactor);
   void SetFilterDecimatorOrder(int decimatorOrder);
+  void SetFilterResponseMask(int newResponseMask);
     
   // get filter parameters
   double GetFilterCutoff();
@@ -69,6 +80,7 @@ public:
   SVFIntegrationMethod GetFilterIntegrationMethod();
   int GetFilterOversamplingFactor();  
   int GetFilterDecimatorOrder();
+  int GetFilterResponseMask();
   
   // normalized noise
 #ifdef FLOATDSP
@@ -82,9 +94,49 @@ public:
   
   // tick filter state
 #ifdef FLOATDSP
-  void filter(float input);
+  inline void filter(float input){
 #else
-  void filter(double input);
+  inline void filter(double input){
+#endif
+    // step integration rate and resonance along the control rate ramp
+    if(controlRampRemaining > 0){
+      if(--controlRampRemaining){
+	dt += dtIncrement;
+	Resonance += resonanceIncrement;
+      }
+      else{
+	dt = dtTarget;
+	Resonance = resonanceTarget;
+      }
+    }
+    
+    // resonance able to self-oscillate keeps the voice awake
+    bool selfOscillating = Resonance > SVF_SLEEP_MAX_RESONANCE;
+    
+    // silent voice sleeps until input returns
+    if(sleepDetector.Asleep(input, selfOscillating)){
+      return;
+    }
+    
+    // automatic oversampling follows signal and filter state
+    if(autoOversampling && governor.Update(cutoffFrequency, Resonance, input)){
+      SwitchOversamplingFactor(governor.GetOversamplingFactor());
+    }
+    (this->*filterKernel)(input);
+
+    // voice sleeps once input, output and state have decayed
+    if(sleepDetector.Update(input, out, selfOscillating)){
+      EnterSleep();
+    }
+  }
+
+  // process a block with per-sample cutoff and resonance
+#ifdef FLOATDSP
+  void ProcessBlock(const float* input, float* output,
+		    const float* cutoff, const float* resonance, int n);
+#else
+  void ProcessBlock(const double* input, double* output,
+		    const double* cutoff, const double* resonance, int n);
 #endif
   
   // get filter responses
@@ -98,6 +150,13 @@ public:
 #else
   double GetFilterOutput();
 #endif
+
+  // get decimated filter response
+#ifdef FLOATDSP
+  float GetFilterResponse(SVFFilterMode filterResponse);
+#else
+  double GetFilterResponse(SVFFilterMode filterResponse);
+#endif
   
   // reset state
   void ResetFilterState();
@@ -106,16 +165,50 @@ private:
   // set integration rate
   void SetFilterIntegrationRate();
 
+  // settle decayed state to rest and put voice to sleep
+  void EnterSleep();
+
+  // clear filter and decimator state, parameters stay
+  void ClearFilterState();
+
+  // filter kernel specialized on integration method and oversampling factor
+#ifdef FLOATDSP
+  typedef void (SVFilter::*FilterKernel)(float input);
+  
+  template <SVFIntegrationMethod method, int factor>
+  void SVFilterKernel(float input);
+#else
+  typedef void (SVFilter::*FilterKernel)(double input);
+  
+  template <SVFIntegrationMethod method, int factor>
+  void SVFilterKernel(double input);
+#endif
+
+  template <SVFIntegrationMethod method>
+  static FilterKernel GetFilterKernel(int factor);
+  
+  // select kernel for current integration method and oversampling factor
+  void SelectFilterKernel();
+
+  // change oversampling factor without restarting the decimator
+  void SwitchOversamplingFactor(int newOversamplingFactor);
+
   // pade approximant functions for hyperbolic functions
   // filter parameters
   double cutoffFrequency;
   double Resonance;
   SVFFilterMode filterMode;
   SVFIntegrationMethod integrationMethod;
+  FilterKernel filterKernel;
   double dt;
-  double sampleRate;
-  int oversamplingFactor;
-  int decimatorOrder;
+  double dt_t1;
+
+  // control rate ramp
+  double dtTarget;
+  double dtIncrement;
+  double resonanceTarget;
+  double resonanceIncrement;
+  int controlRampRemaining;
   
   // filter state
 #ifdef FLOATDSP
@@ -129,6 +222,13 @@ private:
   double hp;
   double u_t1;
 #endif
+
+  // newton-raphson solutions at t-1 and t-2
+#ifdef FLOATDSP
+  float xk_t1, xk_t2;
+#else
+  double xk_t1, xk_t2;
+#endif
   
   // filter output
 #ifdef FLOATDSP
@@ -137,12 +237,185 @@ private:
   double out;
 #endif
   
-  // IIR downsampling filter
+  // decimated responses
 #ifdef FLOATDSP
-  IIRLowpass32 *iir;
+  float response[SVF_NUM_RESPONSES];
 #else
-  IIRLowpass *iir;
+  double response[SVF_NUM_RESPONSES];
 #endif
+  
+  // oversampling and decimation
+  Oversampler oversampler;
+
+  // silent voice sleep
+  SleepDetector sleepDetector;
+
+  // response decimation, one bit per requested response
+  int responseMask;
+  Oversampler responseOversampler[SVF_NUM_RESPONSES];
+
+  // automatic oversampling
+  bool autoOversampling;
+  OversamplingGovernor governor;
+};
+
+// four voice state variable filter with the state of each
+// voice held in one lane of a SIMD register
+class SVFilterX4{
+public:
+  // constructor/destructor
+  SVFilterX4(float4 newCutoff, float4 newResonance, int newOversamplingFactor,
+	     SVFFilterMode newFilterMode, double newSampleRate,
+	     SVFIntegrationMethod newIntegrationMethod, int newDecimatorOrder);
+  SVFilterX4();
+  ~SVFilterX4();
+
+  // set filter parameters
+  void SetFilterCutoff(float4 newCutoff);
+  void SetFilterResonance(float4 newResonance);
+
+  // ramp cutoff and resonance to control rate targets over the given
+  // number of samples, the integration rate is computed once per call
+  void SetFilterControlRamp(float4 newCutoff, float4 newResonance, int steps);
+  void SetFilterMode(SVFFilterMode newFilterMode);
+  void SetFilterSampleRate(double newSampleRate);
+  void SetFilterIntegrationMethod(SVFIntegrationMethod method);
+  void SetFilterOversamplingFactor(int newOversamplingFactor);
+  void SetFilterDecimatorOrder(int decimatorOrder);
+  void SetFilterResponseMask(int newResponseMask);
+    
+  // get filter parameters
+  float4 GetFilterCutoff();
+  float4 GetFilterResonance();
+  SVFFilterMode GetFilterMode();  
+  double GetFilterSampleRate();
+  SVFIntegrationMethod GetFilterIntegrationMethod();
+  int GetFilterOversamplingFactor();  
+  int GetFilterDecimatorOrder();
+  int GetFilterResponseMask();
+  
+  // normalized noise
+  float4 GetNormalizedNoiseValue();
+  
+  // thermal noise generator bank
+  NoiseBankX4 noise;
+  
+  // tick filter state
+  inline void filter(float4 input){
+    // step integration rate and resonance along the control rate ramp
+    if(controlRampRemaining > 0){
+      if(--controlRampRemaining){
+	dt += dtIncrement;
+	Resonance += resonanceIncrement;
+      }
+      else{
+	dt = dtTarget;
+	Resonance = resonanceTarget;
+      }
+    }
+    
+    // resonance able to self-oscillate keeps the voices awake
+    bool selfOscillating = Int4Any(Resonance > SVF_SLEEP_MAX_RESONANCE);
+    
+    // silent voices sleep until input returns
+    if(sleepDetector.Asleep(input, selfOscillating)){
+      return;
+    }
+    
+    // automatic oversampling follows signal and filter state
+    if(autoOversampling && governor.Update(cutoffFrequency, Resonance, input)){
+      SwitchOversamplingFactor(governor.GetOversamplingFactor());
+    }
+    (this->*filterKernel)(input);
+
+    // voices sleep once input, output and state have decayed
+    if(sleepDetector.Update(input, out, selfOscillating)){
+      EnterSleep();
+    }
+  }
+
+  // process a block with per-sample cutoff and resonance
+  void ProcessBlock(const float4* input, float4* output,
+		    const float4* cutoff, const float4* resonance, int n);
+  
+  // get filter output
+  float4 GetFilterOutput();
+
+  // get decimated filter response
+  float4 GetFilterResponse(SVFFilterMode filterResponse);
+  
+  // reset state
+  void ResetFilterState();
+  
+private:
+  // set integration rate
+  void SetFilterIntegrationRate();
+
+  // settle decayed state to rest and put voice to sleep
+  void EnterSleep();
+
+  // clear filter and decimator state, parameters stay
+  void ClearFilterState();
+
+  // filter kernel specialized on integration method and oversampling factor
+  typedef void (SVFilterX4::*FilterKernel)(float4 input);
+  
+  template <SVFIntegrationMethod method, int factor>
+  void SVFilterKernel(float4 input);
+
+  template <SVFIntegrationMethod method>
+  static FilterKernel GetFilterKernel(int factor);
+  
+  // select kernel for current integration method and oversampling factor
+  void SelectFilterKernel();
+
+  // change oversampling factor without restarting the decimator
+  void SwitchOversamplingFactor(int newOversamplingFactor);
+
+  // filter parameters
+  float4 cutoffFrequency;
+  float4 Resonance;
+  SVFFilterMode filterMode;
+  SVFIntegrationMethod integrationMethod;
+  FilterKernel filterKernel;
+  float4 dt;
+  float4 dt_t1;
+
+  // control rate ramp
+  float4 dtTarget;
+  float4 dtIncrement;
+  float4 resonanceTarget;
+  float4 resonanceIncrement;
+  int controlRampRemaining;
+  
+  // filter state
+  float4 lp;
+  float4 bp;
+  float4 hp;
+  float4 u_t1;
+
+  // newton-raphson solutions at t-1 and t-2
+  float4 xk_t1, xk_t2;
+  
+  // filter output
+  float4 out;
+  
+  // decimated responses
+  float4 response[SVF_NUM_RESPONSES];
+  
+  // oversampling and decimation
+  OversamplerX4 oversampler;
+
+  // silent voice sleep
+  SleepDetectorX4 sleepDetector;
+
+  // response decimation, one bit per requested response
+  int responseMask;
+  OversamplerX4 responseOversampler[SVF_NUM_RESPONSES];
+
+  // automatic oversampling
+  bool autoOversampling;
+  OversamplingGovernorX4 governor;
 };
 
 #endif
@@ -22,6 +22,7 @@
 #include "plugin.hpp"
 
 #include "fastmath.h"
+#include "sleep.h"
 
 // define integration error compensation factor
 #define ERROR_COMPENSATION_FACTOR 2.f
@@ -29,6 +30,10 @@
 // define integration rate clamping
 #define INTEGRATION_RATE_MAX 0.55f
 
+// highest resonance at which silent voices may sleep,
+// self-oscillation starts near 0.75
+#define SLEEP_MAX_RESONANCE 0.7f
+
 // define oversampling
 #define OVERSAMPLING_FACTOR 2
 
@@ -65,6 +70,15 @@ struct uLADR : Module {
 
   // filter state
   float p0[16], p1[16], p2[16], p3[16];
+
+  // silent voice sleep
+  SleepDetector sleep[16];
+
+  // feedback saturator argument at t-1
+  float xt_1[16];
+
+  // antiderivative antialiased feedback saturator
+  bool _antialiasing = false;
   
   // system samplerate
   float sampleRate;
@@ -88,7 +102,8 @@ struct uLADR : Module {
     
     // reset filter state
     for(int ii=0; ii < 16; ii++) {
-      p0[ii] = p1[ii] = p2[ii] = p3[ii] = 0.f;
+      p0[ii] = p1[ii] = p2[ii] = p3[ii] = xt_1[ii] = 0.f;
+      sleep[ii].Reset();
     }
   }
 
@@ -119,30 +134,50 @@ struct uLADR : Module {
 
     // compute feedback amount
     fb = 5.0f * reso;
+
+    // resonance able to self-oscillate keeps the voices awake
+    bool selfOscillating = reso > SLEEP_MAX_RESONANCE;
+    
+    // with mono or unpatched cv inputs all voices share
+    // the same cutoff, compute it once per sample
+    bool monoCV = inputs[LINCV_INPUT].getChannels() <= 1 && inputs[EXPCV_INPUT].getChannels() <= 1;
+    if(monoCV){
+      cutoff += 2.0f * lincv_atten*inputs[LINCV_INPUT].getVoltage()/10.f;
+      cutoff *= FloatExp2(expcv_atten*inputs[EXPCV_INPUT].getVoltage());
+    }
     
     for(int ii = 0; ii < channels; ii++){      
-      float channelCutoff = cutoff;
+      // scale channel input
+      input = 0.8f * inputs[INPUT_INPUT].getVoltage(ii) * gain;
 
-      // sum in linear cv
-      if(inputs[LINCV_INPUT].getChannels() == 1){
-	channelCutoff += 2.0f * lincv_atten*inputs[LINCV_INPUT].getVoltage() / 10.f;
-      }
-      else{
-	channelCutoff += 2.0f * lincv_atten*inputs[LINCV_INPUT].getVoltage(ii) / 10.f;
+      // silent voice sleeps until input returns
+      if(sleep[ii].Asleep(input, selfOscillating)){
+	outputs[OUTPUT_OUTPUT].setVoltage(0.f, ii);
+	continue;
       }
       
-      // apply exponential cv
-      if(inputs[EXPCV_INPUT].getChannels() == 1){
-	channelCutoff = channelCutoff * std::pow(2.f, expcv_atten*inputs[EXPCV_INPUT].getVoltage());
-      }
-      else{
-	channelCutoff = channelCutoff * std::pow(2.f, expcv_atten*inputs[EXPCV_INPUT].getVoltage(ii));
+      float channelCutoff = cutoff;
+      
+      if(!monoCV){
+	// sum in linear cv
+	if(inputs[LINCV_INPUT].getChannels() == 1){
+	  channelCutoff += 2.0f * lincv_atten*inputs[LINCV_INPUT].getVoltage() / 10.f;
+	}
+	else{
+	  channelCutoff += 2.0f * lincv_atten*inputs[LINCV_INPUT].getVoltage(ii) / 10.f;
+	}
+	
+	// apply exponential cv
+	if(inputs[EXPCV_INPUT].getChannels() == 1){
+	  channelCutoff = channelCutoff * FloatExp2(expcv_atten*inputs[EXPCV_INPUT].getVoltage());
+	}
+	else{
+	  channelCutoff = channelCutoff * FloatExp2(expcv_atten*inputs[EXPCV_INPUT].getVoltage(ii));
+	}
       }
       
       // tick filter state
       // with semi-implicit euler integration
-      input = 0.8f * inputs[INPUT_INPUT].getVoltage(ii) * gain;
-      
       dt = 44100.f / (sampleRate * (float)(OVERSAMPLING_FACTOR)) * channelCutoff;
 
       // clamp integration rate
@@ -156,7 +191,14 @@ struct uLADR : Module {
       
       // integrate with pseudo oversampling
       for(int jj=0; jj < OVERSAMPLING_FACTOR; jj++) {
-	p0[ii] += dt * (FloatTanhPade23(input - error * fb * p3[ii]) - p0[ii]);
+	float x = input - error * fb * p3[ii];
+	if(_antialiasing){
+	  p0[ii] += dt * (FloatTanhPade23ADAA(x, xt_1[ii]) - p0[ii]);
+	}
+	else{
+	  p0[ii] += dt * (FloatTanhPade23(x) - p0[ii]);
+	}
+	xt_1[ii] = x;
 	p1[ii] += dt * (p0[ii] - p1[ii]);
 	p2[ii] += dt * (p1[ii] - p2[ii]);
 	p3[ii] += dt * (p2[ii] - p3[ii]);
@@ -178,6 +220,16 @@ struct uLADR : Module {
       }
       
       outputs[OUTPUT_OUTPUT].setVoltage((float)(12.0f * out), ii);
+
+      // voice sleeps once input, output and state have decayed
+      if(sleep[ii].Update(input, out, selfOscillating) &&
+	 std::fabs(p0[ii]) < SLEEP_THRESHOLD &&
+	 std::fabs(p1[ii]) < SLEEP_THRESHOLD &&
+	 std::fabs(p2[ii]) < SLEEP_THRESHOLD &&
+	 std::fabs(p3[ii]) < SLEEP_THRESHOLD){
+	p0[ii] = p1[ii] = p2[ii] = p3[ii] = xt_1[ii] = 0.f;
+	sleep[ii].Sleep();
+      }
     }
 
     // set output to be polyphonic
@@ -190,7 +242,8 @@ struct uLADR : Module {
     
     // reset filter state
     for(int ii = 0; ii < 16; ii++){    
-      p0[ii] = p1[ii] = p2[ii] = p3[ii] = 0.f;
+      p0[ii] = p1[ii] = p2[ii] = p3[ii] = xt_1[ii] = 0.f;
+      sleep[ii].Reset();
     }
   }
 
@@ -200,7 +253,8 @@ struct uLADR : Module {
     
     // reset filter state
     for(int ii=0; ii < 16; ii++) {
-      p0[ii] = p1[ii] = p2[ii] = p3[ii] = 0.f;
+      p0[ii] = p1[ii] = p2[ii] = p3[ii] = xt_1[ii] = 0.f;
+      sleep[ii].Reset();
     }
   }
 
@@ -210,9 +264,25 @@ struct uLADR : Module {
     
     // reset filter state
     for(int ii=0; ii < 16; ii++) {
-      p0[ii] = p1[ii] = p2[ii] = p3[ii] = 0.f;
+      p0[ii] = p1[ii] = p2[ii] = p3[ii] = xt_1[ii] = 0.f;
+      sleep[ii].Reset();
+    }
+  }
+
+  json_t* dataToJson() override {
+    json_t* rootJ = json_object();
+    
+    json_object_set_new(rootJ, "antialiasing", json_boolean(_antialiasing));
+    
+    return rootJ;
+  }
+
+  void dataFromJson(json_t* rootJ) override {
+    json_t* antialiasingJ = json_object_get(rootJ, "antialiasing");
+    if (antialiasingJ) {
+      _antialiasing = json_is_true(antialiasingJ);
     }
-  }  
+  }
 };
 
 struct uLADRWidget : ModuleWidget {
@@ -240,6 +310,33 @@ struct uLADRWidget : ModuleWidget {
     
     addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(21.681, 104.7)), module, uLADR::OUTPUT_OUTPUT));
   }
+
+  struct AntialiasingMenuItem : MenuItem {
+    uLADR* _module;
+
+    AntialiasingMenuItem(uLADR* module, const char* label)
+      : _module(module)
+    {
+      this->text = label;
+    }
+
+    void onAction(const event::Action& e) override {
+      _module->_antialiasing = !_module->_antialiasing;
+    }
+
+    void step() override {
+      MenuItem::step();
+      rightText = _module->_antialiasing ? "✔" : "";
+    }
+  };
+  
+  void appendContextMenu(Menu* menu) override {
+    uLADR* a = dynamic_cast<uLADR*>(module);
+    assert(a);
+    
+    menu->addChild(new MenuSeparator());
+    menu->addChild(new AntialiasingMenuItem(a, "Antiderivative antialiasing"));
+  }
 };
 
 Model* modeluLADR = createModel<uLADR, uLADRWidget>("uLADR");
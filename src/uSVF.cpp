@@ -22,6 +22,8 @@
 #include "plugin.hpp"
 
 #include "fastmath.h"
+#include "sleep.h"
+#include "paramcache.h"
 
 // define feedback clamping
 #define FEEDBACK_MAX 0.9f
@@ -70,6 +72,13 @@ struct uSVF : Module {
   // filter state
   float hp[16], bp[16], lp[16];
 
+  // silent voice sleep
+  SleepDetector sleep[16];
+
+  // shaped resonance and gain compensation follow their knobs
+  ParamCache resoParam;
+  ParamCache gainCompParam;
+
   // system samplerate
   float sampleRate;
   
@@ -93,6 +102,7 @@ struct uSVF : Module {
     // reset filter state
     for(int ii=0; ii < 16; ii++) {
       hp[ii] = bp[ii] = lp[ii] = 0.f;
+      sleep[ii].Reset();
     }
   }
 
@@ -118,16 +128,20 @@ struct uSVF : Module {
     
     // shape panel input for a pseudoexponential response
     cutoff = 0.001 + 2.25 * (cutoff * cutoff * cutoff * cutoff);
-    reso = 1.475 * std::log(1.0 + reso);
+    reso = resoParam.Get(reso, [](float x){
+	return 1.475 * std::log(1.0 + x);
+      });
     gain *= gain * gain * gain;
     lincv_atten *= lincv_atten*lincv_atten;
     expcv_atten *= expcv_atten*expcv_atten;
     
     // compute gain compensation to normalize output on high drive levels
-    if(gainComp < 0.0) {
-      gainComp = 0.0;
-    }
-    gainComp = 5.0 * (1.0 - 2.0 * std::log(1.0 + 0.925*gainComp));
+    gainComp = gainCompParam.Get(gainComp, [](float x){
+	if(x < 0.0) {
+	  x = 0.0;
+	}
+	return 5.0 * (1.0 - 2.0 * std::log(1.0 + 0.925*x));
+      });
 
     // feedback amount
     fb = 1.f - (float)(reso);
@@ -140,29 +154,46 @@ struct uSVF : Module {
       fb = FEEDBACK_MIN;
     }
 
+    // with mono or unpatched cv inputs all voices share
+    // the same cutoff, compute it once per sample
+    bool monoCV = inputs[LINCV_INPUT].getChannels() <= 1 && inputs[EXPCV_INPUT].getChannels() <= 1;
+    if(monoCV){
+      cutoff += 2.0f * lincv_atten*inputs[LINCV_INPUT].getVoltage()/10.f;
+      cutoff *= FloatExp2(expcv_atten*inputs[EXPCV_INPUT].getVoltage());
+    }
+    
     for(int ii = 0; ii < channels; ii++){      
-      float channelCutoff = cutoff;
-      
-      // sum in linear cv
-      if(inputs[LINCV_INPUT].getChannels() == 1){
-	channelCutoff += 2.0f * lincv_atten*inputs[LINCV_INPUT].getVoltage()/10.f;
-      }
-      else{
-	channelCutoff += 2.0f * lincv_atten*inputs[LINCV_INPUT].getVoltage(ii)/10.f;
+      // scale channel input
+      input = 0.85f * inputs[INPUT_INPUT].getVoltage(ii) * gain;
+
+      // silent voice sleeps until input returns
+      if(sleep[ii].Asleep(input)){
+	outputs[OUTPUT_OUTPUT].setVoltage(0.f, ii);
+	continue;
       }
       
-      // apply exponential cv
-      if(inputs[EXPCV_INPUT].getChannels() == 1){
-	channelCutoff = channelCutoff * std::pow(2.f, expcv_atten*inputs[EXPCV_INPUT].getVoltage());
-      }
-      else{
-	channelCutoff = channelCutoff * std::pow(2.f, expcv_atten*inputs[EXPCV_INPUT].getVoltage(ii));
+      float channelCutoff = cutoff;
+      
+      if(!monoCV){
+	// sum in linear cv
+	if(inputs[LINCV_INPUT].getChannels() == 1){
+	  channelCutoff += 2.0f * lincv_atten*inputs[LINCV_INPUT].getVoltage()/10.f;
+	}
+	else{
+	  channelCutoff += 2.0f * lincv_atten*inputs[LINCV_INPUT].getVoltage(ii)/10.f;
+	}
+	
+	// apply exponential cv
+	if(inputs[EXPCV_INPUT].getChannels() == 1){
+	  channelCutoff = channelCutoff * FloatExp2(expcv_atten*inputs[EXPCV_INPUT].getVoltage());
+	}
+	else{
+	  channelCutoff = channelCutoff * FloatExp2(expcv_atten*inputs[EXPCV_INPUT].getVoltage(ii));
+	}
       }
       
       // tick filter state
       // with semi-implicit euler integration
-      input = 0.85f * inputs[INPUT_INPUT].getVoltage(ii) * gain;
-      
       dt = 44100.f / (sampleRate * (float)(OVERSAMPLING_FACTOR)) * channelCutoff;
 
       // clamp integration rate
@@ -195,6 +226,14 @@ struct uSVF : Module {
       }
       
       outputs[OUTPUT_OUTPUT].setVoltage((float)(2.f * out * gainComp), ii);
+
+      // voice sleeps once input, output and state have decayed
+      if(sleep[ii].Update(input, out) &&
+	 std::fabs(lp[ii]) < SLEEP_THRESHOLD &&
+	 std::fabs(bp[ii]) < SLEEP_THRESHOLD){
+	hp[ii] = bp[ii] = lp[ii] = 0.f;
+	sleep[ii].Sleep();
+      }
     }
 
     // set output to be polyphonic
@@ -212,6 +251,7 @@ struct uSVF : Module {
     // reset filter state
     for(int ii = 0; ii < 16; ii++){    
       hp[ii] = bp[ii] = lp[ii] = 0.f;
+      sleep[ii].Reset();
     }
   }
 
@@ -222,6 +262,7 @@ struct uSVF : Module {
     // reset filter state
     for(int ii=0; ii < 16; ii++) {
       hp[ii] = bp[ii] = lp[ii] = 0.f;
+      sleep[ii].Reset();
     }
   }
 
@@ -232,6 +273,7 @@ struct uSVF : Module {
     // reset filter state
     for(int ii=0; ii < 16; ii++) {
       hp[ii] = bp[ii] = lp[ii] = 0.f;
+      sleep[ii].Reset();
     }
   }  
 };
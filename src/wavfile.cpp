@@ -0,0 +1,289 @@
+/*
+ *  (C) 2026 Janne Heikkarainen <janne808@radiofreerobotron.net>
+ *
+ *  All rights reserved.
+ *
+ *  This file is part of Kocmoc VCV Rack plugin.
+ *
+ *  Kocmoc VCV Rack plugin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Kocmoc VCV Rack plugin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kocmoc VCV Rack plugin.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <cstdint>
+#include "wavfile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// wave format tags
+#define WAV_FORMAT_PCM 0x0001
+#define WAV_FORMAT_IEEE_FLOAT 0x0003
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+
+// little endian field readers
+static inline uint16_t ReadU16(const unsigned char* p){
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t ReadU32(const unsigned char* p){
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// constructor
+WavFile::WavFile(){
+  data = 0;
+  size = 0;
+#ifdef _WIN32
+  fileHandle = INVALID_HANDLE_VALUE;
+  mappingHandle = 0;
+#else
+  fileDescriptor = -1;
+#endif
+  format = channels = bitsPerSample = bytesPerFrame = 0;
+  sampleRate = 0.0;
+  samples = 0;
+  frames = 0;
+}
+
+// destructor
+WavFile::~WavFile(){
+  Close();
+}
+
+bool WavFile::Open(const char* path){
+  Close();
+  
+#ifdef _WIN32
+  // convert utf-8 path to wide characters
+  wchar_t widePath[MAX_PATH];
+  if(!MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath, MAX_PATH)){
+    return false;
+  }
+
+  fileHandle = CreateFileW(widePath, GENERIC_READ, FILE_SHARE_READ, NULL,
+			   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if(fileHandle == INVALID_HANDLE_VALUE){
+    return false;
+  }
+
+  LARGE_INTEGER fileSize;
+  if(!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0){
+    Close();
+    return false;
+  }
+  size = (size_t)fileSize.QuadPart;
+
+  mappingHandle = CreateFileMappingW(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+  if(!mappingHandle){
+    Close();
+    return false;
+  }
+
+  data = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+  if(!data){
+    Close();
+    return false;
+  }
+#else
+  fileDescriptor = open(path, O_RDONLY);
+  if(fileDescriptor < 0){
+    return false;
+  }
+
+  struct stat st;
+  if(fstat(fileDescriptor, &st) < 0 || st.st_size == 0){
+    Close();
+    return false;
+  }
+  size = (size_t)st.st_size;
+
+  void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+  if(p == MAP_FAILED){
+    Close();
+    return false;
+  }
+  data = (const unsigned char*)p;
+#endif
+
+  if(!ParseHeader()){
+    Close();
+    return false;
+  }
+  
+  return true;
+}
+
+void WavFile::Close(){
+#ifdef _WIN32
+  if(data){
+    UnmapViewOfFile(data);
+  }
+  if(mappingHandle){
+    CloseHandle(mappingHandle);
+  }
+  if(fileHandle != INVALID_HANDLE_VALUE){
+    CloseHandle(fileHandle);
+  }
+  fileHandle = INVALID_HANDLE_VALUE;
+  mappingHandle = 0;
+#else
+  if(data){
+    munmap((void*)data, size);
+  }
+  if(fileDescriptor >= 0){
+    close(fileDescriptor);
+  }
+  fileDescriptor = -1;
+#endif
+  data = 0;
+  size = 0;
+  samples = 0;
+  frames = 0;
+}
+
+bool WavFile::ParseHeader(){
+  if(size < 12 || memcmp(data, "RIFF", 4) || memcmp(data + 8, "WAVE", 4)){
+    return false;
+  }
+
+  bool hasFormat = false;
+  size_t offset = 12;
+
+  // walk chunks, padded to even length
+  while(offset + 8 <= size){
+    const unsigned char* chunk = data + offset;
+    size_t chunkSize = ReadU32(chunk + 4);
+    const unsigned char* body = chunk + 8;
+
+    // truncated files keep whatever data is present
+    if(chunkSize > size - offset - 8){
+      chunkSize = size - offset - 8;
+    }
+    
+    if(!memcmp(chunk, "fmt ", 4) && chunkSize >= 16){
+      format = ReadU16(body);
+      channels = ReadU16(body + 2);
+      sampleRate = (double)ReadU32(body + 4);
+      bitsPerSample = ReadU16(body + 14);
+
+      // extensible format carries the actual tag in its subformat guid
+      if(format == WAV_FORMAT_EXTENSIBLE && chunkSize >= 26){
+	format = ReadU16(body + 24);
+      }
+      hasFormat = true;
+    }
+    else if(!memcmp(chunk, "data", 4) && hasFormat){
+      if(channels < 1 || sampleRate <= 0.0){
+	return false;
+      }
+      
+      if(format == WAV_FORMAT_PCM){
+	if(bitsPerSample != 8 && bitsPerSample != 16 && bitsPerSample != 24 && bitsPerSample != 32){
+	  return false;
+	}
+      }
+      else if(format == WAV_FORMAT_IEEE_FLOAT){
+	if(bitsPerSample != 32 && bitsPerSample != 64){
+	  return false;
+	}
+      }
+      else{
+	return false;
+      }
+
+      bytesPerFrame = channels * bitsPerSample / 8;
+      samples = body;
+      frames = (int)(chunkSize / bytesPerFrame);
+      return true;
+    }
+
+    offset += 8 + chunkSize + (chunkSize & 1);
+  }
+
+  return false;
+}
+
+bool WavFile::IsOpen(){
+  return samples != 0;
+}
+
+double WavFile::GetSampleRate(){
+  return sampleRate;
+}
+
+int WavFile::GetChannels(){
+  return channels;
+}
+
+int WavFile::GetFrames(){
+  return frames;
+}
+
+float WavFile::ReadSample(const unsigned char* p){
+  switch(format){
+  case WAV_FORMAT_PCM:
+    switch(bitsPerSample){
+    case 8:
+      return ((float)p[0] - 128.0f) / 128.0f;
+    case 16:
+      return (float)(int16_t)ReadU16(p) / 32768.0f;
+    case 24:
+      return (float)((int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24)) >> 8) / 8388608.0f;
+    default:
+      return (float)((double)(int32_t)ReadU32(p) / 2147483648.0);
+    }
+  case WAV_FORMAT_IEEE_FLOAT:
+    if(bitsPerSample == 32){
+      float f;
+      uint32_t u = ReadU32(p);
+      memcpy(&f, &u, sizeof(f));
+      return f;
+    }
+    else{
+      double d;
+      uint64_t u = (uint64_t)ReadU32(p) | ((uint64_t)ReadU32(p + 4) << 32);
+      memcpy(&d, &u, sizeof(d));
+      return (float)d;
+    }
+  default:
+    return 0.0f;
+  }
+}
+
+int WavFile::ReadMono(float* output, int maxFrames){
+  if(!samples){
+    return 0;
+  }
+  
+  int n = frames < maxFrames ? frames : maxFrames;
+  int bytesPerSample = bitsPerSample / 8;
+  float scale = 1.0f / (float)channels;
+  
+  for(int ii = 0; ii < n; ii++){
+    const unsigned char* frame = samples + (size_t)ii * bytesPerFrame;
+    float sum = 0.0f;
+    for(int ch = 0; ch < channels; ch++){
+      sum += ReadSample(frame + ch * bytesPerSample);
+    }
+    output[ii] = scale * sum;
+  }
+
+  return n;
+}
@@ -0,0 +1,80 @@
+/*
+ *  (C) 2026 Janne Heikkarainen <janne808@radiofreerobotron.net>
+ *
+ *  All rights reserved.
+ *
+ *  This file is part of Kocmoc VCV Rack plugin.
+ *
+ *  Kocmoc VCV Rack plugin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Kocmoc VCV Rack plugin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Kocmoc VCV Rack plugin.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __wavfileh__
+#define __wavfileh__
+
+#include <cstddef>
+
+// read-only memory-mapped RIFF WAVE file, supports 8, 16, 24 and
+// 32 bit integer PCM and 32 and 64 bit floating point samples
+class WavFile{
+public:
+  // constructor/destructor
+  WavFile();
+  ~WavFile();
+
+  // map file and parse header, returns false on failure
+  bool Open(const char* path);
+
+  // unmap file
+  void Close();
+
+  // get sample format
+  bool IsOpen();
+  double GetSampleRate();
+  int GetChannels();
+  int GetFrames();
+
+  // read up to maxFrames frames averaged down to mono,
+  // returns the number of frames read
+  int ReadMono(float* output, int maxFrames);
+  
+private:
+  // find format and data chunks
+  bool ParseHeader();
+
+  // decode sample at byte offset
+  float ReadSample(const unsigned char* p);
+  
+  // mapped file
+  const unsigned char* data;
+  size_t size;
+#ifdef _WIN32
+  void* fileHandle;
+  void* mappingHandle;
+#else
+  int fileDescriptor;
+#endif
+
+  // sample format
+  int format;
+  int channels;
+  int bitsPerSample;
+  int bytesPerFrame;
+  double sampleRate;
+
+  // sample data chunk
+  const unsigned char* samples;
+  int frames;
+};
+
+#endif